@@ -0,0 +1,11 @@
+/*
+    The sketch, built as an ordinary C++ file for the simulator.
+
+    The Arduino build adds a prototype for every function in a .ino; these are the ones the
+    sketch uses before their definitions.
+*/
+#include <Arduino.h>
+
+void ClearMotionFault();
+
+#include "remote_3-2-3.ino"
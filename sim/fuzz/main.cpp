@@ -0,0 +1,712 @@
+/*
+    Remote 3-2-3 fault injection fuzzer
+
+    Runs the firmware against the droid model like the simulator does, but instead of clean
+    transitions it throws a random mix of trouble at it: limit switch glitches and switches
+    stuck open or closed, Sabertooth bytes dropped or held up on the wire, storms of remote
+    presses and web commands, stalled loop passes, and a clock that runs through the millis()
+    wrap. After every loop() pass it checks the rules the control logic must never break:
+
+        limit   No motor is commanded toward a limit switch the firmware reads as closed.
+        kill    Turning transitions off with button A stops both motors and drops the
+                target by the end of the next pass.
+        unknown With every switch open (STANCE_ERROR_ALL_UNKNOWN) nothing moves unless a web
+                move was asked for by hand.
+        enable  Transitions enabled with button A switch themselves off on time.
+
+    Each seed is one scenario, run in its own process so it starts from a freshly booted
+    firmware. A seed that breaks a rule is appended to the failures file, and can be run
+    again on its own with --seed N --verbose, or all together with --replay FILE.
+
+    remote_fuzz [options]
+        --count N       Scenarios to run (200)
+        --seed N        First seed (1); with --count 1, just this one
+        --seconds S     Simulated length of each scenario (60)
+        --failures FILE Where to append failing seeds (fuzz-failures.txt)
+        --replay FILE   Run the seeds listed in FILE instead
+        --verbose       Echo the firmware's log and every injected fault
+*/
+
+#include <Arduino.h>
+#include <vector>
+#include <random>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "stance.h"
+#include "logger.h"
+#include "webconfig.h"
+#include "simhal.h"
+#include "simsabertooth.h"
+#include "simimu.h"
+#include "simdroid.h"
+
+// The sketch
+void setup();
+void loop();
+extern StanceState currentStance;
+extern StanceState StanceTarget;
+extern bool enableRollCodeTransitions;
+extern unsigned long commandEnableTimeout;
+extern int LegUp;
+extern int LegDn;
+extern int TiltUp;
+extern int TiltDn;
+extern WebConfigServer webConfig;
+extern WebMoveActive webMoveActive;
+
+struct Options
+{
+    uint32_t count = 200;
+    uint32_t seed = 1;
+    uint32_t seconds = 60;
+    const char* failures = "fuzz-failures.txt";
+    const char* replay = nullptr;
+    bool verbose = false;
+};
+
+static Options options;
+
+static const uint8_t SWITCH_PINS[4] = { LegUpPin, LegDnPin, TiltUpPin, TiltDnPin };
+static const char* SWITCH_NAMES[4] = { "LegUp", "LegDn", "TiltUp", "TiltDn" };
+static const uint8_t BUTTON_PINS[4] = { ROLLING_CODE_BUTTON_A_PIN, ROLLING_CODE_BUTTON_B_PIN,
+                                        ROLLING_CODE_BUTTON_C_PIN, ROLLING_CODE_BUTTON_D_PIN };
+static const char* WEB_COMMAND_NAMES[] = { "none", "leg up", "leg down", "tilt up", "tilt down",
+                                           "two to three", "three to two", "emergency stop" };
+
+static const uint32_t TRACE_LENGTH = 24;
+static const uint32_t FALL_RECOVERY_MS = 2000;
+
+/*
+    Scenario
+
+    One seed's worth of simulated droid and injected faults. Everything random comes from the
+    one generator, so a seed always plays out the same way.
+*/
+class Scenario
+{
+    public:
+        explicit Scenario(uint32_t seed);
+
+        // Boot the firmware and run until the end or the first broken rule. Returns true if
+        // every rule held.
+        bool Run();
+
+    private:
+        enum SwitchFault
+        {
+            SWITCH_OK = 0,
+            SWITCH_GLITCH,          // Reads the other way for a moment
+            SWITCH_STUCK_OPEN,
+            SWITCH_STUCK_CLOSED
+        };
+
+        struct DelayedByte
+        {
+            uint64_t dueUs;
+            uint8_t c;
+        };
+
+        uint64_t NowUs() const { return SimMicros() - startUs; }
+        bool Chance(float perSecond, uint32_t stepUs) { return Uniform(0.0f, 1.0f) < perSecond * stepUs / 1e6f; }
+        float Uniform(float low, float high) { return std::uniform_real_distribution<float>(low, high)(random); }
+        uint32_t Pick(uint32_t low, uint32_t high) { return std::uniform_int_distribution<uint32_t>(low, high)(random); }
+
+        void Trace(const char* format, ...);
+        bool Fail(const char* rule, const char* format, ...);
+
+        void Link(uint8_t c);
+        void DeliverBytes();
+        void DriveSwitches();
+        void InjectSwitchFaults(uint32_t stepUs);
+        void InjectLinkFaults(uint32_t stepUs);
+        void InjectRemote(uint32_t stepUs);
+        bool InjectWeb(uint32_t stepUs);
+        void ReleaseButtons();
+        uint32_t NextStepUs();
+        bool Check(bool webCommandThisPass);
+
+        uint32_t seed;
+        std::mt19937 random;
+        uint64_t startUs;
+
+        SimDroid droid;
+        SimSabertooth driver;       // What the driver decodes from the wire
+        SimSabertooth commanded;    // What the firmware sent, before the wire got to it
+        SimQmi8658 imu;
+
+        // Wire faults
+        float dropChance;
+        uint32_t delayUs;
+        uint64_t linkFaultUntilUs;
+        std::deque<DelayedByte> wire;
+        uint64_t lastDueUs;
+        uint32_t droppedBytes;
+
+        // Switch faults
+        SwitchFault switchFault[4];
+        uint64_t switchFaultUntilUs[4];
+
+        // Remote and web
+        uint64_t buttonReleaseUs[4];
+        uint64_t stormUntilUs;
+        uint64_t lastAPressUs;
+
+        // Loop timing
+        uint32_t loopUs;
+        uint64_t fallenAtUs;
+
+        // What the last pass looked like, for the edge based rules
+        bool wasEnabled;
+        uint64_t enabledAtUs;
+        bool killPending;
+        uint64_t killAtUs;
+
+        char trace[TRACE_LENGTH][160];
+        uint32_t traceCount;
+};
+
+Scenario::Scenario(uint32_t seed)
+    : seed(seed), random(seed), startUs(0), dropChance(0), delayUs(0), linkFaultUntilUs(0),
+      lastDueUs(0), droppedBytes(0), stormUntilUs(0), lastAPressUs(0), loopUs(1000),
+      fallenAtUs(0), wasEnabled(false), enabledAtUs(0), killPending(false), killAtUs(0),
+      traceCount(0)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        switchFault[i] = SWITCH_OK;
+        switchFaultUntilUs[i] = 0;
+        buttonReleaseUs[i] = 0;
+    }
+}
+
+void Scenario::Trace(const char* format, ...)
+{
+    char text[128];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    char* line = trace[traceCount++ % TRACE_LENGTH];
+    snprintf(line, sizeof(trace[0]), "%9.3f s  millis %10lu  %s", NowUs() / 1e6, millis(), text);
+    if (options.verbose)
+    {
+        printf("# %s\n", line);
+    }
+}
+
+bool Scenario::Fail(const char* rule, const char* format, ...)
+{
+    char text[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    printf("seed %u: %s rule broken at %.3f s (millis %lu): %s\n", seed, rule, NowUs() / 1e6, millis(), text);
+    printf("    stance %s, target %s, enabled %d, web move %d, switches LU%d LD%d TU%d TD%d, power leg %d tilt %d\n",
+           STANCE_NAMES[currentStance], STANCE_NAMES[StanceTarget], enableRollCodeTransitions, webMoveActive,
+           LegUp, LegDn, TiltUp, TiltDn, commanded.Power(1), commanded.Power(2));
+    uint32_t first = traceCount > TRACE_LENGTH ? traceCount - TRACE_LENGTH : 0;
+    if (first < traceCount)
+    {
+        printf("    last events:\n");
+    }
+    for (uint32_t i = first; i < traceCount; i++)
+    {
+        printf("      %s\n", trace[i % TRACE_LENGTH]);
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The wire to the Sabertooth
+
+// Every byte the firmware sends. It always reaches the clean decoder; the driver gets it
+// unless the wire drops it, and in order but possibly late.
+void Scenario::Link(uint8_t c)
+{
+    commanded.Feed(c);
+    if (dropChance > 0 && Uniform(0.0f, 1.0f) < dropChance)
+    {
+        droppedBytes++;
+        return;
+    }
+    uint64_t due = max(SimMicros() + delayUs, lastDueUs);
+    lastDueUs = due;
+    wire.push_back({ due, c });
+}
+
+void Scenario::DeliverBytes()
+{
+    while (!wire.empty() && wire.front().dueUs <= SimMicros())
+    {
+        driver.Feed(wire.front().c);
+        wire.pop_front();
+    }
+
+    // Telemetry replies come back over a clean line.
+    driver.Update(SimMicros());
+    uint8_t c;
+    while (driver.TakeReplyByte(SimMicros(), c))
+    {
+        Serial0.Receive(c);
+    }
+}
+
+void Scenario::InjectLinkFaults(uint32_t stepUs)
+{
+    if (linkFaultUntilUs != 0 && SimMicros() >= linkFaultUntilUs)
+    {
+        linkFaultUntilUs = 0;
+        dropChance = 0;
+        delayUs = 0;
+        Trace("wire clean again (%u bytes dropped so far)", droppedBytes);
+    }
+    if (linkFaultUntilUs == 0 && Chance(0.2f, stepUs))
+    {
+        uint32_t ms = Pick(50, 3000);
+        linkFaultUntilUs = SimMicros() + (uint64_t)ms * 1000;
+        if (Pick(0, 1))
+        {
+            dropChance = Uniform(0.01f, 0.5f);
+            Trace("wire drops %.0f%% of bytes for %u ms", dropChance * 100, ms);
+        }
+        else
+        {
+            delayUs = Pick(1, 300) * 1000;
+            Trace("wire holds bytes %u ms for %u ms", delayUs / 1000, ms);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Limit switches
+
+void Scenario::DriveSwitches()
+{
+    uint8_t closed = droid.Switches();
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        bool isClosed = (closed & (1 << i)) != 0;
+        switch (switchFault[i])
+        {
+            case SWITCH_GLITCH:         isClosed = !isClosed; break;
+            case SWITCH_STUCK_OPEN:     isClosed = false; break;
+            case SWITCH_STUCK_CLOSED:   isClosed = true; break;
+            default:                    break;
+        }
+        if (isClosed)
+        {
+            SimDrivePin(SWITCH_PINS[i], LOW);
+        }
+        else
+        {
+            SimReleasePin(SWITCH_PINS[i]);
+        }
+    }
+}
+
+void Scenario::InjectSwitchFaults(uint32_t stepUs)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (switchFault[i] != SWITCH_OK && SimMicros() >= switchFaultUntilUs[i])
+        {
+            switchFault[i] = SWITCH_OK;
+            Trace("%s switch back to normal", SWITCH_NAMES[i]);
+        }
+        if (switchFault[i] != SWITCH_OK)
+        {
+            continue;
+        }
+        if (Chance(0.5f, stepUs))
+        {
+            uint32_t us = Pick(100, 20000);
+            switchFault[i] = SWITCH_GLITCH;
+            switchFaultUntilUs[i] = SimMicros() + us;
+            Trace("%s switch glitches for %.1f ms", SWITCH_NAMES[i], us / 1000.0f);
+        }
+        else if (Chance(0.03f, stepUs))
+        {
+            uint32_t ms = Pick(500, 15000);
+            switchFault[i] = Pick(0, 1) ? SWITCH_STUCK_OPEN : SWITCH_STUCK_CLOSED;
+            switchFaultUntilUs[i] = SimMicros() + (uint64_t)ms * 1000;
+            Trace("%s switch stuck %s for %u ms", SWITCH_NAMES[i],
+                  switchFault[i] == SWITCH_STUCK_OPEN ? "open" : "closed", ms);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Remote and web page
+
+// Presses come one at a time most of the time, and now and then in a storm of overlapping
+// presses on every button.
+void Scenario::InjectRemote(uint32_t stepUs)
+{
+    if (stormUntilUs == 0 && Chance(0.05f, stepUs))
+    {
+        uint32_t ms = Pick(200, 3000);
+        stormUntilUs = SimMicros() + (uint64_t)ms * 1000;
+        Trace("remote storm for %u ms", ms);
+    }
+    if (stormUntilUs != 0 && SimMicros() >= stormUntilUs)
+    {
+        stormUntilUs = 0;
+    }
+
+    float rate = stormUntilUs != 0 ? 20.0f : 0.3f;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (buttonReleaseUs[i] != 0)
+        {
+            if (SimMicros() >= buttonReleaseUs[i])
+            {
+                SimDrivePin(BUTTON_PINS[i], LOW);
+                buttonReleaseUs[i] = 0;
+            }
+            continue;
+        }
+        if (!Chance(rate, stepUs))
+        {
+            continue;
+        }
+        uint32_t holdMs = Pick(5, 400);
+        SimDrivePin(BUTTON_PINS[i], HIGH);
+        buttonReleaseUs[i] = SimMicros() + (uint64_t)holdMs * 1000;
+        if (i == 0)
+        {
+            lastAPressUs = SimMicros();
+        }
+        Trace("press %c for %u ms", 'A' + i, holdMs);
+    }
+}
+
+void Scenario::ReleaseButtons()
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        SimDrivePin(BUTTON_PINS[i], LOW);
+        buttonReleaseUs[i] = 0;
+    }
+}
+
+// Returns true if a command went in for this pass.
+bool Scenario::InjectWeb(uint32_t stepUs)
+{
+    float rate = stormUntilUs != 0 ? 10.0f : 0.2f;
+    if (!Chance(rate, stepUs))
+    {
+        return false;
+    }
+    WebCommand command = (WebCommand)Pick(WEB_CMD_MOVE_LEG_UP, WEB_CMD_EMERGENCY_STOP);
+    webConfig.pendingCommand = command;
+    Trace("web %s", WEB_COMMAND_NAMES[command]);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Timing
+
+uint32_t Scenario::NextStepUs()
+{
+    // Now and then a pass stalls, as one does behind a slow flash write or a busy web client.
+    if (Pick(0, 999) == 0)
+    {
+        return Pick(20, 300) * 1000;
+    }
+    return (uint32_t)(loopUs * Uniform(0.5f, 1.5f)) + 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The rules
+
+bool Scenario::Check(bool webCommandThisPass)
+{
+    int legPower = commanded.Power(1);
+    int tiltPower = commanded.Power(2);
+
+    // Positive power drives the leg down and the body over onto three legs.
+    if (legPower > 0 && LegDn == LOW)
+    {
+        return Fail("limit", "leg driven down (%d) with LegDn closed", legPower);
+    }
+    if (legPower < 0 && LegUp == LOW)
+    {
+        return Fail("limit", "leg driven up (%d) with LegUp closed", legPower);
+    }
+    if (tiltPower > 0 && TiltDn == LOW)
+    {
+        return Fail("limit", "tilt driven down (%d) with TiltDn closed", tiltPower);
+    }
+    if (tiltPower < 0 && TiltUp == LOW)
+    {
+        return Fail("limit", "tilt driven up (%d) with TiltUp closed", tiltPower);
+    }
+
+    if (currentStance == STANCE_ERROR_ALL_UNKNOWN && webMoveActive == WEB_MOVE_NONE &&
+        (legPower != 0 || tiltPower != 0))
+    {
+        return Fail("unknown", "motors running (leg %d tilt %d) with every switch open", legPower, tiltPower);
+    }
+
+    // Enable and kill. The firmware switches transitions off either on the timeout or when A is
+    // pressed; a press of A in the last moment means it was the kill.
+    uint64_t now = SimMicros();
+    if (!wasEnabled && enableRollCodeTransitions)
+    {
+        enabledAtUs = now;
+        Trace("transitions enabled");
+    }
+    else if (wasEnabled && !enableRollCodeTransitions)
+    {
+        uint64_t enabledMs = (now - enabledAtUs) / 1000;
+        bool pressed = lastAPressUs != 0 && now - lastAPressUs < 500000;
+        Trace("transitions disabled after %llu ms%s", (unsigned long long)enabledMs, pressed ? " (kill)" : "");
+        if (pressed)
+        {
+            killPending = true;
+            killAtUs = now;
+        }
+        else if (enabledMs + 500 < commandEnableTimeout)
+        {
+            return Fail("enable", "transitions switched off after %llu ms, timeout is %lu ms",
+                        (unsigned long long)enabledMs, commandEnableTimeout);
+        }
+    }
+    else if (enableRollCodeTransitions && (now - enabledAtUs) / 1000 > commandEnableTimeout + 500)
+    {
+        return Fail("enable", "transitions still enabled after %llu ms, timeout is %lu ms",
+                    (unsigned long long)((now - enabledAtUs) / 1000), commandEnableTimeout);
+    }
+    wasEnabled = enableRollCodeTransitions;
+
+    // One whole pass after the kill. A web command that went in on that pass may rightly have
+    // started something new, so it lets the kill off.
+    if (killPending && now > killAtUs)
+    {
+        killPending = false;
+        if (webCommandThisPass)
+        {
+            return true;
+        }
+        if (legPower != 0 || tiltPower != 0 || StanceTarget != STANCE_NO_TARGET || webMoveActive != WEB_MOVE_NONE)
+        {
+            return Fail("kill", "still moving after the kill (leg %d tilt %d, target %s, web move %d)",
+                        legPower, tiltPower, STANCE_NAMES[StanceTarget], webMoveActive);
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Scenario::Run()
+{
+    // Half the scenarios start within two minutes of the millis() wrap.
+    if (Pick(0, 1))
+    {
+        uint64_t toWrapMs = Pick(1000, 120000);
+        startUs = ((1ULL << 32) - toWrapMs) * 1000;
+    }
+    else
+    {
+        startUs = (uint64_t)Pick(0, 1000000) * 1000;
+    }
+    SimSetMicros(startUs);
+
+    loopUs = Pick(200, 3000);
+    DroidParams params;
+    params.bounceMs = Uniform(0.0f, 5.0f);
+    droid.Configure(params);
+    droid.Seed(seed);
+    droid.SetSpeedScale(Uniform(0.6f, 1.4f), Uniform(0.6f, 1.4f));
+    droid.Place(Pick(0, 1) ? THREE_LEG_STANCE : TWO_LEG_STANCE);
+
+    SabertoothParams listenOnly;
+    listenOnly.answerGets = false;
+    commanded.Configure(listenOnly);
+    driver.Seed(seed);
+    Serial0.SetSink([this](uint8_t c) { Link(c); });
+    Wire.Attach(SIM_QMI8658_ADDRESS, &imu);
+    ReleaseButtons();
+    DriveSwitches();
+
+    Trace("boot, %u us loop, %s the millis() wrap", loopUs, startUs > (1ULL << 31) * 1000 ? "near" : "far from");
+    setup();
+
+    uint64_t endUs = SimMicros() + (uint64_t)options.seconds * 1000000;
+    while (SimMicros() < endUs)
+    {
+        uint32_t stepUs = NextStepUs();
+        SimAdvance(stepUs);
+        DeliverBytes();
+        droid.Step(stepUs / 1000.0f, driver.Output(1), driver.Output(2));
+
+        // Someone stands him back up and the run carries on.
+        if (droid.Fallen())
+        {
+            if (fallenAtUs == 0)
+            {
+                fallenAtUs = SimMicros();
+                Trace("fell over");
+            }
+            else if (SimMicros() - fallenAtUs >= (uint64_t)FALL_RECOVERY_MS * 1000)
+            {
+                fallenAtUs = 0;
+                droid.Place(Pick(0, 1) ? THREE_LEG_STANCE : TWO_LEG_STANCE);
+                Trace("stood back up");
+            }
+        }
+
+        InjectSwitchFaults(stepUs);
+        InjectLinkFaults(stepUs);
+        InjectRemote(stepUs);
+        bool webCommand = InjectWeb(stepUs);
+        DriveSwitches();
+        imu.SetTilt(droid.TiltDegrees(), droid.TiltRateDps(), 0.01f, 0.2f);
+
+        loop();
+        #ifdef ENABLE_SERIAL_LOG
+            logger.Drain();
+        #endif
+
+        if (!Check(webCommand))
+        {
+            return false;
+        }
+    }
+
+    printf("seed %u: ok, %u packets sent, %u bytes dropped, %u bad packets at the driver\n",
+           seed, commanded.Packets(), droppedBytes, driver.BadPackets());
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Run one seed in a child process so every scenario boots a fresh firmware. Returns true if
+// it passed.
+static bool RunSeed(uint32_t seed)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        exit(2);
+    }
+    if (pid == 0)
+    {
+        if (options.verbose)
+        {
+            Serial.SetSink([](uint8_t c) { fputc(c, stdout); });
+        }
+        Scenario scenario(seed);
+        bool passed = scenario.Run();
+        fflush(stdout);
+        _exit(passed ? 0 : 1);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (WIFSIGNALED(status))
+    {
+        printf("seed %u: crashed with signal %d\n", seed, WTERMSIG(status));
+        return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void SaveFailure(uint32_t seed)
+{
+    FILE* file = fopen(options.failures, "a");
+    if (file == nullptr)
+    {
+        perror(options.failures);
+        return;
+    }
+    fprintf(file, "%u\n", seed);
+    fclose(file);
+}
+
+static bool ParseOptions(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--verbose") == 0)
+        {
+            options.verbose = true;
+            continue;
+        }
+        if (value == nullptr)
+        {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            return false;
+        }
+        i++;
+        if (strcmp(arg, "--count") == 0)         options.count = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--seed") == 0)     options.seed = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--seconds") == 0)  options.seconds = max(1UL, strtoul(value, nullptr, 0));
+        else if (strcmp(arg, "--failures") == 0) options.failures = value;
+        else if (strcmp(arg, "--replay") == 0)   options.replay = value;
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (!ParseOptions(argc, argv))
+    {
+        return 2;
+    }
+
+    std::vector<uint32_t> seeds;
+    if (options.replay)
+    {
+        FILE* file = fopen(options.replay, "r");
+        if (file == nullptr)
+        {
+            perror(options.replay);
+            return 2;
+        }
+        unsigned long seed;
+        while (fscanf(file, "%lu", &seed) == 1)
+        {
+            seeds.push_back((uint32_t)seed);
+        }
+        fclose(file);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < options.count; i++)
+        {
+            seeds.push_back(options.seed + i);
+        }
+    }
+
+    uint32_t failed = 0;
+    for (size_t i = 0; i < seeds.size(); i++)
+    {
+        if (!RunSeed(seeds[i]))
+        {
+            failed++;
+            if (!options.replay)
+            {
+                SaveFailure(seeds[i]);
+            }
+        }
+    }
+
+    printf("%zu scenarios of %u s, %u broke a rule%s%s\n", seeds.size(), options.seconds, failed,
+           failed && !options.replay ? ", seeds added to " : "", failed && !options.replay ? options.failures : "");
+    return failed ? 1 : 0;
+}
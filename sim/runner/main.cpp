@@ -0,0 +1,416 @@
+/*
+    Remote 3-2-3 host simulator
+
+    Runs the firmware's setup() and loop() against a model of the droid, presses the remote
+    buttons to run transition after transition, and reports how long they took and how they
+    failed. Time is simulated, so thousands of transitions take seconds.
+
+    remote_sim [options]
+        --count N       Transitions to run (1000)
+        --seed N        Random seed (1)
+        --loop-us N     Simulated time per loop() pass (1000)
+        --vary PCT      Per transition motor speed spread, +-percent (5)
+        --bounce MS     Limit switch contact bounce (2)
+        --imu-noise G   Accelerometer noise, g (0.01)
+        --gyro-noise D  Gyro noise, degrees per second (0.2)
+        --uart          Pace the Sabertooth port at its baud rate, as the real UART does
+        --tilt-control  Turn on closed loop tilt, which slows the tilt onto its end stops
+        --learn         Turn on 3-to-2 phase learning and report the timing it ends up with
+        --verbose       Echo the firmware's log
+*/
+
+#include <Arduino.h>
+#include <vector>
+#include <chrono>
+#include "config.h"
+#include "stance.h"
+#include "logger.h"
+#include "simhal.h"
+#include "simsabertooth.h"
+#include "simimu.h"
+#include "simdroid.h"
+#include "settings.h"
+#include "phasetuner.h"
+
+// The sketch
+void setup();
+void loop();
+extern StanceState currentStance;
+extern StanceState StanceTarget;
+extern bool enableRollCodeTransitions;
+extern SettingsManager settingsManager;
+extern PhaseTuner phaseTuner;
+
+enum Outcome
+{
+    OUTCOME_OK = 0,
+    OUTCOME_FELL,           // The model went over
+    OUTCOME_FAULT,          // Firmware latched a motion fault
+    OUTCOME_STUCK,          // Neither finished nor failed in time
+    OUTCOME_COUNT
+};
+
+static const char* OUTCOME_NAMES[OUTCOME_COUNT] = { "ok", "fell", "fault", "stuck" };
+
+struct TransitionResult
+{
+    StanceState target;
+    Outcome outcome;
+    uint32_t durationMs;
+    uint8_t finalStance;
+    float legScale;
+    float tiltScale;
+    float tiltArrival;
+};
+
+struct Options
+{
+    uint32_t count = 1000;
+    uint32_t seed = 1;
+    uint32_t loopUs = 1000;
+    float varyPercent = 5.0f;
+    float bounceMs = 2.0f;
+    float imuNoiseG = 0.01f;
+    float gyroNoiseDps = 0.2f;
+    bool uart = false;
+    bool tiltControl = false;
+    bool learn = false;
+    bool verbose = false;
+};
+
+static const uint32_t STUCK_TIMEOUT_MS = 20000;
+static const uint32_t BUTTON_HOLD_MS = 250;
+static const uint32_t SETTLE_MS = 1000;
+
+static Options options;
+static SimSabertooth sabertooth;
+static SimQmi8658 imu;
+static SimDroid droid;
+static uint64_t steppedUs;
+static uint64_t loopPasses;
+
+static const uint8_t SWITCH_PINS[4] = { LegUpPin, LegDnPin, TiltUpPin, TiltDnPin };
+
+// Put the model's switches on the limit switch pins (closed pulls the pin LOW).
+static void DriveSwitches()
+{
+    uint8_t closed = droid.Switches();
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (closed & (1 << i))
+        {
+            SimDrivePin(SWITCH_PINS[i], LOW);
+        }
+        else
+        {
+            SimReleasePin(SWITCH_PINS[i]);
+        }
+    }
+}
+
+// One loop() pass: move time and the droid on, then let the firmware react. With --uart the
+// pass itself can take longer than loopUs, waiting on the Sabertooth port.
+static void Step()
+{
+    SimAdvance(options.loopUs);
+    sabertooth.Service();
+    droid.Step((SimMicros() - steppedUs) / 1000.0f, sabertooth.Output(1), sabertooth.Output(2));
+    steppedUs = SimMicros();
+    DriveSwitches();
+    imu.SetTilt(droid.TiltDegrees(), droid.TiltRateDps(), options.imuNoiseG, options.gyroNoiseDps);
+
+    loop();
+    loopPasses++;
+    #ifdef ENABLE_SERIAL_LOG
+        logger.Drain();
+    #endif
+}
+
+static void RunFor(uint32_t ms)
+{
+    uint64_t until = SimMicros() + (uint64_t)ms * 1000;
+    while (SimMicros() < until)
+    {
+        Step();
+    }
+}
+
+// The receiver output is HIGH while a button is held.
+static void PressButton(uint8_t pin)
+{
+    SimDrivePin(pin, HIGH);
+    RunFor(BUTTON_HOLD_MS);
+    SimDrivePin(pin, LOW);
+    RunFor(BUTTON_HOLD_MS);
+}
+
+static TransitionResult RunTransition(StanceState target, std::mt19937& random)
+{
+    TransitionResult result;
+    result.target = target;
+
+    std::uniform_real_distribution<float> spread(-options.varyPercent / 100.0f, options.varyPercent / 100.0f);
+    result.legScale = 1.0f + spread(random);
+    result.tiltScale = 1.0f + spread(random);
+    droid.SetSpeedScale(result.legScale, result.tiltScale);
+
+    if (!enableRollCodeTransitions)
+    {
+        PressButton(ROLLING_CODE_BUTTON_A_PIN);
+    }
+
+    uint32_t startMs = millis();
+    SimDrivePin(target == THREE_LEG_STANCE ? ROLLING_CODE_BUTTON_B_PIN : ROLLING_CODE_BUTTON_C_PIN, HIGH);
+    bool held = true;
+
+    for (;;)
+    {
+        Step();
+        uint32_t elapsed = millis() - startMs;
+        if (held && elapsed >= BUTTON_HOLD_MS)
+        {
+            SimDrivePin(target == THREE_LEG_STANCE ? ROLLING_CODE_BUTTON_B_PIN : ROLLING_CODE_BUTTON_C_PIN, LOW);
+            held = false;
+        }
+
+        if (droid.Fallen())
+        {
+            result.outcome = OUTCOME_FELL;
+            break;
+        }
+        if (currentStance >= STANCE_ERROR_LEG_NO_RELEASE)
+        {
+            result.outcome = OUTCOME_FAULT;
+            break;
+        }
+        if (!held && currentStance == target && StanceTarget == STANCE_NO_TARGET)
+        {
+            result.outcome = OUTCOME_OK;
+            break;
+        }
+        if (elapsed >= STUCK_TIMEOUT_MS)
+        {
+            result.outcome = OUTCOME_STUCK;
+            break;
+        }
+    }
+
+    result.durationMs = millis() - startMs;
+    result.tiltArrival = droid.TiltArrivalSpeed();
+    result.finalStance = currentStance;
+    if (held)
+    {
+        SimDrivePin(target == THREE_LEG_STANCE ? ROLLING_CODE_BUTTON_B_PIN : ROLLING_CODE_BUTTON_C_PIN, LOW);
+    }
+
+    // After a failure, hit the kill (as you would) and stand him where he was going so the
+    // firmware finds its target and stops. A latched fault clears on the next command.
+    if (result.outcome != OUTCOME_OK)
+    {
+        if (enableRollCodeTransitions)
+        {
+            PressButton(ROLLING_CODE_BUTTON_A_PIN);
+        }
+        droid.Place(target);
+    }
+    RunFor(SETTLE_MS);
+    return result;
+}
+
+static uint32_t Percentile(std::vector<uint32_t> values, float fraction)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(fraction * (values.size() - 1) + 0.5f);
+    return values[index];
+}
+
+static void Report(const std::vector<TransitionResult>& results, double wallSeconds)
+{
+    for (uint8_t t = TWO_LEG_STANCE; t <= THREE_LEG_STANCE; t++)
+    {
+        uint32_t counts[OUTCOME_COUNT] = {};
+        std::vector<uint32_t> durations;
+        std::vector<uint32_t> arrivals;
+        uint32_t total = 0;
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            if (results[i].target != t)
+            {
+                continue;
+            }
+            total++;
+            counts[results[i].outcome]++;
+            if (results[i].outcome == OUTCOME_OK)
+            {
+                durations.push_back(results[i].durationMs);
+                arrivals.push_back((uint32_t)(results[i].tiltArrival * 100.0f + 0.5f));
+            }
+        }
+
+        printf("%s: %u transitions, %u ok, %u fell, %u fault, %u stuck (%.2f%% failed)\n",
+               t == THREE_LEG_STANCE ? "Two to three" : "Three to two", total, counts[OUTCOME_OK],
+               counts[OUTCOME_FELL], counts[OUTCOME_FAULT], counts[OUTCOME_STUCK],
+               total ? 100.0 * (total - counts[OUTCOME_OK]) / total : 0.0);
+        if (!durations.empty())
+        {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < durations.size(); i++)
+            {
+                sum += durations[i];
+            }
+            printf("    duration ms: min %u  mean %u  p50 %u  p95 %u  max %u\n",
+                   Percentile(durations, 0.0f), (uint32_t)(sum / durations.size()),
+                   Percentile(durations, 0.5f), Percentile(durations, 0.95f), Percentile(durations, 1.0f));
+            printf("    tilt speed onto the end stop, %% of full: p50 %u  p95 %u  max %u\n",
+                   Percentile(arrivals, 0.5f), Percentile(arrivals, 0.95f), Percentile(arrivals, 1.0f));
+        }
+    }
+
+    uint32_t listed = 0;
+    for (size_t i = 0; i < results.size() && listed < 20; i++)
+    {
+        const TransitionResult& r = results[i];
+        if (r.outcome == OUTCOME_OK)
+        {
+            continue;
+        }
+        if (listed++ == 0)
+        {
+            printf("Failures:\n");
+        }
+        printf("    #%zu %s: %s after %u ms, stance %s, speed leg %.2f tilt %.2f\n", i + 1,
+               r.target == THREE_LEG_STANCE ? "two to three" : "three to two", OUTCOME_NAMES[r.outcome],
+               r.durationMs, STANCE_NAMES[r.finalStance], r.legScale, r.tiltScale);
+    }
+
+    if (options.learn)
+    {
+        const ControllerSettings& s = settingsManager.settings;
+        const PhaseWindow& h = phaseTuner.HandTuned();
+        printf("Phase learning %s: phase 1 %u-%u, phase 2 %u (hand-tuned %u-%u, %u)\n",
+               phaseTuner.Learning() ? (phaseTuner.Settled() ? "settled" : "on") : "off",
+               s.phase1Start, s.phase1End, s.phase2Start, h.phase1Start, h.phase1End, h.phase2Start);
+    }
+
+    double simSeconds = SimMicros() / 1e6;
+    printf("Simulated %.0f s in %.2f s (%.0fx real time), %.0f loop passes/s\n",
+           simSeconds, wallSeconds, wallSeconds > 0 ? simSeconds / wallSeconds : 0.0, loopPasses / simSeconds);
+    printf("Sabertooth: %u packets (%.0f/s), %u bad, %u GETs, %u answered\n",
+           sabertooth.Packets(), sabertooth.Packets() / simSeconds, sabertooth.BadPackets(),
+           sabertooth.Gets(), sabertooth.Replies());
+}
+
+static bool ParseOptions(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--verbose") == 0)
+        {
+            options.verbose = true;
+            continue;
+        }
+        if (strcmp(arg, "--uart") == 0)
+        {
+            options.uart = true;
+            continue;
+        }
+        if (strcmp(arg, "--tilt-control") == 0)
+        {
+            options.tiltControl = true;
+            continue;
+        }
+        if (strcmp(arg, "--learn") == 0)
+        {
+            options.learn = true;
+            continue;
+        }
+        if (value == nullptr)
+        {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            return false;
+        }
+        i++;
+        if (strcmp(arg, "--count") == 0)          options.count = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--seed") == 0)      options.seed = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--loop-us") == 0)   options.loopUs = max(1UL, strtoul(value, nullptr, 0));
+        else if (strcmp(arg, "--vary") == 0)      options.varyPercent = atof(value);
+        else if (strcmp(arg, "--bounce") == 0)    options.bounceMs = atof(value);
+        else if (strcmp(arg, "--imu-noise") == 0) options.imuNoiseG = atof(value);
+        else if (strcmp(arg, "--gyro-noise") == 0) options.gyroNoiseDps = atof(value);
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (!ParseOptions(argc, argv))
+    {
+        return 2;
+    }
+
+    if (options.verbose)
+    {
+        Serial.SetSink([](uint8_t c) { fputc(c, stdout); });
+    }
+    sabertooth.Attach(Serial0);
+    sabertooth.Seed(options.seed);
+    Serial0.PaceWrites(options.uart);
+    Wire.Attach(SIM_QMI8658_ADDRESS, &imu);
+
+    DroidParams params;
+    params.bounceMs = options.bounceMs;
+    droid.Configure(params);
+    droid.Seed(options.seed);
+    droid.Place(TWO_LEG_STANCE);
+
+    // Idle receiver outputs are LOW.
+    SimDrivePin(ROLLING_CODE_BUTTON_A_PIN, LOW);
+    SimDrivePin(ROLLING_CODE_BUTTON_B_PIN, LOW);
+    SimDrivePin(ROLLING_CODE_BUTTON_C_PIN, LOW);
+    SimDrivePin(ROLLING_CODE_BUTTON_D_PIN, LOW);
+    DriveSwitches();
+
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+    setup();
+    if (options.tiltControl || options.learn)
+    {
+        settingsManager.settings.tiltControl = options.tiltControl;
+        settingsManager.settings.phaseLearn = options.learn;
+        settingsManager.Save();
+    }
+    RunFor(SETTLE_MS);
+
+    std::mt19937 random(options.seed);
+    std::vector<TransitionResult> results;
+    results.reserve(options.count);
+    StanceState target = THREE_LEG_STANCE;
+    for (uint32_t i = 0; i < options.count; i++)
+    {
+        results.push_back(RunTransition(target, random));
+        target = target == THREE_LEG_STANCE ? TWO_LEG_STANCE : THREE_LEG_STANCE;
+    }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    Report(results, wallSeconds);
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        if (results[i].outcome != OUTCOME_OK)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
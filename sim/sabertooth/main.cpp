@@ -0,0 +1,613 @@
+/*
+    Remote 3-2-3 Sabertooth link bench
+
+    Runs the Sabertooth emulator (simsabertooth.cpp) in real time on one end of a socketpair,
+    with bytes arriving and leaving at the baud rate, and drives it from the other end with the
+    real USBSabertooth library and the firmware's MotorTelemetry poller. The host end writes
+    through a model of the ESP32 UART's 128 byte FIFO, blocking when it is full as the real
+    port does. It reports:
+
+        - motor command latency (from ST.motor() to the driver applying it) and throughput,
+          sending flat out and at a fixed rate,
+        - round trip time of the library's blocking getBattery()/getCurrent()/getTemperature(),
+        - a firmware style loop (two motor commands and a telemetry Update() each pass), with
+          the motor commands sent every pass and only when they change.
+
+    With --pty it instead serves the emulator on a pseudo-terminal, printing the path to open,
+    until interrupted, so any other program can talk to it as if to a driver on a USB serial
+    adapter.
+
+    remote_sabertooth [options]
+        --baud N        Line rate (9600)
+        --seconds S     Length of each timed test (3)
+        --rate HZ       Motor command rate for the fixed rate test (50)
+        --latency-us N  Driver processing time before a reply (1000)
+        --corrupt P     Chance each byte is corrupted on the wire, both ways (0)
+        --drop P        Chance a GET goes unanswered (0)
+        --checksum      Use checksum framing instead of CRC
+        --log FILE      Log each channel's state changes and every GET
+        --pty           Serve on a pseudo-terminal instead of running the bench
+        --seed N        Random seed for the injected errors (1)
+*/
+
+#include <Arduino.h>
+#include <USBSabertooth.h>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include "config.h"
+#include "motortelemetry.h"
+#include "simhal.h"
+#include "simsabertooth.h"
+
+struct Options
+{
+    uint32_t baud = 9600;
+    uint32_t seconds = 3;
+    uint32_t rateHz = 50;
+    uint32_t latencyUs = 1000;
+    float corrupt = 0.0f;
+    float drop = 0.0f;
+    bool checksum = false;
+    const char* logPath = nullptr;
+    bool pty = false;
+    uint32_t seed = 1;
+};
+
+static Options options;
+static std::atomic<bool> interrupted(false);
+
+static const uint32_t UART_FIFO_BYTES = 128;
+
+static uint64_t WallUs()
+{
+    static struct timespec start;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (start.tv_sec == 0 && start.tv_nsec == 0)
+    {
+        start = now;
+    }
+    return (uint64_t)(now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
+}
+
+static void SleepUntil(uint64_t us)
+{
+    uint64_t now = WallUs();
+    if (us > now)
+    {
+        usleep((useconds_t)(us - now));
+    }
+}
+
+static uint64_t ByteUs(uint32_t baud)
+{
+    return (10000000ULL + baud / 2) / baud;
+}
+
+// The library and the firmware read millis(); here the simulated clock is the wall clock.
+static void SyncClock()
+{
+    SimSetMicros(WallUs());
+}
+
+/*
+    FdStream
+
+    The host's serial port on a file descriptor. Writes go through a model of the UART FIFO:
+    once 128 bytes are waiting to go out at the baud rate, a write blocks until there is room.
+*/
+class FdStream : public Stream
+{
+    public:
+        FdStream(int fd, uint32_t baud) : fd(fd), byteUs(ByteUs(baud)), sentUs(0) {}
+
+        using Print::write;
+
+        size_t write(uint8_t c) override
+        {
+            SyncClock();
+            uint64_t now = WallUs();
+            uint64_t start = max(now, sentUs);
+            if (start - now >= UART_FIFO_BYTES * byteUs)
+            {
+                SleepUntil(start - (UART_FIFO_BYTES - 1) * byteUs);
+            }
+            sentUs = start + byteUs;
+            return ::write(fd, &c, 1) == 1 ? 1 : 0;
+        }
+
+        int availableForWrite() override
+        {
+            uint64_t now = WallUs();
+            uint64_t queued = sentUs > now ? (sentUs - now + byteUs - 1) / byteUs : 0;
+            return queued >= UART_FIFO_BYTES ? 0 : (int)(UART_FIFO_BYTES - queued);
+        }
+
+        int available() override
+        {
+            SyncClock();
+            int count = 0;
+            return ioctl(fd, FIONREAD, &count) == 0 ? count : 0;
+        }
+
+        int read() override
+        {
+            SyncClock();
+            uint8_t c;
+            return ::read(fd, &c, 1) == 1 ? c : -1;
+        }
+
+    private:
+        int fd;
+        uint64_t byteUs;
+        uint64_t sentUs;
+};
+
+/*
+    EmulatorLink
+
+    The driver's end of the line, on its own thread. Bytes read from the descriptor are held
+    until they would have finished arriving at the baud rate, then fed to the emulator, and
+    reply bytes are written out as their time on the wire comes up.
+*/
+class EmulatorLink
+{
+    public:
+        EmulatorLink(int fd, const SabertoothParams& params) : fd(fd), byteUs(ByteUs(params.baud)),
+            lastArrivalUs(0), running(false)
+        {
+            emulator.Configure(params);
+            emulator.Seed(options.seed);
+            emulator.SetListener([this](uint64_t us, uint8_t type, uint8_t number, int value)
+            {
+                if (type == 'M' && (number == 1 || number == 2))
+                {
+                    applied.push_back({ us, value });
+                }
+            });
+        }
+
+        void SetLog(FILE* file) { emulator.SetLog(file); }
+
+        void Start()
+        {
+            running = true;
+            thread = std::thread([this]() { Run(); });
+        }
+
+        void Stop()
+        {
+            running = false;
+            thread.join();
+        }
+
+        struct Applied
+        {
+            uint64_t us;
+            int value;
+        };
+
+        // Motor values applied since the last call.
+        std::vector<Applied> TakeApplied()
+        {
+            std::lock_guard<std::mutex> hold(lock);
+            std::vector<Applied> taken;
+            taken.swap(applied);
+            return taken;
+        }
+
+        void Counts(uint32_t& packets, uint32_t& bad, uint32_t& gets, uint32_t& replies)
+        {
+            std::lock_guard<std::mutex> hold(lock);
+            packets = emulator.Packets();
+            bad = emulator.BadPackets();
+            gets = emulator.Gets();
+            replies = emulator.Replies();
+        }
+
+    private:
+        void Run()
+        {
+            uint8_t chunk[256];
+            while (running)
+            {
+                uint64_t wakeUs;
+                {
+                    std::lock_guard<std::mutex> hold(lock);
+                    uint64_t now = WallUs();
+                    while (!arriving.empty() && arriving.front().dueUs <= now)
+                    {
+                        emulator.Feed(arriving.front().c, arriving.front().dueUs);
+                        arriving.pop_front();
+                    }
+                    emulator.Update(now);
+                    uint8_t c;
+                    while (emulator.TakeReplyByte(now, c))
+                    {
+                        if (::write(fd, &c, 1) != 1)
+                        {
+                            break;
+                        }
+                    }
+                    wakeUs = now + 1000;
+                    if (!arriving.empty())
+                    {
+                        wakeUs = min(wakeUs, arriving.front().dueUs);
+                    }
+                }
+
+                uint64_t now = WallUs();
+                struct pollfd pfd = { fd, POLLIN, 0 };
+                int waitMs = wakeUs > now ? (int)((wakeUs - now + 999) / 1000) : 0;
+                if (poll(&pfd, 1, waitMs) <= 0 || !(pfd.revents & POLLIN))
+                {
+                    continue;
+                }
+                ssize_t count = ::read(fd, chunk, sizeof(chunk));
+                now = WallUs();
+                std::lock_guard<std::mutex> hold(lock);
+                for (ssize_t i = 0; i < count; i++)
+                {
+                    lastArrivalUs = max(now, lastArrivalUs) + byteUs;
+                    arriving.push_back({ lastArrivalUs, chunk[i] });
+                }
+            }
+        }
+
+        struct WireByte
+        {
+            uint64_t dueUs;
+            uint8_t c;
+        };
+
+        int fd;
+        uint64_t byteUs;
+        uint64_t lastArrivalUs;
+        SimSabertooth emulator;
+        std::deque<WireByte> arriving;
+        std::vector<Applied> applied;
+        std::mutex lock;
+        std::thread thread;
+        std::atomic<bool> running;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Reporting
+
+struct Spread
+{
+    std::vector<uint32_t> values;
+
+    void Add(uint32_t value) { values.push_back(value); }
+
+    uint32_t At(float fraction)
+    {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(fraction * (values.size() - 1) + 0.5f)];
+    }
+
+    void Print(const char* name, float scale, const char* unit)
+    {
+        if (values.empty())
+        {
+            printf("    %s: none\n", name);
+            return;
+        }
+        uint64_t sum = 0;
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            sum += values[i];
+        }
+        printf("    %s %s: min %.1f  mean %.1f  p50 %.1f  p95 %.1f  max %.1f\n", name, unit,
+               At(0.0f) * scale, (double)sum / values.size() * scale, At(0.5f) * scale,
+               At(0.95f) * scale, At(1.0f) * scale);
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Tests
+
+// ST.motor(1, n) with n counting up, flat out (rateHz 0) or at a fixed rate. The driver sees
+// the same numbers, so each one it applies can be matched with when it was sent.
+static void MotorCommands(USBSabertooth& st, EmulatorLink& link, uint32_t rateHz)
+{
+    link.TakeApplied();
+    std::vector<uint64_t> sentUs;
+    uint64_t startUs = WallUs();
+    uint64_t endUs = startUs + (uint64_t)options.seconds * 1000000;
+    uint64_t periodUs = rateHz ? 1000000 / rateHz : 0;
+
+    while (WallUs() < endUs)
+    {
+        if (periodUs)
+        {
+            SleepUntil(startUs + sentUs.size() * periodUs);
+        }
+        sentUs.push_back(WallUs());
+        st.motor(1, (int)(sentUs.size() % 2047) + 1);
+    }
+    usleep(300000);    // Let the FIFO drain
+
+    std::vector<EmulatorLink::Applied> applied = link.TakeApplied();
+    Spread latency;
+    size_t next = 0;
+    for (size_t i = 0; i < applied.size(); i++)
+    {
+        // The value says which command it was, give or take any lost on the way.
+        while (next < sentUs.size() && (int)((next + 1) % 2047) + 1 != applied[i].value)
+        {
+            next++;
+        }
+        if (next == sentUs.size())
+        {
+            break;
+        }
+        latency.Add((uint32_t)(applied[i].us - sentUs[next]));
+        next++;
+    }
+
+    double seconds = (WallUs() - startUs) / 1e6;
+    if (rateHz)
+    {
+        printf("Motor commands at %u Hz:\n", rateHz);
+    }
+    else
+    {
+        printf("Motor commands flat out:\n");
+    }
+    printf("    %zu sent, %zu applied (%.0f/s), %zu lost\n", sentUs.size(), applied.size(),
+           applied.size() / seconds, sentUs.size() - applied.size());
+    latency.Print("command to driver", 0.001f, "ms");
+}
+
+static void BlockingGets(USBSabertooth& st)
+{
+    Spread battery;
+    Spread current;
+    Spread temperature;
+    uint32_t timeouts = 0;
+    uint64_t endUs = WallUs() + (uint64_t)options.seconds * 1000000;
+
+    while (WallUs() < endUs)
+    {
+        // get() times out on millis(), which only moves when the port is touched.
+        SyncClock();
+        uint64_t t0 = WallUs();
+        int value = st.getBattery(1);
+        uint64_t t1 = WallUs();
+        timeouts += value == SABERTOOTH_GET_TIMED_OUT;
+        battery.Add((uint32_t)(t1 - t0));
+
+        SyncClock();
+        value = st.getCurrent(1);
+        uint64_t t2 = WallUs();
+        timeouts += value == SABERTOOTH_GET_TIMED_OUT;
+        current.Add((uint32_t)(t2 - t1));
+
+        SyncClock();
+        value = st.getTemperature(1);
+        timeouts += value == SABERTOOTH_GET_TIMED_OUT;
+        temperature.Add((uint32_t)(WallUs() - t2));
+    }
+
+    printf("Blocking GETs (library get(), %d ms timeout): %u timed out\n", (int)st.getGetTimeout(), timeouts);
+    battery.Print("getBattery", 0.001f, "ms");
+    current.Print("getCurrent", 0.001f, "ms");
+    temperature.Print("getTemperature", 0.001f, "ms");
+}
+
+// What loop() does with the driver each pass: both motors, then the telemetry poller.
+static void FirmwareLoop(USBSabertooth& st, USBSabertoothSerial& serial, EmulatorLink& link, bool everyPass)
+{
+    MotorTelemetry telemetry(st, serial);
+    telemetry.Configure(DEFAULT_TELEMETRY_CURRENT_INTERVAL, DEFAULT_TELEMETRY_SLOW_INTERVAL,
+                        DEFAULT_CURRENT_LIMIT_M1, DEFAULT_CURRENT_LIMIT_M2, DEFAULT_CURRENT_LIMIT_WINDOW);
+
+    uint32_t packets0, bad0, gets0, replies0;
+    link.Counts(packets0, bad0, gets0, replies0);
+
+    Spread passUs;
+    uint32_t passes = 0;
+    int sent[2] = { 0x7FFF, 0x7FFF };
+    uint64_t refreshedUs = 0;
+    uint64_t startUs = WallUs();
+    uint64_t endUs = startUs + (uint64_t)options.seconds * 1000000;
+
+    while (WallUs() < endUs)
+    {
+        uint64_t t0 = WallUs();
+        // Powers change every half second, like a transition's phases.
+        int power = ((t0 - startUs) / 500000) % 2 ? 2047 : -1024;
+        bool refresh = t0 - refreshedUs >= 100000;
+        for (uint8_t m = 0; m < 2; m++)
+        {
+            if (everyPass || refresh || sent[m] != power)
+            {
+                st.motor(m + 1, power);
+                sent[m] = power;
+            }
+        }
+        if (refresh)
+        {
+            refreshedUs = t0;
+        }
+        SyncClock();
+        telemetry.Update(millis());
+        passes++;
+        passUs.Add((uint32_t)(WallUs() - t0));
+        usleep(200);    // The rest of the loop
+    }
+    usleep(300000);
+
+    uint32_t packets, bad, gets, replies;
+    link.Counts(packets, bad, gets, replies);
+    double seconds = (WallUs() - startUs) / 1e6;
+    printf("Firmware loop, motor commands %s:\n", everyPass ? "every pass" : "on change and every 100 ms");
+    printf("    %.0f passes/s, %.0f packets/s, %u GETs (%u answered), %u telemetry timeouts, current valid %s\n",
+           passes / seconds, (packets - packets0) / seconds, gets - gets0, replies - replies0,
+           telemetry.Timeouts(), telemetry.Valid(TELEMETRY_CURRENT_M1) ? "yes" : "no");
+    passUs.Print("pass", 0.001f, "ms");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int ServePty(const SabertoothParams& params, FILE* log)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        perror("pty");
+        return 2;
+    }
+    const char* path = ptsname(master);
+
+    // Raw bytes both ways. Holding the other end open keeps the master readable between
+    // clients.
+    int slave = open(path, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    EmulatorLink link(master, params);
+    link.SetLog(log);
+    link.Start();
+    printf("Sabertooth emulator at %u baud on %s (Ctrl-C to stop)\n", params.baud, path);
+    fflush(stdout);
+
+    while (!interrupted)
+    {
+        usleep(100000);
+    }
+    link.Stop();
+
+    uint32_t packets, bad, gets, replies;
+    link.Counts(packets, bad, gets, replies);
+    printf("\n%u packets, %u bad, %u GETs, %u answered\n", packets, bad, gets, replies);
+    close(slave);
+    close(master);
+    return 0;
+}
+
+static bool ParseOptions(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--checksum") == 0)
+        {
+            options.checksum = true;
+            continue;
+        }
+        if (strcmp(arg, "--pty") == 0)
+        {
+            options.pty = true;
+            continue;
+        }
+        if (value == nullptr)
+        {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            return false;
+        }
+        i++;
+        if (strcmp(arg, "--baud") == 0)            options.baud = max(300UL, strtoul(value, nullptr, 0));
+        else if (strcmp(arg, "--seconds") == 0)    options.seconds = max(1UL, strtoul(value, nullptr, 0));
+        else if (strcmp(arg, "--rate") == 0)       options.rateHz = max(1UL, strtoul(value, nullptr, 0));
+        else if (strcmp(arg, "--latency-us") == 0) options.latencyUs = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--corrupt") == 0)    options.corrupt = atof(value);
+        else if (strcmp(arg, "--drop") == 0)       options.drop = atof(value);
+        else if (strcmp(arg, "--log") == 0)        options.logPath = value;
+        else if (strcmp(arg, "--seed") == 0)       options.seed = strtoul(value, nullptr, 0);
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (!ParseOptions(argc, argv))
+    {
+        return 2;
+    }
+    signal(SIGINT, [](int) { interrupted = true; });
+    WallUs();
+
+    SabertoothParams params;
+    params.baud = options.baud;
+    params.replyLatencyUs = options.latencyUs;
+    params.corruptChance = options.corrupt;
+    params.replyCorruptChance = options.corrupt;
+    params.replyDropChance = options.drop;
+
+    FILE* log = nullptr;
+    if (options.logPath)
+    {
+        log = fopen(options.logPath, "w");
+        if (log == nullptr)
+        {
+            perror(options.logPath);
+            return 2;
+        }
+    }
+
+    if (options.pty)
+    {
+        return ServePty(params, log);
+    }
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+        perror("socketpair");
+        return 2;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    EmulatorLink link(fds[1], params);
+    link.SetLog(log);
+    link.Start();
+
+    FdStream port(fds[0], options.baud);
+    USBSabertoothSerial serial(port);
+    USBSabertooth st(serial, 128);
+    if (options.checksum)
+    {
+        st.useChecksum();
+    }
+    st.setGetTimeout(100);
+
+    printf("%u baud, %s framing, %u us reply latency, %.1f%% corrupt, %.1f%% GETs dropped\n\n",
+           options.baud, options.checksum ? "checksum" : "CRC", options.latencyUs,
+           options.corrupt * 100, options.drop * 100);
+
+    MotorCommands(st, link, 0);
+    MotorCommands(st, link, options.rateHz);
+    BlockingGets(st);
+    FirmwareLoop(st, serial, link, true);
+    FirmwareLoop(st, serial, link, false);
+
+    link.Stop();
+    uint32_t packets, bad, gets, replies;
+    link.Counts(packets, bad, gets, replies);
+    printf("\nDriver saw %u good packets, %u bad, %u GETs, %u answered\n", packets, bad, gets, replies);
+    if (log)
+    {
+        fclose(log);
+    }
+    return 0;
+}
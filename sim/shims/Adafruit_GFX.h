@@ -0,0 +1,73 @@
+#ifndef SIM_ADAFRUIT_GFX_H
+#define SIM_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+/*
+    Drawing base class. Shapes go through drawPixel()/fillRect() as in the real library; text
+    only moves the cursor, since nobody looks at the simulated screen.
+*/
+class Adafruit_GFX : public Print
+{
+    public:
+        Adafruit_GFX(int16_t w, int16_t h) : _width(w), _height(h) {}
+
+        virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+        virtual void startWrite() {}
+        virtual void endWrite() {}
+        virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+        {
+            for (int16_t j = y; j < y + h; j++)
+            {
+                for (int16_t i = x; i < x + w; i++)
+                {
+                    drawPixel(i, j, color);
+                }
+            }
+        }
+        virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { fillRect(x, y, 1, h, color); }
+        virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { fillRect(x, y, w, 1, color); }
+        virtual void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+
+        void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color)
+        {
+            for (int16_t dy = -r; dy <= r; dy++)
+            {
+                int16_t dx = (int16_t)sqrtf((float)(r * r - dy * dy));
+                drawFastHLine(x0 - dx, y0 + dy, 2 * dx + 1, color);
+            }
+        }
+
+        void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+        void setTextColor(uint16_t) {}
+        void setTextColor(uint16_t, uint16_t) {}
+        void setTextSize(uint8_t size) { textSize = size; }
+        void setTextWrap(bool) {}
+        void setRotation(uint8_t) {}
+        int16_t width() const { return _width; }
+        int16_t height() const { return _height; }
+
+        using Print::write;
+        size_t write(uint8_t c) override
+        {
+            if (c == '\n')
+            {
+                cursorX = 0;
+                cursorY += 8 * textSize;
+            }
+            else if (c != '\r')
+            {
+                cursorX += 6 * textSize;
+            }
+            return 1;
+        }
+
+    protected:
+        int16_t _width;
+        int16_t _height;
+        int16_t cursorX = 0;
+        int16_t cursorY = 0;
+        uint8_t textSize = 1;
+};
+
+#endif // SIM_ADAFRUIT_GFX_H
@@ -0,0 +1,27 @@
+#ifndef SIM_ADAFRUIT_ST7789_H
+#define SIM_ADAFRUIT_ST7789_H
+
+#include <Adafruit_GFX.h>
+
+#define ST77XX_BLACK   0x0000
+#define ST77XX_WHITE   0xFFFF
+#define ST77XX_RED     0xF800
+#define ST77XX_GREEN   0x07E0
+#define ST77XX_BLUE    0x001F
+#define ST77XX_CYAN    0x07FF
+#define ST77XX_MAGENTA 0xF81F
+#define ST77XX_YELLOW  0xFFE0
+#define ST77XX_ORANGE  0xFC00
+
+// A panel that accepts pixels and throws them away.
+class Adafruit_ST7789 : public Adafruit_GFX
+{
+    public:
+        Adafruit_ST7789(int8_t cs, int8_t dc, int8_t rst) : Adafruit_GFX(240, 320) { (void)cs; (void)dc; (void)rst; }
+        void init(uint16_t w, uint16_t h) { _width = w; _height = h; }
+        void drawPixel(int16_t, int16_t, uint16_t) override {}
+        void setAddrWindow(uint16_t, uint16_t, uint16_t, uint16_t) {}
+        void writePixels(uint16_t*, uint32_t, bool = true, bool = false) {}
+};
+
+#endif // SIM_ADAFRUIT_ST7789_H
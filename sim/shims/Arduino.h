@@ -0,0 +1,236 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+/*
+    Host stand-in for the Arduino core, just enough of it for the firmware in src/ to build
+    and run on Linux. Time, pins and the serial ports are backed by the simulator (simhal.cpp)
+    instead of hardware.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW  0
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+#define RISING  1
+#define FALLING 2
+#define CHANGE  3
+
+#define PI 3.14159265358979f
+
+#define F(s) (s)
+#define IRAM_ATTR
+
+#define ARDUINO 10800
+
+using std::min;
+using std::max;
+
+template<class T, class L, class H> T constrain(T value, L low, H high)
+{
+    return value < low ? low : (value > high ? high : value);
+}
+
+// Clock
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Pins
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode);
+void attachInterruptArg(uint8_t interrupt, void (*isr)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t interrupt);
+
+inline bool psramFound() { return true; }
+inline void* ps_malloc(size_t size) { return malloc(size); }
+
+class String
+{
+    public:
+        String() {}
+        String(const char* text) : s(text ? text : "") {}
+        String(const std::string& text) : s(text) {}
+        String(char c) : s(1, c) {}
+        String(int value) : s(std::to_string(value)) {}
+        String(unsigned int value) : s(std::to_string(value)) {}
+        String(long value) : s(std::to_string(value)) {}
+        String(unsigned long value) : s(std::to_string(value)) {}
+        String(long long value) : s(std::to_string(value)) {}
+        String(unsigned long long value) : s(std::to_string(value)) {}
+        String(double value, int decimals = 2)
+        {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+            s = buffer;
+        }
+
+        String& operator+=(const String& other) { s += other.s; return *this; }
+        String& operator+=(const char* other) { s += other; return *this; }
+        String& operator+=(char c) { s += c; return *this; }
+        template<class T> String& operator+=(T value) { s += String(value).s; return *this; }
+
+        bool operator==(const char* other) const { return s == other; }
+        bool operator!=(const char* other) const { return s != other; }
+        bool operator==(const String& other) const { return s == other.s; }
+
+        long toInt() const { return atol(s.c_str()); }
+        float toFloat() const { return (float)atof(s.c_str()); }
+        const char* c_str() const { return s.c_str(); }
+        unsigned int length() const { return s.size(); }
+        void reserve(unsigned int size) { s.reserve(size); }
+        char charAt(unsigned int i) const { return s[i]; }
+        char operator[](unsigned int i) const { return s[i]; }
+        void trim()
+        {
+            size_t first = s.find_first_not_of(" \t\r\n");
+            size_t last = s.find_last_not_of(" \t\r\n");
+            s = first == std::string::npos ? "" : s.substr(first, last - first + 1);
+        }
+        bool startsWith(const char* prefix) const { return s.rfind(prefix, 0) == 0; }
+        String substring(unsigned int from) const { return String(s.substr(from)); }
+        String substring(unsigned int from, unsigned int to) const { return String(s.substr(from, to - from)); }
+
+    private:
+        std::string s;
+};
+
+inline String operator+(const String& a, const String& b)
+{
+    String result = a;
+    result += b;
+    return result;
+}
+
+class Print
+{
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t* buffer, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                write(buffer[i]);
+            }
+            return size;
+        }
+        size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+        size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+        virtual int availableForWrite() { return 256; }
+        virtual void flush() {}
+
+        size_t print(const char* text) { return write(text); }
+        size_t print(const String& text) { return write(text.c_str()); }
+        size_t print(char c) { return write((uint8_t)c); }
+        size_t print(int value, int base = 10) { return PrintNumber(value, base); }
+        size_t print(unsigned int value, int base = 10) { return PrintNumber(value, base); }
+        size_t print(long value, int base = 10) { return PrintNumber(value, base); }
+        size_t print(unsigned long value, int base = 10) { return PrintNumber(value, base); }
+        size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+
+        size_t println() { return write("\r\n"); }
+        template<class T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+        template<class T> size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+
+        size_t printf(const char* format, ...)
+        {
+            char buffer[512];
+            va_list args;
+            va_start(args, format);
+            vsnprintf(buffer, sizeof(buffer), format, args);
+            va_end(args);
+            return write(buffer);
+        }
+
+    private:
+        template<class T> size_t PrintNumber(T value, int base)
+        {
+            char buffer[40];
+            snprintf(buffer, sizeof(buffer), base == 16 ? "%llX" : "%lld", (long long)value);
+            return write(buffer);
+        }
+};
+
+class Stream : public Print
+{
+    public:
+        virtual int available() { return 0; }
+        virtual int read() { return -1; }
+        virtual int peek() { return -1; }
+};
+
+/*
+    A serial port. Bytes written go to the sink the simulator attached (or nowhere), and the
+    simulator queues bytes for the firmware to read with Receive().
+
+    Writes normally leave instantly. With PaceWrites() they go out at the baud rate through a
+    128 byte FIFO, as on an ESP32 UART with no TX buffer: a write that finds the FIFO full waits
+    for room, which moves the simulated clock on, and availableForWrite() is the room left.
+*/
+class HardwareSerial : public Stream
+{
+    public:
+        void begin(unsigned long baud, uint32_t config = 0, int rxPin = -1, int txPin = -1) { (void)config; (void)rxPin; (void)txPin; baudRate = baud; }
+        operator bool() const { return true; }
+        void setTxTimeoutMs(uint32_t) {}
+
+        using Print::write;
+        size_t write(uint8_t c) override;
+        int availableForWrite() override;
+        int available() override { return (int)rx.size(); }
+        int read() override
+        {
+            if (rx.empty())
+            {
+                return -1;
+            }
+            uint8_t c = rx.front();
+            rx.pop_front();
+            return c;
+        }
+        int peek() override { return rx.empty() ? -1 : rx.front(); }
+
+        // Simulator side
+        void SetSink(std::function<void(uint8_t)> onByte) { sink = onByte; }
+        void Receive(uint8_t c) { rx.push_back(c); }
+        unsigned long Baud() const { return baudRate; }
+        void PaceWrites(bool on) { pacing = on; }
+
+        // Simulated time the last byte written finishes on the wire.
+        uint64_t SentUs() const { return sentUs; }
+
+    private:
+        std::function<void(uint8_t)> sink;
+        std::deque<uint8_t> rx;
+        unsigned long baudRate = 0;
+        bool pacing = false;
+        uint64_t sentUs = 0;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial0;
+extern HardwareSerial Serial1;
+
+#endif // SIM_ARDUINO_H
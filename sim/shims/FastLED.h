@@ -0,0 +1,43 @@
+#ifndef SIM_FASTLED_H
+#define SIM_FASTLED_H
+
+#include <Arduino.h>
+
+struct CRGB
+{
+    enum HTMLColorCode
+    {
+        Black  = 0x000000,
+        Red    = 0xFF0000,
+        Yellow = 0xFFFF00,
+        Green  = 0x008000,
+        Cyan   = 0x00FFFF,
+        Blue   = 0x0000FF,
+        Purple = 0x800080,
+        White  = 0xFFFFFF
+    };
+
+    uint8_t r, g, b;
+
+    CRGB() : r(0), g(0), b(0) {}
+    CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+    CRGB(HTMLColorCode code) : r((code >> 16) & 0xFF), g((code >> 8) & 0xFF), b(code & 0xFF) {}
+
+    bool operator==(const CRGB& other) const { return r == other.r && g == other.g && b == other.b; }
+    bool operator!=(const CRGB& other) const { return !(*this == other); }
+};
+
+enum EOrder { RGB, GRB };
+enum ESPIChipsets { WS2812 };
+
+class CFastLED
+{
+    public:
+        template<int CHIPSET, int PIN, int ORDER> void addLeds(CRGB*, int) {}
+        void setBrightness(uint8_t) {}
+        void show() {}
+};
+
+extern CFastLED FastLED;
+
+#endif // SIM_FASTLED_H
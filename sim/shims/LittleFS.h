@@ -0,0 +1,48 @@
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// In-memory file system, empty at start.
+class File
+{
+    public:
+        File() : data(nullptr), pos(0) {}
+        File(std::vector<uint8_t>* contents, size_t position) : data(contents), pos(position) {}
+
+        operator bool() const { return data != nullptr; }
+
+        size_t write(const uint8_t* buffer, size_t length);
+        size_t read(uint8_t* buffer, size_t length);
+        bool seek(uint32_t position);
+        size_t size() const { return data ? data->size() : 0; }
+        size_t position() const { return pos; }
+        void flush() {}
+        void close() { data = nullptr; }
+
+    private:
+        std::vector<uint8_t>* data;
+        size_t pos;
+};
+
+class LittleFSFS
+{
+    public:
+        bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+                   const char* partitionLabel = "spiffs");
+        File open(const char* path, const char* mode);
+        bool exists(const char* path) { return files.count(path) > 0; }
+        bool remove(const char* path) { return files.erase(path) > 0; }
+        size_t totalBytes() { return 1 << 20; }
+        size_t usedBytes();
+
+    private:
+        std::map<std::string, std::vector<uint8_t> > files;
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // SIM_LITTLEFS_H
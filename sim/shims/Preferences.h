@@ -0,0 +1,58 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+    In-memory NVS. Every namespace starts empty, so the firmware boots with its defaults, and
+    what it saves lasts until the simulator exits.
+*/
+class Preferences
+{
+    public:
+        bool begin(const char* name, bool readOnly = false) { (void)readOnly; space = name; return true; }
+        void end() {}
+        bool clear();
+        bool remove(const char* key);
+        bool isKey(const char* key) { return Find(key) != nullptr; }
+
+        uint8_t getUChar(const char* key, uint8_t value = 0) { return Get(key, value); }
+        int16_t getShort(const char* key, int16_t value = 0) { return Get(key, value); }
+        uint16_t getUShort(const char* key, uint16_t value = 0) { return Get(key, value); }
+        uint32_t getULong(const char* key, uint32_t value = 0) { return Get(key, value); }
+        size_t putUChar(const char* key, uint8_t value) { return Put(key, value); }
+        size_t putShort(const char* key, int16_t value) { return Put(key, value); }
+        size_t putUShort(const char* key, uint16_t value) { return Put(key, value); }
+        size_t putULong(const char* key, uint32_t value) { return Put(key, value); }
+
+        size_t getBytesLength(const char* key);
+        size_t getBytes(const char* key, void* buffer, size_t maxLength);
+        size_t putBytes(const char* key, const void* buffer, size_t length);
+
+    private:
+        std::vector<uint8_t>* Find(const char* key);
+
+        template<class T> T Get(const char* key, T fallback)
+        {
+            std::vector<uint8_t>* stored = Find(key);
+            if (stored == nullptr || stored->size() != sizeof(T))
+            {
+                return fallback;
+            }
+            T value;
+            memcpy(&value, stored->data(), sizeof(T));
+            return value;
+        }
+
+        template<class T> size_t Put(const char* key, T value)
+        {
+            return putBytes(key, &value, sizeof(T));
+        }
+
+        std::string space;
+};
+
+#endif // SIM_PREFERENCES_H
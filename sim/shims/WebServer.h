@@ -0,0 +1,33 @@
+#ifndef SIM_WEBSERVER_H
+#define SIM_WEBSERVER_H
+
+#include <WiFi.h>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_POST };
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+// Routes are accepted and never called; there are no clients in the simulator.
+class WebServer
+{
+    public:
+        WebServer(int) {}
+        void on(const char*, HTTPMethod, std::function<void()>) {}
+        void begin() {}
+        void handleClient() {}
+        void send(int, const char*, const String&) {}
+        void send(int, const char* = "", const char* = "") {}
+        void sendContent(const String&) {}
+        void sendContent(const char*) {}
+        void sendContent(const char*, size_t) {}
+        void sendHeader(const char*, const char*, bool = false) {}
+        void setContentLength(size_t) {}
+        bool hasArg(const char*) { return false; }
+        String arg(const char*) { return String(); }
+        String arg(int) { return String(); }
+        String argName(int) { return String(); }
+        int args() { return 0; }
+        WiFiClient client() { return WiFiClient(); }
+};
+
+#endif // SIM_WEBSERVER_H
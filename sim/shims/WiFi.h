@@ -0,0 +1,28 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+
+// No network in the simulator. The access point "starts" and nobody ever connects.
+struct IPAddress
+{
+    String toString() const { return "192.168.4.1"; }
+};
+
+class WiFiClient : public Stream
+{
+    public:
+        using Print::write;
+        size_t write(uint8_t) override { return 1; }
+};
+
+class WiFiClass
+{
+    public:
+        bool softAP(const char*, const char* = nullptr) { return true; }
+        IPAddress softAPIP() { return IPAddress(); }
+};
+
+extern WiFiClass WiFi;
+
+#endif // SIM_WIFI_H
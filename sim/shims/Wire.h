@@ -0,0 +1,51 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+/*
+    A register-style I2C device on the simulated bus. A write sets the register pointer and
+    stores any further bytes from there; a read returns registers from the pointer on, or the
+    same register over and over while the device has its auto increment off.
+*/
+class SimI2cDevice
+{
+    public:
+        virtual ~SimI2cDevice() {}
+        virtual uint8_t ReadRegister(uint8_t reg) = 0;
+        virtual void WriteRegister(uint8_t reg, uint8_t value) = 0;
+        virtual bool AutoIncrement() { return true; }
+};
+
+class TwoWire : public Stream
+{
+    public:
+        bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { (void)sda; (void)scl; (void)frequency; return true; }
+        void setClock(uint32_t) {}
+
+        void beginTransmission(uint8_t address);
+        uint8_t endTransmission(bool sendStop = true);
+        uint8_t requestFrom(uint8_t address, uint8_t quantity);
+
+        using Print::write;
+        size_t write(uint8_t value) override;
+        int available() override;
+        int read() override;
+
+        // Simulator side. A device answers at one 7-bit address; nullptr removes it.
+        void Attach(uint8_t address, SimI2cDevice* device);
+
+    private:
+        SimI2cDevice* devices[128] = {};
+        uint8_t txAddress = 0;
+        uint8_t txBuffer[32];
+        uint8_t txLength = 0;
+        uint8_t registerPointer[128] = {};
+        uint8_t rxBuffer[32];
+        uint8_t rxLength = 0;
+        uint8_t rxIndex = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // SIM_WIRE_H
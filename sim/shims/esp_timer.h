@@ -0,0 +1,11 @@
+#ifndef SIM_ESP_TIMER_H
+#define SIM_ESP_TIMER_H
+
+#include <stdint.h>
+
+#define ESP_OK 0
+
+// Microseconds of simulated time
+int64_t esp_timer_get_time();
+
+#endif // SIM_ESP_TIMER_H
@@ -0,0 +1,29 @@
+#ifndef SIM_FREERTOS_TASK_H
+#define SIM_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+inline BaseType_t xTaskCreate(void (*)(void*), const char*, uint32_t, void*, UBaseType_t, TaskHandle_t* handle)
+{
+    if (handle)
+    {
+        *handle = (TaskHandle_t)1;
+    }
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stack, void* param,
+                                          UBaseType_t priority, TaskHandle_t* handle, BaseType_t)
+{
+    return xTaskCreate(task, name, stack, param, priority, handle);
+}
+
+inline void vTaskDelay(TickType_t) {}
+inline void vTaskDelayUntil(TickType_t*, TickType_t) {}
+inline TickType_t xTaskGetTickCount() { return 0; }
+inline void xTaskNotifyGive(TaskHandle_t) {}
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t*) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+inline void taskYIELD() {}
+
+#endif // SIM_FREERTOS_TASK_H
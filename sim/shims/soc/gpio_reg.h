@@ -0,0 +1,6 @@
+#ifndef SIM_SOC_GPIO_REG_H
+#define SIM_SOC_GPIO_REG_H
+
+#define GPIO_IN_REG 0
+
+#endif // SIM_SOC_GPIO_REG_H
@@ -0,0 +1,11 @@
+#ifndef SIM_SOC_SOC_H
+#define SIM_SOC_SOC_H
+
+#include <stdint.h>
+
+// Only GPIO_IN_REG is ever read: the levels of pins 0-31, one bit each.
+uint32_t SimGpioInputRegister();
+
+#define REG_READ(reg) ((void)(reg), SimGpioInputRegister())
+
+#endif // SIM_SOC_SOC_H
@@ -0,0 +1,111 @@
+#include "simdroid.h"
+#include <math.h>
+
+DroidParams::DroidParams()
+    : legTravelMs(1200.0f), tiltTravelMs(3000.0f), motorLagMs(60.0f), deadband(0.03f),
+      switchTravel(0.03f), tipPoint(0.4f), footSlack(0.05f), maxTiltDeg(18.0f), bounceMs(2.0f)
+{
+}
+
+SimDroid::SimDroid()
+    : leg(0.0f), tilt(0.0f), legSpeed(0.0f), tiltSpeed(0.0f), legScale(1.0f), tiltScale(1.0f),
+      tiltArrival(0.0f), fallen(false), ideal(0), switches(0), random(1)
+{
+    Place(TWO_LEG_STANCE);
+}
+
+void SimDroid::Configure(const DroidParams& newParams)
+{
+    params = newParams;
+}
+
+void SimDroid::SetSpeedScale(float legMultiplier, float tiltMultiplier)
+{
+    legScale = legMultiplier;
+    tiltScale = tiltMultiplier;
+}
+
+void SimDroid::Place(StanceState stance)
+{
+    float end = stance == THREE_LEG_STANCE ? 1.0f : 0.0f;
+    leg = end;
+    tilt = end;
+    legSpeed = 0.0f;
+    tiltSpeed = 0.0f;
+    fallen = false;
+    ideal = IdealSwitches();
+    switches = ideal;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        bounceLeftMs[i] = 0.0f;
+    }
+}
+
+uint8_t SimDroid::IdealSwitches() const
+{
+    uint8_t closed = 0;
+    if (leg <= params.switchTravel)        closed |= SWITCH_LEG_UP;
+    if (leg >= 1.0f - params.switchTravel) closed |= SWITCH_LEG_DN;
+    if (tilt <= params.switchTravel)       closed |= SWITCH_TILT_UP;
+    if (tilt >= 1.0f - params.switchTravel) closed |= SWITCH_TILT_DN;
+    return closed;
+}
+
+float SimDroid::Axis(float position, float& speed, float ms, int power, float travelMs, float scale)
+{
+    float drive = power / 2047.0f;
+    float magnitude = fabsf(drive) <= params.deadband ? 0.0f : (fabsf(drive) - params.deadband) / (1.0f - params.deadband);
+    float target = (drive < 0 ? -magnitude : magnitude) * scale / travelMs;
+
+    float follow = params.motorLagMs > 0.0f ? 1.0f - expf(-ms / params.motorLagMs) : 1.0f;
+    speed += (target - speed) * follow;
+
+    position += speed * ms;
+    if (position <= 0.0f || position >= 1.0f)
+    {
+        // Up against a hard stop, stalled
+        position = fminf(fmaxf(position, 0.0f), 1.0f);
+        speed = 0.0f;
+    }
+    return position;
+}
+
+void SimDroid::Step(float ms, int legPower, int tiltPower)
+{
+    if (!fallen)
+    {
+        leg = Axis(leg, legSpeed, ms, legPower, params.legTravelMs, legScale);
+        tilt = Axis(tilt, tiltSpeed, ms, tiltPower, params.tiltTravelMs, tiltScale);
+
+        if (tilt > params.tipPoint && leg < tilt - params.footSlack)
+        {
+            fallen = true;
+        }
+    }
+
+    // A switch that changes chatters at random for bounceMs before it settles.
+    uint8_t now = IdealSwitches();
+    if (now & ~ideal & (SWITCH_TILT_UP | SWITCH_TILT_DN))
+    {
+        tiltArrival = fabsf(tiltSpeed) * params.tiltTravelMs;
+    }
+    std::uniform_int_distribution<int> coin(0, 1);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        uint8_t bit = 1 << i;
+        if ((now ^ ideal) & bit)
+        {
+            bounceLeftMs[i] = params.bounceMs;
+        }
+        if (bounceLeftMs[i] > 0.0f)
+        {
+            bounceLeftMs[i] -= ms;
+            switches = coin(random) ? (switches | bit) : (switches & ~bit);
+        }
+        else
+        {
+            switches = (switches & ~bit) | (now & bit);
+        }
+    }
+    ideal = now;
+}
@@ -0,0 +1,88 @@
+#ifndef SIMDROID_H
+#define SIMDROID_H
+
+#include <stdint.h>
+#include <random>
+#include "stance.h"
+
+/*
+    Model of the leg and tilt mechanics.
+
+    Each axis is a position from 0 (leg up / body upright) to 1 (leg down / body tilted onto
+    three legs). A motor moves its axis at a speed proportional to the power it is given, less
+    a small deadband, and reaches that speed with a first order lag. Hard stops hold each axis
+    in 0..1, and a limit switch is closed while its axis is within switchTravel of that end.
+
+    Balance is the one rule that can go wrong: once the body tilts past tipPoint it rests on
+    the center foot, so the leg has to be out at least as far as the body is tilted (less
+    footSlack). If it isn't, the droid goes over and the model freezes until Place().
+*/
+struct DroidParams
+{
+    float legTravelMs;      // Leg end to end at full power
+    float tiltTravelMs;     // Tilt end to end at full power
+    float motorLagMs;       // Time constant of speed following power
+    float deadband;         // Fraction of full power that doesn't turn the motor
+    float switchTravel;     // Fraction of travel at each end that holds its switch closed
+    float tipPoint;         // Tilt past which the body needs the center foot
+    float footSlack;        // How far the foot can lag the tilt before he goes over
+    float maxTiltDeg;       // Body angle on three legs
+    float bounceMs;         // Contact bounce each time a switch opens or closes
+
+    DroidParams();
+};
+
+class SimDroid
+{
+    public:
+        SimDroid();
+
+        void Configure(const DroidParams& params);
+
+        // Motor speed multipliers for battery level, friction and wear (1.0 = nominal).
+        void SetSpeedScale(float leg, float tilt);
+
+        // Stand him in TWO_LEG_STANCE or THREE_LEG_STANCE with the motors stopped.
+        void Place(StanceState stance);
+
+        // Advance by ms with these Sabertooth powers (-2047..2047, positive is down).
+        void Step(float ms, int legPower, int tiltPower);
+
+        // Closed switches, SWITCH_* bits from stance.h, including any bounce.
+        uint8_t Switches() const { return switches; }
+
+        float Leg() const { return leg; }
+        float Tilt() const { return tilt; }
+        float TiltDegrees() const { return tilt * params.maxTiltDeg; }
+        float TiltRateDps() const { return tiltSpeed * params.maxTiltDeg * 1000.0f; }
+
+        // Tilt speed, as a fraction of its nominal full power speed, when it last reached an
+        // end and closed that end's limit switch. How hard the body comes onto the end stop.
+        float TiltArrivalSpeed() const { return tiltArrival; }
+
+        bool Fallen() const { return fallen; }
+
+        // Seed the bounce noise.
+        void Seed(uint32_t seed) { random.seed(seed); }
+
+    private:
+        float Axis(float position, float& speed, float ms, int power, float travelMs, float scale);
+        uint8_t IdealSwitches() const;
+
+        DroidParams params;
+        float leg;
+        float tilt;
+        float legSpeed;         // Fraction of travel per ms
+        float tiltSpeed;
+        float legScale;
+        float tiltScale;
+        float tiltArrival;
+        bool fallen;
+
+        uint8_t ideal;          // Switches from position alone
+        uint8_t switches;       // What the pins show
+        float bounceLeftMs[4];
+        std::mt19937 random;
+};
+
+#endif // SIMDROID_H
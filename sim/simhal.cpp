@@ -0,0 +1,449 @@
+#include "simhal.h"
+#include <Wire.h>
+#include <SPI.h>
+#include <WiFi.h>
+#include <FastLED.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <soc/soc.h>
+
+HardwareSerial Serial;
+HardwareSerial Serial0;
+HardwareSerial Serial1;
+TwoWire Wire;
+SPIClass SPI;
+WiFiClass WiFi;
+CFastLED FastLED;
+LittleFSFS LittleFS;
+
+#define SIM_PIN_COUNT 64
+
+static uint64_t nowUs = 0;
+
+struct SimPin
+{
+    uint8_t mode;
+    bool driven;
+    uint8_t drivenLevel;
+    uint8_t outputLevel;
+    int interruptMode;
+    void (*isr)();
+    void (*isrWithArg)(void*);
+    void* isrArg;
+};
+
+static SimPin pins[SIM_PIN_COUNT];
+
+uint64_t SimMicros()
+{
+    return nowUs;
+}
+
+void SimSetMicros(uint64_t us)
+{
+    nowUs = us;
+}
+
+void SimAdvance(uint64_t us)
+{
+    nowUs += us;
+}
+
+unsigned long millis()
+{
+    return (uint32_t)(nowUs / 1000);
+}
+
+unsigned long micros()
+{
+    return (uint32_t)nowUs;
+}
+
+void delay(unsigned long ms)
+{
+    nowUs += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    nowUs += us;
+}
+
+int64_t esp_timer_get_time()
+{
+    return (int64_t)nowUs;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Serial ports
+
+#define SIM_UART_FIFO_BYTES 128
+
+static uint64_t ByteUs(unsigned long baud)
+{
+    return (10000000ULL + baud / 2) / baud;    // Start, 8 data and stop bits
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    if (pacing && baudRate > 0)
+    {
+        uint64_t byteUs = ByteUs(baudRate);
+        uint64_t start = max(nowUs, sentUs);
+        if (start - nowUs >= SIM_UART_FIFO_BYTES * byteUs)
+        {
+            // FIFO full: block until the byte at its head has gone.
+            nowUs = start - (SIM_UART_FIFO_BYTES - 1) * byteUs;
+        }
+        sentUs = start + byteUs;
+    }
+    else
+    {
+        sentUs = nowUs;
+    }
+
+    if (sink)
+    {
+        sink(c);
+    }
+    return 1;
+}
+
+int HardwareSerial::availableForWrite()
+{
+    if (!pacing || baudRate == 0)
+    {
+        return 256;
+    }
+    uint64_t byteUs = ByteUs(baudRate);
+    uint64_t queued = sentUs > nowUs ? (sentUs - nowUs + byteUs - 1) / byteUs : 0;
+    return queued >= SIM_UART_FIFO_BYTES ? 0 : (int)(SIM_UART_FIFO_BYTES - queued);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Pins
+
+int SimPinLevel(uint8_t pin)
+{
+    if (pin >= SIM_PIN_COUNT)
+    {
+        return HIGH;
+    }
+    const SimPin& p = pins[pin];
+    if (p.mode == OUTPUT)
+    {
+        return p.outputLevel;
+    }
+    if (p.driven)
+    {
+        return p.drivenLevel;
+    }
+    // Everything the firmware reads is INPUT_PULLUP; a floating INPUT reads HIGH here too.
+    return HIGH;
+}
+
+static void SetPinState(uint8_t pin, bool driven, uint8_t level)
+{
+    if (pin >= SIM_PIN_COUNT)
+    {
+        return;
+    }
+    int before = SimPinLevel(pin);
+    pins[pin].driven = driven;
+    pins[pin].drivenLevel = level;
+    int after = SimPinLevel(pin);
+
+    SimPin& p = pins[pin];
+    if (before == after || (p.isr == nullptr && p.isrWithArg == nullptr))
+    {
+        return;
+    }
+    bool fire = p.interruptMode == CHANGE ||
+                (p.interruptMode == RISING && after == HIGH) ||
+                (p.interruptMode == FALLING && after == LOW);
+    if (!fire)
+    {
+        return;
+    }
+    if (p.isrWithArg)
+    {
+        p.isrWithArg(p.isrArg);
+    }
+    else
+    {
+        p.isr();
+    }
+}
+
+void SimDrivePin(uint8_t pin, int level)
+{
+    SetPinState(pin, true, level ? HIGH : LOW);
+}
+
+void SimReleasePin(uint8_t pin)
+{
+    SetPinState(pin, false, HIGH);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin < SIM_PIN_COUNT)
+    {
+        pins[pin].mode = mode;
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    return SimPinLevel(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+    if (pin < SIM_PIN_COUNT)
+    {
+        pins[pin].outputLevel = level ? HIGH : LOW;
+    }
+}
+
+uint32_t SimGpioInputRegister()
+{
+    uint32_t levels = 0;
+    for (uint8_t pin = 0; pin < 32; pin++)
+    {
+        if (SimPinLevel(pin) == HIGH)
+        {
+            levels |= 1UL << pin;
+        }
+    }
+    return levels;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode)
+{
+    if (interrupt < SIM_PIN_COUNT)
+    {
+        pins[interrupt].isr = isr;
+        pins[interrupt].isrWithArg = nullptr;
+        pins[interrupt].interruptMode = mode;
+    }
+}
+
+void attachInterruptArg(uint8_t interrupt, void (*isr)(void*), void* arg, int mode)
+{
+    if (interrupt < SIM_PIN_COUNT)
+    {
+        pins[interrupt].isr = nullptr;
+        pins[interrupt].isrWithArg = isr;
+        pins[interrupt].isrArg = arg;
+        pins[interrupt].interruptMode = mode;
+    }
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+    if (interrupt < SIM_PIN_COUNT)
+    {
+        pins[interrupt].isr = nullptr;
+        pins[interrupt].isrWithArg = nullptr;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// I2C
+
+void TwoWire::Attach(uint8_t address, SimI2cDevice* device)
+{
+    devices[address & 0x7F] = device;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    txAddress = address & 0x7F;
+    txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t value)
+{
+    if (txLength >= sizeof(txBuffer))
+    {
+        return 0;
+    }
+    txBuffer[txLength++] = value;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    (void)sendStop;
+    SimI2cDevice* device = devices[txAddress];
+    if (device == nullptr)
+    {
+        return 2;   // Address NACK
+    }
+    if (txLength > 0)
+    {
+        registerPointer[txAddress] = txBuffer[0];
+        for (uint8_t i = 1; i < txLength; i++)
+        {
+            device->WriteRegister(registerPointer[txAddress]++, txBuffer[i]);
+        }
+    }
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+    address &= 0x7F;
+    rxLength = 0;
+    rxIndex = 0;
+    SimI2cDevice* device = devices[address];
+    if (device == nullptr)
+    {
+        return 0;
+    }
+    while (rxLength < quantity && rxLength < sizeof(rxBuffer))
+    {
+        rxBuffer[rxLength++] = device->ReadRegister(registerPointer[address]);
+        if (device->AutoIncrement())
+        {
+            registerPointer[address]++;
+        }
+    }
+    return rxLength;
+}
+
+int TwoWire::available()
+{
+    return rxLength - rxIndex;
+}
+
+int TwoWire::read()
+{
+    return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// NVS
+
+static std::map<std::string, std::vector<uint8_t> > nvs;
+
+std::vector<uint8_t>* Preferences::Find(const char* key)
+{
+    std::map<std::string, std::vector<uint8_t> >::iterator it = nvs.find(space + "/" + key);
+    return it == nvs.end() ? nullptr : &it->second;
+}
+
+bool Preferences::clear()
+{
+    std::string prefix = space + "/";
+    for (std::map<std::string, std::vector<uint8_t> >::iterator it = nvs.begin(); it != nvs.end();)
+    {
+        it = it->first.compare(0, prefix.size(), prefix) == 0 ? nvs.erase(it) : std::next(it);
+    }
+    return true;
+}
+
+bool Preferences::remove(const char* key)
+{
+    return nvs.erase(space + "/" + key) > 0;
+}
+
+size_t Preferences::getBytesLength(const char* key)
+{
+    std::vector<uint8_t>* stored = Find(key);
+    return stored ? stored->size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength)
+{
+    std::vector<uint8_t>* stored = Find(key);
+    if (stored == nullptr || stored->size() > maxLength)
+    {
+        return 0;
+    }
+    memcpy(buffer, stored->data(), stored->size());
+    return stored->size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* buffer, size_t length)
+{
+    const uint8_t* bytes = (const uint8_t*)buffer;
+    nvs[space + "/" + key] = std::vector<uint8_t>(bytes, bytes + length);
+    return length;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// File system
+
+size_t File::write(const uint8_t* buffer, size_t length)
+{
+    if (data == nullptr)
+    {
+        return 0;
+    }
+    if (pos + length > data->size())
+    {
+        data->resize(pos + length);
+    }
+    memcpy(data->data() + pos, buffer, length);
+    pos += length;
+    return length;
+}
+
+size_t File::read(uint8_t* buffer, size_t length)
+{
+    if (data == nullptr || pos >= data->size())
+    {
+        return 0;
+    }
+    size_t count = min(length, data->size() - pos);
+    memcpy(buffer, data->data() + pos, count);
+    pos += count;
+    return count;
+}
+
+bool File::seek(uint32_t position)
+{
+    if (data == nullptr || position > data->size())
+    {
+        return false;
+    }
+    pos = position;
+    return true;
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel)
+{
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    return true;
+}
+
+File LittleFSFS::open(const char* path, const char* mode)
+{
+    if (mode[0] == 'r')
+    {
+        std::map<std::string, std::vector<uint8_t> >::iterator it = files.find(path);
+        return it == files.end() ? File() : File(&it->second, 0);
+    }
+    std::vector<uint8_t>& contents = files[path];
+    if (mode[0] == 'w')
+    {
+        contents.clear();
+    }
+    return File(&contents, mode[0] == 'a' ? contents.size() : 0);
+}
+
+size_t LittleFSFS::usedBytes()
+{
+    size_t used = 0;
+    for (std::map<std::string, std::vector<uint8_t> >::iterator it = files.begin(); it != files.end(); ++it)
+    {
+        used += it->second.size();
+    }
+    return used;
+}
@@ -0,0 +1,26 @@
+#ifndef SIMHAL_H
+#define SIMHAL_H
+
+#include <Arduino.h>
+
+/*
+    The simulated board under the Arduino shims.
+
+    Time only moves when the runner advances it, so a run is exactly repeatable and goes as
+    fast as the host can call loop(). Pins hold whatever level the runner drives onto them (an
+    undriven INPUT_PULLUP pin reads HIGH), and driving a new level runs any interrupt attached
+    to that pin straight away, as the GPIO interrupt would.
+*/
+
+// Simulated time. millis() and micros() wrap at 32 bits as they do on the ESP32; start the
+// clock close to 2^32 ms with SimSetMicros() to run through the millis() wrap.
+uint64_t SimMicros();
+void SimSetMicros(uint64_t us);
+void SimAdvance(uint64_t us);
+
+// Drive a pin from outside the firmware, or let it go back to its pull-up.
+void SimDrivePin(uint8_t pin, int level);
+void SimReleasePin(uint8_t pin);
+int SimPinLevel(uint8_t pin);
+
+#endif // SIMHAL_H
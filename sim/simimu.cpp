@@ -0,0 +1,63 @@
+#include "simimu.h"
+#include "config.h"
+#include <random>
+
+static const uint8_t REG_WHO_AM_I = 0x00;
+static const uint8_t REG_CTRL1 = 0x02;
+static const uint8_t CTRL1_ADDR_AI = 0x40;
+static const uint8_t REG_AX_L = 0x35;
+static const uint8_t REG_GX_L = 0x3B;
+static const float LSB_PER_G = 16384.0f;
+static const float LSB_PER_DPS = 256.0f;
+
+static std::mt19937 noiseSource(1);
+
+SimQmi8658::SimQmi8658()
+{
+    memset(registers, 0, sizeof(registers));
+    registers[REG_WHO_AM_I] = 0x05;
+    SetTilt(0.0f);
+}
+
+static void SetRegisters(uint8_t* registers, uint8_t first, const float* values, float scale, float noiseLevel)
+{
+    std::normal_distribution<float> noise(0.0f, noiseLevel);
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        float value = values[axis] + (noiseLevel > 0.0f ? noise(noiseSource) : 0.0f);
+        int16_t raw = (int16_t)constrain(value * scale, -32768.0f, 32767.0f);
+        registers[first + axis * 2] = raw & 0xFF;
+        registers[first + axis * 2 + 1] = (raw >> 8) & 0xFF;
+    }
+}
+
+void SimQmi8658::SetTilt(float degrees, float rateDps, float noiseG, float noiseDps)
+{
+    // The firmware takes atan2(ax, az) and adds IMU_TILT_OFFSET_DEG, so work backwards from it.
+    float sensorRad = (degrees - IMU_TILT_OFFSET_DEG) * (PI / 180.0f);
+    float g[3] = { sinf(sensorRad), 0.0f, cosf(sensorRad) };
+    SetRegisters(registers, REG_AX_L, g, LSB_PER_G, noiseG);
+
+    // atan2(ax, az) falls as the sensor turns about +Y.
+    float turn[3] = { 0.0f, -rateDps, 0.0f };
+    SetRegisters(registers, REG_GX_L, turn, LSB_PER_DPS, noiseDps);
+}
+
+uint8_t SimQmi8658::ReadRegister(uint8_t reg)
+{
+    return registers[reg & 0x7F];
+}
+
+void SimQmi8658::WriteRegister(uint8_t reg, uint8_t value)
+{
+    // Configuration only; the accelerometer data registers aren't writable.
+    if (reg != REG_WHO_AM_I && reg < REG_AX_L)
+    {
+        registers[reg & 0x7F] = value;
+    }
+}
+
+bool SimQmi8658::AutoIncrement()
+{
+    return (registers[REG_CTRL1] & CTRL1_ADDR_AI) != 0;
+}
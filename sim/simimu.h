@@ -0,0 +1,33 @@
+#ifndef SIMIMU_H
+#define SIMIMU_H
+
+#include <Wire.h>
+
+#define SIM_QMI8658_ADDRESS 0x6B
+
+/*
+    QMI8658 accelerometer on the simulated I2C bus.
+
+    Answers WHO_AM_I and returns gravity for the body tilt as the firmware's ReadQmi8658Tilt()
+    expects it (X/Z axes, +-2g at 16384 LSB/g, mounted with the -90 degree offset in config.h),
+    and the tilt rate on the gyro's Y axis (256 LSB/dps), plus optional noise on each. Like the
+    chip, it only steps through registers on a read once CTRL1's auto increment bit is set.
+*/
+class SimQmi8658 : public SimI2cDevice
+{
+    public:
+        SimQmi8658();
+
+        // Body tilt in degrees as the firmware reports it (0 upright) and how fast it is
+        // changing, with noise in g and degrees per second.
+        void SetTilt(float degrees, float rateDps = 0.0f, float noiseG = 0.0f, float noiseDps = 0.0f);
+
+        uint8_t ReadRegister(uint8_t reg) override;
+        void WriteRegister(uint8_t reg, uint8_t value) override;
+        bool AutoIncrement() override;
+
+    private:
+        uint8_t registers[0x80];
+};
+
+#endif // SIMIMU_H
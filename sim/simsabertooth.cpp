@@ -0,0 +1,519 @@
+#include "simsabertooth.h"
+#include "simhal.h"
+
+SabertoothParams::SabertoothParams()
+    : baud(9600), replyLatencyUs(1000), replyJitterUs(500), answerGets(true),
+      batteryDeciVolts(252), packMilliOhms(60), fullLoadDeciAmps(80), ambientC(25),
+      degreesPerAmpSquared(0.15f), thermalSeconds(120.0f),
+      corruptChance(0.0f), replyDropChance(0.0f), replyCorruptChance(0.0f)
+{
+}
+
+SimSabertooth::SimSabertooth()
+    : log(nullptr), port(nullptr), replyFreeUs(0), address(128), length(0), timeoutMs(0),
+      timedOut(false), lastCommandUs(0), updatedUs(0), packets(0), badPackets(0), gets(0), replies(0)
+{
+    for (uint8_t m = 0; m < 2; m++)
+    {
+        power[m] = 0;
+        output[m] = 0.0f;
+        ramping[m] = 0;
+        rampingSet[m] = false;
+        shutDown[m] = false;
+        load[m] = 1.0f;
+    }
+    temperature = params.ambientC;
+}
+
+void SimSabertooth::Configure(const SabertoothParams& newParams)
+{
+    params = newParams;
+    temperature = params.ambientC;
+}
+
+void SimSabertooth::Attach(HardwareSerial& serialPort)
+{
+    port = &serialPort;
+    port->SetSink([this](uint8_t c) { incoming.push_back({ port->SentUs(), c }); });
+}
+
+void SimSabertooth::Service()
+{
+    uint64_t nowUs = SimMicros();
+    while (!incoming.empty() && incoming.front().dueUs <= nowUs)
+    {
+        Feed(incoming.front().c, incoming.front().dueUs);
+        incoming.pop_front();
+    }
+    Update(nowUs);
+
+    uint8_t c;
+    while (port != nullptr && TakeReplyByte(nowUs, c))
+    {
+        port->Receive(c);
+    }
+}
+
+void SimSabertooth::Feed(uint8_t c)
+{
+    Feed(c, SimMicros());
+}
+
+void SimSabertooth::Feed(uint8_t c, uint64_t nowUs)
+{
+    if (params.corruptChance > 0 && Chance(params.corruptChance))
+    {
+        c ^= 1 << (random() % 8);
+    }
+    Update(nowUs);
+    Parse(c, nowUs);
+}
+
+bool SimSabertooth::TakeReplyByte(uint64_t nowUs, uint8_t& c)
+{
+    if (replyQueue.empty() || replyQueue.front().dueUs > nowUs)
+    {
+        return false;
+    }
+    c = replyQueue.front().c;
+    replyQueue.pop_front();
+    return true;
+}
+
+bool SimSabertooth::Chance(float chance)
+{
+    return std::uniform_real_distribution<float>(0.0f, 1.0f)(random) < chance;
+}
+
+void SimSabertooth::Log(uint64_t nowUs, const char* format, ...)
+{
+    if (log == nullptr)
+    {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    fprintf(log, "%10.3f ms  ", nowUs / 1000.0);
+    vfprintf(log, format, args);
+    fputc('\n', log);
+    va_end(args);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Checks
+
+uint8_t SimSabertooth::Checksum(const uint8_t* data, size_t length)
+{
+    uint8_t sum = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        sum += data[i];
+    }
+    return sum & 0x7F;
+}
+
+uint8_t SimSabertooth::Crc7(const uint8_t* data, size_t length)
+{
+    uint8_t crc = 0x7F;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x76 : crc >> 1;
+        }
+    }
+    return crc ^ 0x7F;
+}
+
+uint16_t SimSabertooth::Crc14(const uint8_t* data, size_t length)
+{
+    uint16_t crc = 0x3FFF;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x22F0 : crc >> 1;
+        }
+    }
+    return crc ^ 0x3FFF;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Packets
+
+/*
+    Parse
+
+    A byte with the top bit set starts a packet: address, command, first data byte and a header
+    check, then for longer commands the rest of the data and a data check. CRC framing sets the
+    0x70 bits of the address and uses CRC7/CRC14 in place of the 7-bit sums.
+*/
+void SimSabertooth::Parse(uint8_t c, uint64_t nowUs)
+{
+    if (c & 0x80)
+    {
+        length = 0;
+    }
+    else if (length == 0)
+    {
+        return;     // Not in a packet
+    }
+    if (length >= MAX_PACKET)
+    {
+        length = 0;
+        badPackets++;
+        return;
+    }
+    buffer[length++] = c;
+    if (length < 4)
+    {
+        return;
+    }
+
+    bool crc = (buffer[0] & 0x70) == 0x70;
+    uint8_t dataLength;
+    switch (buffer[1])
+    {
+        case CMD_SET:
+            dataLength = 5;
+            break;
+        case CMD_GET:
+            dataLength = 3;
+            break;
+        default:
+            length = 0;
+            badPackets++;
+            return;
+    }
+
+    if (length == 4)
+    {
+        uint8_t check = crc ? Crc7(buffer, 3) : Checksum(buffer, 3);
+        if (check != buffer[3])
+        {
+            length = 0;
+            badPackets++;
+        }
+        return;
+    }
+
+    uint8_t total = 4 + (dataLength - 1) + (crc ? 2 : 1);
+    if (length < total)
+    {
+        return;
+    }
+    length = 0;
+
+    bool good;
+    if (crc)
+    {
+        uint16_t check = Crc14(buffer + 4, dataLength - 1);
+        good = buffer[total - 2] == (check & 0x7F) && buffer[total - 1] == ((check >> 7) & 0x7F);
+    }
+    else
+    {
+        good = buffer[total - 1] == Checksum(buffer + 4, dataLength - 1);
+    }
+    if (!good || (uint8_t)(buffer[0] & ~0x70) != address)
+    {
+        badPackets++;
+        Log(nowUs, "bad packet");
+        return;
+    }
+
+    packets++;
+    uint8_t data[5];
+    data[0] = buffer[2];
+    memcpy(data + 1, buffer + 4, dataLength - 1);
+    Handle(buffer[1], data, dataLength, crc, nowUs);
+}
+
+void SimSabertooth::Handle(uint8_t command, const uint8_t* data, uint8_t dataLength, bool crc, uint64_t nowUs)
+{
+    if (command == CMD_SET && dataLength == 5)
+    {
+        HandleSet(data, nowUs);
+    }
+    else if (command == CMD_GET && dataLength == 3)
+    {
+        HandleGet(data, crc, nowUs);
+    }
+}
+
+// Motor numbers come as 1 and 2, '1' and '2', or '*' for both. Returns a bit per motor.
+static uint8_t MotorMask(uint8_t number)
+{
+    switch (number)
+    {
+        case 1:
+        case '1':
+            return 1;
+        case 2:
+        case '2':
+            return 2;
+        case '*':
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+void SimSabertooth::HandleSet(const uint8_t* data, uint64_t nowUs)
+{
+    uint8_t flags = data[0];
+    int value = data[1] | (data[2] << 7);
+    if (flags & 1)
+    {
+        value = -value;
+    }
+    uint8_t type = data[3];
+    uint8_t number = data[4];
+    uint8_t motors = MotorMask(number);
+
+    switch (flags & ~1)
+    {
+        case 0x00:  // Value
+            if (type == 'M')
+            {
+                for (uint8_t m = 0; m < 2; m++)
+                {
+                    if (motors & (1 << m))
+                    {
+                        SetMotor(m, value, nowUs);
+                    }
+                }
+                lastCommandUs = nowUs;
+            }
+            else if (type == 'R')
+            {
+                for (uint8_t m = 0; m < 2; m++)
+                {
+                    if ((motors & (1 << m)) && (!rampingSet[m] || ramping[m] != value))
+                    {
+                        ramping[m] = constrain(value, -16383, 2047);
+                        rampingSet[m] = true;
+                        Log(nowUs, "M%u ramping %d (%.0f ms full scale)", m + 1, ramping[m], RampMs(ramping[m]));
+                    }
+                }
+            }
+            else
+            {
+                Log(nowUs, "set %c%c %d (not modelled)", type, number < 32 ? '0' + number : number, value);
+            }
+            break;
+
+        case 0x10:  // Keep-alive
+            lastCommandUs = nowUs;
+            break;
+
+        case 0x20:  // Shutdown
+            for (uint8_t m = 0; m < 2; m++)
+            {
+                if (type == 'M' && (motors & (1 << m)) && shutDown[m] != (value != 0))
+                {
+                    shutDown[m] = value != 0;
+                    Log(nowUs, "M%u %s", m + 1, shutDown[m] ? "shut down" : "running");
+                }
+            }
+            break;
+
+        case 0x40:  // Serial timeout
+            timeoutMs = value > 0 ? value : 0;
+            lastCommandUs = nowUs;
+            Log(nowUs, "serial timeout %d ms", timeoutMs);
+            break;
+
+        default:
+            break;
+    }
+
+    if (listener)
+    {
+        listener(nowUs, type, number, value);
+    }
+}
+
+void SimSabertooth::SetMotor(uint8_t m, int value, uint64_t nowUs)
+{
+    value = constrain(value, -2047, 2047);
+    if (timedOut)
+    {
+        timedOut = false;
+        Log(nowUs, "serial timeout cleared");
+    }
+    if (power[m] != value)
+    {
+        Log(nowUs, "M%u power %d -> %d", m + 1, power[m], value);
+        power[m] = value;
+    }
+    if (!rampingSet[m])
+    {
+        output[m] = shutDown[m] ? 0.0f : (float)value;
+    }
+}
+
+void SimSabertooth::HandleGet(const uint8_t* data, bool crc, uint64_t nowUs)
+{
+    uint8_t flags = data[0];
+    uint8_t type = data[1];
+    uint8_t number = data[2];
+    uint8_t motor = MotorMask(number) == 2 ? 1 : 0;
+    gets++;
+
+    if (!params.answerGets)
+    {
+        return;
+    }
+    if (params.replyDropChance > 0 && Chance(params.replyDropChance))
+    {
+        Log(nowUs, "GET %02X %c%u dropped", flags, type, number);
+        return;
+    }
+
+    int value;
+    const char* what;
+    switch (flags & ~2)     // Unscaled reads get the same numbers
+    {
+        case 0x00:
+            value = (int)output[motor];
+            what = "value";
+            break;
+        case 0x10:
+            value = BatteryDeciVolts();
+            what = "battery";
+            break;
+        case 0x20:
+            value = CurrentDeciAmps(motor + 1);
+            what = "current";
+            break;
+        case 0x40:
+            value = TemperatureC();
+            what = "temperature";
+            break;
+        default:
+            return;
+    }
+    Log(nowUs, "GET %s %c%u = %d", what, type, number, value);
+    Reply(flags, value, type, number, crc, nowUs);
+}
+
+/*
+    Reply
+
+    Same layout as a SET: address, reply code, flags (bit 0 is the sign) and header check, then
+    the value in two 7-bit bytes, the type and the number, and the data check.
+*/
+void SimSabertooth::Reply(uint8_t flags, int value, uint8_t type, uint8_t number, bool crc, uint64_t nowUs)
+{
+    uint8_t packet[MAX_PACKET];
+    uint8_t n = 0;
+    if (value < 0)
+    {
+        value = -value;
+        flags |= 1;
+    }
+    value = min(value, 16383);
+
+    packet[n++] = crc ? (address | 0x70) : address;
+    packet[n++] = REPLY_GET;
+    packet[n++] = flags;
+    packet[n++] = crc ? Crc7(packet, 3) : Checksum(packet, 3);
+    packet[n++] = value & 0x7F;
+    packet[n++] = (value >> 7) & 0x7F;
+    packet[n++] = type;
+    packet[n++] = number;
+    if (crc)
+    {
+        uint16_t check = Crc14(packet + 4, 4);
+        packet[n++] = check & 0x7F;
+        packet[n++] = (check >> 7) & 0x7F;
+    }
+    else
+    {
+        packet[n++] = Checksum(packet + 4, 4);
+    }
+
+    uint32_t jitter = params.replyJitterUs ? random() % (params.replyJitterUs + 1) : 0;
+    uint64_t dueUs = max(nowUs + params.replyLatencyUs + jitter, replyFreeUs);
+    uint64_t byteUs = params.baud ? (10000000ULL + params.baud / 2) / params.baud : 0;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        uint8_t c = packet[i];
+        if (params.replyCorruptChance > 0 && Chance(params.replyCorruptChance))
+        {
+            c ^= 1 << (random() % 8);
+        }
+        dueUs += byteUs;
+        replyQueue.push_back({ dueUs, c });
+    }
+    replyFreeUs = dueUs;
+    replies++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Outputs
+
+/*
+    RampMs
+
+    Time for a ramped output to go from stop to full. The driver documents -16383 as fastest and
+    2047 as slowest; in between this is a guess, linear from none at -16383 to a quarter second
+    at 0, then up to two seconds at 2047.
+*/
+float SimSabertooth::RampMs(int value)
+{
+    if (value <= 0)
+    {
+        return 250.0f * (value + 16383) / 16383.0f;
+    }
+    return 250.0f + 1750.0f * min(value, 2047) / 2047.0f;
+}
+
+void SimSabertooth::Update(uint64_t nowUs)
+{
+    if (nowUs <= updatedUs)
+    {
+        return;
+    }
+    float ms = (nowUs - updatedUs) / 1000.0f;
+    updatedUs = nowUs;
+
+    if (timeoutMs > 0 && !timedOut && nowUs - lastCommandUs > (uint64_t)timeoutMs * 1000)
+    {
+        timedOut = true;
+        Log(nowUs, "serial timeout, outputs stopped");
+    }
+
+    for (uint8_t m = 0; m < 2; m++)
+    {
+        float target = (shutDown[m] || timedOut) ? 0.0f : (float)power[m];
+        if (!rampingSet[m])
+        {
+            output[m] = target;
+            continue;
+        }
+        float rampMs = RampMs(ramping[m]);
+        float step = rampMs > 0 ? 2047.0f * ms / rampMs : 4094.0f;
+        output[m] = target > output[m] ? min(target, output[m] + step) : max(target, output[m] - step);
+    }
+
+    // Heatsink follows I^2 with a first order lag.
+    float a1 = CurrentDeciAmps(1) / 10.0f;
+    float a2 = CurrentDeciAmps(2) / 10.0f;
+    float steady = params.ambientC + params.degreesPerAmpSquared * (a1 * a1 + a2 * a2);
+    temperature += (steady - temperature) * min(1.0f, ms / (params.thermalSeconds * 1000.0f));
+}
+
+int16_t SimSabertooth::CurrentDeciAmps(uint8_t motor) const
+{
+    uint8_t m = (motor - 1) & 1;
+    return (int16_t)(output[m] / 2047.0f * params.fullLoadDeciAmps * load[m]);
+}
+
+int16_t SimSabertooth::BatteryDeciVolts() const
+{
+    int32_t amps = abs(CurrentDeciAmps(1)) + abs(CurrentDeciAmps(2));
+    return (int16_t)(params.batteryDeciVolts - amps * params.packMilliOhms / 1000);
+}
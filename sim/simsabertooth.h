@@ -0,0 +1,157 @@
+#ifndef SIMSABERTOOTH_H
+#define SIMSABERTOOTH_H
+
+#include <Arduino.h>
+#include <deque>
+#include <random>
+
+/*
+    Electrical and timing behaviour of the emulated driver. The defaults are plausible for a
+    2x32 on a 24 V pack running the leg and tilt gearmotors, not measured.
+*/
+struct SabertoothParams
+{
+    uint32_t baud;                  // Reply bytes go out at this rate (0 = instantly)
+    uint32_t replyLatencyUs;        // From the end of a GET to the first reply byte...
+    uint32_t replyJitterUs;         // ...plus up to this much more
+    bool answerGets;                // False for a listen-only decoder
+
+    int16_t batteryDeciVolts;       // Resting pack voltage, 0.1 V
+    uint16_t packMilliOhms;         // Pack and wiring resistance, for sag under load
+    int16_t fullLoadDeciAmps;       // Motor current at full output and normal load, 0.1 A
+    int16_t ambientC;
+    float degreesPerAmpSquared;     // Temperature rise above ambient at a steady current
+    float thermalSeconds;           // Time constant of the heatsink
+
+    float corruptChance;            // Per received byte, flip a bit before it is parsed
+    float replyDropChance;          // Per GET, don't answer
+    float replyCorruptChance;       // Per reply byte, flip a bit on the way out
+
+    SabertoothParams();
+};
+
+/*
+    Packet serial Sabertooth emulator.
+
+    Speaks the protocol USBSabertoothCommandWriter produces, in checksum or CRC framing:
+    SET for motor outputs ('M'), power outputs ('P'), ramping ('R'), shutdown, serial timeout
+    and keep-alive, and GET for output value, battery, current and temperature. Packets that
+    fail their check are counted and ignored as the real driver does. GETs are answered in the
+    framing they came in, after a processing delay and at the baud rate.
+
+    Each motor output follows its last command through the driver's ramping, and current,
+    battery sag and heatsink temperature follow the outputs. Ramping and the serial timeout
+    only start once the firmware sets them; the driver's own DEScribe settings aren't modelled.
+
+    The emulator works on whatever clock it is given, so the same code runs inside the
+    simulator (Attach()/Service() on the simulated clock and a shim serial port) and on a real
+    file descriptor in real time (Feed()/TakeReplyByte() with wall clock time).
+*/
+class SimSabertooth
+{
+    public:
+        SimSabertooth();
+
+        void Configure(const SabertoothParams& params);
+        void Seed(uint32_t seed) { random.seed(seed); }
+
+        // Log every change of a channel's state, and every GET, to this file (nullptr = off).
+        void SetLog(FILE* file) { log = file; }
+
+        // Simulator transport. Takes the firmware's TX bytes from this port, when the port's
+        // pacing says they have finished arriving, and queues replies on its receive side.
+        void Attach(HardwareSerial& port);
+        void Service();
+
+        // Any transport. One byte has finished arriving at nowUs.
+        void Feed(uint8_t c, uint64_t nowUs);
+        void Feed(uint8_t c);           // Arriving now on the simulated clock
+
+        // Next reply byte whose time on the wire is up by nowUs.
+        bool TakeReplyByte(uint64_t nowUs, uint8_t& c);
+
+        // Move the outputs, battery and temperature on to nowUs.
+        void Update(uint64_t nowUs);
+
+        // Called for each good SET packet, after it has been applied.
+        void SetListener(std::function<void(uint64_t nowUs, uint8_t type, uint8_t number, int value)> onSet) { listener = onSet; }
+
+        // Last commanded power for motor 1 or 2, -2047..2047, and the output the motor actually
+        // gets after ramping, shutdown and the serial timeout.
+        int Power(uint8_t motor) const { return power[(motor - 1) & 1]; }
+        int Output(uint8_t motor) const { return (int)output[(motor - 1) & 1]; }
+
+        // Motor current in 0.1 A (signed with the output), battery in 0.1 V, temperature in C.
+        int16_t CurrentDeciAmps(uint8_t motor) const;
+        int16_t BatteryDeciVolts() const;
+        int16_t TemperatureC() const { return (int16_t)temperature; }
+
+        // Load multiplier on a motor's current, e.g. high while it is stalled on a hard stop.
+        void SetLoad(uint8_t motor, float factor) { load[(motor - 1) & 1] = factor; }
+
+        uint32_t Packets() const { return packets; }
+        uint32_t BadPackets() const { return badPackets; }
+        uint32_t Gets() const { return gets; }
+        uint32_t Replies() const { return replies; }
+
+        static uint8_t Checksum(const uint8_t* data, size_t length);
+        static uint8_t Crc7(const uint8_t* data, size_t length);
+        static uint16_t Crc14(const uint8_t* data, size_t length);
+
+        // Full scale ramp time in ms for a ramping value (-16383 fast .. 2047 slow).
+        static float RampMs(int value);
+
+    private:
+        static const uint8_t CMD_SET = 40;
+        static const uint8_t CMD_GET = 41;
+        static const uint8_t REPLY_GET = 73;
+        static const uint8_t MAX_PACKET = 10;
+
+        struct WireByte
+        {
+            uint64_t dueUs;
+            uint8_t c;
+        };
+
+        void Parse(uint8_t c, uint64_t nowUs);
+        void Handle(uint8_t command, const uint8_t* data, uint8_t length, bool crc, uint64_t nowUs);
+        void HandleSet(const uint8_t* data, uint64_t nowUs);
+        void HandleGet(const uint8_t* data, bool crc, uint64_t nowUs);
+        void Reply(uint8_t flags, int value, uint8_t type, uint8_t number, bool crc, uint64_t nowUs);
+        void SetMotor(uint8_t motor, int value, uint64_t nowUs);
+        bool Chance(float chance);
+        void Log(uint64_t nowUs, const char* format, ...);
+
+        SabertoothParams params;
+        std::mt19937 random;
+        FILE* log;
+        std::function<void(uint64_t, uint8_t, uint8_t, int)> listener;
+
+        HardwareSerial* port;
+        std::deque<WireByte> incoming;  // Sent by the firmware, not yet arrived
+        std::deque<WireByte> replyQueue;
+        uint64_t replyFreeUs;           // When the reply line is next idle
+
+        uint8_t address;
+        uint8_t buffer[MAX_PACKET];
+        uint8_t length;
+
+        int power[2];
+        float output[2];
+        int ramping[2];
+        bool rampingSet[2];
+        bool shutDown[2];
+        float load[2];
+        int32_t timeoutMs;              // Serial timeout, 0 = none
+        bool timedOut;
+        uint64_t lastCommandUs;
+        uint64_t updatedUs;
+        float temperature;
+
+        uint32_t packets;
+        uint32_t badPackets;
+        uint32_t gets;
+        uint32_t replies;
+};
+
+#endif // SIMSABERTOOTH_H
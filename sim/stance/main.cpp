@@ -0,0 +1,308 @@
+/*
+    Remote 3-2-3 stance table check
+
+    STANCE_TABLE and STANCE_ACTIONS replaced the if chains CheckStance() and Move() started
+    out as. The static_asserts in stance.h only check the tables against safety rules, which a
+    change of behaviour can still pass. This goes through every switch mask, target and
+    stance the droid was in before, and checks that the tables, and the firmware's own
+    CheckStance() and Move() reading them, do what the original chains did. The chains are
+    copied below as they were, fall-through and all, with the motor calls replaced by a note of
+    which block ran.
+
+    remote_stance [options]
+        --verbose       List every combination, not just the ones that differ
+
+    The exit code is 1 if anything differs.
+*/
+
+#include <Arduino.h>
+#include "config.h"
+#include "stance.h"
+#include "simhal.h"
+#include "simsabertooth.h"
+#include "simimu.h"
+
+// The sketch
+void setup();
+void CheckStance();
+void Move();
+extern StanceState currentStance;
+extern StanceState StanceTarget;
+extern StanceState moveTarget;
+extern int LegUp;
+extern int LegDn;
+extern int TiltUp;
+extern int TiltDn;
+extern bool LegMoving;
+extern bool TiltMoving;
+
+static SimSabertooth sabertooth;
+static SimQmi8658 imu;
+static bool verbose = false;
+
+static const char* ACTION_NAMES[] =
+{
+    "none", "stop", "three to two", "two to three", "leg up", "leg down", "tilt up", "tilt down"
+};
+
+/*
+    BaselineCheckStance
+
+    The original CheckStance(), for a droid that isn't moving. A mask none of the blocks match
+    leaves the stance as it was.
+*/
+static uint8_t BaselineCheckStance(int LegUp, int LegDn, int TiltUp, int TiltDn, uint8_t currentStance)
+{
+    if (LegUp == LOW && LegDn == HIGH && TiltUp == LOW && TiltDn == HIGH)
+    {
+        return TWO_LEG_STANCE;
+    }
+    if (LegUp == HIGH && LegDn == LOW && TiltUp == HIGH && TiltDn == LOW)
+    {
+        return THREE_LEG_STANCE;
+    }
+    if (LegUp == LOW && LegDn == HIGH && TiltUp == HIGH && TiltDn == HIGH)
+    {
+        currentStance = STANCE_ERROR_LEG_UP_TILT_UNKNOWN;
+    }
+    if (LegUp == HIGH && LegDn == HIGH && TiltUp == LOW && TiltDn == HIGH)
+    {
+        currentStance = STANCE_ERROR_LEG_UNKNOWN_TILT_UP;
+    }
+    if (LegUp == HIGH && LegDn == LOW && TiltUp == LOW && TiltDn == HIGH)
+    {
+        currentStance = STANCE_ERROR_LEG_DOWN_TILT_UP;
+    }
+    if (LegUp == HIGH && LegDn == LOW && TiltUp == HIGH && TiltDn == HIGH)
+    {
+        currentStance = STANCE_ERROR_LEG_DOWN_TILT_UNKNOWN;
+    }
+    if (LegUp == HIGH && LegDn == HIGH && TiltUp == HIGH && TiltDn == LOW)
+    {
+        currentStance = STANCE_ERROR_LEG_UNKNOWN_TILT_DOWN;
+    }
+    if (LegUp == HIGH && LegDn == HIGH && TiltUp == HIGH && TiltDn == HIGH)
+    {
+        currentStance = STANCE_ERROR_ALL_UNKNOWN;
+    }
+    if (LegUp == LOW && LegDn == HIGH && TiltUp == HIGH && TiltDn == LOW)
+    {
+        currentStance = STANCE_ERROR_LEG_UP_TILT_DOWN;
+    }
+    return currentStance;
+}
+
+/*
+    BaselineMove
+
+    The original Move(). The motion blocks don't return, so each one that matches is noted;
+    ran is how many did. Returns the action of the last block that ran, ACTION_NONE if none did.
+*/
+static uint8_t BaselineMove(uint8_t StanceTarget, uint8_t currentStance, uint8_t& ran)
+{
+    uint8_t action = ACTION_NONE;
+    ran = 0;
+
+    if (StanceTarget == STANCE_NO_TARGET)
+    {
+        ran++;
+        return ACTION_STOP;
+    }
+    if (StanceTarget == currentStance)
+    {
+        ran++;
+        return ACTION_STOP;
+    }
+    if (currentStance == STANCE_ERROR_ALL_UNKNOWN)
+    {
+        ran++;
+        return ACTION_STOP;
+    }
+    if (StanceTarget == TWO_LEG_STANCE && currentStance == THREE_LEG_STANCE)
+    {
+        ran++;
+        action = ACTION_THREE_TO_TWO;
+    }
+    if (StanceTarget == TWO_LEG_STANCE && currentStance == STANCE_ERROR_LEG_UP_TILT_UNKNOWN)
+    {
+        ran++;
+        action = ACTION_TILT_UP;
+    }
+    if (StanceTarget == TWO_LEG_STANCE && ((currentStance == STANCE_ERROR_LEG_UNKNOWN_TILT_UP) || (currentStance == STANCE_ERROR_LEG_DOWN_TILT_UP)))
+    {
+        ran++;
+        action = ACTION_LEG_UP;
+    }
+    if (StanceTarget == TWO_LEG_STANCE && currentStance == STANCE_ERROR_LEG_DOWN_TILT_UNKNOWN)
+    {
+        ran++;
+        return ACTION_STOP;
+    }
+    if (StanceTarget == TWO_LEG_STANCE && currentStance == STANCE_ERROR_LEG_UNKNOWN_TILT_DOWN)
+    {
+        ran++;
+        return ACTION_STOP;
+    }
+    if (StanceTarget == THREE_LEG_STANCE && currentStance == TWO_LEG_STANCE)
+    {
+        ran++;
+        action = ACTION_TWO_TO_THREE;
+    }
+    if (StanceTarget == THREE_LEG_STANCE && currentStance == STANCE_ERROR_LEG_UP_TILT_UNKNOWN)
+    {
+        ran++;
+        return ACTION_STOP;
+    }
+    if (StanceTarget == THREE_LEG_STANCE && currentStance == STANCE_ERROR_LEG_UNKNOWN_TILT_UP)
+    {
+        ran++;
+        return ACTION_STOP;
+    }
+    if (StanceTarget == THREE_LEG_STANCE && currentStance == STANCE_ERROR_LEG_DOWN_TILT_UNKNOWN)
+    {
+        ran++;
+        action = ACTION_TILT_DN;
+    }
+    if (StanceTarget == THREE_LEG_STANCE && currentStance == STANCE_ERROR_LEG_UNKNOWN_TILT_DOWN)
+    {
+        ran++;
+        action = ACTION_LEG_DN;
+    }
+    return action;
+}
+
+/*
+    FirmwareStance
+
+    Run the firmware's CheckStance() on a switch mask, starting from a stance.
+*/
+static uint8_t FirmwareStance(uint8_t mask, uint8_t stance)
+{
+    LegUp = (mask & SWITCH_LEG_UP) ? LOW : HIGH;
+    LegDn = (mask & SWITCH_LEG_DN) ? LOW : HIGH;
+    TiltUp = (mask & SWITCH_TILT_UP) ? LOW : HIGH;
+    TiltDn = (mask & SWITCH_TILT_DN) ? LOW : HIGH;
+    LegMoving = false;
+    TiltMoving = false;
+    currentStance = (StanceState)stance;
+    CheckStance();
+    return currentStance;
+}
+
+/*
+    FirmwareHolds
+
+    Run the firmware's Move() for a target already being acted on, with both motors marked as
+    moving. Returns true if it left them alone (ACTION_NONE) and false if it stopped them.
+    Only asked where the tables say one or the other.
+*/
+static bool FirmwareHolds(uint8_t target)
+{
+    StanceTarget = (StanceState)target;
+    moveTarget = StanceTarget;
+    LegMoving = true;
+    TiltMoving = true;
+    Move();
+    return LegMoving && TiltMoving;
+}
+
+static void MaskName(char* text, uint8_t mask)
+{
+    snprintf(text, 5, "%s%s", (mask & SWITCH_LEG_UP) ? "LU" : (mask & SWITCH_LEG_DN) ? "LD" : "--",
+             (mask & SWITCH_TILT_UP) ? "TU" : (mask & SWITCH_TILT_DN) ? "TD" : "--");
+    if ((mask & (SWITCH_LEG_UP | SWITCH_LEG_DN)) == (SWITCH_LEG_UP | SWITCH_LEG_DN) ||
+        (mask & (SWITCH_TILT_UP | SWITCH_TILT_DN)) == (SWITCH_TILT_UP | SWITCH_TILT_DN))
+    {
+        snprintf(text, 5, "0x%X", mask);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--verbose") == 0)
+        {
+            verbose = true;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    sabertooth.Attach(Serial0);
+    Wire.Attach(SIM_QMI8658_ADDRESS, &imu);
+    SimDrivePin(ROLLING_CODE_BUTTON_A_PIN, LOW);
+    SimDrivePin(ROLLING_CODE_BUTTON_B_PIN, LOW);
+    SimDrivePin(ROLLING_CODE_BUTTON_C_PIN, LOW);
+    SimDrivePin(ROLLING_CODE_BUTTON_D_PIN, LOW);
+    setup();
+
+    uint32_t checked = 0;
+    uint32_t differ = 0;
+    for (uint8_t mask = 0; mask < 16; mask++)
+    {
+        int legUp = (mask & SWITCH_LEG_UP) ? LOW : HIGH;
+        int legDn = (mask & SWITCH_LEG_DN) ? LOW : HIGH;
+        int tiltUp = (mask & SWITCH_TILT_UP) ? LOW : HIGH;
+        int tiltDn = (mask & SWITCH_TILT_DN) ? LOW : HIGH;
+
+        for (uint8_t before = 0; before < STANCE_COUNT; before++)
+        {
+            uint8_t expectedStance = BaselineCheckStance(legUp, legDn, tiltUp, tiltDn, before);
+            uint8_t tableStance = STANCE_TABLE[mask] == STANCE_UNCHANGED ? before : STANCE_TABLE[mask];
+            uint8_t firmwareStance = FirmwareStance(mask, before);
+
+            for (uint8_t target = 0; target < STANCE_TARGET_COUNT; target++)
+            {
+                uint8_t ran;
+                uint8_t expected = BaselineMove(target, expectedStance, ran);
+                uint8_t action = STANCE_ACTIONS[target][tableStance];
+
+                const char* problem = nullptr;
+                if (ran > 1)
+                {
+                    problem = "more than one baseline block ran";
+                }
+                else if (tableStance != expectedStance || firmwareStance != expectedStance)
+                {
+                    problem = "stance differs";
+                }
+                else if (action != expected)
+                {
+                    problem = "action differs";
+                }
+                else if (action == ACTION_NONE || action == ACTION_STOP)
+                {
+                    FirmwareStance(mask, before);
+                    if (FirmwareHolds(target) != (action == ACTION_NONE))
+                    {
+                        problem = "Move() differs";
+                    }
+                }
+                checked++;
+
+                if (problem != nullptr)
+                {
+                    differ++;
+                }
+                if (problem != nullptr || verbose)
+                {
+                    char text[5];
+                    MaskName(text, mask);
+                    printf("%-4s from %-13s to %-11s baseline %-13s %-12s table %-13s %-12s firmware %-13s%s%s\n",
+                           text, STANCE_NAMES[before], STANCE_NAMES[target],
+                           STANCE_NAMES[expectedStance], ACTION_NAMES[expected],
+                           STANCE_NAMES[tableStance], ACTION_NAMES[action], STANCE_NAMES[firmwareStance],
+                           problem ? "  <- " : "", problem ? problem : "");
+                }
+            }
+        }
+    }
+
+    printf("%u combinations of switch mask, stance and target checked, %u differ from the baseline\n",
+           checked, differ);
+    return differ ? 1 : 0;
+}
@@ -25,6 +25,37 @@
     #define WIFI_AP_PASSWORD "tiltdroid"
 #endif
 
+///////////////////////////////////////////////////////////////////////////////
+// Loop Profiler
+// Times each stage of loop() and serves the results on /metrics (ESP32) and via
+// the "M" serial command. Comment out for production builds to remove it entirely.
+// Left off on the Pro Micro, where its ~800 bytes of statistics don't fit in RAM.
+#ifdef USE_WAVESHARE_ESP32_LCD
+    #define ENABLE_LOOP_PROFILER
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Serial Log
+// Debug output is buffered in RAM and written to USB serial in the background, so a slow or
+// disconnected host can't stall the loop. Comment out to remove all logging from the build.
+#define ENABLE_SERIAL_LOG
+
+// 0 = errors, 1 = warnings, 2 = info, 3 = debug (stance dumps). Set from the web page on ESP32.
+#define DEFAULT_LOG_LEVEL 3
+
+// Send log lines as compact binary records (message ID plus raw arguments) instead of text.
+// The format strings are left out of the firmware; read the output with tools/logdecode.py.
+//#define SERIAL_LOG_BINARY
+
+///////////////////////////////////////////////////////////////////////////////
+// Display
+// Screen changes are drawn at most this many times a second. On the Waveshare boards a
+// background task does the drawing; on the Pro Micro it happens in loop().
+#define DISPLAY_MAX_FPS 20
+
+// Frame rate of the WS2812 status LED animations (Waveshare boards)
+#define LED_FPS 50
+
 ///////////////////////////////////////////////////////////////////////////////
 // Default Controller Values
 // Motor power values (-2047 to 2047)
@@ -44,14 +75,67 @@
 #define DEFAULT_COMMAND_ENABLE_TIMEOUT       30000
 #define DEFAULT_BUTTON_DEBOUNCE_TIME         150
 
+// Limit switch and remote input filter (milliseconds). An input has to hold a new level this
+// long before anything sees it change; 0 turns the filter off.
+#define DEFAULT_SWITCH_FILTER_TIME           5
+
+// Rolling code remote gestures (milliseconds). Button D uses them to pick a tuning profile.
+#define BUTTON_LONG_PRESS_TIME               1000
+#define BUTTON_DOUBLE_PRESS_TIME             400
+
 // Global power multiplier (percentage 0-100)
 #define DEFAULT_POWER_MULTIPLIER             100
 
+// Tuning profiles (Waveshare boards), switched from the web page or with Button D. Each keeps its
+// own motor powers, power multiplier and stance/phase timing, starting from the defaults above
+// with these names and power multipliers.
+#define PROFILE_COUNT                        3
+#define PROFILE_NAMES                        { "Indoor Carpet", "Outdoor", "Demo Slow" }
+#define PROFILE_POWER_MULTIPLIERS            { DEFAULT_POWER_MULTIPLIER, 100, 50 }
+
 // ThreeToTwo phase timing (in ShowTime ticks)
 #define DEFAULT_PHASE1_START                 1
 #define DEFAULT_PHASE1_END                   10
 #define DEFAULT_PHASE2_START                 12
 
+// ThreeToTwo phase learning (ESP32). Off by default; when on, the fast leg lift is moved at most
+// the learning range (ShowTime ticks) either way of the hand-tuned phase timing.
+#define DEFAULT_PHASE_LEARN                  0
+#define DEFAULT_PHASE_LEARN_RANGE            4
+
+// Motor ramping (milliseconds). A new power is eased in over about the ramp time per full scale
+// (0 = straight to it), along an S-curve whose rate of change builds up over the jerk time.
+// Limit switch and emergency stops are never ramped.
+#define DEFAULT_MOVE_RAMP_TIME               250
+#define DEFAULT_TWO_TO_THREE_RAMP_TIME       250
+#define DEFAULT_THREE_TO_TWO_RAMP_TIME       250
+#define DEFAULT_RAMP_JERK_TIME               100
+
+// Closed loop tilt (boards with the QMI8658). The body angle on two legs and on three, in 0.1
+// degrees as the IMU reads it; the tilt slows over the slow zone (0.1 degrees) before each, down
+// to the minimum power (percent of the move's power). The limit switches still stop it. Off by
+// default; turn it on once the two angles have been read off the droid.
+#define DEFAULT_TILT_CONTROL                 0
+#define DEFAULT_TILT_UP_ANGLE                0
+#define DEFAULT_TILT_DN_ANGLE                180
+#define DEFAULT_TILT_SLOW_ZONE               30
+#define DEFAULT_TILT_MIN_POWER               30
+
+// Motor telemetry polling (milliseconds) and over-current cutoff (0.1 A units, 0 = off)
+#define DEFAULT_TELEMETRY_CURRENT_INTERVAL   50
+#define DEFAULT_TELEMETRY_SLOW_INTERVAL      1000
+#define DEFAULT_CURRENT_LIMIT_M1             250
+#define DEFAULT_CURRENT_LIMIT_M2             250
+#define DEFAULT_CURRENT_LIMIT_WINDOW         250
+
+// Limit switch watchdog (milliseconds, 0 = off). The origin switch must open within the release
+// timeout and the destination switch must close within the travel timeout. With a learn margin
+// (percent, 0 = off) the travel timeout tightens to the slowest recent move plus the margin.
+#define DEFAULT_RELEASE_TIMEOUT              2000
+#define DEFAULT_LEG_TRAVEL_TIMEOUT           10000
+#define DEFAULT_TILT_TRAVEL_TIMEOUT          10000
+#define DEFAULT_TRAVEL_LEARN_MARGIN          50
+
 ///////////////////////////////////////////////////////////////////////////////
 // Pin Definitions
 #ifdef USE_WAVESHARE_ESP32_C6_LCD
@@ -73,6 +157,8 @@
     #define TFT_DC    15
     #define TFT_RST   21
     #define TFT_BL    22
+    #define TFT_WIDTH  172  // Panel size before rotation
+    #define TFT_HEIGHT 320
 
     // RGB LED configuration for Waveshare ESP32-C6-LCD-1.47
     #define NUM_LEDS  1
@@ -100,6 +186,8 @@
     #define TFT_DC    11   // LCD_DC
     #define TFT_RST   9    // LCD_RST
     #define TFT_BL    14   // LCD_BL
+    #define TFT_WIDTH  170  // Panel size before rotation
+    #define TFT_HEIGHT 320
 
     // RGB LED configuration for Waveshare ESP32-S3-LCD-1.9
     #define NUM_LEDS  2  // Two WS2812 LEDs on the back of the board
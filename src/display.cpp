@@ -1,23 +1,66 @@
 #include "config.h"
 #include "display.h"
+#include "logger.h"
+#include "stance.h"
 #include <math.h>
 
-// Enum values for stance comparison (these match the main file's enum)
-#define TWO_LEG_STANCE 1
-#define THREE_LEG_STANCE 2
+#ifdef USE_WAVESHARE_ESP32_LCD
+    // Screen layout, after rotation to 320 wide. Text cells are 6x8 pixels times the text size.
+    static const int16_t STATUS_TEXT_X = 10;
+    static const int16_t STATUS_TEXT_Y = 10;
+    static const uint8_t STATUS_TEXT_SIZE = 3;
+    static const int16_t STATUS_LINE_HEIGHT = 24;
+    static const int16_t OVERLAY_TEXT_X = 8;
+    static const uint8_t OVERLAY_TEXT_SIZE = 2;
+    static const int16_t TILT_OFFSET_FROM_BOTTOM = 26;
+    static const int16_t TELEMETRY_OFFSET_FROM_BOTTOM = 50;
+    static const int16_t ROLL_CODE_RADIUS = 18;
+
+    // Tilt chart, between the status text and the telemetry line
+    static const int16_t CHART_X = 10;
+    static const int16_t CHART_Y = 62;
+    static const int16_t CHART_HEIGHT = 54;
+    static const float CHART_ANGLE_MIN = -5.0f;     // Degrees at the bottom of the chart
+    static const float CHART_ANGLE_MAX = 25.0f;     // Degrees at the top
+    static const float CHART_RATE_RANGE = 60.0f;    // Degrees per second from middle to edge
+    static const uint16_t CHART_ZERO_COLOR = 0x7BEF;   // Grey
+    static const uint16_t CHART_ANGLE_COLOR = ST77XX_WHITE;
+    static const uint16_t CHART_RATE_COLOR = ST77XX_CYAN;
+    static const uint16_t CHART_LEG_MARK_COLOR = ST77XX_YELLOW;
+    static const uint16_t CHART_TILT_MARK_COLOR = ST77XX_ORANGE;
+
+    // ChartSample flags
+    #define CHART_VALID     0x01
+    #define CHART_LEG_MARK  0x02
+    #define CHART_TILT_MARK 0x04
+#endif
 
 DisplayManager::DisplayManager()
-    : lastColor(-1)
+    : lastFrameMillis(0), lastColor(-1)
 {
+    memset(&desired, 0, sizeof(desired));
+    shown = desired;
+
     #ifdef USE_WAVESHARE_ESP32_LCD
         tft = new Adafruit_ST7789(TFT_CS, TFT_DC, TFT_RST);
-        leds = new CRGB[NUM_LEDS];
+        // The screen is used rotated, so the canvas is TFT_HEIGHT wide.
+        canvas = new TftCanvas(TFT_HEIGHT, TFT_WIDTH);
+        dirty = new DirtyRegion(TFT_HEIGHT, TFT_WIDTH);
+        portMUX_INITIALIZE(&stateLock);
+        displayTask = NULL;
         lcdText[0] = '\0';
+        tiltText[0] = '\0';
+        telemetryText[0] = '\0';
         rollCodeEnabled = false;
-        lastTiltAngleDeg = 0.0f;
-        lastTiltValid = false;
+        memset(chart, 0, sizeof(chart));
+        chartLastAngle = 0.0f;
+        chartLastValid = false;
+        chartLastMillis = 0;
     #else
         lcd = new Adafruit_RGBLCDShield();
+        memset(lcdShadow, ' ', sizeof(lcdShadow));
+        lcdCursorColumn = 0;
+        lcdCursorRow = 0;
     #endif
 }
 
@@ -35,270 +78,675 @@ void DisplayManager::begin()
         SPI.begin(TFT_SCLK, -1, TFT_MOSI, TFT_CS);
 
         // Initialize display with appropriate resolution for each board
-        #ifdef USE_WAVESHARE_ESP32_C6_LCD
-            // ESP32-C6-LCD-1.47: 172x320
-            tft->init(172, 320);
-        #elif defined(USE_WAVESHARE_ESP32_S3_LCD)
-            // ESP32-S3-LCD-1.9: 170x320
-            tft->init(170, 320);
-        #endif
+        // ESP32-C6-LCD-1.47: 172x320, ESP32-S3-LCD-1.9: 170x320
+        tft->init(TFT_WIDTH, TFT_HEIGHT);
         tft->setRotation(1);
 
-        tft->setTextColor(ST77XX_WHITE, ST77XX_BLUE);
-        tft->setTextSize(3); // Text height = 8 * scale
+        // Everything is drawn off-screen, then only the changed regions are pushed.
+        if (!canvas->begin(STRIP_ROWS))
+        {
+            LOG_ERROR("Display: no memory for the frame buffer.");
+        }
+        canvas->setTextWrap(false);
 
-        FastLED.addLeds<WS2812, RGB_PIN, RGB>(leds, NUM_LEDS);
-        FastLED.setBrightness(100); // 0–255
+        statusLeds.Begin();
 
         setBacklightColor(BLUE);
-        snprintf(lcdText, sizeof(lcdText), "Holme 3-2-3\nv1.0");
-        setLCDText(lcdText);
-        drawTiltOverlay();
+        updateStatusLeds(shown);
+        setLCDText("Holme 3-2-3\nv1.0");
+        updateTiltText(shown);
+        flush();
+
+        // From here on only the display task touches the panel.
+        xTaskCreate(DisplayTask, "display", 4096, this, tskIDLE_PRIORITY + 1, &displayTask);
     #else
-        lcd->begin(16, 2);
+        // begin() clears the screen and homes the cursor, which is what the shadow starts as.
+        lcd->begin(LCD_COLUMNS, LCD_ROWS);
         lcd->setBacklight(BLUE);
-        lcd->setCursor(2, 0);
-        lcd->print("Holme 2-3-2");
-        lcd->setCursor(0, 1);
-        lcd->print("by Neil H v1.0");
+        lastColor = BLUE;
+        writeLCDLine(0, "  Holme 2-3-2");
+        writeLCDLine(1, "by Neil H v1.0");
     #endif
 }
 
-void DisplayManager::setBacklightColor(int color)
+void DisplayManager::update()
 {
-    #ifdef USE_WAVESHARE_ESP32_LCD
-        // Only update the screen if the color has actually changed
-        if (color != lastColor)
+    #ifndef USE_WAVESHARE_ESP32_LCD
+        unsigned long now = millis();
+        if (now - lastFrameMillis < 1000 / DISPLAY_MAX_FPS)
         {
-            tft->fillScreen(color);
-            tft->setTextColor(ST77XX_WHITE, color);
-            lastColor = color;
+            return;
+        }
+        lastFrameMillis = now;
+        render();
+    #endif
+}
+
+void DisplayManager::showStatus(int stance, const char* stanceName)
+{
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        portENTER_CRITICAL(&stateLock);
+    #endif
+    desired.moving = false;
+    desired.stance = stance;
+    strncpy(desired.stanceName, stanceName, sizeof(desired.stanceName) - 1);
+    desired.stanceName[sizeof(desired.stanceName) - 1] = '\0';
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        portEXIT_CRITICAL(&stateLock);
+    #endif
+    stateChanged();
+}
+
+void DisplayManager::showTransition(int stanceTarget)
+{
+    // Called on every loop() pass during a transition, so only wake the display on a change.
+    if (desired.moving && desired.target == stanceTarget)
+    {
+        return;
+    }
+
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        portENTER_CRITICAL(&stateLock);
+    #endif
+    desired.moving = true;
+    desired.target = stanceTarget;
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        portEXIT_CRITICAL(&stateLock);
+    #endif
+    stateChanged();
+}
+
+void DisplayManager::showRollCodeEnabled(bool enabled, unsigned long disarmMillis)
+{
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        portENTER_CRITICAL(&stateLock);
+    #endif
+    desired.armed = enabled;
+    desired.disarmMillis = enabled ? disarmMillis : 0;
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        portEXIT_CRITICAL(&stateLock);
+    #endif
+    stateChanged();
+}
 
-            // Since the screen is cleared when we change the backlight color, we need to redraw the existing text and indicators.
-            setLCDText(lcdText);
-            drawRollCodeIndicator();
-            drawTiltOverlay();
+void DisplayManager::showTiltAngle(float angleDeg, bool valid)
+{
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        if (valid == desired.tiltValid && (!valid || fabsf(angleDeg - desired.tiltAngleDeg) < 0.05f))
+        {
+            return;
         }
+        portENTER_CRITICAL(&stateLock);
+        desired.tiltAngleDeg = angleDeg;
+        desired.tiltValid = valid;
+        portEXIT_CRITICAL(&stateLock);
+        stateChanged();
+    #else
+        (void)angleDeg;
+        (void)valid;
+    #endif
+}
 
-        CRGB ledColor = CRGB::Black;
-        switch (color)
+void DisplayManager::showTelemetry(int legCurrent, int tiltCurrent, int battery, bool valid)
+{
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        if (valid == desired.telemetryValid && legCurrent == desired.legCurrent &&
+            tiltCurrent == desired.tiltCurrent && battery == desired.battery)
         {
-            case OFF:
-                ledColor = CRGB::Black;
-                break;
-            case RED:
-                ledColor = CRGB::Red;
-                break;
-            case YELLOW:
-                ledColor = CRGB::Yellow;
-                break;
-            case GREEN:
-                ledColor = CRGB::Green;
-                break;
-            case TEAL:
-                ledColor = CRGB::Cyan;
-                break;
-            case BLUE:
-                ledColor = CRGB::Blue;
-                break;
-            case VIOLET:
-                ledColor = CRGB::Purple;
-                break;
-            case WHITE:
-                ledColor = CRGB::White;
-                break;
+            return;
         }
+        portENTER_CRITICAL(&stateLock);
+        desired.legCurrent = legCurrent;
+        desired.tiltCurrent = tiltCurrent;
+        desired.battery = battery;
+        desired.telemetryValid = valid;
+        portEXIT_CRITICAL(&stateLock);
+        stateChanged();
+    #else
+        (void)legCurrent;
+        (void)tiltCurrent;
+        (void)battery;
+        (void)valid;
+    #endif
+}
 
-        for (int i = 0; i < NUM_LEDS; i++)
+void DisplayManager::addTiltSample(float angleDeg, bool valid, bool legEvent, bool tiltEvent, unsigned long nowMs)
+{
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        ChartSample sample;
+        sample.flags = (valid ? CHART_VALID : 0) | (legEvent ? CHART_LEG_MARK : 0) | (tiltEvent ? CHART_TILT_MARK : 0);
+        sample.angle = valid ? (int16_t)lroundf(angleDeg * 10.0f) : 0;
+        sample.rate = 0;
+        if (valid && chartLastValid && nowMs != chartLastMillis)
         {
-            leds[i] = ledColor;
+            float rate = (angleDeg - chartLastAngle) * 1000.0f / (nowMs - chartLastMillis);
+            sample.rate = (int16_t)lroundf(constrain(rate, -999.0f, 999.0f) * 10.0f);
         }
-        FastLED.show();
+        chartLastAngle = angleDeg;
+        chartLastValid = valid;
+        chartLastMillis = nowMs;
+
+        // The display task draws from shown.chartHead, which lags desired.chartHead, and leaves
+        // the slot after the newest one blank, so the slot written here is not on screen yet.
+        portENTER_CRITICAL(&stateLock);
+        chart[desired.chartHead % CHART_WIDTH] = sample;
+        desired.chartHead++;
+        portEXIT_CRITICAL(&stateLock);
+        stateChanged();
     #else
-        lcd->setBacklight(color);
+        (void)angleDeg;
+        (void)valid;
+        (void)legEvent;
+        (void)tiltEvent;
+        (void)nowMs;
     #endif
 }
 
-void DisplayManager::showStatus(int stance, const char* stanceName)
+int DisplayManager::stateColor(const DisplayState& state)
 {
+    if (state.moving)
+    {
+        return GREEN;
+    }
+    if (state.stance > THREE_LEG_STANCE)
+    {
+        return RED;
+    }
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        // The TFT has its own armed indicator.
+        return BLUE;
+    #else
+        return state.armed ? VIOLET : BLUE;
+    #endif
+}
+
+static bool SameState(const DisplayState& a, const DisplayState& b)
+{
+    return a.moving == b.moving && a.stance == b.stance && a.target == b.target &&
+           strcmp(a.stanceName, b.stanceName) == 0 && a.armed == b.armed && a.disarmMillis == b.disarmMillis &&
+           a.tiltValid == b.tiltValid && a.tiltAngleDeg == b.tiltAngleDeg &&
+           a.telemetryValid == b.telemetryValid && a.legCurrent == b.legCurrent &&
+           a.tiltCurrent == b.tiltCurrent && a.battery == b.battery && a.chartHead == b.chartHead;
+}
+
+void DisplayManager::render()
+{
+    DisplayState state;
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        portENTER_CRITICAL(&stateLock);
+        state = desired;
+        portEXIT_CRITICAL(&stateLock);
+    #else
+        state = desired;
+    #endif
+
+    if (SameState(state, shown))
+    {
+        return;
+    }
+
+    const char* targetName = "Unknown";
+    if (state.target == TWO_LEG_STANCE)
+    {
+        targetName = "Two Legs";
+    }
+    else if (state.target == THREE_LEG_STANCE)
+    {
+        targetName = "Three Legs";
+    }
+
     #ifdef USE_WAVESHARE_ESP32_LCD
-        if (stance <= 2)
+        setBacklightColor(stateColor(state));
+        updateStatusLeds(state);
+
+        char text[sizeof(lcdText)];
+        if (state.moving)
         {
-            // Stance is good.
-            setBacklightColor(BLUE);
-            snprintf(lcdText, sizeof(lcdText), "Status: OK     \n%d: %s", stance, stanceName);
+            snprintf(text, sizeof(text), "Status: Moving  \nGoto %s", targetName);
+        }
+        else if (state.stance <= THREE_LEG_STANCE)
+        {
+            snprintf(text, sizeof(text), "Status: OK     \n%d: %s", state.stance, state.stanceName);
         }
         else
         {
-            // Stance is error.
-            setBacklightColor(RED);
-            snprintf(lcdText, sizeof(lcdText), "Status: Error  \n%d: %s", stance, stanceName);
+            snprintf(text, sizeof(text), "Status: Error  \n%d: %s", state.stance, state.stanceName);
+        }
+        setLCDText(text);
+
+        if (state.armed != rollCodeEnabled)
+        {
+            rollCodeEnabled = state.armed;
+            ScreenRect r = rollCodeIndicatorRect();
+            dirty->add(r.x, r.y, r.w, r.h);
         }
 
-        setLCDText(lcdText);
+        updateTiltText(state);
+        updateTelemetryText(state);
+        // The chart is drawn from shown.chartHead, so move it before flushing.
+        markChartColumns(shown.chartHead, state.chartHead);
+        shown.chartHead = state.chartHead;
+        flush();
     #else
-        lcd->setCursor(0, 0);
-        lcd->print("Status:"); //7
-        if (stance <= 2)
+        int color = stateColor(state);
+        if (color != lastColor)
         {
-            lcd->setCursor(8, 0);
-            // Stance is good.
-            lcd->setBacklight(BLUE);
-            lcd->print("OK"); // 10
-            lcd->setCursor(10, 0);
-            lcd->print("    "); // to end
+            lcd->setBacklight(color);
+            lastColor = color;
         }
-        else
+
+        if (state.moving != shown.moving || state.stance != shown.stance || state.target != shown.target ||
+            strcmp(state.stanceName, shown.stanceName) != 0)
         {
-            lcd->setCursor(8, 0);
-            // Stance is error.
-            lcd->setBacklight(RED);
-            lcd->print("Error");
-        }
-        lcd->setCursor(0, 1);
-        lcd->print(stance); // 1 character
-        lcd->setCursor(1, 1);
-        lcd->print(": "); // 2
-        lcd->setCursor(3, 1);
-        lcd->print(stanceName);
+            if (state.moving)
+            {
+                writeLCDLine(0, "Status: Moving");
+            }
+            else
+            {
+                writeLCDLine(0, state.stance <= THREE_LEG_STANCE ? "Status: OK" : "Status: Error");
+            }
+
+            char detail[LCD_COLUMNS + 1];
+            if (state.moving)
+            {
+                snprintf(detail, sizeof(detail), "Goto %s", targetName);
+            }
+            else
+            {
+                snprintf(detail, sizeof(detail), "%d: %.12s", state.stance, state.stanceName);
+            }
+            writeLCDLine(1, detail);
+        }
     #endif
-}
 
-void DisplayManager::showTransition(int stanceTarget)
-{
-    #ifdef USE_WAVESHARE_ESP32_LCD
-        setBacklightColor(GREEN);
+    shown = state;
+}
 
-        if (stanceTarget == TWO_LEG_STANCE)
+#ifndef USE_WAVESHARE_ESP32_LCD
+    void DisplayManager::writeLCDLine(uint8_t row, const char* text)
+    {
+        bool ended = false;
+        for (uint8_t column = 0; column < LCD_COLUMNS; column++)
         {
-            snprintf(lcdText, sizeof(lcdText), "Status: Moving  \nGoto Two Legs   ");
+            ended = ended || text[column] == '\0';
+            char c = ended ? ' ' : text[column];
+            if (lcdShadow[row][column] == c)
+            {
+                continue;
+            }
+
+            // The LCD moves the cursor on after each character, so a run of changes
+            // needs only one cursor move.
+            if (lcdCursorRow != row || lcdCursorColumn != column)
+            {
+                lcd->setCursor(column, row);
+            }
+            lcd->write(c);
+            lcdShadow[row][column] = c;
+            lcdCursorRow = row;
+            lcdCursorColumn = column + 1;
         }
-        else if (stanceTarget == THREE_LEG_STANCE)
+    }
+#endif
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+    void DisplayManager::stateChanged()
+    {
+        if (displayTask != NULL)
         {
-            snprintf(lcdText, sizeof(lcdText), "Status: Moving  \nGoto Three Legs ");
+            xTaskNotifyGive(displayTask);
         }
-        else
+    }
+
+    void DisplayManager::setBacklightColor(int color)
+    {
+        // Only update the screen and LEDs if the color has actually changed
+        if (color == lastColor)
         {
-            snprintf(lcdText, sizeof(lcdText), "Status: Moving  \nGoto Unknown    ");
+            return;
         }
 
-        setLCDText(lcdText);
-    #else
-        lcd->setCursor(0, 0);
-        lcd->print("Status: Moving  ");
-        lcd->setBacklight(GREEN);
+        // The background is behind everything, so the whole screen has to be pushed.
+        lastColor = color;
+        dirty->addAll();
+    }
 
-        lcd->setCursor(0, 1);
+    void DisplayManager::updateStatusLeds(const DisplayState& state)
+    {
+        CRGB color = CRGB::Black;
+        switch (stateColor(state))
+        {
+            case OFF:
+                color = CRGB::Black;
+                break;
+            case RED:
+                color = CRGB::Red;
+                break;
+            case YELLOW:
+                color = CRGB::Yellow;
+                break;
+            case GREEN:
+                color = CRGB::Green;
+                break;
+            case TEAL:
+                color = CRGB::Cyan;
+                break;
+            case BLUE:
+                color = CRGB::Blue;
+                break;
+            case VIOLET:
+                color = CRGB::Purple;
+                break;
+            case WHITE:
+                color = CRGB::White;
+                break;
+        }
 
-        if (stanceTarget == TWO_LEG_STANCE)
+        if (state.moving)
         {
-            lcd->print("Goto Two Legs   ");
+            statusLeds.Show(LED_CHASE, color);
         }
-        else if (stanceTarget == THREE_LEG_STANCE)
+        else if (state.stance > THREE_LEG_STANCE)
         {
-            lcd->print("Goto Three Legs ");
+            statusLeds.Show(LED_BLINK, color);
         }
-    #endif
-}
-
-void DisplayManager::showRollCodeEnabled(bool enabled)
-{
-    #ifdef USE_WAVESHARE_ESP32_LCD
-        rollCodeEnabled = enabled;
-        drawRollCodeIndicator();
-    #else
-        if (enabled)
+        else if (state.armed)
         {
-            lcd->setBacklight(VIOLET);
+            statusLeds.Show(LED_PULSE, color, state.disarmMillis);
         }
         else
         {
-            lcd->setBacklight(BLUE);
+            statusLeds.Show(LED_SOLID, color);
         }
-    #endif
-}
+    }
 
-void DisplayManager::showTiltAngle(float angleDeg, bool valid)
-{
-    #ifdef USE_WAVESHARE_ESP32_LCD
-        if (valid == lastTiltValid && (!valid || fabsf(angleDeg - lastTiltAngleDeg) < 0.2f))
+    void DisplayManager::DisplayTask(void* param)
+    {
+        DisplayManager* self = (DisplayManager*)param;
+        const TickType_t framePeriod = pdMS_TO_TICKS(1000 / DISPLAY_MAX_FPS);
+        TickType_t lastFrame = xTaskGetTickCount();
+
+        for (;;)
         {
-            return;
+            // Sleep until something changes, then wait out the rest of the frame period so a
+            // burst of changes is drawn once.
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            TickType_t sinceLast = xTaskGetTickCount() - lastFrame;
+            if (sinceLast < framePeriod)
+            {
+                vTaskDelay(framePeriod - sinceLast);
+            }
+            lastFrame = xTaskGetTickCount();
+            self->render();
         }
-        lastTiltAngleDeg = angleDeg;
-        lastTiltValid = valid;
-        drawTiltOverlay();
-    #else
-        (void)angleDeg;
-        (void)valid;
-    #endif
-}
+    }
+#endif
 
 #ifdef USE_WAVESHARE_ESP32_LCD
     void DisplayManager::setLCDText(const char* message)
     {
-        int cx = 10;
-        int cy = 10;
-        int lineHeight = 24;
-        tft->setCursor(cx, cy);
+        setBlockText(lcdText, sizeof(lcdText), message,
+                     STATUS_TEXT_X, STATUS_TEXT_Y, STATUS_TEXT_SIZE, STATUS_LINE_HEIGHT);
+    }
+
+    void DisplayManager::setBlockText(char* current, size_t length, const char* text,
+                                      int16_t x, int16_t y, uint8_t size, int16_t lineHeight)
+    {
+        // Walk both strings cell by cell. A missing character draws as background, same as a space.
+        int16_t cellWidth = 6 * size;
+        int16_t cellHeight = 8 * size;
+        const char* a = current;
+        const char* b = text;
+        int16_t line = 0;
+        while (*a || *b)
+        {
+            int16_t column = 0;
+            int16_t runStart = -1;
+            while ((*a && *a != '\n') || (*b && *b != '\n'))
+            {
+                char oldChar = (*a && *a != '\n') ? *a++ : ' ';
+                char newChar = (*b && *b != '\n') ? *b++ : ' ';
+                if (oldChar != newChar && runStart < 0)
+                {
+                    runStart = column;
+                }
+                else if (oldChar == newChar && runStart >= 0)
+                {
+                    dirty->add(x + runStart * cellWidth, y + line * lineHeight,
+                               (column - runStart) * cellWidth, cellHeight);
+                    runStart = -1;
+                }
+                column++;
+            }
+            if (runStart >= 0)
+            {
+                dirty->add(x + runStart * cellWidth, y + line * lineHeight,
+                           (column - runStart) * cellWidth, cellHeight);
+            }
+            if (*a == '\n') a++;
+            if (*b == '\n') b++;
+            line++;
+        }
+
+        strncpy(current, text, length - 1);
+        current[length - 1] = '\0';
+    }
+
+    void DisplayManager::drawBlockText(const char* text, int16_t x, int16_t y, uint8_t size, int16_t lineHeight)
+    {
+        canvas->setTextSize(size);
+        canvas->setCursor(x, y);
 
-        const char* lineStart = message;
+        const char* lineStart = text;
         while (*lineStart)
         {
             const char* lineEnd = strchr(lineStart, '\n');
             if (lineEnd)
             {
-                tft->write(lineStart, lineEnd - lineStart);
-                cy += lineHeight;
-                tft->setCursor(10, cy);
+                canvas->write(lineStart, lineEnd - lineStart);
+                y += lineHeight;
+                canvas->setCursor(x, y);
                 lineStart = lineEnd + 1;
             }
             else
             {
-                tft->print(lineStart);
+                canvas->print(lineStart);
                 break;
             }
         }
     }
 
-    void DisplayManager::drawRollCodeIndicator()
+    ScreenRect DisplayManager::rollCodeIndicatorRect()
     {
-        int screenWidth = tft->width();
-        int screenHeight = tft->height();
-        int radius = 18;
-        int cx = screenWidth - radius - 8;
-        int cy = screenHeight - radius - 8;
+        int16_t cx = canvas->width() - ROLL_CODE_RADIUS - 8;
+        int16_t cy = canvas->height() - ROLL_CODE_RADIUS - 8;
+        ScreenRect r = { (int16_t)(cx - ROLL_CODE_RADIUS), (int16_t)(cy - ROLL_CODE_RADIUS),
+                         (int16_t)(2 * ROLL_CODE_RADIUS + 1), (int16_t)(2 * ROLL_CODE_RADIUS + 1) };
+        return r;
+    }
 
+    void DisplayManager::drawRollCodeIndicator()
+    {
+        // Drawn over the background, so there is nothing to do when it is off.
         if (rollCodeEnabled)
         {
-            tft->fillCircle(cx, cy, radius, VIOLET);
+            ScreenRect r = rollCodeIndicatorRect();
+            canvas->fillCircle(r.x + ROLL_CODE_RADIUS, r.y + ROLL_CODE_RADIUS, ROLL_CODE_RADIUS, VIOLET);
+        }
+    }
+
+    void DisplayManager::updateTiltText(const DisplayState& state)
+    {
+        char text[sizeof(tiltText)];
+        if (state.tiltValid)
+        {
+            // Fixed-width string keeps the unchanged characters in the same cells.
+            snprintf(text, sizeof(text), "Tilt:%6.1f deg ", state.tiltAngleDeg);
         }
         else
         {
-            // Draw circle in background color to hide it
-            tft->fillCircle(cx, cy, radius, lastColor);
+            snprintf(text, sizeof(text), "Tilt:  --.- deg ");
         }
+        setBlockText(tiltText, sizeof(tiltText), text, OVERLAY_TEXT_X,
+                     canvas->height() - TILT_OFFSET_FROM_BOTTOM, OVERLAY_TEXT_SIZE, 0);
     }
 
-    void DisplayManager::drawTiltOverlay()
+    void DisplayManager::updateTelemetryText(const DisplayState& state)
     {
-        int x = 8;
-        int y = tft->height() - 28;
-        tft->setTextSize(2);
-        tft->setCursor(x, y + 2);
-
-        char tiltText[24];
-        if (lastTiltValid)
+        char text[sizeof(telemetryText)];
+        if (state.telemetryValid)
         {
-            // Fixed-width string avoids leftover characters and reduces visible redraw artifacts.
-            snprintf(tiltText, sizeof(tiltText), "Tilt:%6.1f deg ", lastTiltAngleDeg);
+            snprintf(text, sizeof(text), "L%5.1fA T%5.1fA %4.1fV",
+                     state.legCurrent / 10.0f, state.tiltCurrent / 10.0f, state.battery / 10.0f);
         }
         else
         {
-            snprintf(tiltText, sizeof(tiltText), "Tilt:  --.- deg ");
+            snprintf(text, sizeof(text), "L --.-A T --.-A --.-V");
         }
-        tft->print(tiltText);
+        setBlockText(telemetryText, sizeof(telemetryText), text, OVERLAY_TEXT_X,
+                     canvas->height() - TELEMETRY_OFFSET_FROM_BOTTOM, OVERLAY_TEXT_SIZE, 0);
+    }
 
-        tft->setTextSize(3);
+    void DisplayManager::markChartColumns(uint32_t from, uint32_t to)
+    {
+        if (from == to)
+        {
+            return;
+        }
+        if (to - from + CHART_GAP + 1 >= (uint32_t)CHART_WIDTH)
+        {
+            dirty->add(CHART_X, CHART_Y, CHART_WIDTH, CHART_HEIGHT);
+            return;
+        }
+
+        // New samples, the gap that moved ahead of them and the oldest column left, which now
+        // starts the trace. Split where it wraps.
+        int16_t start = from % CHART_WIDTH;
+        int16_t count = to - from + CHART_GAP + 1;
+        int16_t first = min(count, (int16_t)(CHART_WIDTH - start));
+        dirty->add(CHART_X + start, CHART_Y, first, CHART_HEIGHT);
+        if (count > first)
+        {
+            dirty->add(CHART_X, CHART_Y, count - first, CHART_HEIGHT);
+        }
+    }
+
+    // Chart row for a value, clamped to the chart.
+    static int16_t ChartRow(float value, float bottom, float top)
+    {
+        float fraction = (value - bottom) / (top - bottom);
+        int16_t row = CHART_Y + CHART_HEIGHT - 1 - (int16_t)lroundf(fraction * (CHART_HEIGHT - 1));
+        return constrain(row, CHART_Y, (int16_t)(CHART_Y + CHART_HEIGHT - 1));
+    }
+
+    // Draw one trace segment: a vertical run joining the previous sample to this one.
+    static void DrawChartTrace(Adafruit_GFX* gfx, int16_t x, int16_t row, int16_t previousRow, bool joined, uint16_t color)
+    {
+        if (!joined)
+        {
+            gfx->drawPixel(x, row, color);
+            return;
+        }
+        int16_t top = min(row, previousRow);
+        int16_t bottom = max(row, previousRow);
+        gfx->drawFastVLine(x, top, bottom - top + 1, color);
+    }
+
+    void DisplayManager::drawChart(uint32_t head)
+    {
+        const ScreenRect& window = canvas->getWindow();
+        if (head == 0 || !canvas->intersects(CHART_X, CHART_Y, CHART_WIDTH, CHART_HEIGHT))
+        {
+            return;
+        }
+
+        int16_t firstColumn = max((int16_t)(window.x - CHART_X), (int16_t)0);
+        int16_t lastColumn = min((int16_t)(window.x + window.w - CHART_X), (int16_t)CHART_WIDTH);
+        int16_t cursor = head % CHART_WIDTH;
+        int16_t zeroRow = ChartRow(0.0f, CHART_ANGLE_MIN, CHART_ANGLE_MAX);
+
+        for (int16_t column = firstColumn; column < lastColumn; column++)
+        {
+            // Columns just ahead of the newest sample are left blank as the sweep gap.
+            int16_t age = (column - cursor + CHART_WIDTH) % CHART_WIDTH;
+            int32_t index = (int32_t)head - CHART_WIDTH + age;
+            if (age < CHART_GAP || index < 0)
+            {
+                continue;
+            }
+
+            int16_t x = CHART_X + column;
+            canvas->drawPixel(x, zeroRow, CHART_ZERO_COLOR);
+
+            const ChartSample& sample = chart[column];
+            if (sample.flags & CHART_LEG_MARK)
+            {
+                canvas->drawFastVLine(x, CHART_Y, CHART_HEIGHT / 2, CHART_LEG_MARK_COLOR);
+            }
+            if (sample.flags & CHART_TILT_MARK)
+            {
+                canvas->drawFastVLine(x, CHART_Y + CHART_HEIGHT / 2, CHART_HEIGHT - CHART_HEIGHT / 2, CHART_TILT_MARK_COLOR);
+            }
+            if (!(sample.flags & CHART_VALID))
+            {
+                continue;
+            }
+
+            const ChartSample& previous = chart[(column + CHART_WIDTH - 1) % CHART_WIDTH];
+            bool joined = age > CHART_GAP && index > 0 && (previous.flags & CHART_VALID);
+
+            DrawChartTrace(canvas, x,
+                           ChartRow(sample.rate / 10.0f, -CHART_RATE_RANGE, CHART_RATE_RANGE),
+                           ChartRow(previous.rate / 10.0f, -CHART_RATE_RANGE, CHART_RATE_RANGE),
+                           joined, CHART_RATE_COLOR);
+            DrawChartTrace(canvas, x,
+                           ChartRow(sample.angle / 10.0f, CHART_ANGLE_MIN, CHART_ANGLE_MAX),
+                           ChartRow(previous.angle / 10.0f, CHART_ANGLE_MIN, CHART_ANGLE_MAX),
+                           joined, CHART_ANGLE_COLOR);
+        }
+    }
+
+    void DisplayManager::renderScreen()
+    {
+        canvas->fillScreen(lastColor);
+        canvas->setTextColor(ST77XX_WHITE);
+        if (canvas->intersects(0, STATUS_TEXT_Y, canvas->width(), 2 * STATUS_LINE_HEIGHT))
+        {
+            drawBlockText(lcdText, STATUS_TEXT_X, STATUS_TEXT_Y, STATUS_TEXT_SIZE, STATUS_LINE_HEIGHT);
+        }
+        drawChart(shown.chartHead);
+        drawRollCodeIndicator();
+        drawBlockText(telemetryText, OVERLAY_TEXT_X, canvas->height() - TELEMETRY_OFFSET_FROM_BOTTOM,
+                      OVERLAY_TEXT_SIZE, 0);
+        drawBlockText(tiltText, OVERLAY_TEXT_X, canvas->height() - TILT_OFFSET_FROM_BOTTOM,
+                      OVERLAY_TEXT_SIZE, 0);
+    }
+
+    void DisplayManager::flush()
+    {
+        if (dirty->size() == 0 || canvas->capacity() == 0)
+        {
+            return;
+        }
+
+        // Render each dirty rectangle in as many bands as the canvas needs (one with PSRAM)
+        // and push it with a single address window per band.
+        tft->startWrite();
+        for (uint8_t i = 0; i < dirty->size(); i++)
+        {
+            const ScreenRect& r = dirty->get(i);
+            int16_t bandRows = canvas->capacity() / r.w;
+            for (int16_t y = r.y; y < r.y + r.h; y += bandRows)
+            {
+                int16_t rows = min(bandRows, (int16_t)(r.y + r.h - y));
+                canvas->setWindow(r.x, y, r.w, rows);
+                renderScreen();
+                tft->setAddrWindow(r.x, y, r.w, rows);
+                tft->writePixels(canvas->getBuffer(), (uint32_t)r.w * rows);
+            }
+        }
+        tft->endWrite();
+        dirty->clear();
     }
 #endif
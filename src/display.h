@@ -9,6 +9,10 @@
     #include <Adafruit_GFX.h>
     #include <Adafruit_ST7789.h>
     #include <FastLED.h>
+    #include <freertos/FreeRTOS.h>
+    #include <freertos/task.h>
+    #include "tftcanvas.h"
+    #include "statusleds.h"
 #else
     #include "Adafruit_RGBLCDShield.h"
 #endif
@@ -38,16 +42,36 @@
     #endif
 #endif
 
+// What the display should be showing. The show* calls only change this; it is drawn
+// later, and only if it differs from what is already on screen.
+struct DisplayState
+{
+    bool moving;            // Show the transition target instead of the stance
+    int8_t stance;
+    int8_t target;
+    char stanceName[16];
+    bool armed;             // Rolling code transitions enabled
+    unsigned long disarmMillis; // When the rolling code enable times out (0 = no timeout)
+    bool tiltValid;
+    float tiltAngleDeg;
+    bool telemetryValid;
+    int16_t legCurrent;     // 0.1 A
+    int16_t tiltCurrent;    // 0.1 A
+    int16_t battery;        // 0.1 V
+    uint32_t chartHead;     // Tilt chart samples added so far
+};
+
 class DisplayManager
 {
     public:
         DisplayManager();
 
-        // Initialize display hardware
+        // Initialize display hardware. On the Waveshare boards this also starts the display task.
         void begin();
 
-        // Set backlight color (and RGB LED if Waveshare)
-        void setBacklightColor(int color);
+        // Draw any changes, at most DISPLAY_MAX_FPS times a second. Call from loop().
+        // Does nothing on the Waveshare boards, where the display task draws.
+        void update();
 
         // Display current stance status
         void showStatus(int stance, const char* stanceName);
@@ -55,33 +79,130 @@ class DisplayManager
         // Display transition message
         void showTransition(int stanceTarget);
 
-        // Show rolling code enabled/disabled status indicator (Waveshare TFT only)
-        void showRollCodeEnabled(bool enabled);
+        // Show rolling code enabled/disabled status indicator. disarmMillis is the millis() at
+        // which it times out, which the status LEDs count down to.
+        void showRollCodeEnabled(bool enabled, unsigned long disarmMillis = 0);
 
         // Show current tilt angle in degrees (Waveshare TFT only)
         void showTiltAngle(float angleDeg, bool valid);
 
+        // Show motor currents (0.1 A) and battery voltage (0.1 V) (Waveshare TFT only)
+        void showTelemetry(int legCurrent, int tiltCurrent, int battery, bool valid);
+
+        // Add a sample to the scrolling tilt chart, with markers for leg/tilt limit switch
+        // changes since the last sample (Waveshare TFT only)
+        void addTiltSample(float angleDeg, bool valid, bool legEvent, bool tiltEvent, unsigned long nowMs);
+
     private:
+        DisplayState desired;   // Written by the control loop
+        DisplayState shown;     // What was last drawn
+        bool shownValid;
+        unsigned long lastFrameMillis;
+
+        // Draw the desired state if it differs from what is shown
+        void render();
+
+        // Background / backlight color for a state
+        static int stateColor(const DisplayState& state);
+
         #ifdef USE_WAVESHARE_ESP32_LCD
+            // Rows per band when the frame doesn't fit in PSRAM (320 x 16 x 2 bytes = 10KB)
+            static const uint16_t STRIP_ROWS = 16;
+
+            // Tilt chart: one column per sample, drawn as a sweep with a blank gap ahead of
+            // the newest column, so each new sample only touches a couple of columns.
+            static const int16_t CHART_WIDTH = 300;
+            static const int16_t CHART_GAP = 4;
+
+            struct ChartSample
+            {
+                int16_t angle;      // 0.1 degree
+                int16_t rate;       // 0.1 degree per second
+                uint8_t flags;      // CHART_* flags
+            };
+
+            ChartSample chart[CHART_WIDTH];
+            float chartLastAngle;
+            bool chartLastValid;
+            unsigned long chartLastMillis;
+
             // Waveshare ESP32 display objects
             Adafruit_ST7789* tft;
-            CRGB* leds;
+            StatusLeds statusLeds;
+            TftCanvas* canvas;
+            DirtyRegion* dirty;
+
+            // Guards desired between the control loop and the display task
+            portMUX_TYPE stateLock;
+            TaskHandle_t displayTask;
+
+            // What is on screen. Each setter diffs against these and marks only what changed.
             char lcdText[256];
+            char tiltText[24];
+            char telemetryText[32];
             bool rollCodeEnabled;
-            float lastTiltAngleDeg;
-            bool lastTiltValid;
+
+            // Wake the display task
+            void stateChanged();
+
+            // Set background color
+            void setBacklightColor(int color);
+
+            // Pick the status LED effect for a state
+            void updateStatusLeds(const DisplayState& state);
 
             // Internal text setter for Waveshare
             void setLCDText(const char* message);
 
+            // Replace the text of one block, marking the character cells that changed
+            void setBlockText(char* current, size_t length, const char* text,
+                              int16_t x, int16_t y, uint8_t size, int16_t lineHeight);
+
+            // Draw a block of text into the canvas
+            void drawBlockText(const char* text, int16_t x, int16_t y, uint8_t size, int16_t lineHeight);
+
+            // Bounding box of the roll code indicator circle
+            ScreenRect rollCodeIndicatorRect();
+
             // Draw the roll code indicator circle
             void drawRollCodeIndicator();
 
-            // Draw tilt angle overlay
-            void drawTiltOverlay();
+            // Format the tilt angle overlay
+            void updateTiltText(const DisplayState& state);
+
+            // Format the motor current / battery overlay
+            void updateTelemetryText(const DisplayState& state);
+
+            // Mark the chart columns changed by adding samples [from, to)
+            void markChartColumns(uint32_t from, uint32_t to);
+
+            // Draw the chart columns that fall inside the canvas window
+            void drawChart(uint32_t head);
+
+            // Draw the whole screen into the canvas window
+            void renderScreen();
+
+            // Push the dirty regions to the panel
+            void flush();
+
+            static void DisplayTask(void* param);
         #else
+            static const uint8_t LCD_COLUMNS = 16;
+            static const uint8_t LCD_ROWS = 2;
+
             // Arduino Pro Micro LCD shield object
             Adafruit_RGBLCDShield* lcd;
+
+            // What the LCD is showing, and where its cursor is. Every byte goes over I2C through
+            // the shield's port expander, so only changed characters are sent.
+            char lcdShadow[LCD_ROWS][LCD_COLUMNS];
+            uint8_t lcdCursorColumn;
+            uint8_t lcdCursorRow;
+
+            void stateChanged() {}
+
+            // Show text on one row, padded with spaces, writing only the characters that changed
+            void writeLCDLine(uint8_t row, const char* text);
         #endif
 
         int lastColor;
@@ -0,0 +1,388 @@
+#include "config.h"
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#include "eventlog.h"
+#include "logger.h"
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <esp_system.h>
+
+static const char* NVS_NAMESPACE = "r2d2log";
+
+EventLog::EventLog()
+    : mounted(false), bootCount(0), nextSequence(0), dropped(0),
+      head(0), count(0), oldestQueuedMs(0), flushRequested(false),
+      currentSegment(0), fileLock(NULL), writerTask(NULL)
+{
+    portMUX_INITIALIZE(&bufferLock);
+    for (uint8_t i = 0; i < SEGMENT_COUNT; i++)
+    {
+        segmentRecords[i] = 0;
+    }
+}
+
+void EventLog::Begin()
+{
+    // The boot counter lives in NVS so it survives a log format.
+    Preferences preferences;
+    preferences.begin(NVS_NAMESPACE, false);
+    bootCount = preferences.getUShort("boots", 0) + 1;
+    preferences.putUShort("boots", bootCount);
+    preferences.end();
+
+    // Format on first use so a blank partition just works.
+    mounted = LittleFS.begin(true);
+    if (!mounted)
+    {
+        LOG_WARN("Event log: LittleFS mount failed, logging to RAM only.");
+    }
+
+    fileLock = xSemaphoreCreateMutex();
+    if (mounted)
+    {
+        ScanSegments();
+    }
+
+    // Same priority as loop() so it time-slices with the control loop instead of starving.
+    xTaskCreate(WriterTask, "eventlog", 4096, this, tskIDLE_PRIORITY + 1, &writerTask);
+
+    Record(EVENT_BOOT, (uint8_t)esp_reset_reason(), bootCount);
+}
+
+void EventLog::Record(EventType type, uint8_t code, int32_t arg)
+{
+    bool notify = false;
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&bufferLock);
+    if (count >= BUFFER_RECORDS)
+    {
+        dropped++;
+    }
+    else
+    {
+        EventRecord& r = buffer[head];
+        r.sequence = nextSequence++;
+        r.timestampMs = now;
+        r.arg = arg;
+        r.bootCount = bootCount;
+        r.type = (uint8_t)type;
+        r.code = code;
+
+        if (count == 0)
+        {
+            oldestQueuedMs = now;
+        }
+        head = (head + 1) % BUFFER_RECORDS;
+        count++;
+        notify = (count >= PAGE_RECORDS);
+    }
+    portEXIT_CRITICAL(&bufferLock);
+
+    // Only wake the writer once a full page is ready; partial pages wait for the age timeout.
+    if (notify && writerTask != NULL)
+    {
+        xTaskNotifyGive(writerTask);
+    }
+}
+
+void EventLog::RequestFlush()
+{
+    flushRequested = true;
+    if (writerTask != NULL)
+    {
+        xTaskNotifyGive(writerTask);
+    }
+}
+
+size_t EventLog::ReadNewest(uint32_t skip, EventRecord* out, size_t maxCount)
+{
+    size_t n = 0;
+    if (fileLock == NULL || maxCount == 0)
+    {
+        return 0;
+    }
+
+    xSemaphoreTake(fileLock, portMAX_DELAY);
+
+    // Records still in RAM are the newest ones.
+    portENTER_CRITICAL(&bufferLock);
+    for (uint8_t i = 0; i < count && n < maxCount; i++)
+    {
+        uint8_t index = (head + BUFFER_RECORDS - 1 - i) % BUFFER_RECORDS;
+        if (skip > 0)
+        {
+            skip--;
+            continue;
+        }
+        out[n++] = buffer[index];
+    }
+    portEXIT_CRITICAL(&bufferLock);
+
+    // Then walk the segments from the current one backwards.
+    for (uint8_t s = 0; s < SEGMENT_COUNT && n < maxCount && mounted; s++)
+    {
+        uint8_t segment = (currentSegment + SEGMENT_COUNT - s) % SEGMENT_COUNT;
+        uint32_t records = segmentRecords[segment];
+        if (skip >= records)
+        {
+            skip -= records;
+            continue;
+        }
+
+        uint32_t last = records - 1 - skip;
+        uint32_t room = maxCount - n;
+        uint32_t take = (room < last + 1) ? room : last + 1;
+        uint32_t first = last + 1 - take;
+        skip = 0;
+
+        char path[24];
+        SegmentPath(segment, path, sizeof(path));
+        File file = LittleFS.open(path, "r");
+        if (!file)
+        {
+            continue;
+        }
+        file.seek(first * sizeof(EventRecord));
+        size_t got = file.read((uint8_t*)&out[n], take * sizeof(EventRecord)) / sizeof(EventRecord);
+        file.close();
+
+        // Segment files are oldest first, reverse the block so the output stays newest first.
+        for (size_t a = n, b = n + got - 1; got > 0 && a < b; a++, b--)
+        {
+            EventRecord tmp = out[a];
+            out[a] = out[b];
+            out[b] = tmp;
+        }
+        n += got;
+    }
+
+    xSemaphoreGive(fileLock);
+    return n;
+}
+
+uint32_t EventLog::Count()
+{
+    uint32_t total = 0;
+    if (fileLock == NULL)
+    {
+        return count;
+    }
+
+    xSemaphoreTake(fileLock, portMAX_DELAY);
+    for (uint8_t s = 0; s < SEGMENT_COUNT && mounted; s++)
+    {
+        total += segmentRecords[s];
+    }
+    total += count;
+    xSemaphoreGive(fileLock);
+    return total;
+}
+
+const char* EventLog::TypeName(uint8_t type)
+{
+    switch (type)
+    {
+        case EVENT_BOOT:                return "BOOT";
+        case EVENT_STANCE_ERROR:        return "STANCE_ERROR";
+        case EVENT_KILL_SWITCH:         return "KILL_SWITCH";
+        case EVENT_EMERGENCY_STOP:      return "EMERGENCY_STOP";
+        case EVENT_ENABLE_TIMEOUT:      return "ENABLE_TIMEOUT";
+        case EVENT_TRANSITION_COMPLETE: return "TRANSITION_COMPLETE";
+        case EVENT_OVER_CURRENT:        return "OVER_CURRENT";
+        case EVENT_MOTION_TIMEOUT:      return "MOTION_TIMEOUT";
+        case EVENT_PHASE_TUNE:          return "PHASE_TUNE";
+        default:                        return "UNKNOWN";
+    }
+}
+
+void EventLog::SegmentPath(uint8_t segment, char* path, size_t len)
+{
+    snprintf(path, len, "/events%u.bin", segment);
+}
+
+/*
+    ScanSegments
+
+    Work out where the previous boot left off. The segment holding the highest sequence
+    number is the one we keep appending to. A record torn by a reset mid-write is dropped
+    by rewriting the segment with only its whole records.
+*/
+void EventLog::ScanSegments()
+{
+    uint32_t highestSequence = 0;
+    bool found = false;
+
+    for (uint8_t s = 0; s < SEGMENT_COUNT; s++)
+    {
+        char path[24];
+        SegmentPath(s, path, sizeof(path));
+        segmentRecords[s] = 0;
+
+        File file = LittleFS.open(path, "r");
+        if (!file)
+        {
+            continue;
+        }
+
+        size_t size = file.size();
+        uint16_t records = size / sizeof(EventRecord);
+        EventRecord last;
+        bool haveLast = false;
+        if (records > 0)
+        {
+            file.seek((records - 1) * sizeof(EventRecord));
+            haveLast = (file.read((uint8_t*)&last, sizeof(last)) == sizeof(last));
+        }
+
+        if (size % sizeof(EventRecord) != 0)
+        {
+            // Keep the whole records, drop the torn tail.
+            size_t keep = records * sizeof(EventRecord);
+            uint8_t* data = (uint8_t*)malloc(keep > 0 ? keep : 1);
+            file.seek(0);
+            keep = (data != NULL) ? file.read(data, keep) : 0;
+            file.close();
+
+            File rewrite = LittleFS.open(path, "w");
+            if (rewrite && data != NULL)
+            {
+                rewrite.write(data, keep);
+                rewrite.close();
+            }
+            free(data);
+            records = keep / sizeof(EventRecord);
+        }
+        else
+        {
+            file.close();
+        }
+
+        segmentRecords[s] = records;
+        if (haveLast && (!found || last.sequence > highestSequence))
+        {
+            highestSequence = last.sequence;
+            currentSegment = s;
+            found = true;
+        }
+    }
+
+    nextSequence = found ? highestSequence + 1 : 0;
+}
+
+size_t EventLog::WriteRecords(const EventRecord* records, size_t n)
+{
+    size_t total = 0;
+    while (n > 0)
+    {
+        // Rotate to the oldest segment once the current one is full.
+        if (segmentRecords[currentSegment] >= SEGMENT_RECORDS)
+        {
+            currentSegment = (currentSegment + 1) % SEGMENT_COUNT;
+            char oldPath[24];
+            SegmentPath(currentSegment, oldPath, sizeof(oldPath));
+            LittleFS.remove(oldPath);
+            segmentRecords[currentSegment] = 0;
+        }
+
+        size_t room = SEGMENT_RECORDS - segmentRecords[currentSegment];
+        size_t chunk = (n < room) ? n : room;
+
+        char path[24];
+        SegmentPath(currentSegment, path, sizeof(path));
+        File file = LittleFS.open(path, "a");
+        if (!file)
+        {
+            return total;
+        }
+        size_t written = file.write((const uint8_t*)records, chunk * sizeof(EventRecord));
+        file.close();
+
+        segmentRecords[currentSegment] += written / sizeof(EventRecord);
+        total += written / sizeof(EventRecord);
+        if (written != chunk * sizeof(EventRecord))
+        {
+            // Part of a record may have gone; appending after it would put every later record
+            // out of step, so the retry starts on the next segment.
+            segmentRecords[currentSegment] = SEGMENT_RECORDS;
+            return total;
+        }
+        records += chunk;
+        n -= chunk;
+    }
+    return total;
+}
+
+/*
+    FlushPending
+
+    Move queued records to flash one page at a time. A partial page is only written when
+    forced or when its oldest record has waited longer than FLUSH_MAX_AGE_MS, so normal
+    operation produces whole-page appends. Records a failed write didn't get to flash stay
+    queued for the writer task's next pass; while they do, new records that don't fit are
+    counted as dropped.
+*/
+void EventLog::FlushPending(bool force)
+{
+    EventRecord page[PAGE_RECORDS];
+
+    while (true)
+    {
+        xSemaphoreTake(fileLock, portMAX_DELAY);
+
+        portENTER_CRITICAL(&bufferLock);
+        bool aged = (count > 0) && (millis() - oldestQueuedMs >= FLUSH_MAX_AGE_MS);
+        uint8_t n = 0;
+        if (count >= PAGE_RECORDS || (count > 0 && (force || aged)))
+        {
+            n = (count < PAGE_RECORDS) ? count : PAGE_RECORDS;
+            uint8_t tail = (head + BUFFER_RECORDS - count) % BUFFER_RECORDS;
+            for (uint8_t i = 0; i < n; i++)
+            {
+                page[i] = buffer[(tail + i) % BUFFER_RECORDS];
+            }
+        }
+        portEXIT_CRITICAL(&bufferLock);
+
+        if (n == 0 || !mounted)
+        {
+            xSemaphoreGive(fileLock);
+            return;
+        }
+
+        uint8_t written = WriteRecords(page, n);
+
+        // Release the RAM copies only after they are on flash, so readers never miss them.
+        portENTER_CRITICAL(&bufferLock);
+        count -= written;
+        if (count > 0)
+        {
+            uint8_t tail = (head + BUFFER_RECORDS - count) % BUFFER_RECORDS;
+            oldestQueuedMs = buffer[tail].timestampMs;
+        }
+        portEXIT_CRITICAL(&bufferLock);
+
+        xSemaphoreGive(fileLock);
+
+        if (written < n)
+        {
+            LOG_EVERY(LOG_LEVEL_ERROR, 10000, "Event log: flash write failed, %u records kept for a retry.", (unsigned)(n - written));
+            return;
+        }
+    }
+}
+
+void EventLog::WriterTask(void* param)
+{
+    EventLog* self = (EventLog*)param;
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+        bool force = self->flushRequested;
+        self->flushRequested = false;
+        self->FlushPending(force);
+    }
+}
+
+#endif // USE_WAVESHARE_ESP32_LCD
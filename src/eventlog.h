@@ -0,0 +1,101 @@
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+// Event types stored in the persistent log
+enum EventType
+{
+    EVENT_NONE = 0,
+    EVENT_BOOT,                 // code = esp_reset_reason(), arg = boot count
+    EVENT_STANCE_ERROR,         // code = error stance reported by CheckStance()
+    EVENT_KILL_SWITCH,          // Kill switch stopped the motors
+    EVENT_EMERGENCY_STOP,       // EmergencyStop() was called
+    EVENT_ENABLE_TIMEOUT,       // Rolling code enable timed out
+    EVENT_TRANSITION_COMPLETE,  // code = stance reached
+    EVENT_OVER_CURRENT,         // code = motor, arg = current in 0.1 A
+    EVENT_MOTION_TIMEOUT,       // code = error stance, arg = milliseconds waited
+    EVENT_PHASE_TUNE            // code = PhaseTuneAction, arg = PhaseTuner::Pack() of the new window
+};
+
+// One fixed-size log record. 16 records fill one 256 byte flash page.
+struct EventRecord
+{
+    uint32_t sequence;      // Monotonic across reboots
+    uint32_t timestampMs;   // millis() when recorded
+    int32_t  arg;           // Event specific value
+    uint16_t bootCount;     // Boot the record was made in
+    uint8_t  type;          // EventType
+    uint8_t  code;          // Event specific code
+};
+
+class EventLog
+{
+    public:
+        EventLog();
+
+        // Mount LittleFS, record the boot and start the background writer. Call from setup().
+        void Begin();
+
+        // Queue a record in RAM. Never touches flash, safe to call from the control loop.
+        void Record(EventType type, uint8_t code = 0, int32_t arg = 0);
+
+        // Ask the writer to flush buffered records now, even if less than a page is queued.
+        void RequestFlush();
+
+        // Copy up to maxCount records into out, newest first, skipping the newest 'skip' records.
+        // Returns the number of records copied.
+        size_t ReadNewest(uint32_t skip, EventRecord* out, size_t maxCount);
+
+        // Total number of records available (flash + RAM).
+        uint32_t Count();
+
+        // Records dropped because the RAM buffer was full.
+        uint32_t Dropped() const { return dropped; }
+
+        uint16_t BootCount() const { return bootCount; }
+
+        // Human readable name for an EventType.
+        static const char* TypeName(uint8_t type);
+
+    private:
+        static const uint8_t  SEGMENT_COUNT = 4;        // Log files rotated oldest first
+        static const uint16_t SEGMENT_RECORDS = 1024;   // 16KB per segment
+        static const uint8_t  PAGE_RECORDS = 16;        // 256 byte flash page
+        static const uint8_t  BUFFER_RECORDS = 64;      // RAM buffer, 4 pages
+        static const uint32_t FLUSH_MAX_AGE_MS = 10000; // Partial pages are written after this long
+
+        bool mounted;
+        uint16_t bootCount;
+        uint32_t nextSequence;
+        uint32_t dropped;
+
+        // RAM ring buffer, shared between Record() and the writer task.
+        EventRecord buffer[BUFFER_RECORDS];
+        uint8_t head;
+        uint8_t count;
+        uint32_t oldestQueuedMs;
+        volatile bool flushRequested;
+        portMUX_TYPE bufferLock;
+
+        // Segment bookkeeping, only touched with fileLock held.
+        uint8_t currentSegment;
+        uint16_t segmentRecords[SEGMENT_COUNT];
+        SemaphoreHandle_t fileLock;
+
+        TaskHandle_t writerTask;
+
+        void ScanSegments();
+        size_t WriteRecords(const EventRecord* records, size_t n);
+        void FlushPending(bool force);
+        static void SegmentPath(uint8_t segment, char* path, size_t len);
+        static void WriterTask(void* param);
+};
+
+#endif // EVENTLOG_H
+#endif // USE_WAVESHARE_ESP32_LCD
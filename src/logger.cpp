@@ -0,0 +1,304 @@
+#include "logger.h"
+
+#ifdef ENABLE_SERIAL_LOG
+
+Logger logger;
+
+Logger::Logger()
+    : head(0), tail(0), level(DEFAULT_LOG_LEVEL), dropped(0), dropsReported(0), suppressed(0)
+{
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        portMUX_INITIALIZE(&writeLock);
+        drainTask = NULL;
+    #endif
+}
+
+void Logger::Begin()
+{
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        xTaskCreate(DrainTask, "log", 2048, this, tskIDLE_PRIORITY + 1, &drainTask);
+    #endif
+}
+
+void Logger::SetLevel(uint8_t newLevel)
+{
+    level = newLevel < LOG_LEVEL_COUNT ? newLevel : (uint8_t)LOG_LEVEL_DEBUG;
+}
+
+const char* Logger::LevelName(uint8_t messageLevel)
+{
+    switch (messageLevel)
+    {
+        case LOG_LEVEL_ERROR: return "ERROR";
+        case LOG_LEVEL_WARN:  return "WARN";
+        case LOG_LEVEL_INFO:  return "INFO";
+        case LOG_LEVEL_DEBUG: return "DEBUG";
+        default:              return "?";
+    }
+}
+
+void LogRecord::AddInteger(uint32_t value)
+{
+    if (length + 4 > MAX_PAYLOAD)
+    {
+        return;
+    }
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        data[length++] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+void LogRecord::Add(double value)
+{
+    float f = (float)value;
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    AddInteger(bits);
+}
+
+void LogRecord::Add(const char* value)
+{
+    if (length + 1 > MAX_PAYLOAD)
+    {
+        return;
+    }
+    uint8_t n = min(strlen(value), (size_t)(MAX_PAYLOAD - length - 1));
+    data[length++] = n;
+    memcpy(data + length, value, n);
+    length += n;
+}
+
+bool Logger::PassSite(LogSite* site, uint16_t intervalMs, uint16_t& siteSuppressed)
+{
+    siteSuppressed = 0;
+    if (site == NULL)
+    {
+        return true;
+    }
+
+    uint32_t now = millis();
+    if (site->started && now - site->lastMs < intervalMs)
+    {
+        if (site->suppressed < 0xFFFF)
+        {
+            site->suppressed++;
+        }
+        suppressed++;
+        return false;
+    }
+    site->started = true;
+    site->lastMs = now;
+    siteSuppressed = site->suppressed;
+    site->suppressed = 0;
+    return true;
+}
+
+void Logger::Wake()
+{
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        if (drainTask != NULL)
+        {
+            xTaskNotifyGive(drainTask);
+        }
+    #endif
+}
+
+void Logger::Write(uint8_t messageLevel, LogSite* site, uint16_t intervalMs, const char* format, ...)
+{
+    uint16_t siteSuppressed;
+    if (!PassSite(site, intervalMs, siteSuppressed))
+    {
+        return;
+    }
+
+    // Errors and warnings are tagged; everything else reads as before.
+    char line[LINE_MAX];
+    int length = 0;
+    if (messageLevel <= LOG_LEVEL_WARN)
+    {
+        length = snprintf(line, sizeof(line), "%s: ", LevelName(messageLevel));
+    }
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(line + length, sizeof(line) - length, format, args);
+    va_end(args);
+    if (written > 0)
+    {
+        length = min(length + written, (int)sizeof(line) - 1);
+    }
+
+    if (siteSuppressed > 0 && length < (int)sizeof(line) - 1)
+    {
+        written = snprintf(line + length, sizeof(line) - length, " (+%u)", siteSuppressed);
+        if (written > 0)
+        {
+            length = min(length + written, (int)sizeof(line) - 1);
+        }
+    }
+
+    // Always end the line, even if it was cut short.
+    if (length >= (int)sizeof(line) - 1)
+    {
+        length = sizeof(line) - 2;
+    }
+    line[length++] = '\n';
+
+    Push(line, length);
+    Wake();
+}
+
+void Logger::WriteRecord(uint8_t messageLevel, LogSite* site, uint16_t intervalMs,
+                         uint32_t id, const LogRecord& record)
+{
+    uint16_t siteSuppressed;
+    if (!PassSite(site, intervalMs, siteSuppressed))
+    {
+        return;
+    }
+
+    char frame[8 + LogRecord::MAX_PAYLOAD];
+    uint8_t length = 0;
+    frame[length++] = (char)LOG_FRAME_SYNC;
+    length++;   // Filled in below
+    frame[length++] = messageLevel | (siteSuppressed > 0 ? LOG_FLAG_SUPPRESSED : 0);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        frame[length++] = (char)(id >> (8 * i));
+    }
+    if (siteSuppressed > 0)
+    {
+        frame[length++] = (char)siteSuppressed;
+        frame[length++] = (char)(siteSuppressed >> 8);
+    }
+    memcpy(frame + length, record.Data(), record.Length());
+    length += record.Length();
+    frame[1] = length - 2;
+
+    Push(frame, length);
+    Wake();
+}
+
+void Logger::Push(const char* text, uint16_t length)
+{
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        portENTER_CRITICAL(&writeLock);
+    #endif
+
+    uint16_t used = head - tail;
+    if (length > BUFFER_SIZE - used)
+    {
+        dropped++;
+    }
+    else
+    {
+        uint16_t start = head % BUFFER_SIZE;
+        uint16_t first = min(length, (uint16_t)(BUFFER_SIZE - start));
+        memcpy(buffer + start, text, first);
+        memcpy(buffer, text + first, length - first);
+        // Publish only once the bytes are in place.
+        head = head + length;
+    }
+
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        portEXIT_CRITICAL(&writeLock);
+    #endif
+}
+
+void Logger::Drain()
+{
+    for (;;)
+    {
+        int room = Serial.availableForWrite();
+        if (room <= 0)
+        {
+            return;
+        }
+
+        // Say how many lines were lost once there's space to say it.
+        uint32_t lost = dropped;
+        if (lost != dropsReported && head == tail)
+        {
+            char note[40];
+            int length = snprintf(note, sizeof(note), "[log] %lu lines dropped\n", (unsigned long)(lost - dropsReported));
+            if (length > room)
+            {
+                return;
+            }
+            Serial.write((const uint8_t*)note, length);
+            dropsReported = lost;
+            continue;
+        }
+
+        uint16_t available = head - tail;
+        if (available == 0)
+        {
+            return;
+        }
+
+        // Whole lines and records only, no more than the port will take, in two parts if they
+        // wrap round the end of the buffer.
+        uint16_t length = WholeRecords(available, (uint16_t)min(room, (int)available));
+        if (length == 0)
+        {
+            return;
+        }
+        uint16_t start = tail % BUFFER_SIZE;
+        uint16_t first = min(length, (uint16_t)(BUFFER_SIZE - start));
+        Serial.write((const uint8_t*)buffer + start, first);
+        if (length > first)
+        {
+            Serial.write((const uint8_t*)buffer, length - first);
+        }
+        tail = tail + length;
+    }
+}
+
+uint16_t Logger::WholeRecords(uint16_t available, uint16_t room) const
+{
+    uint16_t length = 0;
+    uint16_t end = 0;
+    while (end < room)
+    {
+        #ifdef SERIAL_LOG_BINARY
+            // A record says how long it is; Push() only ever adds whole ones.
+            if (end + 2 > available)
+            {
+                break;
+            }
+            end += 2 + (uint8_t)buffer[(uint16_t)(tail + end + 1) % BUFFER_SIZE];
+        #else
+            // Write() always ends a line with a newline.
+            while (end < room && buffer[(uint16_t)(tail + end) % BUFFER_SIZE] != '\n')
+            {
+                end++;
+            }
+            end++;
+        #endif
+
+        if (end > room)
+        {
+            break;
+        }
+        length = end;
+    }
+    return length;
+}
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+    void Logger::DrainTask(void* param)
+    {
+        Logger* self = (Logger*)param;
+        const TickType_t pollPeriod = pdMS_TO_TICKS(20);
+
+        for (;;)
+        {
+            // Woken by new lines; the timeout picks up the rest once the port has room again.
+            ulTaskNotifyTake(pdTRUE, pollPeriod);
+            self->Drain();
+        }
+    }
+#endif
+
+#endif // ENABLE_SERIAL_LOG
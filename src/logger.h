@@ -0,0 +1,222 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "config.h"
+
+// Log levels, most important first. A message is kept if its level is at or below the
+// current verbosity.
+enum LogLevel
+{
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_COUNT
+};
+
+#ifdef ENABLE_SERIAL_LOG
+
+#include <Arduino.h>
+#include <stdarg.h>
+#ifdef USE_WAVESHARE_ESP32_LCD
+    #include <freertos/FreeRTOS.h>
+    #include <freertos/task.h>
+#endif
+
+// Rate limit state for one LOG_EVERY call site
+struct LogSite
+{
+    uint32_t lastMs;
+    uint16_t suppressed;
+    bool started;
+};
+
+// Binary records: LOG_FRAME_SYNC, length of the rest, level (LOG_FLAG_SUPPRESSED if a uint16_t
+// suppressed count follows), message ID (4 bytes), then the arguments in order. Integers are
+// sent as 4 bytes, floating point as a 4 byte float and strings as a length byte and the
+// characters, all little endian. Anything between records is plain text.
+#define LOG_FRAME_SYNC      0xA5
+#define LOG_FLAG_SUPPRESSED 0x80
+
+// Message ID for a format string: 32-bit FNV-1a, worked out at compile time. tools/logdecode.py
+// computes the same hash over the sources to find the format again.
+constexpr uint32_t LogMessageIdStep(const char* s, uint32_t hash)
+{
+    return *s ? LogMessageIdStep(s + 1, (hash ^ (uint8_t)*s) * 16777619UL) : hash;
+}
+
+constexpr uint32_t LogMessageId(const char* format)
+{
+    return LogMessageIdStep(format, 2166136261UL);
+}
+
+// Arguments of one binary record
+class LogRecord
+{
+    public:
+        static const uint8_t MAX_PAYLOAD = 48;
+
+        LogRecord() : length(0) {}
+
+        void Add(int value)                 { AddInteger((uint32_t)(int32_t)value); }
+        void Add(unsigned int value)        { AddInteger((uint32_t)value); }
+        void Add(long value)                { AddInteger((uint32_t)(int32_t)value); }
+        void Add(unsigned long value)       { AddInteger((uint32_t)value); }
+        void Add(double value);
+        void Add(const char* value);
+
+        const uint8_t* Data() const { return data; }
+        uint8_t Length() const { return length; }
+
+    private:
+        uint8_t data[MAX_PAYLOAD];
+        uint8_t length;
+
+        void AddInteger(uint32_t value);
+};
+
+/*
+    Serial debug log.
+
+    Messages are formatted straight into a RAM ring buffer and written to the USB serial port
+    later, only as fast as the port will take them without blocking, so a slow or disconnected
+    host can't stall the control loop. Lines that don't fit in the buffer are dropped and counted.
+
+    On the Waveshare boards a low priority task drains the buffer; on the Pro Micro, Drain()
+    is called from loop().
+
+    With SERIAL_LOG_BINARY the LOG_* macros skip the formatting and queue a LogRecord instead,
+    which tools/logdecode.py turns back into text on the host.
+*/
+class Logger
+{
+    public:
+        Logger();
+
+        // Start the drain task (Waveshare boards). Call after Serial.begin().
+        void Begin();
+
+        // Messages above this level are discarded before they are formatted.
+        void SetLevel(uint8_t level);
+        uint8_t Level() const { return level; }
+        bool Enabled(uint8_t messageLevel) const { return messageLevel <= level; }
+
+        // Format a line into the buffer. With a site, lines closer together than intervalMs are
+        // suppressed and the next line that gets through says how many were.
+        void Write(uint8_t messageLevel, LogSite* site, uint16_t intervalMs, const char* format, ...);
+
+        // Queue a binary record. Rate limits work as for Write().
+        void WriteRecord(uint8_t messageLevel, LogSite* site, uint16_t intervalMs,
+                         uint32_t id, const LogRecord& record);
+
+        // Write as much of the buffer to Serial as it will take without blocking. Only whole
+        // lines and records go out, so text the sketch prints itself can't land inside one.
+        void Drain();
+
+        // Lines lost because the buffer was full, and lines held back by rate limits.
+        uint32_t Dropped() const { return dropped; }
+        uint32_t Suppressed() const { return suppressed; }
+
+        static const char* LevelName(uint8_t level);
+
+    private:
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            static const uint16_t BUFFER_SIZE = 4096;
+            static const uint8_t LINE_MAX = 128;
+        #else
+            static const uint16_t BUFFER_SIZE = 128;
+            static const uint8_t LINE_MAX = 64;
+        #endif
+
+        // Free running byte counts, so BUFFER_SIZE must divide 65536. The writer only moves head
+        // and the drain only moves tail, so the drain never needs the lock.
+        char buffer[BUFFER_SIZE];
+        volatile uint16_t head;
+        volatile uint16_t tail;
+
+        uint8_t level;
+        volatile uint32_t dropped;
+        uint32_t dropsReported;
+        uint32_t suppressed;
+
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            // Serializes writers from different tasks
+            portMUX_TYPE writeLock;
+            TaskHandle_t drainTask;
+
+            static void DrainTask(void* param);
+        #endif
+
+        // Apply a call site's rate limit. Returns false if the message should be skipped;
+        // otherwise siteSuppressed is how many were skipped before it.
+        bool PassSite(LogSite* site, uint16_t intervalMs, uint16_t& siteSuppressed);
+
+        void Push(const char* text, uint16_t length);
+        void Wake();
+
+        // Bytes from the tail up to the end of the last whole line or record that fits in room
+        uint16_t WholeRecords(uint16_t available, uint16_t room) const;
+};
+
+extern Logger logger;
+
+inline void LogAddArgs(LogRecord&)
+{
+}
+
+template<typename T, typename... Rest>
+inline void LogAddArgs(LogRecord& record, T first, Rest... rest)
+{
+    record.Add(first);
+    LogAddArgs(record, rest...);
+}
+
+template<typename... Args>
+inline void LogWriteRecord(uint8_t messageLevel, LogSite* site, uint16_t intervalMs, uint32_t id, Args... args)
+{
+    LogRecord record;
+    LogAddArgs(record, args...);
+    logger.WriteRecord(messageLevel, site, intervalMs, id, record);
+}
+
+#ifdef SERIAL_LOG_BINARY
+    // Only the hash of the format string reaches the firmware.
+    #define LOG_WRITE_(messageLevel, site, intervalMs, format, ...) \
+        { \
+            constexpr uint32_t logId_ = LogMessageId(format); \
+            LogWriteRecord(messageLevel, site, intervalMs, logId_, ##__VA_ARGS__); \
+        }
+#else
+    #define LOG_WRITE_(messageLevel, site, intervalMs, ...) logger.Write(messageLevel, site, intervalMs, __VA_ARGS__)
+#endif
+
+// Log a printf-style message at a level
+#define LOG_ERROR(...) do { if (logger.Enabled(LOG_LEVEL_ERROR)) LOG_WRITE_(LOG_LEVEL_ERROR, NULL, 0, __VA_ARGS__); } while (0)
+#define LOG_WARN(...)  do { if (logger.Enabled(LOG_LEVEL_WARN))  LOG_WRITE_(LOG_LEVEL_WARN,  NULL, 0, __VA_ARGS__); } while (0)
+#define LOG_INFO(...)  do { if (logger.Enabled(LOG_LEVEL_INFO))  LOG_WRITE_(LOG_LEVEL_INFO,  NULL, 0, __VA_ARGS__); } while (0)
+#define LOG_DEBUG(...) do { if (logger.Enabled(LOG_LEVEL_DEBUG)) LOG_WRITE_(LOG_LEVEL_DEBUG, NULL, 0, __VA_ARGS__); } while (0)
+
+// Log at most once every intervalMs from this call site
+#define LOG_EVERY(messageLevel, intervalMs, ...) \
+    do \
+    { \
+        static LogSite logSite_ = { 0, 0, false }; \
+        if (logger.Enabled(messageLevel)) LOG_WRITE_(messageLevel, &logSite_, intervalMs, __VA_ARGS__); \
+    } while (0)
+
+#define LOG_ENABLED(messageLevel) logger.Enabled(messageLevel)
+#define LOG_SET_LEVEL(messageLevel) logger.SetLevel(messageLevel)
+
+#else
+
+#define LOG_ERROR(...)
+#define LOG_WARN(...)
+#define LOG_INFO(...)
+#define LOG_DEBUG(...)
+#define LOG_EVERY(messageLevel, intervalMs, ...)
+#define LOG_ENABLED(messageLevel) false
+#define LOG_SET_LEVEL(messageLevel)
+
+#endif // ENABLE_SERIAL_LOG
+
+#endif // LOGGER_H
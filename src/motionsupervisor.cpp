@@ -0,0 +1,163 @@
+#include "config.h"
+#include "motionsupervisor.h"
+
+MotionSupervisor::MotionSupervisor()
+    : releaseTimeoutMs(0), learnMarginPercent(0), faultElapsedMs(0)
+{
+    for (uint8_t m = 0; m < SUPERVISED_MOTOR_COUNT; m++)
+    {
+        travelMs[m] = 0;
+    }
+    Forget();
+    Reset();
+}
+
+void MotionSupervisor::Configure(uint16_t releaseTimeout, uint16_t legTravel, uint16_t tiltTravel,
+                                 uint8_t learnMargin)
+{
+    releaseTimeoutMs = releaseTimeout;
+    travelMs[SUPERVISED_LEG] = legTravel;
+    travelMs[SUPERVISED_TILT] = tiltTravel;
+    learnMarginPercent = learnMargin;
+}
+
+void MotionSupervisor::Drive(SupervisedMotor motor, MotionDirection direction, MotionMove move, uint32_t nowMs)
+{
+    Supervision& s = state[motor];
+    if (s.active && s.direction == direction && s.move == move)
+    {
+        return;
+    }
+
+    s.active = true;
+    s.released = false;
+    s.fromOrigin = false;
+    s.direction = direction;
+    s.move = move;
+    s.startMs = nowMs;
+    s.releaseMs = nowMs;
+}
+
+MotionFault MotionSupervisor::Check(SupervisedMotor motor, bool moving, int upSwitch, int dnSwitch, uint32_t nowMs)
+{
+    Supervision& s = state[motor];
+    if (!s.active)
+    {
+        return MOTION_FAULT_NONE;
+    }
+
+    // Stopped by someone else (target reached, emergency stop, new command).
+    if (!moving)
+    {
+        s.active = false;
+        return MOTION_FAULT_NONE;
+    }
+
+    int origin = (s.direction == MOTION_UP) ? dnSwitch : upSwitch;
+    int destination = (s.direction == MOTION_UP) ? upSwitch : dnSwitch;
+
+    if (!s.released)
+    {
+        // A motor that starts part way (from an error stance) has nothing to release.
+        if (origin == LOW)
+        {
+            s.fromOrigin = true;
+        }
+        if (origin == HIGH)
+        {
+            s.released = true;
+            s.releaseMs = nowMs;
+        }
+        else if (releaseTimeoutMs != 0 && nowMs - s.startMs >= releaseTimeoutMs)
+        {
+            s.active = false;
+            faultElapsedMs = nowMs - s.startMs;
+            return MOTION_FAULT_NO_RELEASE;
+        }
+        else
+        {
+            return MOTION_FAULT_NONE;
+        }
+    }
+
+    if (destination == LOW)
+    {
+        // Arrived. Only transitions that started from the origin switch are a full travel.
+        if (s.fromOrigin && s.move == MOTION_TRANSITION)
+        {
+            Learn(motor, s.direction, nowMs - s.releaseMs);
+        }
+        s.active = false;
+        return MOTION_FAULT_NONE;
+    }
+
+    uint16_t deadline = TravelDeadline(motor, s.direction, s.move);
+    if (deadline != 0 && nowMs - s.releaseMs >= deadline)
+    {
+        s.active = false;
+        faultElapsedMs = nowMs - s.releaseMs;
+        return MOTION_FAULT_STALL;
+    }
+
+    return MOTION_FAULT_NONE;
+}
+
+void MotionSupervisor::Reset()
+{
+    for (uint8_t m = 0; m < SUPERVISED_MOTOR_COUNT; m++)
+    {
+        state[m].active = false;
+        state[m].released = false;
+        state[m].fromOrigin = false;
+        state[m].direction = MOTION_UP;
+        state[m].move = MOTION_SINGLE_MOVE;
+        state[m].startMs = 0;
+        state[m].releaseMs = 0;
+    }
+}
+
+void MotionSupervisor::Forget()
+{
+    for (uint8_t m = 0; m < SUPERVISED_MOTOR_COUNT; m++)
+    {
+        for (uint8_t d = 0; d < MOTION_DIRECTION_COUNT; d++)
+        {
+            learnedMs[m][d] = 0;
+            learnedSamples[m][d] = 0;
+        }
+    }
+}
+
+uint16_t MotionSupervisor::TravelDeadline(SupervisedMotor motor, MotionDirection direction, MotionMove move) const
+{
+    uint16_t configured = travelMs[motor];
+    if (configured == 0 || learnMarginPercent == 0 || move != MOTION_TRANSITION ||
+        learnedSamples[motor][direction] < MIN_LEARNED_SAMPLES)
+    {
+        return configured;
+    }
+
+    uint32_t learned = (uint32_t)learnedMs[motor][direction] * (100 + learnMarginPercent) / 100 + MIN_LEARNED_SLACK_MS;
+    return (learned < configured) ? (uint16_t)learned : configured;
+}
+
+void MotionSupervisor::Learn(SupervisedMotor motor, MotionDirection direction, uint32_t travel)
+{
+    uint16_t sample = (travel < 0xFFFF) ? (uint16_t)travel : 0xFFFF;
+    uint16_t& learned = learnedMs[motor][direction];
+
+    // Jump straight up to a slower move, drift back down slowly after faster ones.
+    if (learnedSamples[motor][direction] == 0 || sample > learned)
+    {
+        learned = sample;
+    }
+    else
+    {
+        learned -= (learned - sample) / 8;
+    }
+
+    if (learnedSamples[motor][direction] < 0xFF)
+    {
+        learnedSamples[motor][direction]++;
+    }
+}
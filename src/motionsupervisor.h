@@ -0,0 +1,113 @@
+#ifndef MOTIONSUPERVISOR_H
+#define MOTIONSUPERVISOR_H
+
+#include <Arduino.h>
+
+// Motors watched by the supervisor (Sabertooth motor number minus one)
+enum SupervisedMotor
+{
+    SUPERVISED_LEG = 0,
+    SUPERVISED_TILT,
+    SUPERVISED_MOTOR_COUNT
+};
+
+// Direction a motor is driven, named for the limit switch it is heading to
+enum MotionDirection
+{
+    MOTION_UP = 0,
+    MOTION_DOWN,
+    MOTION_DIRECTION_COUNT
+};
+
+// What a motor is being driven for
+enum MotionMove
+{
+    MOTION_SINGLE_MOVE = 0,     // One motor on its own, from the web page or to leave an error stance
+    MOTION_TRANSITION           // Part of a 2->3 or 3->2
+};
+
+// Deadline a motor missed
+enum MotionFault
+{
+    MOTION_FAULT_NONE = 0,
+    MOTION_FAULT_NO_RELEASE,    // Origin limit switch never opened
+    MOTION_FAULT_STALL          // Destination limit switch never closed
+};
+
+/*
+    Watches each motor while it is driven.
+
+    Once a motor is commanded the switch it is leaving must open within the release timeout,
+    and the switch it is heading for must then close within the travel timeout. The travel
+    timeout is either the configured maximum, or once a few good transitions have been seen, the
+    slowest recent one plus a margin (never more than the configured maximum).
+
+    Each motor and direction belongs to only one transition, so what is learned is that
+    transition's travel. Single moves run at their own powers and always get the configured
+    maximum. What was learned only holds for the settings it was learned with; call Forget()
+    when powers, ramps or timing change.
+*/
+class MotionSupervisor
+{
+    public:
+        MotionSupervisor();
+
+        // Deadlines in milliseconds, 0 disables that check. learnMarginPercent 0 disables learning.
+        void Configure(uint16_t releaseTimeoutMs, uint16_t legTravelMs, uint16_t tiltTravelMs,
+                       uint8_t learnMarginPercent);
+
+        // A non-zero power was sent to the motor. Starts supervision if it isn't already running
+        // in this direction.
+        void Drive(SupervisedMotor motor, MotionDirection direction, MotionMove move, uint32_t nowMs);
+
+        // Check a motor against its deadlines. Call every loop() pass after the motors are driven.
+        // moving is LegMoving/TiltMoving; once it drops the motor is no longer supervised.
+        // upSwitch/dnSwitch are the motor's limit switch readings (LOW when closed).
+        MotionFault Check(SupervisedMotor motor, bool moving, int upSwitch, int dnSwitch, uint32_t nowMs);
+
+        // Stop supervising both motors.
+        void Reset();
+
+        // Drop the learned travel times, going back to the configured maximums.
+        void Forget();
+
+        // Current travel deadline for a motor, direction and kind of move (milliseconds, 0 = none).
+        uint16_t TravelDeadline(SupervisedMotor motor, MotionDirection direction, MotionMove move) const;
+
+        // Slowest recent transition travel time (decaying), and how many it is based on.
+        uint16_t Learned(SupervisedMotor motor, MotionDirection direction) const { return learnedMs[motor][direction]; }
+        uint8_t LearnedSamples(SupervisedMotor motor, MotionDirection direction) const { return learnedSamples[motor][direction]; }
+
+        // How long the last fault had been waiting (milliseconds).
+        uint32_t FaultElapsed() const { return faultElapsedMs; }
+
+    private:
+        static const uint8_t MIN_LEARNED_SAMPLES = 3;
+        static const uint16_t MIN_LEARNED_SLACK_MS = 250;
+
+        struct Supervision
+        {
+            bool active;
+            bool released;
+            bool fromOrigin;    // Origin switch was seen closed, so this is a full travel
+            MotionDirection direction;
+            MotionMove move;
+            uint32_t startMs;
+            uint32_t releaseMs;
+        };
+
+        Supervision state[SUPERVISED_MOTOR_COUNT];
+
+        uint16_t releaseTimeoutMs;
+        uint16_t travelMs[SUPERVISED_MOTOR_COUNT];
+        uint8_t learnMarginPercent;
+
+        uint16_t learnedMs[SUPERVISED_MOTOR_COUNT][MOTION_DIRECTION_COUNT];
+        uint8_t learnedSamples[SUPERVISED_MOTOR_COUNT][MOTION_DIRECTION_COUNT];
+
+        uint32_t faultElapsedMs;
+
+        void Learn(SupervisedMotor motor, MotionDirection direction, uint32_t travel);
+};
+
+#endif // MOTIONSUPERVISOR_H
@@ -0,0 +1,139 @@
+#include "config.h"
+#include "motordrive.h"
+
+MotorDrive::MotorDrive(USBSabertooth& sabertooth)
+    : st(sabertooth), jerkMs(0), lastMs(0), started(false)
+{
+    for (uint8_t m = 0; m < MOTOR_DRIVE_COUNT; m++)
+    {
+        Channel& c = channels[m];
+        c.target = 0;
+        c.power = 0.0f;
+        c.rate = 0.0f;
+        c.rampMs = 0;
+        c.sent = 0;
+        c.sentMs = 0;
+        c.sendNow = true;   // Nothing has told the driver to stop yet
+    }
+}
+
+void MotorDrive::Configure(uint16_t jerk)
+{
+    jerkMs = jerk;
+}
+
+void MotorDrive::Drive(uint8_t motor, int power, uint16_t rampMs)
+{
+    Channel& c = channels[(motor - 1) & 1];
+    power = constrain(power, -FULL_SCALE, FULL_SCALE);
+    if (power == c.target && rampMs == c.rampMs)
+    {
+        return;
+    }
+
+    c.target = power;
+    c.rampMs = rampMs;
+    if (rampMs == 0)
+    {
+        c.power = (float)power;
+        c.rate = 0.0f;
+        c.sendNow = true;
+    }
+}
+
+void MotorDrive::Stop(uint8_t motor)
+{
+    Channel& c = channels[(motor - 1) & 1];
+    c.target = 0;
+    c.power = 0.0f;
+    c.rate = 0.0f;
+    if (c.sent != 0 || c.sendNow)
+    {
+        Send(motor, c, lastMs);
+    }
+}
+
+void MotorDrive::Update(uint32_t nowMs)
+{
+    float dtMs = started ? (float)(nowMs - lastMs) : 0.0f;
+    lastMs = nowMs;
+    started = true;
+
+    for (uint8_t m = 0; m < MOTOR_DRIVE_COUNT; m++)
+    {
+        Channel& c = channels[m];
+        if ((int)c.power != c.target)
+        {
+            Ramp(c, dtMs);
+        }
+
+        int power = (int)c.power;
+        bool settled = power == c.target;
+        if (c.sendNow ||
+            (power != c.sent && (settled || nowMs - c.sentMs >= UPDATE_MS)) ||
+            nowMs - c.sentMs >= REFRESH_MS)
+        {
+            Send(m + 1, c, nowMs);
+        }
+    }
+}
+
+/*
+    Ramp
+
+    One step of the S-curve toward the target. The rate of change moves by at most the jerk
+    limit per millisecond, up to the full scale rate, and starts to come back down once the
+    power left to go is what it takes to bring the rate to zero, so the motor settles onto the
+    new power rather than hitting it at full rate. A target that changes part way, even to the
+    other direction, carries on from the current power and rate.
+*/
+void MotorDrive::Ramp(Channel& c, float dtMs)
+{
+    if (dtMs <= 0.0f)
+    {
+        return;
+    }
+
+    float maxRate = (float)FULL_SCALE / c.rampMs;
+    float jerk = jerkMs > 0 ? maxRate / jerkMs : 0.0f;
+    float error = c.target - c.power;
+    float direction = error > 0.0f ? 1.0f : -1.0f;
+
+    if (jerk == 0.0f)
+    {
+        c.rate = direction * maxRate;
+    }
+    else
+    {
+        float step = jerk * dtMs;
+        float stopping = c.rate * c.rate / (2.0f * jerk);
+        if (c.rate * direction > 0.0f && fabsf(error) <= stopping)
+        {
+            // Ease off, but keep creeping toward the target.
+            c.rate -= direction * step;
+            if (c.rate * direction <= 0.0f)
+            {
+                c.rate = direction * min(step, maxRate);
+            }
+        }
+        else
+        {
+            c.rate = constrain(c.rate + direction * step, -maxRate, maxRate);
+        }
+    }
+
+    c.power += c.rate * dtMs;
+    if ((c.target - c.power) * direction <= 0.0f)
+    {
+        c.power = (float)c.target;
+        c.rate = 0.0f;
+    }
+}
+
+void MotorDrive::Send(uint8_t motor, Channel& c, uint32_t nowMs)
+{
+    c.sent = (int)c.power;
+    c.sentMs = nowMs;
+    c.sendNow = false;
+    st.motor(motor, c.sent);
+}
@@ -0,0 +1,71 @@
+#ifndef MOTORDRIVE_H
+#define MOTORDRIVE_H
+
+#include <Arduino.h>
+#include <USBSabertooth.h>
+
+#define MOTOR_DRIVE_COUNT 2
+
+/*
+    Sends the motor powers to the Sabertooth, easing each motor onto a new power.
+
+    A power change follows an S-curve: the rate of change builds up over the jerk time, holds
+    at full scale per ramp time, and eases off again as the power arrives. Each Drive() gives
+    its own ramp time, so every transition and phase can be tuned separately; 0 steps straight
+    to the new power as before. Stop() never ramps, since a limit switch or an emergency stop
+    has to cut the motor at once.
+
+    Powers only go out when they change, no more often than UPDATE_MS while a ramp is running,
+    and again every REFRESH_MS. At 9600 baud a motor packet takes about 10 ms, so sending both
+    motors every loop() pass fills the UART, blocks the loop and starves the telemetry GETs.
+*/
+class MotorDrive
+{
+    public:
+        MotorDrive(USBSabertooth& sabertooth);
+
+        // Time for the rate of change to build up to full, in milliseconds. 0 ramps linearly.
+        void Configure(uint16_t jerkMs);
+
+        // Aim motor 1 or 2 at a power, reaching it over about rampMs per full scale (2047).
+        // Call every pass while the motor should run; only a changed power starts a new ramp.
+        void Drive(uint8_t motor, int power, uint16_t rampMs);
+
+        // Stop the motor now, without ramping down.
+        void Stop(uint8_t motor);
+
+        // Move the ramps on and send what has changed. Call every loop() pass after the
+        // motion code, before the telemetry poller.
+        void Update(uint32_t nowMs);
+
+        // Power the motor is being driven at now, and the one it is heading for.
+        int Output(uint8_t motor) const { return (int)channels[(motor - 1) & 1].power; }
+        int Target(uint8_t motor) const { return channels[(motor - 1) & 1].target; }
+
+    private:
+        static const uint16_t UPDATE_MS = 25;
+        static const uint16_t REFRESH_MS = 100;
+        static const int FULL_SCALE = 2047;
+
+        struct Channel
+        {
+            int target;
+            float power;
+            float rate;         // Power per millisecond
+            uint16_t rampMs;
+            int sent;
+            uint32_t sentMs;
+            bool sendNow;
+        };
+
+        USBSabertooth& st;
+        Channel channels[MOTOR_DRIVE_COUNT];
+        uint16_t jerkMs;
+        uint32_t lastMs;
+        bool started;
+
+        void Ramp(Channel& c, float dtMs);
+        void Send(uint8_t motor, Channel& c, uint32_t nowMs);
+};
+
+#endif // MOTORDRIVE_H
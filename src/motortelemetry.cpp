@@ -0,0 +1,232 @@
+#include "config.h"
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#include "motortelemetry.h"
+
+MotorTelemetry::MotorTelemetry(USBSabertooth& sabertooth, USBSabertoothSerial& serial)
+    : st(sabertooth), serial(serial), limitWindowMs(0),
+      awaitingReply(false), pendingChannel(0), requestMs(0), nextChannel(0), timeouts(0),
+      trippedMotor(0)
+{
+    for (uint8_t c = 0; c < TELEMETRY_CHANNEL_COUNT; c++)
+    {
+        intervals[c] = 0;
+        values[c] = 0;
+        lastPolledMs[c] = 0;
+        lastValueMs[c] = 0;
+        everValid[c] = false;
+    }
+    for (uint8_t m = 0; m < 2; m++)
+    {
+        limits[m] = 0;
+        overSinceMs[m] = 0;
+        overLimit[m] = false;
+    }
+    ResetPeaks();
+}
+
+void MotorTelemetry::Configure(uint16_t currentIntervalMs, uint16_t slowIntervalMs,
+                               uint16_t limitM1, uint16_t limitM2, uint16_t limitWindow)
+{
+    intervals[TELEMETRY_CURRENT_M1] = currentIntervalMs;
+    intervals[TELEMETRY_CURRENT_M2] = currentIntervalMs;
+    intervals[TELEMETRY_BATTERY] = slowIntervalMs;
+    intervals[TELEMETRY_TEMPERATURE] = slowIntervalMs;
+    limits[0] = limitM1;
+    limits[1] = limitM2;
+    limitWindowMs = limitWindow;
+}
+
+void MotorTelemetry::Update(uint32_t nowMs)
+{
+    ReadReplies(nowMs);
+
+    if (awaitingReply)
+    {
+        if (nowMs - requestMs < REPLY_TIMEOUT_MS)
+        {
+            return;
+        }
+        // Give up on this one and move on to the next channel.
+        awaitingReply = false;
+        receiver.reset();
+        timeouts++;
+    }
+
+    // Round-robin over the channels that are due, so a fast current rate can't starve the others.
+    for (uint8_t i = 0; i < TELEMETRY_CHANNEL_COUNT; i++)
+    {
+        uint8_t channel = (nextChannel + i) % TELEMETRY_CHANNEL_COUNT;
+        if (intervals[channel] == 0 || nowMs - lastPolledMs[channel] < intervals[channel])
+        {
+            continue;
+        }
+        if (SendRequest(channel, nowMs))
+        {
+            nextChannel = (channel + 1) % TELEMETRY_CHANNEL_COUNT;
+        }
+        break;
+    }
+}
+
+uint8_t MotorTelemetry::TakeOverCurrentTrip()
+{
+    uint8_t motor = trippedMotor;
+    trippedMotor = 0;
+    return motor;
+}
+
+bool MotorTelemetry::Valid(TelemetryChannel channel) const
+{
+    return everValid[channel] && (millis() - lastValueMs[channel] < STALE_MS);
+}
+
+void MotorTelemetry::ResetPeaks()
+{
+    for (uint8_t c = 0; c < TELEMETRY_CHANNEL_COUNT; c++)
+    {
+        peaks[c] = 0;
+    }
+}
+
+bool MotorTelemetry::SendRequest(uint8_t channel, uint32_t nowMs)
+{
+    // Never let a poll wait for room in the UART buffer; the motor commands come first.
+    if (serial.port().availableForWrite() < SABERTOOTH_COMMAND_MAX_BUFFER_LENGTH)
+    {
+        return false;
+    }
+
+    byte getType;
+    byte number;
+    ChannelRequest(channel, getType, number);
+
+    // Same packet USBSabertooth::get() builds, in scaled units.
+    byte data[3];
+    data[0] = getType;
+    data[1] = 'M';
+    data[2] = number;
+    USBSabertoothCommandWriter::writeToStream(serial.port(), st.address(), SABERTOOTH_CMD_GET,
+                                              st.usingCRC(), data, sizeof(data));
+
+    awaitingReply = true;
+    pendingChannel = channel;
+    requestMs = nowMs;
+    lastPolledMs[channel] = nowMs;
+    return true;
+}
+
+void MotorTelemetry::ReadReplies(uint32_t nowMs)
+{
+    Stream& port = serial.port();
+    while (port.available() > 0)
+    {
+        int value = port.read();
+        if (value < 0)
+        {
+            break;
+        }
+
+        receiver.read((byte)value);
+        if (!receiver.ready())
+        {
+            continue;
+        }
+
+        if (!awaitingReply ||
+            receiver.address() != st.address() ||
+            receiver.command() != SABERTOOTH_RC_GET ||
+            receiver.usingCRC() != st.usingCRC())
+        {
+            continue;
+        }
+
+        byte getType;
+        byte number;
+        ChannelRequest(pendingChannel, getType, number);
+
+        const byte* data = receiver.data();
+        if (getType == (data[2] & ~1) && data[6] == 'M' && data[7] == number)
+        {
+            int16_t v = (uint16_t)data[4] << 0 | (uint16_t)data[5] << 7;
+            StoreValue(pendingChannel, (data[2] & 1) ? -v : v, nowMs);
+            awaitingReply = false;
+        }
+    }
+}
+
+void MotorTelemetry::StoreValue(uint8_t channel, int16_t value, uint32_t nowMs)
+{
+    values[channel] = value;
+    lastValueMs[channel] = nowMs;
+    everValid[channel] = true;
+
+    int16_t magnitude = abs(value);
+    switch (channel)
+    {
+        case TELEMETRY_BATTERY:
+            // Track the lowest voltage seen, that is the interesting one for brownouts.
+            if (peaks[channel] == 0 || value < peaks[channel])
+            {
+                peaks[channel] = value;
+            }
+            return;
+        case TELEMETRY_TEMPERATURE:
+            if (value > peaks[channel])
+            {
+                peaks[channel] = value;
+            }
+            return;
+        default:
+            if (magnitude > peaks[channel])
+            {
+                peaks[channel] = magnitude;
+            }
+            break;
+    }
+
+    // Current channel: the motor must stay over its limit for the whole window to trip.
+    uint8_t m = (channel == TELEMETRY_CURRENT_M1) ? 0 : 1;
+    if (limits[m] == 0 || magnitude <= limits[m])
+    {
+        overLimit[m] = false;
+        return;
+    }
+
+    if (!overLimit[m])
+    {
+        overLimit[m] = true;
+        overSinceMs[m] = nowMs;
+    }
+    if (nowMs - overSinceMs[m] >= limitWindowMs)
+    {
+        trippedMotor = m + 1;
+        overLimit[m] = false;
+    }
+}
+
+void MotorTelemetry::ChannelRequest(uint8_t channel, byte& getType, byte& number)
+{
+    switch (channel)
+    {
+        case TELEMETRY_CURRENT_M1:
+            getType = SABERTOOTH_GET_CURRENT;
+            number = 1;
+            break;
+        case TELEMETRY_CURRENT_M2:
+            getType = SABERTOOTH_GET_CURRENT;
+            number = 2;
+            break;
+        case TELEMETRY_BATTERY:
+            getType = SABERTOOTH_GET_BATTERY;
+            number = 1;
+            break;
+        default:
+            getType = SABERTOOTH_GET_TEMPERATURE;
+            number = 1;
+            break;
+    }
+}
+
+#endif // USE_WAVESHARE_ESP32_LCD
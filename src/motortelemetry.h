@@ -0,0 +1,91 @@
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#ifndef MOTORTELEMETRY_H
+#define MOTORTELEMETRY_H
+
+#include <Arduino.h>
+#include <USBSabertooth.h>
+
+// Values polled from the Sabertooth, in its scaled units
+enum TelemetryChannel
+{
+    TELEMETRY_CURRENT_M1 = 0,   // Motor 1 (leg) current, 0.1 A
+    TELEMETRY_CURRENT_M2,       // Motor 2 (tilt) current, 0.1 A
+    TELEMETRY_BATTERY,          // Battery voltage, 0.1 V
+    TELEMETRY_TEMPERATURE,      // Driver temperature, degrees C
+    TELEMETRY_CHANNEL_COUNT
+};
+
+/*
+    Non-blocking replacement for USBSabertooth::getCurrent() and friends.
+
+    USBSabertooth::get() spins until the reply arrives. Instead we send one GET packet at a
+    time and feed whatever reply bytes have arrived into a USBSabertoothReplyReceiver on
+    each Update(), so the control loop never waits on the serial link.
+*/
+class MotorTelemetry
+{
+    public:
+        MotorTelemetry(USBSabertooth& sabertooth, USBSabertoothSerial& serial);
+
+        // Set polling rates and over-current limits. Limits are in 0.1 A, 0 disables the limit.
+        void Configure(uint16_t currentIntervalMs, uint16_t slowIntervalMs,
+                       uint16_t limitM1, uint16_t limitM2, uint16_t limitWindowMs);
+
+        // Service the poller. Call every loop() pass, after the motor commands.
+        void Update(uint32_t nowMs);
+
+        // Returns the motor (1 or 2) that has been over its current limit for the whole window,
+        // or 0. The trip is cleared once it has been read.
+        uint8_t TakeOverCurrentTrip();
+
+        // Latest value of a channel, and whether it is fresh.
+        int16_t Value(TelemetryChannel channel) const { return values[channel]; }
+        bool Valid(TelemetryChannel channel) const;
+
+        // Peak absolute current per channel, lowest battery voltage and highest temperature since boot.
+        int16_t Peak(TelemetryChannel channel) const { return peaks[channel]; }
+
+        void ResetPeaks();
+
+        // Replies that never arrived.
+        uint32_t Timeouts() const { return timeouts; }
+
+    private:
+        static const uint16_t REPLY_TIMEOUT_MS = 50;
+        static const uint16_t STALE_MS = 2000;
+
+        USBSabertooth& st;
+        USBSabertoothSerial& serial;
+        USBSabertoothReplyReceiver receiver;
+
+        uint16_t intervals[TELEMETRY_CHANNEL_COUNT];
+        uint16_t limits[2];
+        uint16_t limitWindowMs;
+
+        int16_t values[TELEMETRY_CHANNEL_COUNT];
+        int16_t peaks[TELEMETRY_CHANNEL_COUNT];
+        uint32_t lastPolledMs[TELEMETRY_CHANNEL_COUNT];
+        uint32_t lastValueMs[TELEMETRY_CHANNEL_COUNT];
+        bool everValid[TELEMETRY_CHANNEL_COUNT];
+
+        // Outstanding request
+        bool awaitingReply;
+        uint8_t pendingChannel;
+        uint32_t requestMs;
+        uint8_t nextChannel;
+        uint32_t timeouts;
+
+        // Over-current window tracking
+        uint32_t overSinceMs[2];
+        bool overLimit[2];
+        uint8_t trippedMotor;
+
+        bool SendRequest(uint8_t channel, uint32_t nowMs);
+        void ReadReplies(uint32_t nowMs);
+        void StoreValue(uint8_t channel, int16_t value, uint32_t nowMs);
+        static void ChannelRequest(uint8_t channel, byte& getType, byte& number);
+};
+
+#endif // MOTORTELEMETRY_H
+#endif // USE_WAVESHARE_ESP32_LCD
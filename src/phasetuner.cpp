@@ -0,0 +1,402 @@
+#include "config.h"
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#include "phasetuner.h"
+#include "settings.h"
+
+static const char* NVS_NAMESPACE = "r2d2tune";
+static const char* STATE_KEY = "phase";
+
+// Framed like the settings blobs: magic, version, reserved, payload length, payload, CRC-32.
+// The payload is valid, profile, the hand-tuned window and the floor, 16-bit values little endian.
+static const uint32_t STATE_MAGIC = 0x54503252;        // "R2PT"
+static const uint8_t STATE_VERSION = 1;
+static const uint8_t STATE_HEADER_LENGTH = 8;
+static const uint8_t STATE_PAYLOAD_LENGTH = 10;
+static const uint8_t STATE_CRC_LENGTH = 4;
+static const uint8_t STATE_LENGTH = STATE_HEADER_LENGTH + STATE_PAYLOAD_LENGTH + STATE_CRC_LENGTH;
+
+// How far the body may swing back toward three legs, or carry on past two, before the
+// transition counts as unstable. Well clear of the fused angle's noise.
+const float PhaseTuner::FELL_BACK_DEG = 2.0f;
+const float PhaseTuner::OVERSHOOT_DEG = 3.0f;
+
+PhaseTuner::PhaseTuner()
+    : enabled(false), rangeTicks(0), upAngleDeg(0.0f), downAngleDeg(0.0f), haveWindow(false),
+      trying(false), settled(false), runs(0), legCloseTotalMs(0), tiltCloseTotalMs(0),
+      settledRuns(0), tracking(false), tiltSeen(false), bestProgressDeg(0.0f), fellBackDeg(0.0f), overshootDeg(0.0f)
+{
+    memset(&saved, 0, sizeof(saved));
+    memset(&current, 0, sizeof(current));
+    memset(&good, 0, sizeof(good));
+    memset(&lastRun, 0, sizeof(lastRun));
+}
+
+void PhaseTuner::Begin()
+{
+    uint8_t blob[STATE_LENGTH];
+    preferences.begin(NVS_NAMESPACE, true); // read-only
+    size_t length = preferences.getBytes(STATE_KEY, blob, sizeof(blob));
+    preferences.end();
+
+    // Anything damaged, or from a layout this build doesn't know, counts as nothing learned.
+    memset(&saved, 0, sizeof(saved));
+    if (length != STATE_LENGTH || ReadLE(blob, 4) != STATE_MAGIC || blob[4] != STATE_VERSION ||
+        ReadLE(blob + 6, 2) != STATE_PAYLOAD_LENGTH ||
+        ReadLE(blob + STATE_LENGTH - STATE_CRC_LENGTH, 4) != SettingsManager::Crc32(blob, STATE_LENGTH - STATE_CRC_LENGTH))
+    {
+        return;
+    }
+    const uint8_t* p = blob + STATE_HEADER_LENGTH;
+    saved.valid = p[0];
+    saved.profile = p[1];
+    saved.handTuned.phase1Start = ReadLE(p + 2, 2);
+    saved.handTuned.phase1End = ReadLE(p + 4, 2);
+    saved.handTuned.phase2Start = ReadLE(p + 6, 2);
+    saved.floor = ReadLE(p + 8, 2);
+}
+
+void PhaseTuner::Configure(bool enable, uint8_t range, float upAngle, float downAngle)
+{
+    // Without the two angles a fall can't be told from a good transition.
+    enabled = enable && upAngle != downAngle;
+    rangeTicks = range;
+    upAngleDeg = upAngle;
+    downAngleDeg = downAngle;
+}
+
+void PhaseTuner::TiltSample(bool active, float angleDeg, bool valid)
+{
+    if (!active)
+    {
+        tracking = false;
+        return;
+    }
+    if (!tracking)
+    {
+        tracking = true;
+        bestProgressDeg = -1000.0f;
+        fellBackDeg = 0.0f;
+        overshootDeg = 0.0f;
+        tiltSeen = false;
+    }
+    if (!valid || upAngleDeg == downAngleDeg)
+    {
+        return;
+    }
+    tiltSeen = true;
+
+    // Degrees travelled from three legs toward two, whichever way round the IMU reads.
+    float span = downAngleDeg - upAngleDeg;
+    float progress = (downAngleDeg - angleDeg) * (span > 0.0f ? 1.0f : -1.0f);
+    bestProgressDeg = max(bestProgressDeg, progress);
+    fellBackDeg = max(fellBackDeg, bestProgressDeg - progress);
+    overshootDeg = max(overshootDeg, progress - fabsf(span));
+}
+
+PhaseTuneAction PhaseTuner::Completed(const PhaseWindow& ran, uint8_t profile, const PhaseRun& run)
+{
+    lastRun = run;
+    lastRun.result = PHASE_RUN_STABLE;
+    lastRun.fellBackDeg = tracking ? fellBackDeg : 0.0f;
+    lastRun.overshootDeg = tracking ? overshootDeg : 0.0f;
+    bool judged = tracking && tiltSeen;
+    tracking = false;
+
+    if (!judged)
+    {
+        // The IMU never gave a reading, so there's no telling whether the body held.
+        lastRun.result = PHASE_RUN_NO_TILT;
+        return PHASE_TUNE_NONE;
+    }
+    if (lastRun.fellBackDeg > FELL_BACK_DEG)
+    {
+        lastRun.result = PHASE_RUN_FELL_BACK;
+    }
+    else if (lastRun.overshootDeg > OVERSHOOT_DEG)
+    {
+        lastRun.result = PHASE_RUN_OVERSHOT;
+    }
+
+    PhaseTuneAction action = PHASE_TUNE_NONE;
+    if (!Adopt(ran, profile, action))
+    {
+        return PHASE_TUNE_NONE;
+    }
+    if (lastRun.result != PHASE_RUN_STABLE)
+    {
+        return Unstable();
+    }
+
+    // Settled on a window, but the droid drifts; have another go now and then.
+    if (settled)
+    {
+        if (++settledRuns >= RELEARN_RUNS)
+        {
+            settled = false;
+            ResetRuns();
+        }
+        return action;
+    }
+
+    // A switch that was never seen to close says nothing about which finished last.
+    if (run.legCloseMs == NOT_SEEN || run.tiltCloseMs == NOT_SEEN)
+    {
+        return action;
+    }
+    runs++;
+    legCloseTotalMs += run.legCloseMs;
+    tiltCloseTotalMs += run.tiltCloseMs;
+    if (runs < EVAL_RUNS)
+    {
+        return action;
+    }
+    bool tiltLast = tiltCloseTotalMs >= legCloseTotalMs;
+    ResetRuns();
+
+    // This window has held up. Lifting earlier only helps while the leg is what finishes last.
+    good = current;
+    trying = false;
+
+    PhaseWindow next;
+    if (tiltLast || !Earlier(current, next))
+    {
+        settled = true;
+        return action;
+    }
+    current = next;
+    trying = true;
+    return PHASE_TUNE_ADVANCE;
+}
+
+PhaseTuneAction PhaseTuner::Stopped(const PhaseWindow& ran, uint8_t profile)
+{
+    memset(&lastRun, 0, sizeof(lastRun));
+    lastRun.result = PHASE_RUN_STOPPED;
+    tracking = false;
+
+    PhaseTuneAction action = PHASE_TUNE_NONE;
+    if (!Adopt(ran, profile, action))
+    {
+        return PHASE_TUNE_NONE;
+    }
+    return Unstable();
+}
+
+PhaseTuneAction PhaseTuner::Revert()
+{
+    if (!saved.valid)
+    {
+        return PHASE_TUNE_NONE;
+    }
+
+    current = saved.handTuned;
+    good = current;
+    haveWindow = true;
+    enabled = false;
+    trying = false;
+    settled = false;
+    ResetRuns();
+
+    saved.valid = 0;
+    Save();
+    return PHASE_TUNE_REVERT;
+}
+
+int32_t PhaseTuner::Pack(const PhaseWindow& w)
+{
+    return (int32_t)(((uint32_t)(w.phase2Start & 0xFF) << 16) |
+                     ((uint32_t)(w.phase1End & 0xFF) << 8) |
+                     (uint32_t)(w.phase1Start & 0xFF));
+}
+
+const char* PhaseTuner::ActionName(uint8_t action)
+{
+    switch (action)
+    {
+        case PHASE_TUNE_START:      return "start";
+        case PHASE_TUNE_ADVANCE:    return "advance";
+        case PHASE_TUNE_BACK_OFF:   return "back off";
+        case PHASE_TUNE_GIVE_UP:    return "give up";
+        case PHASE_TUNE_REVERT:     return "revert";
+        default:                    return "none";
+    }
+}
+
+const char* PhaseTuner::ResultName(uint8_t result)
+{
+    switch (result)
+    {
+        case PHASE_RUN_STABLE:      return "stable";
+        case PHASE_RUN_STOPPED:     return "stopped";
+        case PHASE_RUN_FELL_BACK:   return "fell back";
+        case PHASE_RUN_OVERSHOT:    return "overshot";
+        case PHASE_RUN_NO_TILT:     return "no tilt reading";
+        default:                    return "none";
+    }
+}
+
+/*
+    Adopt
+
+    Work out which window a transition ran with before scoring it. The first one learned from,
+    or one run after the phase settings were changed by hand, becomes the hand-tuned window
+    that learning starts from. Returns false while learning is off or another profile is in use.
+*/
+bool PhaseTuner::Adopt(const PhaseWindow& ran, uint8_t profile, PhaseTuneAction& action)
+{
+    if (!enabled || (saved.valid && profile != saved.profile))
+    {
+        return false;
+    }
+
+    if (!saved.valid || (haveWindow && !SameWindow(ran, current)))
+    {
+        saved.valid = 1;
+        saved.profile = profile;
+        saved.handTuned = ran;
+        saved.floor = 0;
+        Save();
+        action = PHASE_TUNE_START;
+    }
+    else if (haveWindow)
+    {
+        return true;
+    }
+
+    // Nothing known about this window yet, after a restart or a new start.
+    current = ran;
+    good = ran;
+    haveWindow = true;
+    trying = false;
+    settled = false;
+    ResetRuns();
+    return true;
+}
+
+/*
+    Unstable
+
+    The transition just run went wrong. Nothing as early as it is tried again. A step being
+    tried goes back to the window before it; otherwise the window moves BACK_OFF_TICKS later,
+    and if the learning range doesn't allow that, learning gives up.
+*/
+PhaseTuneAction PhaseTuner::Unstable()
+{
+    ResetRuns();
+    if (current.phase2Start + 1 > saved.floor)
+    {
+        saved.floor = current.phase2Start + 1;
+        Save();
+    }
+
+    if (trying)
+    {
+        current = good;
+        trying = false;
+        settled = true;
+        return PHASE_TUNE_BACK_OFF;
+    }
+
+    PhaseWindow later;
+    if (!Later(current, later))
+    {
+        enabled = false;
+        return PHASE_TUNE_GIVE_UP;
+    }
+    current = later;
+    good = later;
+    settled = true;
+    return PHASE_TUNE_BACK_OFF;
+}
+
+// The fast lift one tick earlier, if that stays in range, after phase 1 and short of the floor.
+bool PhaseTuner::Earlier(const PhaseWindow& from, PhaseWindow& to) const
+{
+    if (from.phase2Start == 0)
+    {
+        return false;
+    }
+
+    to = from;
+    to.phase2Start--;
+    if (to.phase1End > to.phase1Start)
+    {
+        to.phase1End--;
+    }
+    return to.phase2Start > to.phase1End &&
+           to.phase2Start >= saved.floor &&
+           (int)saved.handTuned.phase2Start - (int)to.phase2Start <= rangeTicks;
+}
+
+// The fast lift BACK_OFF_TICKS later, or as much of that as the range allows.
+bool PhaseTuner::Later(const PhaseWindow& from, PhaseWindow& to) const
+{
+    int limit = min((int)saved.handTuned.phase2Start + rangeTicks, (int)MAX_TICK);
+    int ticks = min((int)BACK_OFF_TICKS, limit - (int)from.phase2Start);
+    if (ticks <= 0)
+    {
+        return false;
+    }
+
+    to = from;
+    to.phase1End = min(from.phase1End + ticks, (int)MAX_TICK);
+    to.phase2Start = from.phase2Start + ticks;
+    return true;
+}
+
+void PhaseTuner::ResetRuns()
+{
+    runs = 0;
+    legCloseTotalMs = 0;
+    tiltCloseTotalMs = 0;
+    settledRuns = 0;
+}
+
+void PhaseTuner::Save()
+{
+    uint8_t blob[STATE_LENGTH];
+    WriteLE(blob, STATE_MAGIC, 4);
+    blob[4] = STATE_VERSION;
+    blob[5] = 0;
+    WriteLE(blob + 6, STATE_PAYLOAD_LENGTH, 2);
+    uint8_t* p = blob + STATE_HEADER_LENGTH;
+    p[0] = saved.valid;
+    p[1] = saved.profile;
+    WriteLE(p + 2, saved.handTuned.phase1Start, 2);
+    WriteLE(p + 4, saved.handTuned.phase1End, 2);
+    WriteLE(p + 6, saved.handTuned.phase2Start, 2);
+    WriteLE(p + 8, saved.floor, 2);
+    WriteLE(blob + STATE_LENGTH - STATE_CRC_LENGTH, SettingsManager::Crc32(blob, STATE_LENGTH - STATE_CRC_LENGTH), STATE_CRC_LENGTH);
+
+    preferences.begin(NVS_NAMESPACE, false); // read-write
+    preferences.putBytes(STATE_KEY, blob, sizeof(blob));
+    preferences.end();
+}
+
+uint32_t PhaseTuner::ReadLE(const uint8_t* p, uint8_t size)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++)
+    {
+        value |= (uint32_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+void PhaseTuner::WriteLE(uint8_t* p, uint32_t value, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+bool PhaseTuner::SameWindow(const PhaseWindow& a, const PhaseWindow& b)
+{
+    return a.phase1Start == b.phase1Start && a.phase1End == b.phase1End &&
+           a.phase2Start == b.phase2Start;
+}
+
+#endif // USE_WAVESHARE_ESP32_LCD
@@ -0,0 +1,170 @@
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#ifndef PHASETUNER_H
+#define PHASETUNER_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// The ThreeToTwo phase settings, in ShowTime ticks
+struct PhaseWindow
+{
+    uint16_t phase1Start;
+    uint16_t phase1End;
+    uint16_t phase2Start;
+};
+
+// What the tuner did, stored as the EVENT_PHASE_TUNE code
+enum PhaseTuneAction
+{
+    PHASE_TUNE_NONE = 0,
+    PHASE_TUNE_START,       // Learning started from the hand-tuned window
+    PHASE_TUNE_ADVANCE,     // Trying the fast lift a tick earlier
+    PHASE_TUNE_BACK_OFF,    // A 3->2 went wrong, moved back later
+    PHASE_TUNE_GIVE_UP,     // Went wrong at the latest window allowed, learning turned off
+    PHASE_TUNE_REVERT       // Hand-tuned window put back
+};
+
+// How a 3->2 went, as far as the tuner could tell
+enum PhaseRunResult
+{
+    PHASE_RUN_NONE = 0,     // Nothing recorded yet
+    PHASE_RUN_STABLE,
+    PHASE_RUN_STOPPED,      // Emergency stop, kill switch, watchdog or over-current
+    PHASE_RUN_FELL_BACK,    // The body swung back toward three legs
+    PHASE_RUN_OVERSHOT,     // The body went on past the two leg angle
+    PHASE_RUN_NO_TILT       // No tilt reading, so not learned from
+};
+
+// Timing and tilt of one 3->2, in milliseconds from the command
+struct PhaseRun
+{
+    uint8_t result;         // PhaseRunResult
+    uint16_t legReleaseMs;
+    uint16_t tiltReleaseMs;
+    uint16_t legCloseMs;
+    uint16_t tiltCloseMs;
+    uint16_t completeMs;
+    float fellBackDeg;      // Furthest the body swung back from the most upright it had been
+    float overshootDeg;     // Furthest past the two leg angle
+};
+
+/*
+    Learns the ThreeToTwo phase window from the transitions the droid actually makes.
+
+    With learning on, every 3->2 is recorded: its switch release and close times, its
+    completion time and how the body moved. One that was stopped part way, or whose body swung
+    back toward three legs or on past two, was unstable. Learning needs the IMU to see that, so
+    it stays off without one, and a transition with no tilt reading isn't learned from. Once a window
+    has run EVAL_RUNS stable transitions, and the leg rather than the tilt was what finished
+    them, the fast leg lift (phase 1 end and phase 2 start together) is tried a tick earlier;
+    while the tilt finishes last an earlier lift gains nothing and only spends margin. After an
+    unstable transition the tuner goes back to the last window that stayed stable, or later
+    still, and never again tries the fast lift as early as a window that went wrong.
+
+    It never moves the window more than the learning range from the hand-tuned values, which
+    are kept in NVS until reverted. Changing the phase settings by hand starts learning afresh
+    from the new values. The tuner only decides; loop() saves the window and logs each action.
+*/
+class PhaseTuner
+{
+    public:
+        PhaseTuner();
+
+        // Load the hand-tuned window from NVS. Call from setup().
+        void Begin();
+
+        // Learning on or off, how many ticks either way of the hand-tuned window it may go,
+        // and the body angles on two legs and on three (equal where there is no IMU, which
+        // keeps learning off).
+        void Configure(bool enabled, uint8_t rangeTicks, float upAngleDeg, float downAngleDeg);
+
+        // Fused tilt angle, each time it is read. active is true while a timed 3->2 runs.
+        void TiltSample(bool active, float angleDeg, bool valid);
+
+        // A timed 3->2 reached two legs, with the window and profile it ran with. run has its
+        // switch and completion times; the result and tilt are filled in here.
+        PhaseTuneAction Completed(const PhaseWindow& ran, uint8_t profile, const PhaseRun& run);
+
+        // A timed 3->2 was stopped part way by an emergency stop of any kind.
+        PhaseTuneAction Stopped(const PhaseWindow& ran, uint8_t profile);
+
+        // Go back to the hand-tuned window and forget what was learned. PHASE_TUNE_NONE if
+        // there is nothing to revert.
+        PhaseTuneAction Revert();
+
+        // The window to run with after the last action, and the profile it belongs to.
+        const PhaseWindow& Window() const { return current; }
+        uint8_t Profile() const { return saved.profile; }
+
+        // The values learning started from, while there are any to revert to.
+        bool HasHandTuned() const { return saved.valid; }
+        const PhaseWindow& HandTuned() const { return saved.handTuned; }
+
+        bool Learning() const { return enabled; }
+        bool Settled() const { return settled; }
+        const PhaseRun& LastRun() const { return lastRun; }
+
+        // Window packed into one event log argument: phase 2 start, phase 1 end, phase 1 start
+        // in bytes 2, 1 and 0.
+        static int32_t Pack(const PhaseWindow& w);
+
+        static const char* ActionName(uint8_t action);
+        static const char* ResultName(uint8_t result);
+
+    private:
+        static const uint8_t EVAL_RUNS = 3;         // Stable transitions averaged per window
+        static const uint8_t BACK_OFF_TICKS = 2;    // Later by this after an unstable transition
+        static const uint8_t RELEARN_RUNS = 20;     // Settled transitions before trying again
+        static const uint16_t MAX_TICK = 100;       // Top of the phase settings' range
+        static const uint16_t NOT_SEEN = 0xFFFF;    // A mark TransitionStats never saw
+        static const float FELL_BACK_DEG;
+        static const float OVERSHOOT_DEG;
+
+        // Kept in NVS, framed by Save()
+        struct SavedState
+        {
+            uint8_t valid;
+            uint8_t profile;
+            PhaseWindow handTuned;
+            uint16_t floor;         // Earliest phase 2 start not known to go wrong
+        };
+
+        bool enabled;
+        uint8_t rangeTicks;
+        float upAngleDeg;
+        float downAngleDeg;
+
+        SavedState saved;
+        PhaseWindow current;        // Window being run
+        PhaseWindow good;           // Fastest window that has stayed stable
+        bool haveWindow;            // current is known; not until a transition after boot
+        bool trying;                // current is a step earlier than good
+        bool settled;
+        uint8_t runs;
+        uint32_t legCloseTotalMs;
+        uint32_t tiltCloseTotalMs;
+        uint8_t settledRuns;
+
+        bool tracking;
+        bool tiltSeen;              // A valid angle arrived during the transition running now
+        float bestProgressDeg;      // Of the transition running now
+        float fellBackDeg;
+        float overshootDeg;
+        PhaseRun lastRun;
+
+        Preferences preferences;
+
+        bool Adopt(const PhaseWindow& ran, uint8_t profile, PhaseTuneAction& action);
+        PhaseTuneAction Unstable();
+        bool Earlier(const PhaseWindow& from, PhaseWindow& to) const;
+        bool Later(const PhaseWindow& from, PhaseWindow& to) const;
+        void ResetRuns();
+        void Save();
+        static bool SameWindow(const PhaseWindow& a, const PhaseWindow& b);
+        static uint32_t ReadLE(const uint8_t* p, uint8_t size);
+        static void WriteLE(uint8_t* p, uint32_t value, uint8_t size);
+};
+
+#endif // PHASETUNER_H
+#endif // USE_WAVESHARE_ESP32_LCD
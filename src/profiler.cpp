@@ -0,0 +1,153 @@
+#include "config.h"
+#include "profiler.h"
+
+#ifdef ENABLE_LOOP_PROFILER
+
+LoopProfiler loopProfiler;
+
+LoopProfiler::LoopProfiler()
+    : lastLoopStartUs(0), haveLoopStart(false)
+{
+    Reset();
+}
+
+void LoopProfiler::Record(uint8_t stage, uint32_t elapsedUs)
+{
+    if (stage >= PROF_STAGE_COUNT)
+    {
+        return;
+    }
+
+    StageStats& s = stats[stage];
+    if (s.count == 0 || elapsedUs < s.minUs)
+    {
+        s.minUs = elapsedUs;
+    }
+    if (elapsedUs > s.maxUs)
+    {
+        s.maxUs = elapsedUs;
+    }
+    s.count++;
+    s.sumUs += elapsedUs;
+
+    // Bucket is the bit length of the sample, so each one spans a power of two.
+    uint8_t bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && (elapsedUs >> bucket) != 0)
+    {
+        bucket++;
+    }
+    s.buckets[bucket]++;
+}
+
+void LoopProfiler::LoopTick()
+{
+    uint32_t now = ProfilerNowUs();
+    if (haveLoopStart)
+    {
+        Record(PROF_LOOP_PERIOD, now - lastLoopStartUs);
+    }
+    lastLoopStartUs = now;
+    haveLoopStart = true;
+}
+
+void LoopProfiler::Reset()
+{
+    memset(stats, 0, sizeof(stats));
+    haveLoopStart = false;
+}
+
+const char* LoopProfiler::StageName(uint8_t stage)
+{
+    switch (stage)
+    {
+        case PROF_WEB_COMMANDS:   return "web_commands";
+        case PROF_ROLLING_CODE:   return "rolling_code";
+        case PROF_LIMIT_SWITCHES: return "limit_switches";
+        case PROF_IMU:            return "imu";
+        case PROF_CHECK_STANCE:   return "check_stance";
+        case PROF_DISPLAY:        return "display";
+        case PROF_WEB_MOVE:       return "web_move";
+        case PROF_MOVE:           return "move";
+        case PROF_MOTOR_IO:       return "motor_io";
+        case PROF_WEB_CLIENT:     return "web_client";
+        case PROF_LOOP_PERIOD:    return "loop_period";
+        default:                  return "unknown";
+    }
+}
+
+void LoopProfiler::PrintMetrics(Print& out) const
+{
+    out.println(F("# HELP r2_loop_stage_us Time spent in each loop() stage, microseconds."));
+    out.println(F("# TYPE r2_loop_stage_us histogram"));
+    for (uint8_t stage = 0; stage < PROF_STAGE_COUNT; stage++)
+    {
+        const StageStats& s = stats[stage];
+        const char* name = StageName(stage);
+
+        // Prometheus buckets are cumulative. Bucket i holds samples below 2^i, so its upper bound is 2^i - 1.
+        uint32_t cumulative = 0;
+        for (uint8_t b = 0; b < BUCKET_COUNT; b++)
+        {
+            cumulative += s.buckets[b];
+            out.print(F("r2_loop_stage_us_bucket{stage=\""));
+            out.print(name);
+            out.print(F("\",le=\""));
+            if (b == BUCKET_COUNT - 1)
+            {
+                out.print(F("+Inf"));
+            }
+            else
+            {
+                out.print((1UL << b) - 1);
+            }
+            out.print(F("\"} "));
+            out.println(cumulative);
+        }
+        out.print(F("r2_loop_stage_us_sum{stage=\""));
+        out.print(name);
+        out.print(F("\"} "));
+        out.println((unsigned long)s.sumUs);
+        out.print(F("r2_loop_stage_us_count{stage=\""));
+        out.print(name);
+        out.print(F("\"} "));
+        out.println(s.count);
+    }
+
+    // Each family's samples have to follow its own TYPE line, so min, avg and max go out one
+    // family at a time.
+    PrintGauge(out, "r2_loop_stage_min_us", "Shortest time spent in each loop() stage, microseconds.", GAUGE_MIN);
+    PrintGauge(out, "r2_loop_stage_avg_us", "Mean time spent in each loop() stage, microseconds.", GAUGE_AVG);
+    PrintGauge(out, "r2_loop_stage_max_us", "Longest time spent in each loop() stage, microseconds.", GAUGE_MAX);
+}
+
+void LoopProfiler::PrintGauge(Print& out, const char* family, const char* help, GaugeValue value) const
+{
+    out.print(F("# HELP "));
+    out.print(family);
+    out.print(' ');
+    out.println(help);
+    out.print(F("# TYPE "));
+    out.print(family);
+    out.println(F(" gauge"));
+    for (uint8_t stage = 0; stage < PROF_STAGE_COUNT; stage++)
+    {
+        const StageStats& s = stats[stage];
+        uint32_t sample = s.maxUs;
+        if (value == GAUGE_MIN)
+        {
+            sample = s.minUs;
+        }
+        else if (value == GAUGE_AVG)
+        {
+            sample = (s.count > 0) ? (uint32_t)(s.sumUs / s.count) : 0;
+        }
+
+        out.print(family);
+        out.print(F("{stage=\""));
+        out.print(StageName(stage));
+        out.print(F("\"} "));
+        out.println(sample);
+    }
+}
+
+#endif // ENABLE_LOOP_PROFILER
@@ -0,0 +1,112 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "config.h"
+
+#ifdef ENABLE_LOOP_PROFILER
+
+#include <Arduino.h>
+#ifdef USE_WAVESHARE_ESP32_LCD
+    #include <esp_timer.h>
+#endif
+
+// Stages of loop() that are timed individually
+enum ProfileStage
+{
+    PROF_WEB_COMMANDS = 0,
+    PROF_ROLLING_CODE,
+    PROF_LIMIT_SWITCHES,
+    PROF_IMU,
+    PROF_CHECK_STANCE,
+    PROF_DISPLAY,
+    PROF_WEB_MOVE,
+    PROF_MOVE,
+    PROF_MOTOR_IO,      // Motion checks, motor ramping and over-current checks
+    PROF_WEB_CLIENT,
+    PROF_LOOP_PERIOD,   // Start of one loop() to the start of the next
+    PROF_STAGE_COUNT
+};
+
+// Microsecond timestamp used for all profiler measurements.
+inline uint32_t ProfilerNowUs()
+{
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        return (uint32_t)esp_timer_get_time();
+    #else
+        return micros();
+    #endif
+}
+
+class LoopProfiler
+{
+    public:
+        // Histogram bucket i counts samples of bit length i (2^(i-1) <= us < 2^i); the last bucket takes everything longer.
+        static const uint8_t BUCKET_COUNT = 17;
+
+        LoopProfiler();
+
+        // Add one sample for a stage.
+        void Record(uint8_t stage, uint32_t elapsedUs);
+
+        // Mark the start of a loop() pass and record the period since the previous one.
+        void LoopTick();
+
+        // Clear all statistics.
+        void Reset();
+
+        // Write all stages in Prometheus text exposition format.
+        void PrintMetrics(Print& out) const;
+
+        static const char* StageName(uint8_t stage);
+
+    private:
+        struct StageStats
+        {
+            uint32_t count;
+            uint32_t minUs;
+            uint32_t maxUs;
+            uint64_t sumUs;
+            uint32_t buckets[BUCKET_COUNT];
+        };
+
+        // Which of a stage's figures a gauge family reports
+        enum GaugeValue
+        {
+            GAUGE_MIN = 0,
+            GAUGE_AVG,
+            GAUGE_MAX
+        };
+
+        StageStats stats[PROF_STAGE_COUNT];
+        uint32_t lastLoopStartUs;
+        bool haveLoopStart;
+
+        // One gauge family: its HELP and TYPE lines, then a sample for every stage.
+        void PrintGauge(Print& out, const char* family, const char* help, GaugeValue value) const;
+};
+
+extern LoopProfiler loopProfiler;
+
+// Times the rest of the enclosing scope and records it against a stage.
+class ProfileScope
+{
+    public:
+        ProfileScope(uint8_t stage) : stage(stage), startUs(ProfilerNowUs()) {}
+        ~ProfileScope() { loopProfiler.Record(stage, ProfilerNowUs() - startUs); }
+
+    private:
+        uint8_t stage;
+        uint32_t startUs;
+};
+
+#define PROFILE_SCOPE(stage) ProfileScope profileScope_##stage(stage)
+#define PROFILE_LOOP_TICK()  loopProfiler.LoopTick()
+
+#else
+
+#define PROFILE_SCOPE(stage)
+#define PROFILE_LOOP_TICK()
+
+#endif // ENABLE_LOOP_PROFILER
+
+#endif // PROFILER_H
@@ -46,21 +46,33 @@
 
     Things that need to happen:
 
-    When starting a transition, if the expected Limit switches don't release stop! - TBD
+    When starting a transition, if the expected Limit switches don't release stop! - DONE
     Add a STOP command, so that if the safety is toggled, the sequence stops immediately - DONE
     Convert ShowTime to be a timer, instead of a counter.  Just use the counter directly. - TBD
-    Check for over amperage?? - TBD
+    Check for over amperage?? - DONE (ESP32 builds)
 */
 
 #include "config.h"
 #include "display.h"
+#include "profiler.h"
+#include "motionsupervisor.h"
+#include "logger.h"
+#include "stance.h"
+#include "switchinputs.h"
+#include "remotebuttons.h"
+#include "motordrive.h"
 #include <USBSabertooth.h>
 #ifdef USE_WAVESHARE_ESP32_S3_LCD
     #include <Wire.h>
+    #include "tiltcontroller.h"
 #endif
 #ifdef USE_WAVESHARE_ESP32_LCD
     #include "settings.h"
     #include "webconfig.h"
+    #include "eventlog.h"
+    #include "transitionstats.h"
+    #include "phasetuner.h"
+    #include "motortelemetry.h"
 #endif
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -74,10 +86,35 @@
 #endif
 USBSabertooth       ST(C, 128);              // Use address 128.
 
+// All motor commands go through here, for the ramping and to keep the UART from flooding.
+MotorDrive motors(ST);
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+    // Background current/battery/temperature polling, replaces the blocking ST.getCurrent()
+    MotorTelemetry telemetry(ST, C);
+    unsigned long PreviousTelemetryDisplayMillis = 0;
+    const unsigned long TelemetryDisplayInterval = 500;
+#endif
+
 // Control Mode - Rolling Code Remote
 // NOTE - RC and serial control modes removed to simplify the code and avoid confusion. The rolling code remote is the only control mode supported in this version of the sketch.
 #define ENABLE_ROLLING_CODE_TRIGGER
 
+// Limit switches and remote inputs, sampled together and debounced once per loop. Bits 0-3 are
+// the limit switches (SWITCH_* in stance.h), then the rolling code buttons.
+SwitchInputs switchInputs;
+#define INPUT_BUTTON_A 0x10
+#define INPUT_BUTTON_B 0x20
+#define INPUT_BUTTON_C 0x40
+#define INPUT_BUTTON_D 0x80
+static const uint8_t INPUT_PINS[] =
+{
+    LegUpPin, LegDnPin, TiltUpPin, TiltDnPin,
+    #ifdef ENABLE_ROLLING_CODE_TRIGGER
+        ROLLING_CODE_BUTTON_A_PIN, ROLLING_CODE_BUTTON_B_PIN, ROLLING_CODE_BUTTON_C_PIN, ROLLING_CODE_BUTTON_D_PIN
+    #endif
+};
+
 // Display Manager
 DisplayManager display;
 
@@ -85,16 +122,11 @@ DisplayManager display;
 #ifdef USE_WAVESHARE_ESP32_LCD
     SettingsManager settingsManager;
     WebConfigServer webConfig(settingsManager);
+    EventLog eventLog;
+    TransitionStats transitionStats;
+    PhaseTuner phaseTuner;
 
     // Independent single-motor web move (runs alongside StanceTarget system)
-    enum WebMoveActive
-    {
-        WEB_MOVE_NONE = 0,
-        WEB_MOVE_LEG_UP,
-        WEB_MOVE_LEG_DN,
-        WEB_MOVE_TILT_UP,
-        WEB_MOVE_TILT_DN
-    };
     WebMoveActive webMoveActive = WEB_MOVE_NONE;
 #endif
 
@@ -109,6 +141,11 @@ int threeToTwoLegSlowPower;
 int threeToTwoLegFastPower;
 int threeToTwoTiltPower;
 
+// Motor ramp times per full scale, milliseconds (populated from settings on ESP32, hardcoded on Pro Micro)
+int moveRampTime;
+int twoToThreeRampTime;
+int threeToTwoRampTime;
+
 // Timing Variables (populated from settings on ESP32, hardcoded on Pro Micro)
 int StanceInterval;
 int ShowTimeInterval;
@@ -123,24 +160,25 @@ unsigned long ShowTime = 0;
     bool imuAvailable = false;
     bool imuTiltValid = false;
     float imuTiltAngleDeg = 0.0f;
+    float imuTiltRateDps = 0.0f;
+    unsigned long imuSampleMillis = 0;
+    unsigned long PreviousImuMillis = 0;
     unsigned long PreviousTiltMillis = 0;
-    const unsigned long TiltInterval = 100;
-#endif
+    const unsigned long TiltInterval = 100;         // Display and chart
+    const unsigned long ImuControlInterval = 10;    // IMU reads while the tilt motor runs
 
-// Variables to check R2 state for transitions
-enum StanceState
-{
-    STANCE_NO_TARGET = 0,
-    TWO_LEG_STANCE = 1,
-    THREE_LEG_STANCE = 2,
-    STANCE_ERROR_LEG_UP_TILT_UNKNOWN = 3,
-    STANCE_ERROR_LEG_UNKNOWN_TILT_UP = 4,
-    STANCE_ERROR_LEG_DOWN_TILT_UNKNOWN = 5,
-    STANCE_ERROR_LEG_UNKNOWN_TILT_DOWN = 6,
-    STANCE_ERROR_ALL_UNKNOWN = 7,
-    STANCE_ERROR_LEG_DOWN_TILT_UP = 8,
-    STANCE_ERROR_LEG_UP_TILT_DOWN = 9
-};
+    // Gyro against accelerometer in the fused angle: the gyro's share of the angle fades over
+    // about this long, so its drift never builds up and the accelerometer's noise is smoothed.
+    const float ImuFusionSeconds = 0.5f;
+
+    // Slows the tilt onto its end stops
+    TiltController tiltController;
+
+    // Limit switches closed at the last loop (bit 0 LegUp, 1 LegDn, 2 TiltUp, 3 TiltDn) and the
+    // ones that changed since the last tilt chart sample, so short bounces still get a marker.
+    uint8_t chartSwitchState = 0;
+    uint8_t chartSwitchEvents = 0;
+#endif
 
 int TiltUp;
 int TiltDn;
@@ -152,48 +190,26 @@ int previousStance = -1;  // Track previous stance for display updates
 char stanceName[16] = "No Target";
 bool LegMoving;  // False if leg is at target, True if leg is moving
 bool TiltMoving; // False if tilt is at target, True if tilt is moving
-int rollCodeA;
-int rollCodeB;
-int rollCodeC;
-int rollCodeD;
+StanceState moveTarget = STANCE_NO_TARGET;  // The target Move() last acted on
+
+// Limit switch watchdog. A missed deadline stops the motors and latches an error stance
+// until the next command.
+MotionSupervisor motionSupervisor;
+StanceState motionFaultStance = STANCE_NO_TARGET;
 bool enableRollCodeTransitions = false;
 unsigned long rollCodeTransitionTimeout; // Used to auto disable the enable signal after a set time
 unsigned long commandEnableTimeout;
-bool killDebugSent = false;
+bool killDebugSent = true;  // Nothing to stop at power up
 
 // Button detection and debounce for the rolling code remote
 #ifdef ENABLE_ROLLING_CODE_TRIGGER
+    RemoteButtons remoteButtons;
     unsigned long buttonDebounceTime;
 
     // ThreeToTwo phase timing (ShowTime tick counts)
     int phase1Start;
     int phase1End;
     int phase2Start;
-    int buttonALastState;
-    int buttonBLastState;
-    int buttonCLastState;
-    int buttonDLastState;
-    unsigned long buttonATimeout;
-    unsigned long buttonBTimeout;
-    unsigned long buttonCTimeout;
-    unsigned long buttonDTimeout;
-#endif
-
-// Scale a motor power value by a percentage (0-100). Preserves sign.
-int ScalePower(int power, int percent)
-{
-    return (int)((long)power * percent / 100);
-}
-
-// Debug Print stuff
-#define DEBUG
-#define DEBUG_VERBOSE  // Enable this to see all debug status on the Serial Monitor.
-#ifdef DEBUG
-    #define DEBUG_PRINT_LN(msg)  Serial.println(msg)
-    #define DEBUG_PRINT(msg)  Serial.print(msg)
-#else
-    #define DEBUG_PRINT_LN(msg)
-    #define DEBUG_PRINT(msg)
 #endif
 
 #ifdef USE_WAVESHARE_ESP32_S3_LCD
@@ -210,6 +226,8 @@ bool ImuWriteReg(uint8_t reg, uint8_t value)
     return (Wire.endTransmission() == 0);
 }
 
+// Read consecutive registers in one burst. Relies on the address auto increment that
+// InitQmi8658() turns on for anything longer than one register.
 bool ImuReadRegs(uint8_t reg, uint8_t* data, uint8_t len)
 {
     if (imuAddress < 0)
@@ -217,20 +235,20 @@ bool ImuReadRegs(uint8_t reg, uint8_t* data, uint8_t len)
         return false;
     }
 
-    for (uint8_t i = 0; i < len; i++)
+    Wire.beginTransmission((uint8_t)imuAddress);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0)
     {
-        Wire.beginTransmission((uint8_t)imuAddress);
-        Wire.write((uint8_t)(reg + i));
-        if (Wire.endTransmission(false) != 0)
-        {
-            return false;
-        }
+        return false;
+    }
 
-        uint8_t readLen = Wire.requestFrom((uint8_t)imuAddress, (uint8_t)1);
-        if (readLen != 1)
-        {
-            return false;
-        }
+    uint8_t readLen = Wire.requestFrom((uint8_t)imuAddress, len);
+    if (readLen != len)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < len; i++)
+    {
         data[i] = Wire.read();
     }
     return true;
@@ -246,9 +264,14 @@ bool InitQmi8658()
         imuAddress = addresses[i];
         if (ImuReadRegs(0x00, &whoAmI, 1) && whoAmI == 0x05)
         {
+            // CTRL1: address auto increment, so the samples can be read in one burst.
+            uint8_t ctrl1 = 0;
+            ImuReadRegs(0x02, &ctrl1, 1);
+            ImuWriteReg(0x02, ctrl1 | 0x40);
+
             // CTRL2: ACC range/ODR, CTRL7: enable ACC and GYRO.
             ImuWriteReg(0x03, 0x15); // 2g, 250Hz
-            ImuWriteReg(0x04, 0x35); // Gyro config (unused for tilt, keeps device in known mode)
+            ImuWriteReg(0x04, 0x35); // Gyro +-128 dps (256 LSB/dps), 235Hz
             ImuWriteReg(0x08, 0x03); // Enable ACC + GYRO
             return true;
         }
@@ -258,10 +281,16 @@ bool InitQmi8658()
     return false;
 }
 
-bool ReadQmi8658Tilt(float& tiltDegOut)
+bool ReadQmi8658Tilt(float& tiltDegOut, float& rateDpsOut)
 {
-    uint8_t raw[6];
-    if (!ImuReadRegs(0x35, raw, sizeof(raw)))
+    // Accelerometer X, Y, Z, then the gyro as far as the axis the tilt turns about, in one burst.
+    #if IMU_TILT_USE_X_AXIS
+        const uint8_t readLength = 10;  // Gyro X, Y
+    #else
+        const uint8_t readLength = 8;   // Gyro X
+    #endif
+    uint8_t raw[10];
+    if (!ImuReadRegs(0x35, raw, readLength))
     {
         return false;
     }
@@ -281,16 +310,22 @@ bool ReadQmi8658Tilt(float& tiltDegOut)
         return false;
     }
 
-    // Signed tilt angle from gravity, range about -180..180 degrees.
-    // Choose axis in config.h (X/Z or Y/Z).
+    // Signed tilt angle from gravity, range about -180..180 degrees, and how fast it is
+    // changing from the gyro. Choose axis in config.h (X/Z or Y/Z). Turning about +Y lowers
+    // atan2(ax, az), turning about +X raises atan2(ay, az).
     #if IMU_TILT_USE_X_AXIS
+        int16_t gyRaw = (int16_t)((raw[9] << 8) | raw[8]);
         tiltDegOut = atan2f(ax, az) * (180.0f / PI);
+        rateDpsOut = -(float)gyRaw / 256.0f;
     #else
+        int16_t gxRaw = (int16_t)((raw[7] << 8) | raw[6]);
         tiltDegOut = atan2f(ay, az) * (180.0f / PI);
+        rateDpsOut = (float)gxRaw / 256.0f;
     #endif
 
     #if IMU_TILT_INVERT
         tiltDegOut = -tiltDegOut;
+        rateDpsOut = -rateDpsOut;
     #endif
 
     tiltDegOut += IMU_TILT_OFFSET_DEG;
@@ -309,23 +344,29 @@ bool ReadQmi8658Tilt(float& tiltDegOut)
 void UpdateTiltFromImu()
 {
     float sampleTilt = 0.0f;
+    float sampleRate = 0.0f;
     if (!imuAvailable)
     {
         imuTiltValid = false;
         return;
     }
 
-    if (ReadQmi8658Tilt(sampleTilt))
+    if (ReadQmi8658Tilt(sampleTilt, sampleRate))
     {
-        // Low-pass filter for stable display.
-        if (imuTiltValid)
+        // Complementary filter: follow the gyro from the last angle, and pull toward the
+        // accelerometer's angle just enough to cancel the gyro's drift.
+        float dt = (currentMillis - imuSampleMillis) / 1000.0f;
+        if (imuTiltValid && dt < ImuFusionSeconds)
         {
-            imuTiltAngleDeg = (0.8f * imuTiltAngleDeg) + (0.2f * sampleTilt);
+            float gyroShare = ImuFusionSeconds / (ImuFusionSeconds + dt);
+            imuTiltAngleDeg = gyroShare * (imuTiltAngleDeg + sampleRate * dt) + (1.0f - gyroShare) * sampleTilt;
         }
         else
         {
             imuTiltAngleDeg = sampleTilt;
         }
+        imuTiltRateDps = sampleRate;
+        imuSampleMillis = currentMillis;
         imuTiltValid = true;
     }
     else
@@ -335,6 +376,120 @@ void UpdateTiltFromImu()
 }
 #endif
 
+#ifdef USE_WAVESHARE_ESP32_LCD
+// Copy the published settings into the globals the motion code uses and push the telemetry and
+// watchdog limits to their modules.
+void ApplySettings()
+{
+    const ControllerSettings& s = settingsManager.Live();
+
+    moveLegDnPower         = s.moveLegDnPower;
+    moveLegUpPower         = s.moveLegUpPower;
+    moveTiltDnPower        = s.moveTiltDnPower;
+    moveTiltUpPower        = s.moveTiltUpPower;
+    twoToThreeLegPower     = s.twoToThreeLegPower;
+    twoToThreeTiltPower    = s.twoToThreeTiltPower;
+    threeToTwoLegSlowPower = s.threeToTwoLegSlowPower;
+    threeToTwoLegFastPower = s.threeToTwoLegFastPower;
+    threeToTwoTiltPower    = s.threeToTwoTiltPower;
+
+    moveRampTime           = s.moveRampTime;
+    twoToThreeRampTime     = s.twoToThreeRampTime;
+    threeToTwoRampTime     = s.threeToTwoRampTime;
+    motors.Configure(s.rampJerkTime);
+
+    StanceInterval         = s.stanceInterval;
+    ShowTimeInterval       = s.showTimeInterval;
+    commandEnableTimeout   = s.commandEnableTimeout;
+    buttonDebounceTime     = s.buttonDebounceTime;
+    remoteButtons.Configure(buttonDebounceTime, BUTTON_LONG_PRESS_TIME, BUTTON_DOUBLE_PRESS_TIME);
+    switchInputs.SetFilterTime(s.switchFilterTime);
+    phase1Start            = s.phase1Start;
+    phase1End              = s.phase1End;
+    phase2Start            = s.phase2Start;
+
+    telemetry.Configure(s.telemetryCurrentInterval, s.telemetrySlowInterval,
+                        s.currentLimitM1, s.currentLimitM2, s.currentLimitWindow);
+    #ifdef USE_WAVESHARE_ESP32_S3_LCD
+        tiltController.Configure(s.tiltControl, s.tiltUpAngle / 10.0f, s.tiltDnAngle / 10.0f,
+                                 s.tiltSlowZone / 10.0f, s.tiltMinPower);
+        phaseTuner.Configure(s.phaseLearn, s.phaseLearnRange, s.tiltUpAngle / 10.0f, s.tiltDnAngle / 10.0f);
+    #else
+        phaseTuner.Configure(s.phaseLearn, s.phaseLearnRange, 0.0f, 0.0f);
+    #endif
+    motionSupervisor.Configure(s.releaseTimeout, s.legTravelTimeout,
+                               s.tiltTravelTimeout, s.travelLearnMargin);
+    if (settingsManager.TravelChanged())
+    {
+        // Travel times learned at the old powers, ramps or timing no longer hold.
+        motionSupervisor.Forget();
+    }
+    LOG_SET_LEVEL(s.logLevel);
+}
+
+// True while a timed 3->2, the one the phase tuner learns from, is under way.
+bool TimingThreeToTwo()
+{
+    return transitionStats.Active() && transitionStats.Direction() == TRANSITION_THREE_TO_TWO;
+}
+
+/*
+    ApplyPhaseTune
+
+    Log what the phase tuner did (a PhaseTuneAction) and save the window it wants into the
+    profile it belongs to. Like an edit from the settings page, the new timing goes out once the
+    motors are idle.
+*/
+void ApplyPhaseTune(uint8_t action)
+{
+    if (action == PHASE_TUNE_NONE)
+    {
+        return;
+    }
+
+    const PhaseWindow& w = phaseTuner.Window();
+    eventLog.Record(EVENT_PHASE_TUNE, action, PhaseTuner::Pack(w));
+    LOG_INFO("Phase tuning (%s): phase 1 %d-%d, phase 2 %d", PhaseTuner::ActionName(action),
+             w.phase1Start, w.phase1End, w.phase2Start);
+
+    // The window belongs to the profile it was learned on, which needn't be the active one.
+    uint8_t profile = phaseTuner.Profile();
+    settingsManager.SetProfileValue(profile, "ph1Start", w.phase1Start);
+    settingsManager.SetProfileValue(profile, "ph1End", w.phase1End);
+    settingsManager.SetProfileValue(profile, "ph2Start", w.phase2Start);
+    if (action == PHASE_TUNE_GIVE_UP || action == PHASE_TUNE_REVERT)
+    {
+        settingsManager.settings.phaseLearn = 0;
+    }
+    settingsManager.Save();
+}
+
+/*
+    PhaseTuneTransition
+
+    Hand the timed 3->2 that just reached two legs, or was stopped part way, to the phase tuner
+    with the phase timing it ran with.
+*/
+void PhaseTuneTransition(bool completed)
+{
+    PhaseWindow ran = { (uint16_t)phase1Start, (uint16_t)phase1End, (uint16_t)phase2Start };
+    uint8_t profile = settingsManager.ActiveProfile();
+    if (!completed)
+    {
+        ApplyPhaseTune(phaseTuner.Stopped(ran, profile));
+        return;
+    }
+
+    PhaseRun run;
+    run.legReleaseMs = transitionStats.LastMark(TRANSITION_THREE_TO_TWO, MARK_LEG_RELEASE);
+    run.tiltReleaseMs = transitionStats.LastMark(TRANSITION_THREE_TO_TWO, MARK_TILT_RELEASE);
+    run.legCloseMs = transitionStats.LastMark(TRANSITION_THREE_TO_TWO, MARK_LEG_CLOSE);
+    run.tiltCloseMs = transitionStats.LastMark(TRANSITION_THREE_TO_TWO, MARK_TILT_CLOSE);
+    run.completeMs = transitionStats.LastMark(TRANSITION_THREE_TO_TWO, MARK_COMPLETE);
+    ApplyPhaseTune(phaseTuner.Completed(ran, profile, run));
+}
+#endif
+
 /*
     Setup
 
@@ -344,18 +499,11 @@ void UpdateTiltFromImu()
 */
 void setup()
 {
-    pinMode(TiltUpPin, INPUT_PULLUP);  // Limit Switch for body tilt (upper)
-    pinMode(TiltDnPin, INPUT_PULLUP);  // Limit Switch for body tilt (lower)
-    pinMode(LegUpPin,  INPUT_PULLUP);  // Limit Switch for leg lift (upper)
-    pinMode(LegDnPin,  INPUT_PULLUP);  // Limit Switch for leg lift (lower)
-
-    #ifdef ENABLE_ROLLING_CODE_TRIGGER
-        // Rolling Code Remote Pins
-        pinMode(ROLLING_CODE_BUTTON_A_PIN, INPUT_PULLUP);  // Rolling code enable/disable pin
-        pinMode(ROLLING_CODE_BUTTON_B_PIN, INPUT_PULLUP);  // Pins to trigger transitions.
-        pinMode(ROLLING_CODE_BUTTON_C_PIN, INPUT_PULLUP);
-        pinMode(ROLLING_CODE_BUTTON_D_PIN, INPUT_PULLUP);
-    #endif //ENABLE_ROLLING_CODE_TRIGGER
+    // Limit switches and the rolling code remote pins
+    switchInputs.Begin(INPUT_PINS, sizeof(INPUT_PINS));
+    #if defined(ENABLE_ROLLING_CODE_TRIGGER) && defined(USE_WAVESHARE_ESP32_LCD)
+        remoteButtons.Begin(INPUT_PINS + 4);
+    #endif
 
     // Initialize the Sabertooth serial port (UART0 on ESP32, UART1 on Pro Micro)
     #ifdef USE_WAVESHARE_ESP32_LCD
@@ -370,6 +518,14 @@ void setup()
     #else
         Serial.begin(9600); // USB on Pro Micro
     #endif
+    #ifdef ENABLE_SERIAL_LOG
+        logger.Begin();
+    #endif
+
+    // Start the persistent event log early so the boot record is first.
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        eventLog.Begin();
+    #endif
 
     // Initialize the display
     display.begin();
@@ -382,39 +538,23 @@ void setup()
         display.showTiltAngle(0.0f, imuAvailable);
         if (imuAvailable)
         {
-            DEBUG_PRINT_LN("QMI8658 IMU detected.");
+            LOG_INFO("QMI8658 IMU detected.");
         }
         else
         {
-            DEBUG_PRINT_LN("QMI8658 IMU not detected.");
+            LOG_WARN("QMI8658 IMU not detected.");
         }
     #endif
 
     // Load settings and start WiFi config server (ESP32 only)
     #ifdef USE_WAVESHARE_ESP32_LCD
         settingsManager.Load();
+        transitionStats.Begin();
+        phaseTuner.Begin();
         webConfig.Begin();
 
-        // Populate motor power variables from saved settings, scaled by power multiplier
-        int pct = settingsManager.settings.powerMultiplier;
-        moveLegDnPower         = ScalePower(settingsManager.settings.moveLegDnPower, pct);
-        moveLegUpPower         = ScalePower(settingsManager.settings.moveLegUpPower, pct);
-        moveTiltDnPower        = ScalePower(settingsManager.settings.moveTiltDnPower, pct);
-        moveTiltUpPower        = ScalePower(settingsManager.settings.moveTiltUpPower, pct);
-        twoToThreeLegPower     = ScalePower(settingsManager.settings.twoToThreeLegPower, pct);
-        twoToThreeTiltPower    = ScalePower(settingsManager.settings.twoToThreeTiltPower, pct);
-        threeToTwoLegSlowPower = ScalePower(settingsManager.settings.threeToTwoLegSlowPower, pct);
-        threeToTwoLegFastPower = ScalePower(settingsManager.settings.threeToTwoLegFastPower, pct);
-        threeToTwoTiltPower    = ScalePower(settingsManager.settings.threeToTwoTiltPower, pct);
-
-        // Populate timing variables from saved settings
-        StanceInterval         = settingsManager.settings.stanceInterval;
-        ShowTimeInterval       = settingsManager.settings.showTimeInterval;
-        commandEnableTimeout   = settingsManager.settings.commandEnableTimeout;
-        buttonDebounceTime     = settingsManager.settings.buttonDebounceTime;
-        phase1Start            = settingsManager.settings.phase1Start;
-        phase1End              = settingsManager.settings.phase1End;
-        phase2Start            = settingsManager.settings.phase2Start;
+        settingsManager.Publish(false);
+        ApplySettings();
     #else
         // Arduino Pro Micro: use shared compiled defaults
         moveLegDnPower         = DEFAULT_MOVE_LEG_DN_POWER;
@@ -427,13 +567,22 @@ void setup()
         threeToTwoLegFastPower = DEFAULT_THREE_TO_TWO_LEG_FAST_POWER;
         threeToTwoTiltPower    = DEFAULT_THREE_TO_TWO_TILT_POWER;
 
+        moveRampTime           = DEFAULT_MOVE_RAMP_TIME;
+        twoToThreeRampTime     = DEFAULT_TWO_TO_THREE_RAMP_TIME;
+        threeToTwoRampTime     = DEFAULT_THREE_TO_TWO_RAMP_TIME;
+        motors.Configure(DEFAULT_RAMP_JERK_TIME);
+
         StanceInterval         = DEFAULT_STANCE_INTERVAL;
         ShowTimeInterval       = DEFAULT_SHOWTIME_INTERVAL;
         commandEnableTimeout   = DEFAULT_COMMAND_ENABLE_TIMEOUT;
         buttonDebounceTime     = DEFAULT_BUTTON_DEBOUNCE_TIME;
+        remoteButtons.Configure(buttonDebounceTime, BUTTON_LONG_PRESS_TIME, BUTTON_DOUBLE_PRESS_TIME);
+        switchInputs.SetFilterTime(DEFAULT_SWITCH_FILTER_TIME);
         phase1Start            = DEFAULT_PHASE1_START;
         phase1End              = DEFAULT_PHASE1_END;
         phase2Start            = DEFAULT_PHASE2_START;
+        motionSupervisor.Configure(DEFAULT_RELEASE_TIMEOUT, DEFAULT_LEG_TRAVEL_TIMEOUT,
+                                   DEFAULT_TILT_TRAVEL_TIMEOUT, DEFAULT_TRAVEL_LEARN_MARGIN);
     #endif
 
     // Setup the Target as no-target to begin.
@@ -446,89 +595,177 @@ void setup()
     This code will read the signal from the four limit switches installed in the body.
     The Limit switches are expected to be installed in NO Mode (Normal Open) so that
     when the switch is depressed, the signal will be pulled LOW.
+
+    All the inputs, remote included, are sampled at once and debounced here, and everything
+    else works from this pass's values.
 */
 void ReadLimitSwitches()
 {
-    TiltUp = digitalRead(TiltUpPin);
-    TiltDn = digitalRead(TiltDnPin);
-    LegUp = digitalRead(LegUpPin);
-    LegDn = digitalRead(LegDnPin);
+    switchInputs.Sample(currentMillis);
+
+    LegUp  = switchInputs.IsLow(SWITCH_LEG_UP)  ? LOW : HIGH;
+    LegDn  = switchInputs.IsLow(SWITCH_LEG_DN)  ? LOW : HIGH;
+    TiltUp = switchInputs.IsLow(SWITCH_TILT_UP) ? LOW : HIGH;
+    TiltDn = switchInputs.IsLow(SWITCH_TILT_DN) ? LOW : HIGH;
 }
 
 /*
     ReadRollingCodeTrigger
 
     This code will read the signals from the rolling code remote receiver, and set the StanceTarget variable accordingly.
+
+    The buttons are captured by edge (see RemoteButtons), so a press is acted on with the time it
+    happened even if the loop was busy when it did. A, B and C act as soon as they go down.
+    Button D's action isn't urgent, so it waits to see which gesture it was.
 */
 void ReadRollingCodeTrigger()
 {
     #ifdef ENABLE_ROLLING_CODE_TRIGGER
 
-        unsigned long now = millis();
-        rollCodeA = digitalRead(ROLLING_CODE_BUTTON_A_PIN);
-        rollCodeB = digitalRead(ROLLING_CODE_BUTTON_B_PIN);
-        rollCodeC = digitalRead(ROLLING_CODE_BUTTON_C_PIN);
-        rollCodeD = digitalRead(ROLLING_CODE_BUTTON_D_PIN);
+        #ifndef USE_WAVESHARE_ESP32_LCD
+            // No interrupts on these pins, so hand over this pass's levels. HIGH is pressed.
+            remoteButtons.Feed(REMOTE_BUTTON_A, !switchInputs.IsLow(INPUT_BUTTON_A), currentMillis);
+            remoteButtons.Feed(REMOTE_BUTTON_B, !switchInputs.IsLow(INPUT_BUTTON_B), currentMillis);
+            remoteButtons.Feed(REMOTE_BUTTON_C, !switchInputs.IsLow(INPUT_BUTTON_C), currentMillis);
+            remoteButtons.Feed(REMOTE_BUTTON_D, !switchInputs.IsLow(INPUT_BUTTON_D), currentMillis);
+        #endif
+        remoteButtons.Poll(currentMillis);
 
-        // Button A: Toggle rolling code transitions enable/disable.
-        // Only triggers on the rising edge (LOW -> HIGH transition).
-        if (now >= buttonATimeout && rollCodeA == HIGH && buttonALastState == LOW)
+        RemoteButtonEvent event;
+        while (remoteButtons.Next(event))
         {
-            buttonATimeout = now + buttonDebounceTime;
+            // Button A: Toggle rolling code transitions enable/disable.
+            if (event.button == REMOTE_BUTTON_A && event.gesture == GESTURE_PRESS)
+            {
+                if (!enableRollCodeTransitions)
+                {
+                    enableRollCodeTransitions = true;
+                    killDebugSent = false;
+                    rollCodeTransitionTimeout = event.ms + commandEnableTimeout;
+                    display.showRollCodeEnabled(true, rollCodeTransitionTimeout);
+                    LOG_INFO("Rolling Code Transmitter Transitions Enabled");
+                }
+                else
+                {
+                    enableRollCodeTransitions = false;
+                    killDebugSent = false;
+                    display.showRollCodeEnabled(false);
+                    LOG_INFO("Rolling Code Transmitter Transitions Disabled");
+                }
+                continue;
+            }
+
             if (!enableRollCodeTransitions)
             {
-                enableRollCodeTransitions = true;
-                killDebugSent = false;
-                rollCodeTransitionTimeout = now + commandEnableTimeout;
-                display.showRollCodeEnabled(true);
-                DEBUG_PRINT_LN("Rolling Code Transmitter Transitions Enabled");
+                continue;
             }
-            else
+
+            // Button B: Transition to three leg stance.
+            if (event.button == REMOTE_BUTTON_B && event.gesture == GESTURE_PRESS)
             {
-                enableRollCodeTransitions = false;
-                killDebugSent = false;
-                display.showRollCodeEnabled(false);
-                DEBUG_PRINT_LN("Rolling Code Transmitter Transitions Disabled");
+                ClearMotionFault();
+                StanceTarget = THREE_LEG_STANCE;
+                #ifdef USE_WAVESHARE_ESP32_LCD
+                    transitionStats.CommandReceived(StanceTarget, currentStance, event.ms);
+                #endif
+                LOG_INFO("Moving to Three Leg Stance.");
             }
-        }
-        // Always track the actual signal state so edges aren't missed during debounce
-        buttonALastState = rollCodeA;
 
-        // Button B: Transition to three leg stance.
-        if (now >= buttonBTimeout && enableRollCodeTransitions && rollCodeB == HIGH && buttonBLastState == LOW)
-        {
-            buttonBTimeout = now + buttonDebounceTime;
-            StanceTarget = THREE_LEG_STANCE;
-            DEBUG_PRINT_LN("Moving to Three Leg Stance.");
+            // Button C: Transition to two leg stance.
+            if (event.button == REMOTE_BUTTON_C && event.gesture == GESTURE_PRESS)
+            {
+                ClearMotionFault();
+                StanceTarget = TWO_LEG_STANCE;
+                #ifdef USE_WAVESHARE_ESP32_LCD
+                    transitionStats.CommandReceived(StanceTarget, currentStance, event.ms);
+                #endif
+                LOG_INFO("Moving to Two Leg Stance.");
+            }
+
+            // Button D: Tuning profiles (Waveshare boards). Click for the next one, double press
+            // for the previous one, long press to go back to the first.
+            if (event.button == REMOTE_BUTTON_D && event.gesture != GESTURE_PRESS)
+            {
+                #ifdef USE_WAVESHARE_ESP32_LCD
+                    uint8_t profile = settingsManager.ActiveProfile();
+                    if (event.gesture == GESTURE_CLICK)
+                    {
+                        profile = (profile + 1) % PROFILE_COUNT;
+                    }
+                    else if (event.gesture == GESTURE_DOUBLE_PRESS)
+                    {
+                        profile = (profile + PROFILE_COUNT - 1) % PROFILE_COUNT;
+                    }
+                    else
+                    {
+                        profile = 0;
+                    }
+                    settingsManager.SelectProfile(profile);
+                    LOG_INFO("Tuning profile: %s", settingsManager.ProfileName(profile));
+                #else
+                    LOG_INFO("Button D gesture %d", event.gesture);
+                #endif
+            }
         }
-        buttonBLastState = rollCodeB;
 
-        // Button C: Transition to two leg stance.
-        if (now >= buttonCTimeout && enableRollCodeTransitions && rollCodeC == HIGH && buttonCLastState == LOW)
+    #endif
+}
+
+/*
+    ReadSerialCommand
+
+    Reads a line from the USB serial port without blocking and runs it.
+    M  - dump the loop profiler statistics
+    MR - reset the loop profiler statistics
+*/
+void ReadSerialCommand()
+{
+    static char line[16];
+    static uint8_t length = 0;
+
+    while (Serial.available() > 0)
+    {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r')
         {
-            buttonCTimeout = now + buttonDebounceTime;
-            StanceTarget = TWO_LEG_STANCE;
-            DEBUG_PRINT_LN("Moving to Two Leg Stance.");
+            if (length < sizeof(line) - 1)
+            {
+                line[length++] = toupper(c);
+            }
+            continue;
         }
-        buttonCLastState = rollCodeC;
-
-        // Button D: Reserved for future use.
-        if (now >= buttonDTimeout && enableRollCodeTransitions && rollCodeD == HIGH && buttonDLastState == LOW)
+        if (length == 0)
         {
-            buttonDTimeout = now + buttonDebounceTime;
-            DEBUG_PRINT_LN("Button D Pressed");
+            continue;
         }
-        buttonDLastState = rollCodeD;
+        line[length] = '\0';
+        length = 0;
 
-    #endif
+        #ifdef ENABLE_LOOP_PROFILER
+            if (strcmp(line, "M") == 0)
+            {
+                loopProfiler.PrintMetrics(Serial);
+                continue;
+            }
+            if (strcmp(line, "MR") == 0)
+            {
+                loopProfiler.Reset();
+                Serial.println("Profiler reset.");
+                continue;
+            }
+        #endif
+
+        Serial.print("Unknown command: ");
+        Serial.println(line);
+    }
 }
 
 /*
     Display
 
-    This will output all debug Variables on the serial monitor if DEBUG_VERBOSE mode is enabled.
+    This will output all debug Variables on the serial monitor if the log level is debug.
     The output can be helpful to verify the limit switch wiring and other inputs prior to installing
-    the arduino in your droid.  For normal operation DEBUG_VERBOSE mode should be turned off.
+    the arduino in your droid.  For normal operation the log level should be info or lower.
 */
 void Display()
 {
@@ -538,46 +775,55 @@ void Display()
         display.showTiltAngle(imuTiltAngleDeg, imuTiltValid);
     #endif
 
-    // We only output this if DEBUG_VERBOSE mode is enabled.
-    #ifdef DEBUG_VERBOSE
-        DEBUG_PRINT("Tilt Up       : ");
-        TiltUp ? DEBUG_PRINT_LN("Open") : DEBUG_PRINT_LN("Closed");
-        DEBUG_PRINT("Tilt Down     : ");
-        TiltDn ? DEBUG_PRINT_LN("Open") : DEBUG_PRINT_LN("Closed");
-        DEBUG_PRINT("Leg Up        : ");
-        LegUp ? DEBUG_PRINT_LN("Open") : DEBUG_PRINT_LN("Closed");
-        DEBUG_PRINT("Leg Down      : ");
-        LegDn ? DEBUG_PRINT_LN("Open") : DEBUG_PRINT_LN("Closed");
-        DEBUG_PRINT("Stance        : ");
-        DEBUG_PRINT(currentStance); DEBUG_PRINT(": "); DEBUG_PRINT_LN(stanceName);
-        DEBUG_PRINT("Stance Target : ");
-        DEBUG_PRINT_LN(StanceTarget);
-        DEBUG_PRINT("Leg Moving    : ");
-        DEBUG_PRINT_LN(LegMoving);
-        DEBUG_PRINT("Tilt Moving   : ");
-        DEBUG_PRINT_LN(TiltMoving);
-        DEBUG_PRINT("Show Time     : ");
-        DEBUG_PRINT_LN(ShowTime);
+    // We only output this if the log level is debug. Two short lines, so the whole dump fits
+    // the Pro Micro's log buffer before the end of the pass drains it.
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG))
+    {
+        LOG_DEBUG("Switches LU %s LD %s TU %s TD %s", LegUp ? "open" : "closed",
+                  LegDn ? "open" : "closed", TiltUp ? "open" : "closed", TiltDn ? "open" : "closed");
+        LOG_DEBUG("Stance %d target %d moving leg %d tilt %d show time %lu", currentStance,
+                  StanceTarget, LegMoving, TiltMoving, ShowTime);
         #ifdef USE_WAVESHARE_ESP32_S3_LCD
-            DEBUG_PRINT("IMU Tilt      : ");
             if (imuTiltValid)
             {
-                DEBUG_PRINT_LN(imuTiltAngleDeg);
+                LOG_DEBUG("IMU Tilt      : %.2f", imuTiltAngleDeg);
             }
             else
             {
-                DEBUG_PRINT_LN("Invalid");
+                LOG_DEBUG("IMU Tilt      : Invalid");
             }
         #endif
-    #endif
+    }
 }
 
 /*
     Actual movement commands are here,  when we send the command to move leg down, first it checks the leg down limit switch, if it is closed it
     stops the motor, sets a flag (Moving) and then exits the loop, if it is open the down motor is triggered.
     all 4 work the same way
+
+    They use the switch readings taken by ReadLimitSwitches() at the start of this pass, so
+    every decision in one pass sees the same switch states.
+
+    Powers are eased in by MotorDrive over the move's ramp time and sent at the end of the
+    pass; a stop goes out straight away.
 */
 
+/*
+    TiltPower
+
+    The power to drive the tilt at this pass for a move configured at power, tilting down
+    (toward three legs) or up. On boards with the IMU the tilt controller slows it as the body
+    nears the stance it is heading for.
+*/
+int TiltPower(int power, bool down)
+{
+    #ifdef USE_WAVESHARE_ESP32_S3_LCD
+        return tiltController.Power(power, down, imuTiltAngleDeg, imuTiltRateDps, imuTiltValid);
+    #else
+        return power;
+    #endif
+}
+
 /*
     MoveLegDn
 
@@ -585,13 +831,10 @@ void Display()
 */
 void MoveLegDn()
 {
-    // Read the Pin to see where the leg is.
-    LegDn = digitalRead(LegDnPin);
-
     // If the Limit switch is closed, we should stop the motor.
     if (LegDn == LOW)
     {
-        ST.motor(1, 0);     // Stop.
+        motors.Stop(1);     // Stop.
         LegMoving = false;   // Record that we are in a good state.
         return;
     }
@@ -600,7 +843,8 @@ void MoveLegDn()
     // the switch is closed.
     if (LegDn == HIGH)
     {
-        ST.motor(1, moveLegDnPower);
+        motors.Drive(1, moveLegDnPower, moveRampTime);
+        motionSupervisor.Drive(SUPERVISED_LEG, MOTION_DOWN, MOTION_SINGLE_MOVE, currentMillis);
     }
 }
 
@@ -611,13 +855,10 @@ void MoveLegDn()
 */
 void MoveLegUp()
 {
-    // Read the Pin to see where the leg is.
-    LegUp = digitalRead(LegUpPin);
-
     // If the Limit switch is closed, we should stop the motor.
     if (LegUp == LOW)
     {
-        ST.motor(1, 0);     // Stop.
+        motors.Stop(1);     // Stop.
         LegMoving = false;   // Record that we are in a good state.
         return;
     }
@@ -626,7 +867,8 @@ void MoveLegUp()
     // the switch is closed.
     if (LegUp == HIGH)
     {
-        ST.motor(1, moveLegUpPower);
+        motors.Drive(1, moveLegUpPower, moveRampTime);
+        motionSupervisor.Drive(SUPERVISED_LEG, MOTION_UP, MOTION_SINGLE_MOVE, currentMillis);
     }
 }
 
@@ -637,13 +879,10 @@ void MoveLegUp()
 */
 void MoveTiltDn()
 {
-    // Read the Pin to see where the body tilt is.
-    TiltDn = digitalRead(TiltDnPin);
-
     // If the Limit switch is closed, we should stop the motor.
     if (TiltDn == LOW)
     {
-        ST.motor(2, 0);     // Stop.
+        motors.Stop(2);     // Stop.
         TiltMoving = false;  // Record that we are in a good state.
         return;
     }
@@ -652,7 +891,8 @@ void MoveTiltDn()
     // the switch is closed.
     if (TiltDn == HIGH)
     {
-        ST.motor(2, moveTiltDnPower);
+        motors.Drive(2, TiltPower(moveTiltDnPower, true), moveRampTime);
+        motionSupervisor.Drive(SUPERVISED_TILT, MOTION_DOWN, MOTION_SINGLE_MOVE, currentMillis);
     }
 }
 
@@ -663,13 +903,10 @@ void MoveTiltDn()
 */
 void MoveTiltUp()
 {
-    // Read the Pin to see where the body tilt is.
-    TiltUp = digitalRead(TiltUpPin);
-
     // If the Limit switch is closed, we should stop the motor.
     if (TiltUp == LOW)
     {
-        ST.motor(2, 0);     // Stop.
+        motors.Stop(2);     // Stop.
         TiltMoving = false;  // Record that we are in a good state.
         return;
     }
@@ -678,7 +915,8 @@ void MoveTiltUp()
     // the switch is closed.
     if (TiltUp == HIGH)
     {
-        ST.motor(2, moveTiltUpPower);
+        motors.Drive(2, TiltPower(moveTiltUpPower, false), moveRampTime);
+        motionSupervisor.Drive(SUPERVISED_TILT, MOTION_UP, MOTION_SINGLE_MOVE, currentMillis);
     }
 }
 
@@ -691,36 +929,36 @@ void MoveTiltUp()
 */
 void TwoToThree()
 {
-    // Read the pin positions to check if they are both down
-    // before we start moving anything.
-    TiltDn = digitalRead(TiltDnPin);
-    LegDn = digitalRead(LegDnPin);
-
-    DEBUG_PRINT_LN("  Moving to Three Legs  ");
+    LOG_EVERY(LOG_LEVEL_INFO, 1000, "  Moving to Three Legs  ");
     display.showTransition(StanceTarget);
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        transitionStats.Mark(MARK_FIRST_MOTOR, currentMillis);
+    #endif
 
     // If the leg is already down, then we are done.
     if (LegDn == LOW)
     {
-        ST.motor(1, 0);    // Stop
+        motors.Stop(1);    // Stop
         LegMoving = false;  // Record that we are in a good state.
     }
     else if (LegDn == HIGH)
     {
         // If the leg is not down, move the leg motor.
-        ST.motor(1, twoToThreeLegPower);
+        motors.Drive(1, twoToThreeLegPower, twoToThreeRampTime);
+        motionSupervisor.Drive(SUPERVISED_LEG, MOTION_DOWN, MOTION_TRANSITION, currentMillis);
     }
 
     // If the Body is already tilted, we are done.
     if (TiltDn == LOW)
     {
-        ST.motor(2, 0);     // Stop
+        motors.Stop(2);     // Stop
         TiltMoving = false;  // Record that we are in a good state.
     }
     else if (TiltDn == HIGH)
     {
         // If the body is not tilted, move the tilt motor.
-        ST.motor(2, twoToThreeTiltPower);
+        motors.Drive(2, TiltPower(twoToThreeTiltPower, true), twoToThreeRampTime);
+        motionSupervisor.Drive(SUPERVISED_TILT, MOTION_DOWN, MOTION_TRANSITION, currentMillis);
     }
 }
 
@@ -735,18 +973,16 @@ void TwoToThree()
 */
 void ThreeToTwo()
 {
-    // Read the limit switches to see where we are.
-    TiltUp = digitalRead(TiltUpPin);
-    LegUp = digitalRead(LegUpPin);
-    TiltDn = digitalRead(TiltDnPin);
-
-    DEBUG_PRINT_LN("  Moving to Two Legs  ");
+    LOG_EVERY(LOG_LEVEL_INFO, 1000, "  Moving to Two Legs  ");
     display.showTransition(StanceTarget);
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        transitionStats.Mark(MARK_FIRST_MOTOR, currentMillis);
+    #endif
 
     // First if the center leg is up, do nothing.
     if (LegUp == LOW)
     {
-        ST.motor(1, 0);    // Stop
+        motors.Stop(1);    // Stop
         LegMoving = false;  // Record that we are in a good state.
     }
 
@@ -756,24 +992,33 @@ void ThreeToTwo()
     // point for two leg stance.  After that point we can pull the leg up quickly.
     if (LegUp == HIGH && ShowTime >= phase1Start && ShowTime <= phase1End)
     {
-        ST.motor(1, threeToTwoLegSlowPower);
+        motors.Drive(1, threeToTwoLegSlowPower, threeToTwoRampTime);
+        motionSupervisor.Drive(SUPERVISED_LEG, MOTION_UP, MOTION_TRANSITION, currentMillis);
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            transitionStats.Mark(MARK_PHASE1, currentMillis);
+        #endif
     }
 
     //  If leg up is open AND the timer is past the phase 2 start then lift the center leg at full speed
     if (LegUp == HIGH && ShowTime >= phase2Start)
     {
-        ST.motor(1, threeToTwoLegFastPower);
+        motors.Drive(1, threeToTwoLegFastPower, threeToTwoRampTime);
+        motionSupervisor.Drive(SUPERVISED_LEG, MOTION_UP, MOTION_TRANSITION, currentMillis);
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            transitionStats.Mark(MARK_PHASE2, currentMillis);
+        #endif
     }
 
     // at the same time, tilt up till the switch is closed
     if (TiltUp == LOW)
     {
-        ST.motor(2, 0);     // Stop
+        motors.Stop(2);     // Stop
         TiltMoving = false;  // Record that we are in a good state.
     }
     if (TiltUp == HIGH)
     {
-        ST.motor(2, threeToTwoTiltPower);
+        motors.Drive(2, TiltPower(threeToTwoTiltPower, false), threeToTwoRampTime);
+        motionSupervisor.Drive(SUPERVISED_TILT, MOTION_UP, MOTION_TRANSITION, currentMillis);
     }
 }
 
@@ -805,74 +1050,21 @@ void CheckStance()
     // We only do this if the leg and tilt are NOT moving.
     if (LegMoving == false && TiltMoving == false)
     {
-        // Center leg is up, and the body is straight.  This is a 2 leg Stance.
-        if (LegUp == LOW && LegDn == HIGH && TiltUp == LOW && TiltDn == HIGH)
-        {
-            currentStance = TWO_LEG_STANCE;
-            strcpy(stanceName, "Two Legs.    "); // LUTU
-            return;
-        }
-
-        // Center leg is down, Body is tilted.  This is a 3 leg stance
-        if (LegUp == HIGH && LegDn == LOW && TiltUp == HIGH && TiltDn == LOW)
+        // A motor missed a limit switch deadline.  Hold the error until the next command,
+        // whatever the switches say now.
+        if (motionFaultStance != STANCE_NO_TARGET)
         {
-            currentStance = THREE_LEG_STANCE;
-            strcpy(stanceName, "Three Legs   "); // LDTD
+            currentStance = motionFaultStance;
+            strcpy(stanceName, STANCE_NAMES[currentStance]);
             return;
         }
 
-        // Leg is up.  Body switches are open.
-        // The body is somewhere between straight and tilted.
-        if (LegUp == LOW && LegDn == HIGH && TiltUp == HIGH && TiltDn == HIGH)
-        {
-            currentStance = STANCE_ERROR_LEG_UP_TILT_UNKNOWN;
-            strcpy(stanceName, "Error - LUT?");
-        }
-
-        // Leg switches are both open.  The leg is somewhere between up and down
-        // Body is straight for a 2 leg stance.
-        if (LegUp == HIGH && LegDn == HIGH && TiltUp == LOW && TiltDn == HIGH)
+        // Both switches of one axis closed is a wiring fault, not a stance, so keep the last one.
+        uint8_t stance = STANCE_TABLE[SwitchMask(LegUp, LegDn, TiltUp, TiltDn)];
+        if (stance != STANCE_UNCHANGED)
         {
-            currentStance = STANCE_ERROR_LEG_UNKNOWN_TILT_UP;
-            strcpy(stanceName, "Error - L?TU");
-        }
-
-        // Leg is down, and the body is straight for a 2 leg stance
-        // The droid is balanced on the center foot. (Probably about to fall over)
-        if (LegUp == HIGH && LegDn == LOW && TiltUp == LOW && TiltDn == HIGH)
-        {
-            currentStance = STANCE_ERROR_LEG_DOWN_TILT_UP;
-            strcpy(stanceName, "Error - LDTU");
-        }
-
-        // Leg is down.  Body switches are both open.
-        // The body is somewhere between straight and 18 degrees
-        if (LegUp == HIGH && LegDn == LOW && TiltUp == HIGH && TiltDn == HIGH)
-        {
-            currentStance = STANCE_ERROR_LEG_DOWN_TILT_UNKNOWN;
-            strcpy(stanceName, "Error - LDT?");
-        }
-
-        // Leg switches are both open.
-        // Body is tilted for a 3 leg stance.
-        if (LegUp == HIGH && LegDn == HIGH && TiltUp == HIGH && TiltDn == LOW)
-        {
-            currentStance = STANCE_ERROR_LEG_UNKNOWN_TILT_DOWN;
-            strcpy(stanceName, "Error - L?TD");
-        }
-
-        // All 4 limit switches are open.  No idea where we are.
-        if (LegUp == HIGH && LegDn == HIGH && TiltUp == HIGH && TiltDn == HIGH)
-        {
-            currentStance = STANCE_ERROR_ALL_UNKNOWN;
-            strcpy(stanceName, "Error - L?T?");
-        }
-
-        // Leg is up, body is tilted.  This should not be possible.  If it happens, we are in a bad state.
-        if (LegUp == LOW && LegDn == HIGH && TiltUp == HIGH && TiltDn == LOW)
-        {
-            currentStance = STANCE_ERROR_LEG_UP_TILT_DOWN;
-            strcpy(stanceName, "Error - LUTD");
+            currentStance = (StanceState)stance;
+            strcpy(stanceName, STANCE_NAMES[stance]);
         }
     }
 }
@@ -884,15 +1076,31 @@ void CheckStance()
 */
 void EmergencyStop()
 {
-    ST.motor(1, 0);
-    ST.motor(2, 0);
+    motors.Stop(1);
+    motors.Stop(2);
     LegMoving = false;
     TiltMoving = false;
 
     // Setting StanceTarget to STANCE_NO_TARGET ensures we don't try to restart movement.
     StanceTarget = STANCE_NO_TARGET;
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        webMoveActive = WEB_MOVE_NONE;
+    #endif
+
+    LOG_WARN("Emergency Stop.");
 
-    DEBUG_PRINT_LN("Emergency Stop.");
+    // Get this one onto flash straight away, the next thing may be a brownout.
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        eventLog.Record(EVENT_EMERGENCY_STOP, currentStance);
+        eventLog.RequestFlush();
+
+        // A 3->2 stopped part way counts against the phase timing it ran with.
+        if (TimingThreeToTwo())
+        {
+            PhaseTuneTransition(false);
+        }
+        transitionStats.Abort();
+    #endif
 }
 
 /*
@@ -918,11 +1126,111 @@ void checkKillSwitch()
 
     if (stopMotors && !killDebugSent)
     {
-        DEBUG_PRINT_LN("Killswitch activated.  Stopping Motors!");
+        LOG_WARN("Killswitch activated.  Stopping Motors!");
         killDebugSent = true;
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            eventLog.Record(EVENT_KILL_SWITCH, currentStance);
+        #endif
+        EmergencyStop();
+    }
+}
+
+/*
+    CheckMotion
+
+    Runs the limit switch watchdog for both motors.  If the switch a motor is leaving doesn't
+    open in time, or the switch it is heading for doesn't close in time, something is jammed or
+    a switch has failed.  Stop everything and report which motor and which deadline.
+*/
+void CheckMotion()
+{
+    StanceState fault = STANCE_NO_TARGET;
+
+    MotionFault legFault = motionSupervisor.Check(SUPERVISED_LEG, LegMoving, LegUp, LegDn, currentMillis);
+    if (legFault == MOTION_FAULT_NO_RELEASE)
+    {
+        fault = STANCE_ERROR_LEG_NO_RELEASE;
+    }
+    else if (legFault == MOTION_FAULT_STALL)
+    {
+        fault = STANCE_ERROR_LEG_STALL;
+    }
+
+    MotionFault tiltFault = motionSupervisor.Check(SUPERVISED_TILT, TiltMoving, TiltUp, TiltDn, currentMillis);
+    if (fault == STANCE_NO_TARGET && tiltFault == MOTION_FAULT_NO_RELEASE)
+    {
+        fault = STANCE_ERROR_TILT_NO_RELEASE;
+    }
+    else if (fault == STANCE_NO_TARGET && tiltFault == MOTION_FAULT_STALL)
+    {
+        fault = STANCE_ERROR_TILT_STALL;
+    }
+
+    if (fault == STANCE_NO_TARGET)
+    {
+        return;
+    }
+
+    LOG_ERROR("Limit switch timeout, stance %d", fault);
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        eventLog.Record(EVENT_MOTION_TIMEOUT, fault, motionSupervisor.FaultElapsed());
+    #endif
+
+    // Stop both motors, the other half of a transition can't finish safely on its own.
+    EmergencyStop();
+    motionSupervisor.Reset();
+    motionFaultStance = fault;
+    CheckStance();
+}
+
+/*
+    ClearMotionFault
+
+    A new command was given, so drop any latched limit switch timeout and work out the
+    stance from the switches again.
+*/
+void ClearMotionFault()
+{
+    if (motionFaultStance == STANCE_NO_TARGET)
+    {
+        return;
+    }
+
+    motionFaultStance = STANCE_NO_TARGET;
+    CheckStance();
+}
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+/*
+    CheckOverCurrent
+
+    Polls the Sabertooth for current, battery and temperature without blocking, and cuts
+    both motors through EmergencyStop() if either motor stays over its current limit for
+    the configured window.
+*/
+void CheckOverCurrent()
+{
+    telemetry.Update(currentMillis);
+
+    uint8_t motor = telemetry.TakeOverCurrentTrip();
+    if (motor != 0)
+    {
+        TelemetryChannel channel = (motor == 1) ? TELEMETRY_CURRENT_M1 : TELEMETRY_CURRENT_M2;
+        LOG_ERROR("Over current on motor %d", motor);
+        eventLog.Record(EVENT_OVER_CURRENT, motor, telemetry.Value(channel));
         EmergencyStop();
     }
+
+    if (currentMillis - PreviousTelemetryDisplayMillis >= TelemetryDisplayInterval)
+    {
+        PreviousTelemetryDisplayMillis = currentMillis;
+        display.showTelemetry(telemetry.Value(TELEMETRY_CURRENT_M1),
+                              telemetry.Value(TELEMETRY_CURRENT_M2),
+                              telemetry.Value(TELEMETRY_BATTERY),
+                              telemetry.Valid(TELEMETRY_CURRENT_M1) && telemetry.Valid(TELEMETRY_BATTERY));
+    }
 }
+#endif
 
 /*
     Move
@@ -945,112 +1253,69 @@ void checkKillSwitch()
     the request.
 
     In the rest of the cases, if we can't move safely, we wont.
+
+    Which of these applies is looked up in STANCE_ACTIONS (stance.h), one entry per target and
+    stance, so only one action is ever taken per pass.
+
+    A new target, including one given halfway through a transition, starts from both motors
+    stopped.  The actions only drive the motors they need, so otherwise a motor left running
+    from the old target would go on past its limit switch with nothing watching it.
 */
 void Move()
 {
-    // there is no stance target 0, so turn off your motors and do nothing.
-    if (StanceTarget == STANCE_NO_TARGET)
-    {
-        ST.motor(1, 0);
-        ST.motor(2, 0);
-        LegMoving = false;
-        TiltMoving = false;
-        return;
-    }
-    // if you are told to go where you are, then do nothing
-    if (StanceTarget == currentStance)
-    {
-        ST.motor(1, 0);
-        ST.motor(2, 0);
-        LegMoving = false;
-        TiltMoving = false;
-        return;
-    }
-    // Stance 7 is bad, all 4 switches open, no idea where anything is.  do nothing.
-    if (currentStance == STANCE_ERROR_ALL_UNKNOWN)
+    if (StanceTarget != moveTarget)
     {
-        ST.motor(1, 0);
-        ST.motor(2, 0);
+        moveTarget = StanceTarget;
+        motors.Stop(1);
+        motors.Stop(2);
         LegMoving = false;
         TiltMoving = false;
-        return;
-    }
-    // if you are in three legs and told to go to 2
-    if (StanceTarget == TWO_LEG_STANCE && currentStance == THREE_LEG_STANCE)
-    {
-        LegMoving = true;
-        TiltMoving = true;
-        ThreeToTwo();
-    }
-    // This is the first of the slight unknowns, target is two legs,  look up to stance 3, the center leg is up, but the tilt is unknown.
-    // You are either standing on two legs, or already in a pile on the ground. Cant hurt to try tilting up.
-    if (StanceTarget == TWO_LEG_STANCE && currentStance == STANCE_ERROR_LEG_UP_TILT_UNKNOWN)
-    {
-        TiltMoving = true;
-        MoveTiltUp();
-    }
-    // target two legs, tilt is up, center leg unknown, Can not hurt to try and lift the leg again.
-    if (StanceTarget == TWO_LEG_STANCE && ((currentStance == STANCE_ERROR_LEG_UNKNOWN_TILT_UP) || (currentStance == STANCE_ERROR_LEG_DOWN_TILT_UP)))
-    {
-        LegMoving = true;
-        MoveLegUp();
     }
-    //Target is two legs, center foot is down, tilt is unknown, too risky do nothing.
-    if (StanceTarget == TWO_LEG_STANCE && currentStance == STANCE_ERROR_LEG_DOWN_TILT_UNKNOWN)
-    {
-        ST.motor(1, 0);
-        ST.motor(2, 0);
-        LegMoving = false;
-        TiltMoving = false;
-        return;
-    }
-    // target is two legs, tilt is down, center leg is unknown,  too risky, do nothing.
-    if (StanceTarget == TWO_LEG_STANCE && currentStance == STANCE_ERROR_LEG_UNKNOWN_TILT_DOWN)
-    {
-        ST.motor(1, 0);
-        ST.motor(2, 0);
-        LegMoving = false;
-        TiltMoving = false;
-        return;
-    }
-    // target is three legs, stance is two legs, run two to three.
-    if (StanceTarget == THREE_LEG_STANCE && currentStance == TWO_LEG_STANCE)
-    {
-        LegMoving = true;
-        TiltMoving = true;
-        TwoToThree();
-    }
-    //Target is three legs. center leg is up, tilt is unknown, safer to do nothing, Recover from stance 3 with the up command
-    if (StanceTarget == THREE_LEG_STANCE && currentStance == STANCE_ERROR_LEG_UP_TILT_UNKNOWN)
-    {
-        ST.motor(1, 0);
-        ST.motor(2, 0);
-        LegMoving = false;
-        TiltMoving = false;
-        return;
-    }
-    // target is three legs, but don't know where the center leg is.   Best to not try this,
-    // recover from stance 4 with the up command,
-    if (StanceTarget == THREE_LEG_STANCE && currentStance == STANCE_ERROR_LEG_UNKNOWN_TILT_UP)
-    {
-        ST.motor(1, 0);
-        ST.motor(2, 0);
-        LegMoving = false;
-        TiltMoving = false;
-        return;
-    }
-    // Target is three legs, the center foot is down, tilt is unknown. either on 3 legs now, or a smoking mess,
-    // nothing to lose in trying to tilt down again
-    if (StanceTarget == THREE_LEG_STANCE && currentStance == STANCE_ERROR_LEG_DOWN_TILT_UNKNOWN)
-    {
-        TiltMoving = true;
-        MoveTiltDn();
-    }
-    // kinda like above, Target is 3 legs, tilt is down, center leg is unknown, ......got nothing to lose.
-    if (StanceTarget == THREE_LEG_STANCE && currentStance == STANCE_ERROR_LEG_UNKNOWN_TILT_DOWN)
+
+    // The target is only ever one of the first STANCE_TARGET_COUNT stances.
+    switch (STANCE_ACTIONS[StanceTarget][currentStance])
     {
-        LegMoving = true;
-        MoveLegDn();
+        case ACTION_STOP:
+            motors.Stop(1);
+            motors.Stop(2);
+            LegMoving = false;
+            TiltMoving = false;
+            break;
+
+        case ACTION_THREE_TO_TWO:
+            LegMoving = true;
+            TiltMoving = true;
+            ThreeToTwo();
+            break;
+
+        case ACTION_TWO_TO_THREE:
+            LegMoving = true;
+            TiltMoving = true;
+            TwoToThree();
+            break;
+
+        case ACTION_TILT_UP:
+            TiltMoving = true;
+            MoveTiltUp();
+            break;
+
+        case ACTION_LEG_UP:
+            LegMoving = true;
+            MoveLegUp();
+            break;
+
+        case ACTION_TILT_DN:
+            TiltMoving = true;
+            MoveTiltDn();
+            break;
+
+        case ACTION_LEG_DN:
+            LegMoving = true;
+            MoveLegDn();
+            break;
+
+        default:
+            break;
     }
 }
 
@@ -1071,6 +1336,7 @@ void Move()
 */
 void loop()
 {
+    PROFILE_LOOP_TICK();
     currentMillis = millis();  // this updates the current time each loop
 
     // Want to look closely at this.  I think this will reset the ShowTime every time though the loop
@@ -1085,51 +1351,78 @@ void loop()
     // If the killswitch has been turned off (to kill the 2-3-2 system)
     // We will stop the motors, regardless of what is being done.
     // The assumption is that if you hit the killswitch, it was for a good reason.
-    //checkKillSwitch();
+    checkKillSwitch();
 
     // Process web commands
     #ifdef USE_WAVESHARE_ESP32_LCD
         if (webConfig.pendingCommand != WEB_CMD_NONE)
         {
+            PROFILE_SCOPE(PROF_WEB_COMMANDS);
             WebCommand cmd = webConfig.pendingCommand;
             webConfig.pendingCommand = WEB_CMD_NONE;
 
+            if (cmd != WEB_CMD_EMERGENCY_STOP && cmd != WEB_CMD_PHASE_REVERT)
+            {
+                ClearMotionFault();
+            }
+
+            // A single motor move takes over from any transition or earlier move. Only its own
+            // motor runs, and Move() starts afresh from stopped motors once it's done.
+            if (cmd >= WEB_CMD_MOVE_LEG_UP && cmd <= WEB_CMD_MOVE_TILT_DN)
+            {
+                motors.Stop(1);
+                motors.Stop(2);
+                LegMoving = false;
+                TiltMoving = false;
+                moveTarget = STANCE_NO_TARGET;
+                if (StanceTarget != STANCE_NO_TARGET)
+                {
+                    StanceTarget = STANCE_NO_TARGET;
+                    transitionStats.Abort();
+                }
+            }
+
             switch (cmd)
             {
                 case WEB_CMD_TWO_TO_THREE:
                     webMoveActive = WEB_MOVE_NONE;
                     StanceTarget = THREE_LEG_STANCE;
-                    DEBUG_PRINT_LN("Web: Moving to Three Leg Stance.");
+                    transitionStats.CommandReceived(StanceTarget, currentStance, currentMillis);
+                    LOG_INFO("Web: Moving to Three Leg Stance.");
                     break;
                 case WEB_CMD_THREE_TO_TWO:
                     webMoveActive = WEB_MOVE_NONE;
                     StanceTarget = TWO_LEG_STANCE;
-                    DEBUG_PRINT_LN("Web: Moving to Two Leg Stance.");
+                    transitionStats.CommandReceived(StanceTarget, currentStance, currentMillis);
+                    LOG_INFO("Web: Moving to Two Leg Stance.");
                     break;
                 case WEB_CMD_MOVE_LEG_UP:
                     webMoveActive = WEB_MOVE_LEG_UP;
                     LegMoving = true;
-                    DEBUG_PRINT_LN("Web: Moving Leg Up.");
+                    LOG_INFO("Web: Moving Leg Up.");
                     break;
                 case WEB_CMD_MOVE_LEG_DN:
                     webMoveActive = WEB_MOVE_LEG_DN;
                     LegMoving = true;
-                    DEBUG_PRINT_LN("Web: Moving Leg Down.");
+                    LOG_INFO("Web: Moving Leg Down.");
                     break;
                 case WEB_CMD_MOVE_TILT_UP:
                     webMoveActive = WEB_MOVE_TILT_UP;
                     TiltMoving = true;
-                    DEBUG_PRINT_LN("Web: Moving Tilt Up.");
+                    LOG_INFO("Web: Moving Tilt Up.");
                     break;
                 case WEB_CMD_MOVE_TILT_DN:
                     webMoveActive = WEB_MOVE_TILT_DN;
                     TiltMoving = true;
-                    DEBUG_PRINT_LN("Web: Moving Tilt Down.");
+                    LOG_INFO("Web: Moving Tilt Down.");
                     break;
                 case WEB_CMD_EMERGENCY_STOP:
-                    webMoveActive = WEB_MOVE_NONE;
                     EmergencyStop();
                     break;
+                case WEB_CMD_PHASE_REVERT:
+                    LOG_INFO("Web: Reverting learned phase timing.");
+                    ApplyPhaseTune(phaseTuner.Revert());
+                    break;
                 default:
                     break;
             }
@@ -1137,21 +1430,51 @@ void loop()
     #endif
 
     // Read rolling code buttons and limit switches every loop iteration.
-    // These are instant digitalRead() calls and should not be throttled.
-    ReadRollingCodeTrigger(); // Only does something if ENABLE_ROLLING_CODE_TRIGGER is defined.
-    ReadLimitSwitches();
+    // This is one register read plus the debounce and should not be throttled.
+    {
+        PROFILE_SCOPE(PROF_LIMIT_SWITCHES);
+        ReadLimitSwitches();
+    }
+    {
+        PROFILE_SCOPE(PROF_ROLLING_CODE);
+        ReadRollingCodeTrigger(); // Only does something if ENABLE_ROLLING_CODE_TRIGGER is defined.
+    }
+    ReadSerialCommand();
+
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        transitionStats.SwitchSample(LegUp, LegDn, TiltUp, TiltDn, currentMillis);
+    #endif
 
     #ifdef USE_WAVESHARE_ESP32_S3_LCD
+        {
+            uint8_t closed = SwitchMask(LegUp, LegDn, TiltUp, TiltDn);
+            chartSwitchEvents |= closed ^ chartSwitchState;
+            chartSwitchState = closed;
+        }
+    #endif
+
+    #ifdef USE_WAVESHARE_ESP32_S3_LCD
+        // The tilt controller wants a fresh angle every few milliseconds while the tilt runs;
+        // otherwise the display's rate is plenty.
+        if (currentMillis - PreviousImuMillis >= (TiltMoving ? ImuControlInterval : TiltInterval))
+        {
+            PROFILE_SCOPE(PROF_IMU);
+            PreviousImuMillis = currentMillis;
+            UpdateTiltFromImu();
+            phaseTuner.TiltSample(TimingThreeToTwo(), imuTiltAngleDeg, imuTiltValid);
+        }
         if (currentMillis - PreviousTiltMillis >= TiltInterval)
         {
             PreviousTiltMillis = currentMillis;
-            UpdateTiltFromImu();
             display.showTiltAngle(imuTiltAngleDeg, imuTiltValid);
+            display.addTiltSample(imuTiltAngleDeg, imuTiltValid, chartSwitchEvents & 0x03, chartSwitchEvents & 0x0C, currentMillis);
+            chartSwitchEvents = 0;
         }
     #endif
 
     if (currentMillis - PreviousStanceMillis >= StanceInterval)
     {
+        PROFILE_SCOPE(PROF_CHECK_STANCE);
         PreviousStanceMillis = currentMillis;
         CheckStance();
     }
@@ -1159,18 +1482,40 @@ void loop()
     // Update LCD immediately when stance changes
     if (currentStance != previousStance)
     {
+        PROFILE_SCOPE(PROF_DISPLAY);
         previousStance = currentStance;
         Display();
+
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            if (currentStance > THREE_LEG_STANCE)
+            {
+                eventLog.Record(EVENT_STANCE_ERROR, currentStance, StanceTarget);
+            }
+        #endif
     }
 
-    // Check if the rolling code transition timeout has expired.
-    if (enableRollCodeTransitions && (currentMillis >= rollCodeTransitionTimeout))
+    // Draw any display changes.  The Waveshare boards draw from their own task instead.
+    display.update();
+
+    // Write out buffered log lines.  The Waveshare boards drain the log from their own task instead.
+    #if defined(ENABLE_SERIAL_LOG) && !defined(USE_WAVESHARE_ESP32_LCD)
+        logger.Drain();
+    #endif
+
+    // Check if the rolling code transition timeout has expired.  Compared as a difference so
+    // it still works when millis() wraps.
+    if (enableRollCodeTransitions && (int32_t)(currentMillis - rollCodeTransitionTimeout) >= 0)
     {
         // We have exceeded the time to do a transition start.
         // Auto Disable the safety so we don't accidentally trigger the transition.
+        // This isn't the killswitch, so a transition already under way is left to finish.
         enableRollCodeTransitions = false;
+        killDebugSent = true;
         display.showRollCodeEnabled(false);
-        //DEBUG_PRINT_LN("Warning: Transition Enable Timeout reached.  Disabling Rolling Code Transitions.");
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            eventLog.Record(EVENT_ENABLE_TIMEOUT);
+        #endif
+        //LOG_WARN("Transition Enable Timeout reached.  Disabling Rolling Code Transitions.");
     }
 
     // Drive individual web-commanded motor moves each loop iteration.
@@ -1179,6 +1524,7 @@ void loop()
     #ifdef USE_WAVESHARE_ESP32_LCD
         if (webMoveActive != WEB_MOVE_NONE)
         {
+            PROFILE_SCOPE(PROF_WEB_MOVE);
             switch (webMoveActive)
             {
                 case WEB_MOVE_LEG_UP:
@@ -1205,12 +1551,24 @@ void loop()
 
     // Skip Move() while an independent web move is active, since Move() would
     // stop motors and clear Moving flags when StanceTarget is STANCE_NO_TARGET.
-    #ifdef USE_WAVESHARE_ESP32_LCD
-        if (webMoveActive == WEB_MOVE_NONE)
+    {
+        PROFILE_SCOPE(PROF_MOVE);
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            if (webMoveActive == WEB_MOVE_NONE)
+                Move();
+        #else
             Move();
-    #else
-        Move();
-    #endif
+        #endif
+    }
+
+    {
+        PROFILE_SCOPE(PROF_MOTOR_IO);
+        CheckMotion();
+        motors.Update(currentMillis);
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            CheckOverCurrent();
+        #endif
+    }
 
     // Once we have moved, check to see if we've reached the target.
     // If we have then we reset the Target, so that we don't keep
@@ -1218,8 +1576,20 @@ void loop()
     if (currentStance == StanceTarget)
     {
         // Transition complete!
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            if (StanceTarget != STANCE_NO_TARGET)
+            {
+                bool threeToTwo = TimingThreeToTwo();
+                eventLog.Record(EVENT_TRANSITION_COMPLETE, StanceTarget);
+                transitionStats.Complete(currentMillis);
+                if (threeToTwo)
+                {
+                    PhaseTuneTransition(true);
+                }
+            }
+        #endif
         StanceTarget = STANCE_NO_TARGET;
-        DEBUG_PRINT_LN("Transition Complete");
+        LOG_INFO("Transition Complete");
     }
 
     // the following lines triggers my showtime timer to advance one number every 100ms.
@@ -1228,34 +1598,35 @@ void loop()
     {
         PreviousShowTimeMillis = currentMillis;
         ShowTime++;
-        //DEBUG_PRINT("Showtime: ");DEBUG_PRINT_LN(ShowTime);
+        //LOG_DEBUG("Showtime: %lu", ShowTime);
     }
 
     #ifdef USE_WAVESHARE_ESP32_LCD
-        webConfig.HandleClient();
+        {
+            PROFILE_SCOPE(PROF_WEB_CLIENT);
+            webConfig.HandleClient();
+        }
+
+        // Publish saved settings between control ticks. Settings that are safe to change
+        // mid-move go out straight away; the rest wait until the motors stop.
+        if (settingsManager.Publish(LegMoving || TiltMoving))
+        {
+            ApplySettings();
+            if (settingsManager.Pending())
+            {
+                LOG_INFO("Settings applied, the rest when motors are idle.");
+            }
+            else
+            {
+                LOG_INFO("Settings applied.");
+            }
+        }
 
-        // Apply pending settings when motors are idle
-        if (settingsManager.pendingApply && !LegMoving && !TiltMoving)
+        // A profile switched mid-move is written to NVS once the motors stop; the write holds
+        // up the loop, and with it the limit switches.
+        if (!LegMoving && !TiltMoving)
         {
-            int pct = settingsManager.settings.powerMultiplier;
-            moveLegDnPower         = ScalePower(settingsManager.settings.moveLegDnPower, pct);
-            moveLegUpPower         = ScalePower(settingsManager.settings.moveLegUpPower, pct);
-            moveTiltDnPower        = ScalePower(settingsManager.settings.moveTiltDnPower, pct);
-            moveTiltUpPower        = ScalePower(settingsManager.settings.moveTiltUpPower, pct);
-            twoToThreeLegPower     = ScalePower(settingsManager.settings.twoToThreeLegPower, pct);
-            twoToThreeTiltPower    = ScalePower(settingsManager.settings.twoToThreeTiltPower, pct);
-            threeToTwoLegSlowPower = ScalePower(settingsManager.settings.threeToTwoLegSlowPower, pct);
-            threeToTwoLegFastPower = ScalePower(settingsManager.settings.threeToTwoLegFastPower, pct);
-            threeToTwoTiltPower    = ScalePower(settingsManager.settings.threeToTwoTiltPower, pct);
-            StanceInterval         = settingsManager.settings.stanceInterval;
-            ShowTimeInterval       = settingsManager.settings.showTimeInterval;
-            commandEnableTimeout   = settingsManager.settings.commandEnableTimeout;
-            buttonDebounceTime     = settingsManager.settings.buttonDebounceTime;
-            phase1Start            = settingsManager.settings.phase1Start;
-            phase1End              = settingsManager.settings.phase1End;
-            phase2Start            = settingsManager.settings.phase2Start;
-            settingsManager.pendingApply = false;
-            Serial.println("Settings applied.");
+            settingsManager.SaveDeferred();
         }
     #endif
 }
@@ -0,0 +1,211 @@
+#include "config.h"
+#include "remotebuttons.h"
+#include "logger.h"
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+    #include "soc/gpio_reg.h"
+    #include "soc/soc.h"
+#else
+    #define IRAM_ATTR
+#endif
+
+// The edge queue has one writer (the GPIO interrupt, or Feed() on the Pro Micro) and one reader
+// (Poll()), on the same core, so keeping the compiler from moving the slot writes past the
+// index update is all the ordering it needs.
+#define QUEUE_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+// Timestamps come from the interrupt and can be a little later than the loop's millis(), so
+// compare them signed.
+static bool Reached(uint32_t nowMs, uint32_t sinceMs, uint16_t intervalMs)
+{
+    return (int32_t)(nowMs - sinceMs) >= (int32_t)intervalMs;
+}
+
+RemoteButtons::RemoteButtons()
+    : edgeHead(0), edgeTail(0), overflows(0), overflowsReported(0), eventHead(0), eventTail(0),
+      fedLevels(0), debounceMs(0), longPressMs(0), doublePressMs(0)
+{
+    for (uint8_t i = 0; i < REMOTE_BUTTON_COUNT; i++)
+    {
+        memset(&state[i], 0, sizeof(state[i]));
+    }
+}
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+void RemoteButtons::Begin(const uint8_t* pins)
+{
+    uint32_t levels = REG_READ(GPIO_IN_REG);
+
+    for (uint8_t i = 0; i < REMOTE_BUTTON_COUNT; i++)
+    {
+        if (pins[i] >= 32)
+        {
+            LOG_ERROR("Remote button pin %d is not in GPIO_IN_REG, ignored", pins[i]);
+            continue;
+        }
+        slots[i].owner = this;
+        slots[i].button = i;
+        slots[i].pinBit = 1UL << pins[i];
+        state[i].pressed = (levels & slots[i].pinBit) != 0;
+        attachInterruptArg(digitalPinToInterrupt(pins[i]), EdgeIsr, &slots[i], CHANGE);
+    }
+}
+
+void IRAM_ATTR RemoteButtons::EdgeIsr(void* arg)
+{
+    IsrSlot* slot = (IsrSlot*)arg;
+    bool pressed = (REG_READ(GPIO_IN_REG) & slot->pinBit) != 0;
+    slot->owner->Push(slot->button, pressed, millis());
+}
+#endif
+
+void RemoteButtons::Configure(uint16_t debounce, uint16_t longPress, uint16_t doublePress)
+{
+    debounceMs = debounce;
+    longPressMs = longPress;
+    doublePressMs = doublePress;
+}
+
+void RemoteButtons::Feed(uint8_t button, bool pressed, uint32_t nowMs)
+{
+    uint8_t bit = 1 << button;
+    if (((fedLevels & bit) != 0) == pressed)
+    {
+        return;
+    }
+    fedLevels ^= bit;
+    Push(button, pressed, nowMs);
+}
+
+void IRAM_ATTR RemoteButtons::Push(uint8_t button, bool pressed, uint32_t ms)
+{
+    uint8_t head = edgeHead;
+    if ((uint8_t)(head - edgeTail) >= EDGE_QUEUE_SIZE)
+    {
+        overflows = overflows + 1;
+        return;
+    }
+
+    Edge& edge = edges[head % EDGE_QUEUE_SIZE];
+    edge.ms = ms;
+    edge.button = button;
+    edge.pressed = pressed;
+    QUEUE_BARRIER();
+    edgeHead = head + 1;
+}
+
+void RemoteButtons::Poll(uint32_t nowMs)
+{
+    while (edgeTail != edgeHead)
+    {
+        QUEUE_BARRIER();
+        Edge edge = edges[edgeTail % EDGE_QUEUE_SIZE];
+        QUEUE_BARRIER();
+        edgeTail = edgeTail + 1;
+
+        // Inside the debounce time only remember where the input ended up.
+        ButtonState& b = state[edge.button];
+        if (!Reached(edge.ms, b.changedMs, debounceMs))
+        {
+            b.settling = true;
+            b.settledLevel = edge.pressed;
+            continue;
+        }
+        b.settling = false;
+        if (edge.pressed != b.pressed)
+        {
+            Accept(edge.button, edge.pressed, edge.ms);
+        }
+    }
+
+    uint16_t lost = overflows;
+    if (lost != overflowsReported)
+    {
+        LOG_WARN("Remote button edges dropped: %u", (unsigned int)(uint16_t)(lost - overflowsReported));
+        overflowsReported = lost;
+    }
+
+    for (uint8_t i = 0; i < REMOTE_BUTTON_COUNT; i++)
+    {
+        ButtonState& b = state[i];
+
+        // No more edges for the debounce time, so the input has settled where the last one left it.
+        if (b.settling && Reached(nowMs, b.changedMs, debounceMs))
+        {
+            b.settling = false;
+            if (b.settledLevel != b.pressed)
+            {
+                Accept(i, b.settledLevel, b.changedMs + debounceMs);
+            }
+        }
+
+        if (b.pressed && !b.gestureTaken && Reached(nowMs, b.pressMs, longPressMs))
+        {
+            b.gestureTaken = true;
+            Emit(i, GESTURE_LONG_PRESS, b.pressMs + longPressMs);
+        }
+
+        if (b.clickPending && !b.pressed && Reached(nowMs, b.releaseMs, doublePressMs))
+        {
+            b.clickPending = false;
+            Emit(i, GESTURE_CLICK, b.releaseMs);
+        }
+    }
+}
+
+void RemoteButtons::Accept(uint8_t button, bool pressed, uint32_t ms)
+{
+    ButtonState& b = state[button];
+    b.pressed = pressed;
+    b.changedMs = ms;
+
+    if (!pressed)
+    {
+        if (!b.gestureTaken)
+        {
+            b.clickPending = true;
+            b.releaseMs = ms;
+        }
+        return;
+    }
+
+    bool doublePress = b.clickPending && !Reached(ms, b.releaseMs, doublePressMs);
+    if (b.clickPending && !doublePress)
+    {
+        // Poll() hadn't got round to it yet.
+        Emit(button, GESTURE_CLICK, b.releaseMs);
+    }
+    b.clickPending = false;
+    b.gestureTaken = doublePress;
+    b.pressMs = ms;
+
+    Emit(button, GESTURE_PRESS, ms);
+    if (doublePress)
+    {
+        Emit(button, GESTURE_DOUBLE_PRESS, ms);
+    }
+}
+
+void RemoteButtons::Emit(uint8_t button, uint8_t gesture, uint32_t ms)
+{
+    if ((uint8_t)(eventHead - eventTail) >= EVENT_QUEUE_SIZE)
+    {
+        return;
+    }
+    RemoteButtonEvent& event = events[eventHead % EVENT_QUEUE_SIZE];
+    event.button = button;
+    event.gesture = gesture;
+    event.ms = ms;
+    eventHead++;
+}
+
+bool RemoteButtons::Next(RemoteButtonEvent& event)
+{
+    if (eventTail == eventHead)
+    {
+        return false;
+    }
+    event = events[eventTail % EVENT_QUEUE_SIZE];
+    eventTail++;
+    return true;
+}
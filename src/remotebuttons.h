@@ -0,0 +1,126 @@
+#ifndef REMOTEBUTTONS_H
+#define REMOTEBUTTONS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define REMOTE_BUTTON_COUNT 4
+
+enum RemoteButton
+{
+    REMOTE_BUTTON_A = 0,
+    REMOTE_BUTTON_B,
+    REMOTE_BUTTON_C,
+    REMOTE_BUTTON_D
+};
+
+enum RemoteGesture
+{
+    GESTURE_PRESS = 0,      // Button went down. Sent straight away, before any of the others.
+    GESTURE_CLICK,          // Pressed and released once, with no second press in the double press window
+    GESTURE_DOUBLE_PRESS,   // Second press within the double press window (no click for either)
+    GESTURE_LONG_PRESS      // Held for the long press time (no click when it is released)
+};
+
+struct RemoteButtonEvent
+{
+    uint8_t button;         // RemoteButton
+    uint8_t gesture;        // RemoteGesture
+    uint32_t ms;            // millis() at the edge that caused it
+};
+
+/*
+    Rolling code receiver buttons, captured by edge.
+
+    On the Waveshare boards each button pin has a change interrupt that timestamps the edge into
+    a small queue, so a pulse that starts and ends while loop() is busy drawing or talking to
+    the Sabertooth is still seen, and seen at the time it happened. Poll() works through the
+    queue: an edge within the debounce time of the last accepted one is held back until the
+    input settles, and presses and releases are turned into gestures.
+
+    The Pro Micro's receiver pins have no external or pin change interrupt, so there the loop
+    feeds it the debounced levels with Feed() instead and the rest works the same.
+*/
+class RemoteButtons
+{
+    public:
+        RemoteButtons();
+
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            // Attach the edge interrupts to the A-D pins, which must already be inputs. A
+            // receiver output is HIGH while its button is held.
+            void Begin(const uint8_t* pins);
+        #endif
+
+        void Configure(uint16_t debounceMs, uint16_t longPressMs, uint16_t doublePressMs);
+
+        // Queue a level seen without an interrupt (true = pressed).
+        void Feed(uint8_t button, bool pressed, uint32_t nowMs);
+
+        // Turn queued edges and elapsed time into gestures. Call every loop() pass.
+        void Poll(uint32_t nowMs);
+
+        // Take the next gesture from Poll(). Returns false when there are none left.
+        bool Next(RemoteButtonEvent& event);
+
+        // Edges lost because the queue was full.
+        uint16_t Overflows() const { return overflows; }
+
+    private:
+        static const uint8_t EDGE_QUEUE_SIZE = 16;      // Power of two
+        static const uint8_t EVENT_QUEUE_SIZE = 8;      // Power of two
+
+        struct Edge
+        {
+            uint32_t ms;
+            uint8_t button;
+            bool pressed;
+        };
+
+        struct ButtonState
+        {
+            bool pressed;           // Debounced level
+            bool settling;          // Edges arrived inside the debounce time
+            bool settledLevel;      // ...and the last of them left it at this level
+            bool clickPending;      // Released once, waiting to see if a second press follows
+            bool gestureTaken;      // This press was a double or long press, so no click
+            uint32_t changedMs;     // Last accepted edge
+            uint32_t pressMs;
+            uint32_t releaseMs;
+        };
+
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            struct IsrSlot
+            {
+                RemoteButtons* owner;
+                uint8_t button;
+                uint32_t pinBit;
+            };
+            IsrSlot slots[REMOTE_BUTTON_COUNT];
+            static void EdgeIsr(void* arg);
+        #endif
+
+        void Push(uint8_t button, bool pressed, uint32_t ms);
+        void Accept(uint8_t button, bool pressed, uint32_t ms);
+        void Emit(uint8_t button, uint8_t gesture, uint32_t ms);
+
+        // Written by the interrupt (edgeHead) and by Poll() (edgeTail) only
+        Edge edges[EDGE_QUEUE_SIZE];
+        volatile uint8_t edgeHead;
+        volatile uint8_t edgeTail;
+        volatile uint16_t overflows;
+        uint16_t overflowsReported;
+
+        RemoteButtonEvent events[EVENT_QUEUE_SIZE];
+        uint8_t eventHead;
+        uint8_t eventTail;
+
+        uint8_t fedLevels;          // Last level given to Feed(), one bit per button
+
+        ButtonState state[REMOTE_BUTTON_COUNT];
+        uint16_t debounceMs;
+        uint16_t longPressMs;
+        uint16_t doublePressMs;
+};
+
+#endif // REMOTEBUTTONS_H
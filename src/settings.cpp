@@ -3,95 +3,731 @@
 #ifdef USE_WAVESHARE_ESP32_LCD
 
 #include "settings.h"
+#include "logger.h"
 
 static const char* NVS_NAMESPACE = "r2d2cfg";
+static const char* SETTINGS_KEY = "settings";
+static const char* PROFILES_KEY = "profiles";
+
+static const uint32_t SETTINGS_MAGIC = 0x46433252;     // "R2CF"
+static const uint32_t PROFILES_MAGIC = 0x46503252;     // "R2PF"
+static const uint8_t BLOB_HEADER_LENGTH = 8;            // Magic, version, reserved, payload length
+static const uint8_t BLOB_CRC_LENGTH = 4;
+static const uint16_t BLOB_MAX_PAYLOAD = 256;
+static const uint16_t BLOB_MAX_LENGTH = BLOB_HEADER_LENGTH + BLOB_MAX_PAYLOAD + BLOB_CRC_LENGTH;
+static const uint8_t PROFILES_PREFIX_LENGTH = 3;        // Active profile, profile count, bytes per profile
+
+// A setting that has been in the blob since version 1. Later additions use SETTING_SINCE
+// with the new SETTINGS_BLOB_VERSION.
+#define SETTING(field, type, key, def, minVal, maxVal, label, group, flags) \
+    SETTING_SINCE(1, field, type, key, def, minVal, maxVal, label, group, flags)
+#define SETTING_SINCE(version, field, type, key, def, minVal, maxVal, label, group, flags) \
+    { key, type, offsetof(ControllerSettings, field), def, minVal, maxVal, label, group, flags, version }
+
+constexpr SettingDescriptor SETTINGS_SCHEMA[] =
+{
+    SETTING(powerMultiplier,          SETTING_U8,  "pwrMult",     DEFAULT_POWER_MULTIPLIER,            0,     100,    "Power Multiplier (%)",             SETTING_GROUP_POWER_SCALE,  SETTING_PROFILE | SETTING_TRAVEL),
+
+    SETTING(moveLegDnPower,           SETTING_I16, "legDnPwr",    DEFAULT_MOVE_LEG_DN_POWER,           -2047, 2047,   "Leg Down",                         SETTING_GROUP_MOTOR_POWER,  SETTING_SCALED_POWER | SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING(moveLegUpPower,           SETTING_I16, "legUpPwr",    DEFAULT_MOVE_LEG_UP_POWER,           -2047, 2047,   "Leg Up",                           SETTING_GROUP_MOTOR_POWER,  SETTING_SCALED_POWER | SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING(moveTiltDnPower,          SETTING_I16, "tiltDnPwr",   DEFAULT_MOVE_TILT_DN_POWER,          -2047, 2047,   "Tilt Down",                        SETTING_GROUP_MOTOR_POWER,  SETTING_SCALED_POWER | SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING(moveTiltUpPower,          SETTING_I16, "tiltUpPwr",   DEFAULT_MOVE_TILT_UP_POWER,          -2047, 2047,   "Tilt Up",                          SETTING_GROUP_MOTOR_POWER,  SETTING_SCALED_POWER | SETTING_PROFILE | SETTING_TRAVEL),
+
+    SETTING(twoToThreeLegPower,       SETTING_I16, "23legPwr",    DEFAULT_TWO_TO_THREE_LEG_POWER,      -2047, 2047,   "Leg Power",                        SETTING_GROUP_TWO_TO_THREE, SETTING_SCALED_POWER | SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING(twoToThreeTiltPower,      SETTING_I16, "23tiltPwr",   DEFAULT_TWO_TO_THREE_TILT_POWER,     -2047, 2047,   "Tilt Power",                       SETTING_GROUP_TWO_TO_THREE, SETTING_SCALED_POWER | SETTING_PROFILE | SETTING_TRAVEL),
+
+    SETTING(threeToTwoLegSlowPower,   SETTING_I16, "32legSlwPwr", DEFAULT_THREE_TO_TWO_LEG_SLOW_POWER, -2047, 2047,   "Leg Slow Power",                   SETTING_GROUP_THREE_TO_TWO, SETTING_SCALED_POWER | SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING(threeToTwoLegFastPower,   SETTING_I16, "32legFstPwr", DEFAULT_THREE_TO_TWO_LEG_FAST_POWER, -2047, 2047,   "Leg Fast Power",                   SETTING_GROUP_THREE_TO_TWO, SETTING_SCALED_POWER | SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING(threeToTwoTiltPower,      SETTING_I16, "32tiltPwr",   DEFAULT_THREE_TO_TWO_TILT_POWER,     -2047, 2047,   "Tilt Power",                       SETTING_GROUP_THREE_TO_TWO, SETTING_SCALED_POWER | SETTING_PROFILE | SETTING_TRAVEL),
+
+    SETTING(phase1Start,              SETTING_U16, "ph1Start",    DEFAULT_PHASE1_START,                0,     100,    "Phase 1 Start",                    SETTING_GROUP_PHASE_TIMING, SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING(phase1End,                SETTING_U16, "ph1End",      DEFAULT_PHASE1_END,                  0,     100,    "Phase 1 End",                      SETTING_GROUP_PHASE_TIMING, SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING(phase2Start,              SETTING_U16, "ph2Start",    DEFAULT_PHASE2_START,                0,     100,    "Phase 2 Start",                    SETTING_GROUP_PHASE_TIMING, SETTING_PROFILE | SETTING_TRAVEL),
+    #ifdef USE_WAVESHARE_ESP32_S3_LCD
+        SETTING_SINCE(5, phaseLearn,  SETTING_U8,  "phLearn",     DEFAULT_PHASE_LEARN,                 0,     1,      "Learn Phase Timing (0=off 1=on)",  SETTING_GROUP_PHASE_TIMING, SETTING_LIVE),
+    #else
+        // Learning judges each transition by the IMU's tilt angle; without one it stays off.
+        SETTING_SINCE(5, phaseLearn,  SETTING_U8,  "phLearn",     0,                                   0,     0,      "Learn Phase Timing (needs the IMU)", SETTING_GROUP_PHASE_TIMING, SETTING_LIVE),
+    #endif
+    SETTING_SINCE(5, phaseLearnRange, SETTING_U8,  "phLearnRng",  DEFAULT_PHASE_LEARN_RANGE,           0,     20,     "Learning Range (ticks)",           SETTING_GROUP_PHASE_TIMING, SETTING_LIVE),
+
+    SETTING_SINCE(3, moveRampTime,       SETTING_U16, "moveRamp", DEFAULT_MOVE_RAMP_TIME,         0, 5000, "Single Moves",                    SETTING_GROUP_RAMPING,      SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING_SINCE(3, twoToThreeRampTime, SETTING_U16, "23ramp",   DEFAULT_TWO_TO_THREE_RAMP_TIME, 0, 5000, "2-Leg to 3-Leg",                  SETTING_GROUP_RAMPING,      SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING_SINCE(3, threeToTwoRampTime, SETTING_U16, "32ramp",   DEFAULT_THREE_TO_TWO_RAMP_TIME, 0, 5000, "3-Leg to 2-Leg",                  SETTING_GROUP_RAMPING,      SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING_SINCE(3, rampJerkTime,       SETTING_U16, "rampJerk", DEFAULT_RAMP_JERK_TIME,         0, 2000, "S-Curve Jerk Time",               SETTING_GROUP_RAMPING,      SETTING_PROFILE | SETTING_TRAVEL),
+
+    #ifdef USE_WAVESHARE_ESP32_S3_LCD
+        SETTING_SINCE(4, tiltControl,  SETTING_U8,  "tiltCtl",   DEFAULT_TILT_CONTROL,   0,     1,    "Closed Loop Tilt (0=off 1=on)",    SETTING_GROUP_TILT_CONTROL, SETTING_LIVE | SETTING_TRAVEL),
+        SETTING_SINCE(4, tiltUpAngle,  SETTING_I16, "tiltUpAng", DEFAULT_TILT_UP_ANGLE,  -900,  900,  "2-Leg Angle (0.1 deg)",            SETTING_GROUP_TILT_CONTROL, SETTING_LIVE | SETTING_TRAVEL),
+        SETTING_SINCE(4, tiltDnAngle,  SETTING_I16, "tiltDnAng", DEFAULT_TILT_DN_ANGLE,  -900,  900,  "3-Leg Angle (0.1 deg)",            SETTING_GROUP_TILT_CONTROL, SETTING_LIVE | SETTING_TRAVEL),
+        SETTING_SINCE(4, tiltSlowZone, SETTING_U16, "tiltSlow",  DEFAULT_TILT_SLOW_ZONE, 0,     450,  "Slow Zone (0.1 deg, 0=off)",       SETTING_GROUP_TILT_CONTROL, SETTING_LIVE | SETTING_TRAVEL),
+        SETTING_SINCE(4, tiltMinPower, SETTING_U8,  "tiltMinPwr", DEFAULT_TILT_MIN_POWER, 10,   100,  "Minimum Power (%)",                SETTING_GROUP_TILT_CONTROL, SETTING_LIVE | SETTING_TRAVEL),
+    #endif
+
+    SETTING(currentLimitM1,           SETTING_U16, "curLimM1",    DEFAULT_CURRENT_LIMIT_M1,            0,     1000,   "Leg Current Limit (0.1 A, 0=off)", SETTING_GROUP_OVER_CURRENT, SETTING_LIVE),
+    SETTING(currentLimitM2,           SETTING_U16, "curLimM2",    DEFAULT_CURRENT_LIMIT_M2,            0,     1000,   "Tilt Current Limit (0.1 A, 0=off)", SETTING_GROUP_OVER_CURRENT, SETTING_LIVE),
+    SETTING(currentLimitWindow,       SETTING_U16, "curLimWin",   DEFAULT_CURRENT_LIMIT_WINDOW,        0,     5000,   "Limit Window (ms)",                SETTING_GROUP_OVER_CURRENT, SETTING_LIVE),
+    SETTING(telemetryCurrentInterval, SETTING_U16, "telCurInt",   DEFAULT_TELEMETRY_CURRENT_INTERVAL,  20,    1000,   "Current Poll Interval (ms)",       SETTING_GROUP_OVER_CURRENT, SETTING_LIVE),
+    SETTING(telemetrySlowInterval,    SETTING_U16, "telSlowInt",  DEFAULT_TELEMETRY_SLOW_INTERVAL,     100,   10000,  "Battery/Temp Poll Interval (ms)",  SETTING_GROUP_OVER_CURRENT, SETTING_LIVE),
+
+    SETTING(releaseTimeout,           SETTING_U16, "relTimeout",  DEFAULT_RELEASE_TIMEOUT,             0,     10000,  "Switch Release Timeout",           SETTING_GROUP_WATCHDOG,     SETTING_LIVE),
+    SETTING(legTravelTimeout,         SETTING_U16, "legTravel",   DEFAULT_LEG_TRAVEL_TIMEOUT,          0,     60000,  "Leg Travel Timeout",               SETTING_GROUP_WATCHDOG,     SETTING_LIVE),
+    SETTING(tiltTravelTimeout,        SETTING_U16, "tiltTravel",  DEFAULT_TILT_TRAVEL_TIMEOUT,         0,     60000,  "Tilt Travel Timeout",              SETTING_GROUP_WATCHDOG,     SETTING_LIVE),
+    SETTING(travelLearnMargin,        SETTING_U8,  "learnMargin", DEFAULT_TRAVEL_LEARN_MARGIN,         0,     200,    "Learned Travel Margin (%)",        SETTING_GROUP_WATCHDOG,     SETTING_LIVE),
+
+    SETTING(logLevel,                 SETTING_U8,  "logLevel",    DEFAULT_LOG_LEVEL,                   0,     3,      "Log Level (0=error 1=warn 2=info 3=debug)", SETTING_GROUP_LOG, SETTING_LIVE),
+
+    SETTING(stanceInterval,           SETTING_U16, "stanceInt",   DEFAULT_STANCE_INTERVAL,             10,    1000,   "Stance Interval",                  SETTING_GROUP_TIMING,       SETTING_PROFILE),
+    SETTING(showTimeInterval,         SETTING_U16, "showTimeInt", DEFAULT_SHOWTIME_INTERVAL,           10,    1000,   "ShowTime Interval",                SETTING_GROUP_TIMING,       SETTING_PROFILE | SETTING_TRAVEL),
+    SETTING(commandEnableTimeout,     SETTING_U32, "cmdTimeout",  DEFAULT_COMMAND_ENABLE_TIMEOUT,      1000,  120000, "Command Enable Timeout",           SETTING_GROUP_TIMING,       SETTING_LIVE),
+    SETTING(buttonDebounceTime,       SETTING_U16, "btnDebounce", DEFAULT_BUTTON_DEBOUNCE_TIME,        50,    500,    "Button Debounce",                  SETTING_GROUP_TIMING,       SETTING_LIVE),
+    SETTING_SINCE(2, switchFilterTime, SETTING_U8, "swFilter", DEFAULT_SWITCH_FILTER_TIME, 0,  50,     "Switch Filter Time",               SETTING_GROUP_TIMING,       SETTING_LIVE),
+};
+
+const uint8_t SETTINGS_SCHEMA_COUNT = sizeof(SETTINGS_SCHEMA) / sizeof(SETTINGS_SCHEMA[0]);
+
+constexpr uint8_t SettingTypeSize(uint8_t type)
+{
+    return type == SETTING_U8 ? 1 : type == SETTING_U32 ? 4 : 2;
+}
+
+// Catch a config.h default that the page would refuse, a range the field can't hold, or a
+// setting from a blob version that doesn't exist yet.
+constexpr bool SchemaValid(uint8_t i)
+{
+    return i >= sizeof(SETTINGS_SCHEMA) / sizeof(SETTINGS_SCHEMA[0]) ||
+        (SETTINGS_SCHEMA[i].version >= 1 && SETTINGS_SCHEMA[i].version <= SETTINGS_BLOB_VERSION &&
+         SETTINGS_SCHEMA[i].minValue <= SETTINGS_SCHEMA[i].defaultValue &&
+         SETTINGS_SCHEMA[i].defaultValue <= SETTINGS_SCHEMA[i].maxValue &&
+         SETTINGS_SCHEMA[i].minValue >= (SETTINGS_SCHEMA[i].type == SETTING_I16 ? -32768 : 0) &&
+         SETTINGS_SCHEMA[i].maxValue <= (SETTINGS_SCHEMA[i].type == SETTING_U8  ? 255 :
+                                         SETTINGS_SCHEMA[i].type == SETTING_I16 ? 32767 :
+                                         SETTINGS_SCHEMA[i].type == SETTING_U16 ? 65535 : 0x7FFFFFFF) &&
+         SchemaValid(i + 1));
+}
+static_assert(SchemaValid(0), "Settings schema default out of range");
+
+constexpr uint16_t SchemaBytes(uint8_t i, uint8_t requiredFlags)
+{
+    return i >= sizeof(SETTINGS_SCHEMA) / sizeof(SETTINGS_SCHEMA[0]) ? 0 :
+        ((SETTINGS_SCHEMA[i].flags & requiredFlags) == requiredFlags ? SettingTypeSize(SETTINGS_SCHEMA[i].type) : 0) +
+        SchemaBytes(i + 1, requiredFlags);
+}
+static_assert(SchemaBytes(0, 0) <= BLOB_MAX_PAYLOAD, "Settings blob too large, raise BLOB_MAX_PAYLOAD");
+static_assert(PROFILES_PREFIX_LENGTH + PROFILE_COUNT * (PROFILE_NAME_LENGTH + SchemaBytes(0, SETTING_PROFILE)) <= BLOB_MAX_PAYLOAD,
+              "Profiles blob too large, raise BLOB_MAX_PAYLOAD");
+
+static const char* const GROUP_TITLES[SETTING_GROUP_COUNT] =
+{
+    "Global Power Scale",
+    "Motor Power (-2047 to 2047)",
+    "Transition: 2-Leg to 3-Leg",
+    "Transition: 3-Leg to 2-Leg",
+    "3-to-2 Phase Timing (ShowTime ticks)",
+    "Motor Ramping (milliseconds per full power, 0=off)",
+    #ifdef USE_WAVESHARE_ESP32_S3_LCD
+        "Closed Loop Tilt (QMI8658)",
+    #endif
+    "Over-Current Protection",
+    "Limit Switch Watchdog (milliseconds, 0=off)",
+    "Serial Log",
+    "Timing (milliseconds)"
+};
 
 SettingsManager::SettingsManager()
-    : pendingApply(false)
+    : live(&buffers[0]), pendingApply(false), pendingLive(false), travelChanged(false),
+      activeProfile(0), profilesDirty(false), saveDeferred(false)
 {
-    SetDefaults();
+    SetDefaults(settings);
+    SetProfileDefaults();
+    CopyProfileFields(settings, profiles[0].values);
+    stored = settings;
+    Prepare();
+    buffers[0] = shadow;
+    pendingApply = false;
+    pendingLive = false;
 }
 
-void SettingsManager::SetDefaults()
+void SettingsManager::SetDefaults(ControllerSettings& s)
 {
-    settings.powerMultiplier         = DEFAULT_POWER_MULTIPLIER;
-    settings.moveLegDnPower          = DEFAULT_MOVE_LEG_DN_POWER;
-    settings.moveLegUpPower          = DEFAULT_MOVE_LEG_UP_POWER;
-    settings.moveTiltDnPower         = DEFAULT_MOVE_TILT_DN_POWER;
-    settings.moveTiltUpPower         = DEFAULT_MOVE_TILT_UP_POWER;
-    settings.twoToThreeLegPower      = DEFAULT_TWO_TO_THREE_LEG_POWER;
-    settings.twoToThreeTiltPower     = DEFAULT_TWO_TO_THREE_TILT_POWER;
-    settings.threeToTwoLegSlowPower  = DEFAULT_THREE_TO_TWO_LEG_SLOW_POWER;
-    settings.threeToTwoLegFastPower  = DEFAULT_THREE_TO_TWO_LEG_FAST_POWER;
-    settings.threeToTwoTiltPower     = DEFAULT_THREE_TO_TWO_TILT_POWER;
+    for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+    {
+        Set(s, SETTINGS_SCHEMA[i], SETTINGS_SCHEMA[i].defaultValue);
+    }
+}
 
-    settings.stanceInterval          = DEFAULT_STANCE_INTERVAL;
-    settings.showTimeInterval        = DEFAULT_SHOWTIME_INTERVAL;
-    settings.commandEnableTimeout    = DEFAULT_COMMAND_ENABLE_TIMEOUT;
-    settings.buttonDebounceTime      = DEFAULT_BUTTON_DEBOUNCE_TIME;
+int32_t SettingsManager::Get(const ControllerSettings& s, const SettingDescriptor& d)
+{
+    const uint8_t* field = (const uint8_t*)&s + d.offset;
+    switch (d.type)
+    {
+        case SETTING_U8:  return *field;
+        case SETTING_I16: return *(const int16_t*)field;
+        case SETTING_U16: return *(const uint16_t*)field;
+        case SETTING_U32: return (int32_t)*(const uint32_t*)field;
+        default:          return 0;
+    }
+}
 
-    settings.phase1Start             = DEFAULT_PHASE1_START;
-    settings.phase1End               = DEFAULT_PHASE1_END;
-    settings.phase2Start             = DEFAULT_PHASE2_START;
+void SettingsManager::Set(ControllerSettings& s, const SettingDescriptor& d, int32_t value)
+{
+    value = constrain(value, d.minValue, d.maxValue);
+    uint8_t* field = (uint8_t*)&s + d.offset;
+    switch (d.type)
+    {
+        case SETTING_U8:  *field = (uint8_t)value; break;
+        case SETTING_I16: *(int16_t*)field = (int16_t)value; break;
+        case SETTING_U16: *(uint16_t*)field = (uint16_t)value; break;
+        case SETTING_U32: *(uint32_t*)field = (uint32_t)value; break;
+    }
 }
 
-void SettingsManager::Load()
+const SettingDescriptor* SettingsManager::Find(const char* key)
 {
-    // Start with defaults so any missing keys get default values
-    SetDefaults();
+    for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+    {
+        if (strcmp(SETTINGS_SCHEMA[i].key, key) == 0)
+        {
+            return &SETTINGS_SCHEMA[i];
+        }
+    }
+    return NULL;
+}
 
-    preferences.begin(NVS_NAMESPACE, true); // read-only
+const char* SettingsManager::GroupTitle(uint8_t group)
+{
+    return group < SETTING_GROUP_COUNT ? GROUP_TITLES[group] : "";
+}
 
-    settings.powerMultiplier         = preferences.getUChar("pwrMult",     settings.powerMultiplier);
-    settings.moveLegDnPower          = preferences.getShort("legDnPwr",    settings.moveLegDnPower);
-    settings.moveLegUpPower          = preferences.getShort("legUpPwr",    settings.moveLegUpPower);
-    settings.moveTiltDnPower         = preferences.getShort("tiltDnPwr",   settings.moveTiltDnPower);
-    settings.moveTiltUpPower         = preferences.getShort("tiltUpPwr",   settings.moveTiltUpPower);
-    settings.twoToThreeLegPower      = preferences.getShort("23legPwr",    settings.twoToThreeLegPower);
-    settings.twoToThreeTiltPower     = preferences.getShort("23tiltPwr",   settings.twoToThreeTiltPower);
-    settings.threeToTwoLegSlowPower  = preferences.getShort("32legSlwPwr", settings.threeToTwoLegSlowPower);
-    settings.threeToTwoLegFastPower  = preferences.getShort("32legFstPwr", settings.threeToTwoLegFastPower);
-    settings.threeToTwoTiltPower     = preferences.getShort("32tiltPwr",   settings.threeToTwoTiltPower);
-
-    settings.stanceInterval          = preferences.getUShort("stanceInt",  settings.stanceInterval);
-    settings.showTimeInterval        = preferences.getUShort("showTimeInt", settings.showTimeInterval);
-    settings.commandEnableTimeout    = preferences.getULong("cmdTimeout",  settings.commandEnableTimeout);
-    settings.buttonDebounceTime      = preferences.getUShort("btnDebounce", settings.buttonDebounceTime);
-
-    settings.phase1Start             = preferences.getUShort("ph1Start",   settings.phase1Start);
-    settings.phase1End               = preferences.getUShort("ph1End",     settings.phase1End);
-    settings.phase2Start             = preferences.getUShort("ph2Start",   settings.phase2Start);
+const char* SettingsManager::ProfileName(uint8_t index) const
+{
+    return index < PROFILE_COUNT ? profiles[index].name : "";
+}
 
-    preferences.end();
+void SettingsManager::SetProfileName(uint8_t index, const char* name)
+{
+    if (index >= PROFILE_COUNT)
+    {
+        return;
+    }
+
+    // The name goes straight into the settings page, so keep to plain printable characters.
+    char clean[PROFILE_NAME_LENGTH];
+    uint8_t length = 0;
+    for (; *name != '\0' && length < PROFILE_NAME_LENGTH - 1; name++)
+    {
+        if (*name >= ' ' && *name <= '~' && strchr("<>&\"'\\", *name) == NULL)
+        {
+            clean[length++] = *name;
+        }
+    }
+    clean[length] = '\0';
+
+    if (length > 0 && strcmp(clean, profiles[index].name) != 0)
+    {
+        strcpy(profiles[index].name, clean);
+        profilesDirty = true;
+    }
 }
 
-void SettingsManager::Save()
+bool SettingsManager::SetProfileValue(uint8_t index, const char* key, int32_t value)
+{
+    const SettingDescriptor* d = Find(key);
+    if (index >= PROFILE_COUNT || d == NULL || !(d->flags & SETTING_PROFILE))
+    {
+        return false;
+    }
+
+    if (Get(profiles[index].values, *d) != constrain(value, d->minValue, d->maxValue))
+    {
+        Set(profiles[index].values, *d, value);
+        profilesDirty = true;
+    }
+    if (index == activeProfile)
+    {
+        Set(settings, *d, value);
+    }
+    return true;
+}
+
+bool SettingsManager::SelectProfile(uint8_t index)
+{
+    if (index >= PROFILE_COUNT)
+    {
+        return false;
+    }
+
+    if (index != activeProfile)
+    {
+        CopyProfileFields(profiles[activeProfile].values, settings);
+        activeProfile = index;
+        CopyProfileFields(settings, profiles[index].values);
+        profilesDirty = true;
+        saveDeferred = true;
+        Prepare();
+    }
+    return true;
+}
+
+void SettingsManager::SaveDeferred()
+{
+    if (saveDeferred)
+    {
+        Save();
+    }
+}
+
+void SettingsManager::SetProfileDefaults()
+{
+    static const char* const names[PROFILE_COUNT] = PROFILE_NAMES;
+    static const uint8_t multipliers[PROFILE_COUNT] = PROFILE_POWER_MULTIPLIERS;
+
+    for (uint8_t p = 0; p < PROFILE_COUNT; p++)
+    {
+        SetDefaults(profiles[p].values);
+        profiles[p].values.powerMultiplier = multipliers[p];
+        strncpy(profiles[p].name, names[p], PROFILE_NAME_LENGTH - 1);
+        profiles[p].name[PROFILE_NAME_LENGTH - 1] = '\0';
+    }
+    activeProfile = 0;
+}
+
+void SettingsManager::CopyProfileFields(ControllerSettings& to, const ControllerSettings& from)
+{
+    for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+    {
+        if (SETTINGS_SCHEMA[i].flags & SETTING_PROFILE)
+        {
+            Set(to, SETTINGS_SCHEMA[i], Get(from, SETTINGS_SCHEMA[i]));
+        }
+    }
+}
+
+void SettingsManager::Prepare()
+{
+    // Worked out once here rather than every time the loop picks the settings up.
+    shadow = settings;
+    for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+    {
+        const SettingDescriptor& d = SETTINGS_SCHEMA[i];
+        if (d.flags & SETTING_SCALED_POWER)
+        {
+            // Preserves sign; never leaves the field's range since the multiplier is at most 100%.
+            Set(shadow, d, Get(settings, d) * settings.powerMultiplier / 100);
+        }
+    }
+    pendingApply = true;
+    pendingLive = !SameSettings(shadow, *live, SETTING_LIVE);
+}
+
+bool SettingsManager::Publish(bool moving)
+{
+    if (!pendingApply || (moving && !pendingLive))
+    {
+        return false;
+    }
+
+    ControllerSettings* next = (live == &buffers[0]) ? &buffers[1] : &buffers[0];
+    if (moving)
+    {
+        // Only what is safe mid-move; the rest stays pending.
+        *next = *live;
+        for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+        {
+            const SettingDescriptor& d = SETTINGS_SCHEMA[i];
+            if (d.flags & SETTING_LIVE)
+            {
+                Set(*next, d, Get(shadow, d));
+            }
+        }
+        pendingApply = !SameSettings(*next, shadow, 0);
+    }
+    else
+    {
+        *next = shadow;
+        pendingApply = false;
+    }
+    pendingLive = false;
+
+    travelChanged = !SameSettings(*next, *live, SETTING_TRAVEL);
+    live = next;
+    return true;
+}
+
+bool SettingsManager::SameSettings(const ControllerSettings& a, const ControllerSettings& b, uint8_t requiredFlags)
+{
+    for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+    {
+        const SettingDescriptor& d = SETTINGS_SCHEMA[i];
+        if ((d.flags & requiredFlags) == requiredFlags && Get(a, d) != Get(b, d))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t SettingsManager::Crc32(const uint8_t* data, size_t length)
+{
+    // CRC-32 (IEEE), bitwise. The blobs are small and only checked at boot and on save.
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t ReadLE(const uint8_t* p, uint8_t size)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++)
+    {
+        value |= (uint32_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+static void WriteLE(uint8_t* p, uint32_t value, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+uint16_t SettingsManager::FieldsLength(uint8_t version, uint8_t requiredFlags)
+{
+    uint16_t length = 0;
+    for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+    {
+        const SettingDescriptor& d = SETTINGS_SCHEMA[i];
+        if (d.version <= version && (d.flags & requiredFlags) == requiredFlags)
+        {
+            length += SettingTypeSize(d.type);
+        }
+    }
+    return length;
+}
+
+uint8_t* SettingsManager::EncodeFields(uint8_t* p, const ControllerSettings& s, uint8_t requiredFlags)
+{
+    for (uint8_t v = 1; v <= SETTINGS_BLOB_VERSION; v++)
+    {
+        for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+        {
+            const SettingDescriptor& d = SETTINGS_SCHEMA[i];
+            if (d.version == v && (d.flags & requiredFlags) == requiredFlags)
+            {
+                uint8_t size = SettingTypeSize(d.type);
+                WriteLE(p, (uint32_t)Get(s, d), size);
+                p += size;
+            }
+        }
+    }
+    return p;
+}
+
+const uint8_t* SettingsManager::DecodeFields(const uint8_t* p, uint8_t version, ControllerSettings& s, uint8_t requiredFlags)
+{
+    for (uint8_t v = 1; v <= version; v++)
+    {
+        for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+        {
+            const SettingDescriptor& d = SETTINGS_SCHEMA[i];
+            if (d.version == v && (d.flags & requiredFlags) == requiredFlags)
+            {
+                uint8_t size = SettingTypeSize(d.type);
+                uint32_t raw = ReadLE(p, size);
+                Set(s, d, d.type == SETTING_I16 ? (int32_t)(int16_t)raw : (int32_t)raw);
+                p += size;
+            }
+        }
+    }
+    return p;
+}
+
+// Fill in the header and CRC around a payload already at blob + BLOB_HEADER_LENGTH. Returns
+// the length of the whole blob.
+static size_t FrameBlob(uint8_t* blob, uint32_t magic, uint16_t payloadLength)
+{
+    WriteLE(blob, magic, 4);
+    blob[4] = SETTINGS_BLOB_VERSION;
+    blob[5] = 0;
+    WriteLE(blob + 6, payloadLength, 2);
+    size_t length = BLOB_HEADER_LENGTH + payloadLength;
+    WriteLE(blob + length, SettingsManager::Crc32(blob, length), BLOB_CRC_LENGTH);
+    return length + BLOB_CRC_LENGTH;
+}
+
+// Check a blob's header and CRC. Returns the payload, or NULL if the blob is damaged.
+static const uint8_t* UnframeBlob(const uint8_t* blob, size_t length, uint32_t magic,
+                                  uint8_t& version, uint16_t& payloadLength)
+{
+    if (length < BLOB_HEADER_LENGTH + BLOB_CRC_LENGTH || ReadLE(blob, 4) != magic)
+    {
+        return NULL;
+    }
+    version = blob[4];
+    payloadLength = ReadLE(blob + 6, 2);
+    if (version == 0 || (size_t)(BLOB_HEADER_LENGTH + payloadLength + BLOB_CRC_LENGTH) != length ||
+        ReadLE(blob + length - BLOB_CRC_LENGTH, 4) != SettingsManager::Crc32(blob, length - BLOB_CRC_LENGTH))
+    {
+        return NULL;
+    }
+    return blob + BLOB_HEADER_LENGTH;
+}
+
+bool SettingsManager::DecodeSettings(const uint8_t* blob, size_t length, uint8_t& version)
+{
+    uint16_t payloadLength;
+    const uint8_t* payload = UnframeBlob(blob, length, SETTINGS_MAGIC, version, payloadLength);
+    if (payload == NULL)
+    {
+        return false;
+    }
+
+    // Newer firmware only appends, so a newer blob starts with everything this build knows.
+    uint8_t readVersion = min(version, (uint8_t)SETTINGS_BLOB_VERSION);
+    if (payloadLength < FieldsLength(readVersion, 0) ||
+        (version <= SETTINGS_BLOB_VERSION && payloadLength != FieldsLength(version, 0)))
+    {
+        return false;
+    }
+
+    DecodeFields(payload, readVersion, settings, 0);
+    return true;
+}
+
+bool SettingsManager::DecodeProfiles(const uint8_t* blob, size_t length, uint8_t& version)
+{
+    uint16_t payloadLength;
+    const uint8_t* payload = UnframeBlob(blob, length, PROFILES_MAGIC, version, payloadLength);
+    if (payload == NULL || payloadLength < PROFILES_PREFIX_LENGTH)
+    {
+        return false;
+    }
+
+    // Active profile, profile count and bytes per profile, then the profiles. Newer firmware
+    // may have more profiles or longer ones; this build reads what it knows.
+    uint8_t active = payload[0];
+    uint8_t count = payload[1];
+    uint8_t stride = payload[2];
+    uint8_t readVersion = min(version, (uint8_t)SETTINGS_BLOB_VERSION);
+    if (stride < PROFILE_NAME_LENGTH + FieldsLength(readVersion, SETTING_PROFILE) ||
+        payloadLength != PROFILES_PREFIX_LENGTH + count * stride)
+    {
+        return false;
+    }
+
+    const uint8_t* p = payload + PROFILES_PREFIX_LENGTH;
+    for (uint8_t i = 0; i < count && i < PROFILE_COUNT; i++, p += stride)
+    {
+        memcpy(profiles[i].name, p, PROFILE_NAME_LENGTH);
+        profiles[i].name[PROFILE_NAME_LENGTH - 1] = '\0';
+        DecodeFields(p + PROFILE_NAME_LENGTH, readVersion, profiles[i].values, SETTING_PROFILE);
+    }
+    activeProfile = active < PROFILE_COUNT ? active : 0;
+    return true;
+}
+
+void SettingsManager::WriteBlob(const char* key, const uint8_t* blob, size_t length)
 {
+    // NVS replaces a blob by writing the new copy before erasing the old one, so a power cut
+    // part way through leaves one or the other, never a mix.
     preferences.begin(NVS_NAMESPACE, false); // read-write
+    size_t written = preferences.putBytes(key, blob, length);
+    preferences.end();
+
+    if (written != length)
+    {
+        LOG_ERROR("Settings: NVS write of %s failed.", key);
+    }
+}
+
+void SettingsManager::WriteSettingsBlob()
+{
+    uint8_t blob[BLOB_MAX_LENGTH];
+    uint8_t* end = EncodeFields(blob + BLOB_HEADER_LENGTH, settings, 0);
+    WriteBlob(SETTINGS_KEY, blob, FrameBlob(blob, SETTINGS_MAGIC, end - (blob + BLOB_HEADER_LENGTH)));
+}
+
+void SettingsManager::WriteProfilesBlob()
+{
+    uint8_t blob[BLOB_MAX_LENGTH];
+    uint8_t* payload = blob + BLOB_HEADER_LENGTH;
+    payload[0] = activeProfile;
+    payload[1] = PROFILE_COUNT;
+    payload[2] = PROFILE_NAME_LENGTH + FieldsLength(SETTINGS_BLOB_VERSION, SETTING_PROFILE);
 
-    preferences.putUChar("pwrMult",     settings.powerMultiplier);
-    preferences.putShort("legDnPwr",    settings.moveLegDnPower);
-    preferences.putShort("legUpPwr",    settings.moveLegUpPower);
-    preferences.putShort("tiltDnPwr",   settings.moveTiltDnPower);
-    preferences.putShort("tiltUpPwr",   settings.moveTiltUpPower);
-    preferences.putShort("23legPwr",    settings.twoToThreeLegPower);
-    preferences.putShort("23tiltPwr",   settings.twoToThreeTiltPower);
-    preferences.putShort("32legSlwPwr", settings.threeToTwoLegSlowPower);
-    preferences.putShort("32legFstPwr", settings.threeToTwoLegFastPower);
-    preferences.putShort("32tiltPwr",   settings.threeToTwoTiltPower);
-
-    preferences.putUShort("stanceInt",  settings.stanceInterval);
-    preferences.putUShort("showTimeInt", settings.showTimeInterval);
-    preferences.putULong("cmdTimeout",  settings.commandEnableTimeout);
-    preferences.putUShort("btnDebounce", settings.buttonDebounceTime);
-
-    preferences.putUShort("ph1Start",   settings.phase1Start);
-    preferences.putUShort("ph1End",     settings.phase1End);
-    preferences.putUShort("ph2Start",   settings.phase2Start);
+    uint8_t* p = payload + PROFILES_PREFIX_LENGTH;
+    for (uint8_t i = 0; i < PROFILE_COUNT; i++)
+    {
+        memset(p, 0, PROFILE_NAME_LENGTH);
+        strncpy((char*)p, profiles[i].name, PROFILE_NAME_LENGTH - 1);
+        p = EncodeFields(p + PROFILE_NAME_LENGTH, profiles[i].values, SETTING_PROFILE);
+    }
+    WriteBlob(PROFILES_KEY, blob, FrameBlob(blob, PROFILES_MAGIC, p - payload));
+}
+
+bool SettingsManager::LoadLegacyKeys()
+{
+    bool found = false;
+
+    preferences.begin(NVS_NAMESPACE, true); // read-only
+    for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+    {
+        const SettingDescriptor& d = SETTINGS_SCHEMA[i];
+        if (!preferences.isKey(d.key))
+        {
+            continue;
+        }
+        found = true;
 
+        int32_t value = 0;
+        switch (d.type)
+        {
+            case SETTING_U8:  value = preferences.getUChar(d.key); break;
+            case SETTING_I16: value = preferences.getShort(d.key); break;
+            case SETTING_U16: value = preferences.getUShort(d.key); break;
+            case SETTING_U32: value = (int32_t)preferences.getULong(d.key); break;
+        }
+        Set(settings, d, value);
+    }
     preferences.end();
 
-    pendingApply = true;
+    return found;
+}
+
+void SettingsManager::Load()
+{
+    unsigned long startUs = micros();
+
+    // Start with defaults so anything the blobs don't hold gets its default value
+    SetDefaults(settings);
+    SetProfileDefaults();
+
+    uint8_t settingsBlob[BLOB_MAX_LENGTH];
+    uint8_t profilesBlob[BLOB_MAX_LENGTH];
+    preferences.begin(NVS_NAMESPACE, true); // read-only
+    size_t settingsLength = preferences.getBytes(SETTINGS_KEY, settingsBlob, sizeof(settingsBlob));
+    size_t profilesLength = preferences.getBytes(PROFILES_KEY, profilesBlob, sizeof(profilesBlob));
+    preferences.end();
+
+    bool haveSettings = false;
+    bool writeSettings = false;
+    bool legacy = false;
+    uint8_t version = 0;
+    if (settingsLength > 0)
+    {
+        if (!DecodeSettings(settingsBlob, settingsLength, version))
+        {
+            SetDefaults(settings);
+            writeSettings = true;
+            LOG_WARN("Settings: stored settings are damaged, reset to defaults.");
+        }
+        else
+        {
+            haveSettings = true;
+            if (version < SETTINGS_BLOB_VERSION)
+            {
+                writeSettings = true;
+                LOG_INFO("Settings: upgraded from version %u.", (unsigned)version);
+            }
+            else if (version > SETTINGS_BLOB_VERSION)
+            {
+                LOG_WARN("Settings: saved by newer firmware (version %u), newer settings ignored.", (unsigned)version);
+            }
+        }
+    }
+    else if (LoadLegacyKeys())
+    {
+        // Settings from the one-key-per-setting layout move into the blob.
+        haveSettings = true;
+        writeSettings = true;
+        legacy = true;
+    }
+
+    bool writeProfiles = false;
+    if (profilesLength > 0 && DecodeProfiles(profilesBlob, profilesLength, version))
+    {
+        // The profile is the master copy of its values; the settings blob may lag behind it.
+        CopyProfileFields(settings, profiles[activeProfile].values);
+        writeProfiles = version < SETTINGS_BLOB_VERSION;
+    }
+    else
+    {
+        if (profilesLength > 0)
+        {
+            LOG_WARN("Settings: stored profiles are damaged, reset to defaults.");
+        }
+        SetProfileDefaults();
+        if (haveSettings)
+        {
+            // Tuning saved before there were profiles becomes the first profile.
+            CopyProfileFields(profiles[0].values, settings);
+        }
+        else
+        {
+            CopyProfileFields(settings, profiles[0].values);
+        }
+        writeProfiles = haveSettings || profilesLength > 0;
+    }
+
+    // Profiles first: they win over the settings blob if only one write makes it.
+    if (writeProfiles)
+    {
+        WriteProfilesBlob();
+    }
+    if (writeSettings)
+    {
+        WriteSettingsBlob();
+    }
+    if (legacy)
+    {
+        // Only once the blob is written, so an interrupted upgrade just runs again next boot.
+        preferences.begin(NVS_NAMESPACE, false); // read-write
+        for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+        {
+            preferences.remove(SETTINGS_SCHEMA[i].key);
+        }
+        preferences.end();
+        LOG_INFO("Settings: moved to single blob storage.");
+    }
+
+    stored = settings;
+    profilesDirty = false;
+    Prepare();
+
+    LOG_DEBUG("Settings loaded in %lu us.", (unsigned long)(micros() - startUs));
+}
+
+void SettingsManager::Save()
+{
+    // Edits to the profile settings belong to the active profile.
+    if (!SameSettings(settings, profiles[activeProfile].values, SETTING_PROFILE))
+    {
+        CopyProfileFields(profiles[activeProfile].values, settings);
+        profilesDirty = true;
+    }
+
+    if (profilesDirty)
+    {
+        WriteProfilesBlob();
+        profilesDirty = false;
+    }
+    if (!SameSettings(settings, stored, 0))
+    {
+        WriteSettingsBlob();
+        stored = settings;
+    }
+    saveDeferred = false;
+
+    Prepare();
 }
 
 void SettingsManager::ResetToDefaults()
@@ -100,8 +736,13 @@ void SettingsManager::ResetToDefaults()
     preferences.clear();
     preferences.end();
 
-    SetDefaults();
-    pendingApply = true;
+    SetDefaults(settings);
+    SetProfileDefaults();
+    CopyProfileFields(settings, profiles[0].values);
+    stored = settings;
+    profilesDirty = false;
+    saveDeferred = false;
+    Prepare();
 }
 
 #endif // USE_WAVESHARE_ESP32_LCD
@@ -4,6 +4,7 @@
 #define SETTINGS_H
 
 #include <Preferences.h>
+#include <stddef.h>
 
 struct ControllerSettings
 {
@@ -26,11 +27,121 @@ struct ControllerSettings
     uint16_t showTimeInterval;
     uint32_t commandEnableTimeout;
     uint16_t buttonDebounceTime;
+    uint8_t switchFilterTime;
 
     // ThreeToTwo phase timing (ShowTime tick counts)
     uint16_t phase1Start;
     uint16_t phase1End;
     uint16_t phase2Start;
+
+    // ThreeToTwo phase learning: on/off and how far from the hand-tuned timing (ShowTime ticks)
+    uint8_t phaseLearn;
+    uint8_t phaseLearnRange;
+
+    // Motor ramp time per full scale for each kind of move, and the S-curve jerk time (milliseconds)
+    uint16_t moveRampTime;
+    uint16_t twoToThreeRampTime;
+    uint16_t threeToTwoRampTime;
+    uint16_t rampJerkTime;
+
+    #ifdef USE_WAVESHARE_ESP32_S3_LCD
+        // Closed loop tilt: on/off, stance angles and slow zone (0.1 degree), minimum power (percent)
+        uint8_t tiltControl;
+        int16_t tiltUpAngle;
+        int16_t tiltDnAngle;
+        uint16_t tiltSlowZone;
+        uint8_t tiltMinPower;
+    #endif
+
+    // Motor telemetry polling (milliseconds)
+    uint16_t telemetryCurrentInterval;
+    uint16_t telemetrySlowInterval;
+
+    // Over-current cutoff (0.1 A units, 0 disables) and how long it must be exceeded (milliseconds)
+    uint16_t currentLimitM1;
+    uint16_t currentLimitM2;
+    uint16_t currentLimitWindow;
+
+    // Limit switch watchdog (milliseconds, 0 disables) and learned travel margin (percent, 0 disables)
+    uint16_t releaseTimeout;
+    uint16_t legTravelTimeout;
+    uint16_t tiltTravelTimeout;
+    uint8_t travelLearnMargin;
+
+    // Serial log verbosity (LogLevel), applied as soon as it is saved
+    uint8_t logLevel;
+};
+
+// How a ControllerSettings field is stored
+enum SettingType
+{
+    SETTING_U8 = 0,
+    SETTING_I16,
+    SETTING_U16,
+    SETTING_U32
+};
+
+// Sections of the settings page, in page order
+enum SettingGroup
+{
+    SETTING_GROUP_POWER_SCALE = 0,
+    SETTING_GROUP_MOTOR_POWER,
+    SETTING_GROUP_TWO_TO_THREE,
+    SETTING_GROUP_THREE_TO_TWO,
+    SETTING_GROUP_PHASE_TIMING,
+    SETTING_GROUP_RAMPING,
+    #ifdef USE_WAVESHARE_ESP32_S3_LCD
+        SETTING_GROUP_TILT_CONTROL,
+    #endif
+    SETTING_GROUP_OVER_CURRENT,
+    SETTING_GROUP_WATCHDOG,
+    SETTING_GROUP_LOG,
+    SETTING_GROUP_TIMING,
+    SETTING_GROUP_COUNT
+};
+
+// SettingDescriptor flags
+#define SETTING_SCALED_POWER 0x01   // Motor power, scaled by powerMultiplier when applied
+#define SETTING_PROFILE      0x02   // Kept separately for each tuning profile
+#define SETTING_LIVE         0x04   // Safe to change while the motors are moving
+#define SETTING_TRAVEL       0x08   // Changes how long a move takes
+
+#define PROFILE_NAME_LENGTH 16      // Including the terminator
+
+// Settings are kept in NVS as one blob: magic, version, payload length, the values and a CRC-32
+// of everything before it. The tuning profiles are a second blob framed the same way. Each value
+// takes its SettingType size, little endian. Version 1 holds every version 1 setting in schema
+// order and each later version appends the settings it added, so an older blob reads as the
+// start of the current one and the rest get defaults. Bump the version whenever a setting is
+// added.
+#define SETTINGS_BLOB_VERSION 5
+
+// One setting: where it lives in ControllerSettings, its key (the web form field, and the NVS
+// key older firmware saved it under), its default and range, and where it goes on the page.
+struct SettingDescriptor
+{
+    const char* key;
+    uint8_t type;           // SettingType
+    uint16_t offset;        // offsetof(ControllerSettings, field)
+    int32_t defaultValue;
+    int32_t minValue;
+    int32_t maxValue;
+    const char* label;
+    uint8_t group;          // SettingGroup
+    uint8_t flags;          // SETTING_* flags
+    uint8_t version;        // Blob version that added it
+};
+
+// Every setting, in page order. Loading, saving, the web page and range checks all work
+// from this table, so a new setting is a field in ControllerSettings and a row here.
+extern const SettingDescriptor SETTINGS_SCHEMA[];
+extern const uint8_t SETTINGS_SCHEMA_COUNT;
+
+// A named set of the SETTING_PROFILE settings, e.g. gentler powers for a demo
+struct TuningProfile
+{
+    char name[PROFILE_NAME_LENGTH];
+    ControllerSettings values;      // Only the SETTING_PROFILE fields are used
 };
 
 class SettingsManager
@@ -38,24 +149,111 @@ class SettingsManager
     public:
         SettingsManager();
 
-        // Load settings from NVS. If no saved settings exist, loads defaults.
+        // Load settings and profiles from NVS, one read each. Settings a blob doesn't have get
+        // their defaults and out of range values are clamped. A corrupt blob loads defaults;
+        // settings saved by older firmware, one NVS key each, are moved into the blob.
         void Load();
 
-        // Save current settings to NVS.
+        // Save current settings to NVS. Each blob is one write, so a save interrupted by a power
+        // cut never leaves a blob half old and half new. Unchanged blobs aren't written.
         void Save();
 
         // Reset settings to compiled defaults and save to NVS.
         void ResetToDefaults();
 
-        // The active settings.
-        ControllerSettings settings;
+        // Read a setting, or write it clamped to its range.
+        static int32_t Get(const ControllerSettings& s, const SettingDescriptor& d);
+        static void Set(ControllerSettings& s, const SettingDescriptor& d, int32_t value);
+
+        // Descriptor for an NVS key, or NULL.
+        static const SettingDescriptor* Find(const char* key);
+
+        // Heading for a SettingGroup on the settings page.
+        static const char* GroupTitle(uint8_t group);
+
+        static uint32_t Crc32(const uint8_t* data, size_t length);
+
+        // Switch tuning profile. Its values replace the profile settings and are applied like an
+        // edit from the settings page, but only in RAM: writing NVS holds up the loop, so the
+        // switch is saved by SaveDeferred() once the motors stop, or by the next Save().
+        // Returns false if there is no such profile.
+        bool SelectProfile(uint8_t index);
+
+        // Save what SelectProfile() left unsaved. Call while the motors are idle.
+        void SaveDeferred();
+        uint8_t ActiveProfile() const { return activeProfile; }
+
+        const char* ProfileName(uint8_t index) const;
+
+        // Rename a profile, keeping only characters that are safe in the settings page.
+        // Saved with the next Save().
+        void SetProfileName(uint8_t index, const char* name);
+
+        // Change a SETTING_PROFILE setting in one profile, clamped to its range, without
+        // switching to it. The settings being edited only change if it is the active profile.
+        // Saved with the next Save(). Returns false for an unknown profile or setting.
+        bool SetProfileValue(uint8_t index, const char* key, int32_t value);
+
+        // Hand saved changes to the control loop. Call between control ticks. While the motors
+        // are moving only SETTING_LIVE settings go out and the rest wait until they stop.
+        // Returns true if Live() changed.
+        bool Publish(bool moving);
+
+        // The settings the control loop runs with, motor powers scaled by powerMultiplier.
+        const ControllerSettings& Live() const { return *live; }
+
+        // True while saved changes are waiting to be published.
+        bool Pending() const { return pendingApply; }
 
-        // Flag indicating new settings need to be applied when motors are idle.
-        bool pendingApply;
+        // True if the last Publish() changed a SETTING_TRAVEL setting.
+        bool TravelChanged() const { return travelChanged; }
+
+        // The settings being edited. The SETTING_PROFILE fields are the active profile's.
+        ControllerSettings settings;
 
     private:
         Preferences preferences;
-        void SetDefaults();
+
+        // What NVS holds, so Save() can skip settings that haven't changed
+        ControllerSettings stored;
+
+        // Edits are scaled into shadow when saved, then copied into whichever buffer live
+        // doesn't point at and published by moving the pointer.
+        ControllerSettings shadow;
+        ControllerSettings buffers[2];
+        const ControllerSettings* live;
+        bool pendingApply;          // shadow differs from live
+        bool pendingLive;           // ...in a SETTING_LIVE setting
+        bool travelChanged;         // The last Publish() changed a SETTING_TRAVEL setting
+
+        TuningProfile profiles[PROFILE_COUNT];
+        uint8_t activeProfile;
+        bool profilesDirty;         // Profiles differ from what NVS holds
+        bool saveDeferred;          // SelectProfile() changed what NVS should hold
+
+        static void SetDefaults(ControllerSettings& s);
+        void SetProfileDefaults();
+        static void CopyProfileFields(ControllerSettings& to, const ControllerSettings& from);
+        void Prepare();
+
+        // Compare the settings that have all of requiredFlags.
+        static bool SameSettings(const ControllerSettings& a, const ControllerSettings& b, uint8_t requiredFlags);
+
+        // Blob payload for the settings that have all of requiredFlags, in blob layout order.
+        static uint16_t FieldsLength(uint8_t version, uint8_t requiredFlags);
+        static uint8_t* EncodeFields(uint8_t* p, const ControllerSettings& s, uint8_t requiredFlags);
+        static const uint8_t* DecodeFields(const uint8_t* p, uint8_t version, ControllerSettings& s, uint8_t requiredFlags);
+
+        // Fill in settings or profiles from a blob read from NVS. Returns false if it is damaged.
+        bool DecodeSettings(const uint8_t* blob, size_t length, uint8_t& version);
+        bool DecodeProfiles(const uint8_t* blob, size_t length, uint8_t& version);
+
+        // Read settings saved one key each. Returns false if there are none.
+        bool LoadLegacyKeys();
+
+        void WriteBlob(const char* key, const uint8_t* blob, size_t length);
+        void WriteSettingsBlob();
+        void WriteProfilesBlob();
 };
 
 #endif // SETTINGS_H
@@ -0,0 +1,218 @@
+#ifndef STANCE_H
+#define STANCE_H
+
+#include <stdint.h>
+
+// Variables to check R2 state for transitions
+enum StanceState
+{
+    STANCE_NO_TARGET = 0,
+    TWO_LEG_STANCE = 1,
+    THREE_LEG_STANCE = 2,
+    STANCE_ERROR_LEG_UP_TILT_UNKNOWN = 3,
+    STANCE_ERROR_LEG_UNKNOWN_TILT_UP = 4,
+    STANCE_ERROR_LEG_DOWN_TILT_UNKNOWN = 5,
+    STANCE_ERROR_LEG_UNKNOWN_TILT_DOWN = 6,
+    STANCE_ERROR_ALL_UNKNOWN = 7,
+    STANCE_ERROR_LEG_DOWN_TILT_UP = 8,
+    STANCE_ERROR_LEG_UP_TILT_DOWN = 9,
+    STANCE_ERROR_LEG_NO_RELEASE = 10,
+    STANCE_ERROR_LEG_STALL = 11,
+    STANCE_ERROR_TILT_NO_RELEASE = 12,
+    STANCE_ERROR_TILT_STALL = 13,
+    STANCE_COUNT
+};
+
+// Closed limit switches, one bit each. Switches are wired normally open, so closed reads LOW.
+#define SWITCH_LEG_UP   0x01
+#define SWITCH_LEG_DN   0x02
+#define SWITCH_TILT_UP  0x04
+#define SWITCH_TILT_DN  0x08
+
+// STANCE_TABLE entry for masks with both switches of one axis closed. That's a wiring fault
+// rather than a stance, so the last stance stands.
+#define STANCE_UNCHANGED 0xFF
+
+inline uint8_t SwitchMask(int legUp, int legDn, int tiltUp, int tiltDn)
+{
+    return (legUp == 0 ? SWITCH_LEG_UP : 0) | (legDn == 0 ? SWITCH_LEG_DN : 0) |
+           (tiltUp == 0 ? SWITCH_TILT_UP : 0) | (tiltDn == 0 ? SWITCH_TILT_DN : 0);
+}
+
+// Stance for each switch mask.
+constexpr uint8_t STANCE_TABLE[16] =
+{
+    STANCE_ERROR_ALL_UNKNOWN,               // ----  All 4 switches open, no idea where we are
+    STANCE_ERROR_LEG_UP_TILT_UNKNOWN,       // LU--  Body somewhere between straight and tilted
+    STANCE_ERROR_LEG_DOWN_TILT_UNKNOWN,     // LD--  Body somewhere between straight and 18 degrees
+    STANCE_UNCHANGED,
+    STANCE_ERROR_LEG_UNKNOWN_TILT_UP,       // --TU  Leg somewhere between up and down
+    TWO_LEG_STANCE,                         // LUTU
+    STANCE_ERROR_LEG_DOWN_TILT_UP,          // LDTU  Balanced on the center foot, about to fall over
+    STANCE_UNCHANGED,
+    STANCE_ERROR_LEG_UNKNOWN_TILT_DOWN,     // --TD  Leg somewhere between up and down
+    STANCE_ERROR_LEG_UP_TILT_DOWN,          // LUTD  Shouldn't be possible
+    THREE_LEG_STANCE,                       // LDTD
+    STANCE_UNCHANGED,
+    STANCE_UNCHANGED,
+    STANCE_UNCHANGED,
+    STANCE_UNCHANGED,
+    STANCE_UNCHANGED
+};
+
+// Shown on the display and the web page.
+constexpr const char* STANCE_NAMES[STANCE_COUNT] =
+{
+    "No Target",
+    "Two Legs.    ",
+    "Three Legs   ",
+    "Error - LUT?",
+    "Error - L?TU",
+    "Error - LDT?",
+    "Error - L?TD",
+    "Error - L?T?",
+    "Error - LDTU",
+    "Error - LUTD",
+    "Err L NoRel",
+    "Err L Stall",
+    "Err T NoRel",
+    "Err T Stall"
+};
+
+// What Move() does for a target and the current stance.
+enum StanceAction
+{
+    ACTION_NONE = 0,        // Leave the motors as they are
+    ACTION_STOP,            // Stop both motors
+    ACTION_THREE_TO_TWO,
+    ACTION_TWO_TO_THREE,
+    ACTION_LEG_UP,
+    ACTION_LEG_DN,
+    ACTION_TILT_UP,
+    ACTION_TILT_DN
+};
+
+#define STANCE_TARGET_COUNT 3   // STANCE_NO_TARGET, TWO_LEG_STANCE, THREE_LEG_STANCE
+
+/*
+    STANCE_ACTIONS
+
+    Indexed by [StanceTarget][currentStance]. Going where we already are, or anywhere when all
+    four switches are open, stops the motors. From the other good stance we run the full
+    transition. Where one axis is unknown but the other is already where the target wants it,
+    retrying that axis either finishes the move or leaves us no worse off, so we try. Where the
+    known axis is in the wrong place it's too risky and we stop. The remaining error stances
+    do nothing and wait for a command that can recover them.
+*/
+constexpr uint8_t STANCE_ACTIONS[STANCE_TARGET_COUNT][STANCE_COUNT] =
+{
+    // STANCE_NO_TARGET
+    {
+        ACTION_STOP, ACTION_STOP, ACTION_STOP, ACTION_STOP, ACTION_STOP, ACTION_STOP, ACTION_STOP,
+        ACTION_STOP, ACTION_STOP, ACTION_STOP, ACTION_STOP, ACTION_STOP, ACTION_STOP, ACTION_STOP
+    },
+    // TWO_LEG_STANCE
+    {
+        ACTION_NONE,            // STANCE_NO_TARGET
+        ACTION_STOP,            // TWO_LEG_STANCE
+        ACTION_THREE_TO_TWO,    // THREE_LEG_STANCE
+        ACTION_TILT_UP,         // LUT?  On two legs or already in a pile, can't hurt to tilt up
+        ACTION_LEG_UP,          // L?TU  Can't hurt to lift the leg again
+        ACTION_STOP,            // LDT?  Too risky
+        ACTION_STOP,            // L?TD  Too risky
+        ACTION_STOP,            // L?T?
+        ACTION_LEG_UP,          // LDTU
+        ACTION_NONE,            // LUTD
+        ACTION_NONE, ACTION_NONE, ACTION_NONE, ACTION_NONE
+    },
+    // THREE_LEG_STANCE
+    {
+        ACTION_NONE,            // STANCE_NO_TARGET
+        ACTION_TWO_TO_THREE,    // TWO_LEG_STANCE
+        ACTION_STOP,            // THREE_LEG_STANCE
+        ACTION_STOP,            // LUT?  Recover with the up command
+        ACTION_STOP,            // L?TU  Recover with the up command
+        ACTION_TILT_DN,         // LDT?  On three legs or a smoking mess, nothing to lose
+        ACTION_LEG_DN,          // L?TD  Nothing to lose
+        ACTION_STOP,            // L?T?
+        ACTION_NONE,            // LDTU
+        ACTION_NONE,            // LUTD
+        ACTION_NONE, ACTION_NONE, ACTION_NONE, ACTION_NONE
+    }
+};
+
+/*
+    Compile time checks
+
+    Every switch mask against every target, so a table edit that breaks one of the rules below
+    fails the build. These are C++11 constexpr functions (one return statement, recursion for
+    loops) so they build for the Pro Micro as well. That the tables still behave exactly as the
+    original CheckStance() and Move() did is checked by the simulator's sim/stance.
+*/
+namespace StanceCheck
+{
+    constexpr bool Closed(uint8_t mask, uint8_t bit) { return (mask & bit) != 0; }
+
+    // Exactly one switch of each axis closed is a proper stance, and a stance is only ever
+    // what the switches say.
+    constexpr bool StanceMatches(uint8_t mask)
+    {
+        return (Closed(mask, SWITCH_LEG_UP) && Closed(mask, SWITCH_LEG_DN)) ||
+               (Closed(mask, SWITCH_TILT_UP) && Closed(mask, SWITCH_TILT_DN))
+            ? STANCE_TABLE[mask] == STANCE_UNCHANGED
+            : mask == (SWITCH_LEG_UP | SWITCH_TILT_UP) ? STANCE_TABLE[mask] == TWO_LEG_STANCE
+            : mask == (SWITCH_LEG_DN | SWITCH_TILT_DN) ? STANCE_TABLE[mask] == THREE_LEG_STANCE
+            : mask == 0 ? STANCE_TABLE[mask] == STANCE_ERROR_ALL_UNKNOWN
+            : STANCE_TABLE[mask] > THREE_LEG_STANCE && STANCE_TABLE[mask] < STANCE_ERROR_LEG_NO_RELEASE;
+    }
+
+    // The action for a switch mask never moves a motor away from the target, only starts a
+    // full transition from the other good stance, and only retries one axis when the other is
+    // already where the target wants it.
+    constexpr bool ActionSafe(uint8_t target, uint8_t mask, uint8_t action)
+    {
+        return target == STANCE_NO_TARGET ? action == ACTION_STOP
+            : mask == 0 || STANCE_TABLE[mask] == target ? action == ACTION_STOP
+            : action == ACTION_THREE_TO_TWO
+                ? target == TWO_LEG_STANCE && STANCE_TABLE[mask] == THREE_LEG_STANCE
+            : action == ACTION_TWO_TO_THREE
+                ? target == THREE_LEG_STANCE && STANCE_TABLE[mask] == TWO_LEG_STANCE
+            : action == ACTION_TILT_UP
+                ? target == TWO_LEG_STANCE && Closed(mask, SWITCH_LEG_UP)
+            : action == ACTION_LEG_UP
+                ? target == TWO_LEG_STANCE && Closed(mask, SWITCH_TILT_UP)
+            : action == ACTION_TILT_DN
+                ? target == THREE_LEG_STANCE && Closed(mask, SWITCH_LEG_DN)
+            : action == ACTION_LEG_DN
+                ? target == THREE_LEG_STANCE && Closed(mask, SWITCH_TILT_DN)
+            : action == ACTION_STOP || action == ACTION_NONE;
+    }
+
+    constexpr bool MaskValid(uint8_t target, uint8_t mask)
+    {
+        return StanceMatches(mask) &&
+               (STANCE_TABLE[mask] == STANCE_UNCHANGED ||
+                ActionSafe(target, mask, STANCE_ACTIONS[target][STANCE_TABLE[mask]]));
+    }
+
+    constexpr bool AllValid(uint8_t target, uint8_t mask)
+    {
+        return target == STANCE_TARGET_COUNT ? true
+            : mask == 16 ? AllValid(target + 1, 0)
+            : MaskValid(target, mask) && AllValid(target, mask + 1);
+    }
+
+    // Latched motion faults never move anything.
+    constexpr bool FaultsHold(uint8_t target, uint8_t stance)
+    {
+        return target == STANCE_TARGET_COUNT ? true
+            : stance == STANCE_COUNT ? FaultsHold(target + 1, STANCE_ERROR_LEG_NO_RELEASE)
+            : (STANCE_ACTIONS[target][stance] == ACTION_NONE || STANCE_ACTIONS[target][stance] == ACTION_STOP) &&
+              FaultsHold(target, stance + 1);
+    }
+}
+
+static_assert(StanceCheck::AllValid(0, 0), "STANCE_TABLE or STANCE_ACTIONS breaks a stance rule");
+static_assert(StanceCheck::FaultsHold(0, STANCE_ERROR_LEG_NO_RELEASE), "A motion fault stance moves a motor");
+
+#endif // STANCE_H
@@ -0,0 +1,171 @@
+#include "config.h"
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#include "statusleds.h"
+
+StatusLeds::StatusLeds()
+    : effect(LED_SOLID), color(CRGB::Black), countdownEndMs(0), effectStartMs(0),
+      task(NULL), pulsePhase(0)
+{
+    portMUX_INITIALIZE(&lock);
+    for (int i = 0; i < NUM_LEDS; i++)
+    {
+        leds[i] = CRGB::Black;
+    }
+}
+
+void StatusLeds::Begin()
+{
+    FastLED.addLeds<WS2812, RGB_PIN, RGB>(leds, NUM_LEDS);
+    FastLED.setBrightness(100); // 0–255
+    FastLED.show();
+
+    xTaskCreate(LedTask, "leds", 2048, this, tskIDLE_PRIORITY + 1, &task);
+}
+
+void StatusLeds::Show(LedEffect newEffect, CRGB newColor, unsigned long newCountdownEndMs)
+{
+    portENTER_CRITICAL(&lock);
+    bool changed = newEffect != effect || newColor != color || newCountdownEndMs != countdownEndMs;
+    if (changed)
+    {
+        // Restart the animation only when the effect itself changes, so a new countdown
+        // doesn't make the pulse jump.
+        if (newEffect != effect)
+        {
+            effectStartMs = millis();
+        }
+        effect = newEffect;
+        color = newColor;
+        countdownEndMs = newCountdownEndMs;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (changed && task != NULL)
+    {
+        xTaskNotifyGive(task);
+    }
+}
+
+CRGB StatusLeds::Scale(CRGB c, uint8_t level)
+{
+    return CRGB((c.r * (level + 1)) >> 8, (c.g * (level + 1)) >> 8, (c.b * (level + 1)) >> 8);
+}
+
+bool StatusLeds::RenderFrame(LedEffect effect, CRGB color, unsigned long countdownEndMs,
+                             unsigned long elapsedMs, unsigned long nowMs, uint16_t frameMs, CRGB* frame)
+{
+    switch (effect)
+    {
+        case LED_PULSE:
+        {
+            uint32_t period = PULSE_PERIOD_MS;
+            if (countdownEndMs != 0)
+            {
+                long remaining = (long)(countdownEndMs - nowMs);
+                if (remaining <= 0)
+                {
+                    period = PULSE_FASTEST_MS;
+                }
+                else if (remaining < COUNTDOWN_MS)
+                {
+                    period = PULSE_FASTEST_MS + (uint32_t)(PULSE_PERIOD_MS - PULSE_FASTEST_MS) * remaining / COUNTDOWN_MS;
+                }
+            }
+            pulsePhase += (uint16_t)((65536UL * frameMs) / period);
+
+            // Triangle wave between DIM_LEVEL and full, squared so it looks even to the eye.
+            uint16_t triangle = pulsePhase < 32768 ? pulsePhase : 65535 - pulsePhase;
+            uint8_t level = (uint8_t)((uint32_t)triangle * triangle >> 22);
+            level = DIM_LEVEL + (uint8_t)((uint16_t)level * (255 - DIM_LEVEL) / 255);
+            for (int i = 0; i < NUM_LEDS; i++)
+            {
+                frame[i] = Scale(color, level);
+            }
+            return true;
+        }
+
+        case LED_CHASE:
+        {
+            // With a single LED the "chase" is a bright/dim step.
+            uint32_t step = elapsedMs / CHASE_STEP_MS;
+            int lit = NUM_LEDS > 1 ? step % NUM_LEDS : 0;
+            bool bright = NUM_LEDS > 1 || (step % 2) == 0;
+            for (int i = 0; i < NUM_LEDS; i++)
+            {
+                frame[i] = (i == lit && bright) ? color : Scale(color, DIM_LEVEL);
+            }
+            return true;
+        }
+
+        case LED_BLINK:
+        {
+            bool on = (elapsedMs / BLINK_PERIOD_MS) % 2 == 0;
+            for (int i = 0; i < NUM_LEDS; i++)
+            {
+                frame[i] = on ? color : CRGB(CRGB::Black);
+            }
+            return true;
+        }
+
+        case LED_SOLID:
+        default:
+            for (int i = 0; i < NUM_LEDS; i++)
+            {
+                frame[i] = color;
+            }
+            return false;
+    }
+}
+
+void StatusLeds::LedTask(void* param)
+{
+    StatusLeds* self = (StatusLeds*)param;
+    const TickType_t framePeriod = pdMS_TO_TICKS(1000 / LED_FPS);
+    TickType_t lastWake = xTaskGetTickCount();
+    bool animating = false;
+
+    for (;;)
+    {
+        // Steady frames wait for the next Show(); animations tick at the frame rate.
+        if (animating)
+        {
+            vTaskDelayUntil(&lastWake, framePeriod);
+            ulTaskNotifyTake(pdTRUE, 0);
+        }
+        else
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            lastWake = xTaskGetTickCount();
+        }
+
+        portENTER_CRITICAL(&self->lock);
+        LedEffect effect = self->effect;
+        CRGB color = self->color;
+        unsigned long countdownEndMs = self->countdownEndMs;
+        unsigned long effectStartMs = self->effectStartMs;
+        portEXIT_CRITICAL(&self->lock);
+
+        unsigned long now = millis();
+        CRGB frame[NUM_LEDS];
+        animating = self->RenderFrame(effect, color, countdownEndMs, now - effectStartMs, now,
+                                      1000 / LED_FPS, frame);
+
+        bool changed = false;
+        for (int i = 0; i < NUM_LEDS; i++)
+        {
+            if (frame[i] != self->leds[i])
+            {
+                self->leds[i] = frame[i];
+                changed = true;
+            }
+        }
+        if (changed)
+        {
+            FastLED.show();
+        }
+    }
+}
+
+#endif // USE_WAVESHARE_ESP32_LCD
@@ -0,0 +1,72 @@
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#ifndef STATUSLEDS_H
+#define STATUSLEDS_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// What the WS2812 status LEDs are doing
+enum LedEffect
+{
+    LED_SOLID = 0,      // Steady color
+    LED_PULSE,          // Breathing, faster as a countdown runs out
+    LED_CHASE,          // One bright LED stepping along the strip
+    LED_BLINK           // On/off
+};
+
+/*
+    Animated WS2812 status LEDs.
+
+    The control loop only picks an effect. A low priority task works out the frames at
+    LED_FPS and pushes a frame only when it differs from the last one. FastLED sends it
+    out through the RMT peripheral. While the effect is steady the task sleeps until the
+    effect changes.
+*/
+class StatusLeds
+{
+    public:
+        StatusLeds();
+
+        // Register the LEDs with FastLED and start the animation task.
+        void Begin();
+
+        // Change the effect. For LED_PULSE, countdownEndMs is the millis() at which the
+        // pulse should be at its fastest (0 for no countdown).
+        void Show(LedEffect effect, CRGB color, unsigned long countdownEndMs = 0);
+
+    private:
+        static const uint16_t PULSE_PERIOD_MS = 1600;
+        static const uint16_t PULSE_FASTEST_MS = 300;
+        static const uint16_t COUNTDOWN_MS = 5000;       // Pulse speeds up over the last 5 seconds
+        static const uint16_t CHASE_STEP_MS = 150;
+        static const uint16_t BLINK_PERIOD_MS = 500;
+        static const uint8_t DIM_LEVEL = 24;             // Unlit chase LEDs and the bottom of a pulse
+
+        CRGB leds[NUM_LEDS];
+
+        // Effect requested by Show(), guarded by lock
+        portMUX_TYPE lock;
+        LedEffect effect;
+        CRGB color;
+        unsigned long countdownEndMs;
+        unsigned long effectStartMs;
+        TaskHandle_t task;
+
+        // Pulse position, 0-65535 per cycle. Advanced a frame at a time so the pulse stays
+        // smooth while the countdown changes its speed. Only the task touches it.
+        uint16_t pulsePhase;
+
+        // Work out the next frame, frameMs after the previous one. Returns false if the
+        // frame won't change until the effect does.
+        bool RenderFrame(LedEffect effect, CRGB color, unsigned long countdownEndMs,
+                         unsigned long elapsedMs, unsigned long nowMs, uint16_t frameMs, CRGB* frame);
+
+        static CRGB Scale(CRGB color, uint8_t level);
+        static void LedTask(void* param);
+};
+
+#endif // STATUSLEDS_H
+#endif // USE_WAVESHARE_ESP32_LCD
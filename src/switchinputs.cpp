@@ -0,0 +1,157 @@
+#include "config.h"
+#include "switchinputs.h"
+#include "logger.h"
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+    #include "soc/gpio_reg.h"
+    #include "soc/soc.h"
+#endif
+
+SwitchInputs::SwitchInputs()
+    : inputCount(0), filterTime(0), raw(0), previousRaw(0), filtered(0), lastSampleMs(0)
+{
+    #ifndef USE_WAVESHARE_ESP32_LCD
+        portCount = 0;
+    #endif
+    for (uint8_t i = 0; i < SWITCH_INPUT_MAX; i++)
+    {
+        integrator[i] = 0;
+    }
+}
+
+void SwitchInputs::Begin(const uint8_t* pins, uint8_t count)
+{
+    inputCount = min(count, (uint8_t)SWITCH_INPUT_MAX);
+
+    for (uint8_t i = 0; i < inputCount; i++)
+    {
+        pinMode(pins[i], INPUT_PULLUP);
+
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            // All of the input pins on these boards are in the first GPIO input register.
+            if (pins[i] >= 32)
+            {
+                LOG_ERROR("Input pin %d is not in GPIO_IN_REG, ignored", pins[i]);
+                inputBit[i] = 0;
+                continue;
+            }
+            inputBit[i] = 1UL << pins[i];
+        #else
+            // Read each port once however many inputs share it.
+            volatile uint8_t* reg = portInputRegister(digitalPinToPort(pins[i]));
+            uint8_t port = 0;
+            while (port < portCount && portRegisters[port] != reg)
+            {
+                port++;
+            }
+            if (port == portCount)
+            {
+                portRegisters[portCount++] = reg;
+            }
+            inputPort[i] = port;
+            inputBit[i] = digitalPinToBitMask(pins[i]);
+        #endif
+    }
+
+    raw = ReadRaw();
+    previousRaw = raw;
+    filtered = raw;
+    lastSampleMs = millis();
+    SetFilterTime(filterTime);
+}
+
+void SwitchInputs::SetFilterTime(uint8_t ms)
+{
+    filterTime = ms;
+
+    // Start each integrator at the end matching its current level.
+    for (uint8_t i = 0; i < inputCount; i++)
+    {
+        integrator[i] = (filtered & (1 << i)) ? filterTime : 0;
+    }
+}
+
+uint8_t SwitchInputs::ReadRaw()
+{
+    uint8_t low = 0;
+
+    #ifdef USE_WAVESHARE_ESP32_LCD
+        uint32_t levels = REG_READ(GPIO_IN_REG);
+
+        for (uint8_t i = 0; i < inputCount; i++)
+        {
+            if (inputBit[i] != 0 && (levels & inputBit[i]) == 0)
+            {
+                low |= 1 << i;
+            }
+        }
+    #else
+        uint8_t ports[SWITCH_INPUT_MAX];
+        uint8_t oldSREG = SREG;
+        cli();
+        for (uint8_t p = 0; p < portCount; p++)
+        {
+            ports[p] = *portRegisters[p];
+        }
+        SREG = oldSREG;
+
+        for (uint8_t i = 0; i < inputCount; i++)
+        {
+            if ((ports[inputPort[i]] & inputBit[i]) == 0)
+            {
+                low |= 1 << i;
+            }
+        }
+    #endif
+
+    return low;
+}
+
+uint8_t SwitchInputs::Sample(uint32_t nowMs)
+{
+    raw = ReadRaw();
+
+    uint32_t elapsed = nowMs - lastSampleMs;
+    lastSampleMs = nowMs;
+
+    if (filterTime == 0)
+    {
+        previousRaw = raw;
+        filtered = raw;
+        return filtered;
+    }
+
+    // Passes within the same millisecond leave the integrators alone.
+    uint8_t step = elapsed >= filterTime ? filterTime : (uint8_t)elapsed;
+    if (step == 0)
+    {
+        return filtered;
+    }
+
+    // A long pass fills an integrator in one step, so a level also has to be seen twice running.
+    uint8_t steady = ~(raw ^ previousRaw);
+    previousRaw = raw;
+
+    for (uint8_t i = 0; i < inputCount; i++)
+    {
+        uint8_t bit = 1 << i;
+        if (raw & bit)
+        {
+            integrator[i] = (uint8_t)min((uint16_t)(integrator[i] + step), (uint16_t)filterTime);
+            if (integrator[i] == filterTime && (steady & bit))
+            {
+                filtered |= bit;
+            }
+        }
+        else
+        {
+            integrator[i] = integrator[i] > step ? integrator[i] - step : 0;
+            if (integrator[i] == 0 && (steady & bit))
+            {
+                filtered &= ~bit;
+            }
+        }
+    }
+
+    return filtered;
+}
@@ -0,0 +1,66 @@
+#ifndef SWITCHINPUTS_H
+#define SWITCHINPUTS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define SWITCH_INPUT_MAX 8
+
+/*
+    Samples the limit switches and remote inputs together and debounces them.
+
+    Every input is read from the GPIO input register in one go (on the Pro Micro, one read of
+    each port with interrupts off), so the whole set is a snapshot of a single instant. Each
+    input then goes through an integrator: a count that rises by the milliseconds since the
+    last sample while the input is low and falls while it's high. The filtered input only
+    changes once the count reaches the filter time or zero, so bounces shorter than that are
+    ignored, and only on a sample that reads the same as the one before it. A single pass can
+    take longer than the filter time (an NVS save, a web page), and without that one glitch
+    caught on the sample after it would get through. The result is one bitmask per loop pass
+    that everything reads.
+*/
+class SwitchInputs
+{
+    public:
+        SwitchInputs();
+
+        // Set up the pins (INPUT_PULLUP) and take the first sample unfiltered. Bit n of the mask
+        // is pins[n].
+        void Begin(const uint8_t* pins, uint8_t count);
+
+        // Milliseconds an input has to hold a new level before the filtered mask follows it.
+        // 0 passes the raw samples straight through.
+        void SetFilterTime(uint8_t ms);
+
+        // Sample every input and update the filtered mask. Call once per loop() pass.
+        uint8_t Sample(uint32_t nowMs);
+
+        // Inputs reading LOW (a closed switch), filtered and as last sampled.
+        uint8_t Low() const { return filtered; }
+        uint8_t RawLow() const { return raw; }
+
+        bool IsLow(uint8_t bit) const { return (filtered & bit) != 0; }
+
+    private:
+        uint8_t ReadRaw();
+
+        uint8_t inputCount;
+        uint8_t filterTime;
+        uint8_t raw;
+        uint8_t previousRaw;        // The sample before raw, a millisecond or more earlier
+        uint8_t filtered;
+        uint8_t integrator[SWITCH_INPUT_MAX];
+        uint32_t lastSampleMs;
+
+        #ifdef USE_WAVESHARE_ESP32_LCD
+            uint32_t inputBit[SWITCH_INPUT_MAX];
+        #else
+            // Each input's port (index into portRegisters) and bit in it
+            volatile uint8_t* portRegisters[SWITCH_INPUT_MAX];
+            uint8_t portCount;
+            uint8_t inputPort[SWITCH_INPUT_MAX];
+            uint8_t inputBit[SWITCH_INPUT_MAX];
+        #endif
+};
+
+#endif // SWITCHINPUTS_H
@@ -0,0 +1,206 @@
+#include "config.h"
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#include "tftcanvas.h"
+
+TftCanvas::TftCanvas(int16_t screenWidth, int16_t screenHeight)
+    : Adafruit_GFX(screenWidth, screenHeight), buffer(nullptr), bufferPixels(0)
+{
+    window.x = 0;
+    window.y = 0;
+    window.w = 0;
+    window.h = 0;
+}
+
+bool TftCanvas::begin(uint16_t stripRows)
+{
+    #ifdef BOARD_HAS_PSRAM
+        uint32_t screenPixels = (uint32_t)width() * height();
+        if (psramFound())
+        {
+            buffer = (uint16_t*)ps_malloc(screenPixels * sizeof(uint16_t));
+            if (buffer)
+            {
+                bufferPixels = screenPixels;
+                return true;
+            }
+        }
+    #endif
+
+    // No PSRAM: a band of full-width rows. Halve it until it fits.
+    for (uint16_t rows = stripRows; rows > 0; rows /= 2)
+    {
+        buffer = (uint16_t*)malloc((uint32_t)width() * rows * sizeof(uint16_t));
+        if (buffer)
+        {
+            bufferPixels = (uint32_t)width() * rows;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TftCanvas::setWindow(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    window.x = x;
+    window.y = y;
+    window.w = w;
+    window.h = h;
+}
+
+bool TftCanvas::intersects(int16_t x, int16_t y, int16_t w, int16_t h) const
+{
+    return x < window.x + window.w && window.x < x + w &&
+           y < window.y + window.h && window.y < y + h;
+}
+
+void TftCanvas::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+    x -= window.x;
+    y -= window.y;
+    if (x < 0 || y < 0 || x >= window.w || y >= window.h)
+    {
+        return;
+    }
+    buffer[(int32_t)y * window.w + x] = color;
+}
+
+void TftCanvas::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    // Clip to the window, then fill row by row.
+    int16_t x0 = max(x, window.x) - window.x;
+    int16_t y0 = max(y, window.y) - window.y;
+    int16_t x1 = min((int16_t)(x + w), (int16_t)(window.x + window.w)) - window.x;
+    int16_t y1 = min((int16_t)(y + h), (int16_t)(window.y + window.h)) - window.y;
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+
+    for (int16_t row = y0; row < y1; row++)
+    {
+        uint16_t* p = buffer + (int32_t)row * window.w + x0;
+        for (int16_t col = x0; col < x1; col++)
+        {
+            *p++ = color;
+        }
+    }
+}
+
+void TftCanvas::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+    fillRect(x, y, w, 1, color);
+}
+
+void TftCanvas::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+{
+    fillRect(x, y, 1, h, color);
+}
+
+void TftCanvas::fillScreen(uint16_t color)
+{
+    fillRect(window.x, window.y, window.w, window.h, color);
+}
+
+DirtyRegion::DirtyRegion(int16_t screenWidth, int16_t screenHeight)
+    : screenWidth(screenWidth), screenHeight(screenHeight), count(0)
+{
+}
+
+void DirtyRegion::add(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    // Clip to the screen.
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > screenWidth)  w = screenWidth - x;
+    if (y + h > screenHeight) h = screenHeight - y;
+    if (w <= 0 || h <= 0)
+    {
+        return;
+    }
+
+    ScreenRect r = { x, y, w, h };
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (touches(rects[i], r))
+        {
+            mergeInto(i, r);
+            return;
+        }
+    }
+
+    if (count < MAX_RECTS)
+    {
+        rects[count++] = r;
+        return;
+    }
+
+    // Full: grow whichever rectangle costs the fewest extra pixels.
+    uint8_t best = 0;
+    int32_t bestGrowth = INT32_MAX;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        int32_t growth = unionArea(rects[i], r) - (int32_t)rects[i].w * rects[i].h;
+        if (growth < bestGrowth)
+        {
+            bestGrowth = growth;
+            best = i;
+        }
+    }
+    mergeInto(best, r);
+}
+
+void DirtyRegion::addAll()
+{
+    rects[0].x = 0;
+    rects[0].y = 0;
+    rects[0].w = screenWidth;
+    rects[0].h = screenHeight;
+    count = 1;
+}
+
+void DirtyRegion::mergeInto(uint8_t index, const ScreenRect& r)
+{
+    ScreenRect& a = rects[index];
+    int16_t x0 = min(a.x, r.x);
+    int16_t y0 = min(a.y, r.y);
+    int16_t x1 = max((int16_t)(a.x + a.w), (int16_t)(r.x + r.w));
+    int16_t y1 = max((int16_t)(a.y + a.h), (int16_t)(r.y + r.h));
+    a.x = x0;
+    a.y = y0;
+    a.w = x1 - x0;
+    a.h = y1 - y0;
+
+    // The bigger rectangle may now touch others, fold them in too.
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (i != index && touches(rects[i], a))
+        {
+            ScreenRect other = rects[i];
+            rects[i] = rects[--count];
+            if (index == count)
+            {
+                index = i;
+            }
+            mergeInto(index, other);
+            return;
+        }
+    }
+}
+
+bool DirtyRegion::touches(const ScreenRect& a, const ScreenRect& b)
+{
+    return a.x <= b.x + b.w && b.x <= a.x + a.w &&
+           a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+int32_t DirtyRegion::unionArea(const ScreenRect& a, const ScreenRect& b)
+{
+    int32_t w = max(a.x + a.w, b.x + b.w) - min(a.x, b.x);
+    int32_t h = max(a.y + a.h, b.y + b.h) - min(a.y, b.y);
+    return w * h;
+}
+
+#endif // USE_WAVESHARE_ESP32_LCD
@@ -0,0 +1,96 @@
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#ifndef TFTCANVAS_H
+#define TFTCANVAS_H
+
+#include <Adafruit_GFX.h>
+
+// A rectangle in screen coordinates
+struct ScreenRect
+{
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+};
+
+/*
+    Off-screen RGB565 render target for the TFT.
+
+    It has the logical size of the whole screen so the drawing code keeps using screen
+    coordinates, but it only stores one window of it: the whole screen when there is PSRAM,
+    otherwise a band of rows. Pixels outside the window are dropped, so a region of the screen
+    is rendered by moving the window there and drawing everything.
+*/
+class TftCanvas : public Adafruit_GFX
+{
+    public:
+        TftCanvas(int16_t screenWidth, int16_t screenHeight);
+
+        // Allocate the pixel buffer: the whole screen in PSRAM if there is any, otherwise
+        // stripRows full-width rows of internal RAM. Returns false if nothing could be allocated.
+        bool begin(uint16_t stripRows);
+
+        // Move the window. w * h must not exceed capacity().
+        void setWindow(int16_t x, int16_t y, int16_t w, int16_t h);
+
+        // The part of the screen currently held.
+        const ScreenRect& getWindow() const { return window; }
+
+        // Whether a screen rectangle overlaps the window, so drawing it can be skipped.
+        bool intersects(int16_t x, int16_t y, int16_t w, int16_t h) const;
+
+        // Number of pixels the buffer holds.
+        uint32_t capacity() const { return bufferPixels; }
+
+        // Window pixels, row-major with a stride of the window width.
+        uint16_t* getBuffer() const { return buffer; }
+
+        void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+        void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+        void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+        void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+        void fillScreen(uint16_t color) override;
+
+    private:
+        uint16_t* buffer;
+        uint32_t bufferPixels;
+        ScreenRect window;
+};
+
+/*
+    Regions of the screen that have changed since the last push.
+
+    Overlapping or touching rectangles are merged as they are added. When the list is full
+    the new rectangle is merged into whichever existing one grows the least.
+*/
+class DirtyRegion
+{
+    public:
+        DirtyRegion(int16_t screenWidth, int16_t screenHeight);
+
+        // Mark a rectangle as changed. It is clipped to the screen.
+        void add(int16_t x, int16_t y, int16_t w, int16_t h);
+
+        // Mark the whole screen as changed.
+        void addAll();
+
+        void clear() { count = 0; }
+        uint8_t size() const { return count; }
+        const ScreenRect& get(uint8_t index) const { return rects[index]; }
+
+    private:
+        static const uint8_t MAX_RECTS = 8;
+
+        int16_t screenWidth;
+        int16_t screenHeight;
+        ScreenRect rects[MAX_RECTS];
+        uint8_t count;
+
+        void mergeInto(uint8_t index, const ScreenRect& r);
+        static bool touches(const ScreenRect& a, const ScreenRect& b);
+        static int32_t unionArea(const ScreenRect& a, const ScreenRect& b);
+};
+
+#endif // TFTCANVAS_H
+#endif // USE_WAVESHARE_ESP32_LCD
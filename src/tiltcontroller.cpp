@@ -0,0 +1,49 @@
+#include "config.h"
+
+#ifdef USE_WAVESHARE_ESP32_S3_LCD
+
+#include "tiltcontroller.h"
+
+// How far ahead the angle is projected at its current rate. About the motor's spin down
+// plus the fusion filter's lag.
+const float TiltController::LEAD_SECONDS = 0.1f;
+
+TiltController::TiltController()
+    : enabled(false), upAngleDeg(0.0f), downAngleDeg(0.0f), slowZoneDeg(0.0f), minFraction(1.0f)
+{
+}
+
+void TiltController::Configure(bool enable, float upAngle, float downAngle, float slowZone,
+                               uint8_t minPowerPercent)
+{
+    enabled = enable;
+    upAngleDeg = upAngle;
+    downAngleDeg = downAngle;
+    slowZoneDeg = slowZone;
+    minFraction = constrain(minPowerPercent, 0, 100) / 100.0f;
+}
+
+int TiltController::Power(int power, bool down, float angleDeg, float rateDps, bool valid) const
+{
+    if (!enabled || !valid || power == 0 || slowZoneDeg <= 0.0f || upAngleDeg == downAngleDeg)
+    {
+        return power;
+    }
+
+    // Degrees left to the target stance, positive while still short of it, whichever way
+    // round the IMU reads.
+    float target = down ? downAngleDeg : upAngleDeg;
+    float origin = down ? upAngleDeg : downAngleDeg;
+    float direction = target > origin ? 1.0f : -1.0f;
+    float remaining = (target - (angleDeg + rateDps * LEAD_SECONDS)) * direction;
+
+    float fraction = 1.0f;
+    if (remaining < slowZoneDeg)
+    {
+        fraction = remaining > 0.0f ? sqrtf(remaining / slowZoneDeg) : 0.0f;
+    }
+    fraction = max(fraction, minFraction);
+    return (int)(power * fraction);
+}
+
+#endif // USE_WAVESHARE_ESP32_S3_LCD
@@ -0,0 +1,45 @@
+#ifdef USE_WAVESHARE_ESP32_S3_LCD
+
+#ifndef TILTCONTROLLER_H
+#define TILTCONTROLLER_H
+
+#include <Arduino.h>
+
+/*
+    Slows the tilt motor as the body nears the stance it is heading for.
+
+    The tilt runs at its configured power through mid-travel. Once the fused IMU angle, led by
+    the current rate to make up for the motor and filter lag, is within the slow zone of the
+    target stance angle, the power falls off with the square root of the angle left to go, so
+    the body decelerates evenly onto the end stop, down to a floor that still carries it onto
+    the limit switch. The switch is what stops the motor; nothing here ever does. Without a
+    fresh angle the tilt runs open loop at its configured power, as before.
+*/
+class TiltController
+{
+    public:
+        TiltController();
+
+        // Body angle on two legs and on three, in degrees as the IMU reads them, the angle
+        // before each that the slowing starts, and the least power as a percent of the
+        // configured power. Disabled, Power() passes the configured power straight through.
+        void Configure(bool enabled, float upAngleDeg, float downAngleDeg, float slowZoneDeg,
+                       uint8_t minPowerPercent);
+
+        // Power for the tilt motor this pass. power is the configured power for this move, down
+        // whether it tilts toward three legs, whichever sign the motor wiring gives its power,
+        // and angleDeg and rateDps the fused tilt.
+        int Power(int power, bool down, float angleDeg, float rateDps, bool valid) const;
+
+    private:
+        static const float LEAD_SECONDS;
+
+        bool enabled;
+        float upAngleDeg;
+        float downAngleDeg;
+        float slowZoneDeg;
+        float minFraction;
+};
+
+#endif // TILTCONTROLLER_H
+#endif // USE_WAVESHARE_ESP32_S3_LCD
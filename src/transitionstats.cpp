@@ -0,0 +1,223 @@
+#include "config.h"
+
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#include "transitionstats.h"
+#include "stance.h"
+
+static const char* NVS_NAMESPACE = "r2d2stats";
+
+TransitionStats::TransitionStats()
+    : active(false), activeDirection(TRANSITION_TWO_TO_THREE), commandMs(0)
+{
+    for (uint8_t d = 0; d < TRANSITION_DIRECTION_COUNT; d++)
+    {
+        historyHead[d] = 0;
+        historyCount[d] = 0;
+        memset(&lifetime[d], 0, sizeof(lifetime[d]));
+    }
+}
+
+void TransitionStats::Begin()
+{
+    preferences.begin(NVS_NAMESPACE, true); // read-only
+    preferences.getBytes("life23", &lifetime[TRANSITION_TWO_TO_THREE], sizeof(TransitionLifetime));
+    preferences.getBytes("life32", &lifetime[TRANSITION_THREE_TO_TWO], sizeof(TransitionLifetime));
+    preferences.end();
+}
+
+void TransitionStats::CommandReceived(int target, int stance, uint32_t nowMs)
+{
+    // A new command always ends whatever was being timed.
+    Abort();
+
+    if (target == THREE_LEG_STANCE && stance == TWO_LEG_STANCE)
+    {
+        activeDirection = TRANSITION_TWO_TO_THREE;
+    }
+    else if (target == TWO_LEG_STANCE && stance == THREE_LEG_STANCE)
+    {
+        activeDirection = TRANSITION_THREE_TO_TWO;
+    }
+    else
+    {
+        // Recovery moves from error stances are not timed.
+        return;
+    }
+
+    for (uint8_t m = 0; m < MARK_COUNT; m++)
+    {
+        current.marks[m] = NOT_SEEN;
+    }
+    commandMs = nowMs;
+    active = true;
+}
+
+void TransitionStats::Mark(TransitionMark mark, uint32_t nowMs)
+{
+    if (!active || current.marks[mark] != NOT_SEEN)
+    {
+        return;
+    }
+
+    uint32_t elapsed = nowMs - commandMs;
+    current.marks[mark] = (elapsed < NOT_SEEN) ? elapsed : NOT_SEEN - 1;
+}
+
+void TransitionStats::SwitchSample(int legUp, int legDn, int tiltUp, int tiltDn, uint32_t nowMs)
+{
+    if (!active)
+    {
+        return;
+    }
+
+    if (nowMs - commandMs >= ABANDON_MS)
+    {
+        Abort();
+        return;
+    }
+
+    // Switches read LOW when closed.
+    if (activeDirection == TRANSITION_TWO_TO_THREE)
+    {
+        if (legUp == HIGH)  Mark(MARK_LEG_RELEASE, nowMs);
+        if (tiltUp == HIGH) Mark(MARK_TILT_RELEASE, nowMs);
+        if (legDn == LOW)   Mark(MARK_LEG_CLOSE, nowMs);
+        if (tiltDn == LOW)  Mark(MARK_TILT_CLOSE, nowMs);
+    }
+    else
+    {
+        if (legDn == HIGH)  Mark(MARK_LEG_RELEASE, nowMs);
+        if (tiltDn == HIGH) Mark(MARK_TILT_RELEASE, nowMs);
+        if (legUp == LOW)   Mark(MARK_LEG_CLOSE, nowMs);
+        if (tiltUp == LOW)  Mark(MARK_TILT_CLOSE, nowMs);
+    }
+}
+
+void TransitionStats::Complete(uint32_t nowMs)
+{
+    if (!active)
+    {
+        return;
+    }
+
+    Mark(MARK_COMPLETE, nowMs);
+    active = false;
+
+    TransitionDirection dir = activeDirection;
+    history[dir][historyHead[dir]] = current;
+    historyHead[dir] = (historyHead[dir] + 1) % HISTORY_LENGTH;
+    if (historyCount[dir] < HISTORY_LENGTH)
+    {
+        historyCount[dir]++;
+    }
+
+    uint16_t total = current.marks[MARK_COMPLETE];
+    TransitionLifetime& life = lifetime[dir];
+    if (life.count == 0 || total < life.bestMs)
+    {
+        life.bestMs = total;
+    }
+    if (total > life.worstMs)
+    {
+        life.worstMs = total;
+    }
+    life.count++;
+    life.totalMs += total;
+
+    MarkSummary recent = Summarize(dir, MARK_COMPLETE);
+    life.recentMeanMs = recent.mean;
+    life.recentP95Ms = recent.p95;
+
+    // One small NVS write per transition, made after the motors have stopped.
+    SaveLifetime(dir);
+}
+
+void TransitionStats::Abort()
+{
+    active = false;
+}
+
+uint16_t TransitionStats::LastMark(TransitionDirection dir, TransitionMark mark) const
+{
+    if (historyCount[dir] == 0)
+    {
+        return NOT_SEEN;
+    }
+    uint8_t last = (historyHead[dir] + HISTORY_LENGTH - 1) % HISTORY_LENGTH;
+    return history[dir][last].marks[mark];
+}
+
+MarkSummary TransitionStats::Summarize(TransitionDirection dir, TransitionMark mark) const
+{
+    MarkSummary summary;
+    memset(&summary, 0, sizeof(summary));
+
+    // Gather the valid samples, sorted with an insertion sort (at most HISTORY_LENGTH of them).
+    uint16_t values[HISTORY_LENGTH];
+    uint16_t n = 0;
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < historyCount[dir]; i++)
+    {
+        uint8_t index = (historyHead[dir] + HISTORY_LENGTH - 1 - i) % HISTORY_LENGTH;
+        uint16_t v = history[dir][index].marks[mark];
+        if (v == NOT_SEEN)
+        {
+            continue;
+        }
+        if (n == 0)
+        {
+            summary.last = v;
+        }
+        sum += v;
+
+        uint16_t j = n++;
+        while (j > 0 && values[j - 1] > v)
+        {
+            values[j] = values[j - 1];
+            j--;
+        }
+        values[j] = v;
+    }
+
+    summary.samples = n;
+    if (n > 0)
+    {
+        summary.mean = sum / n;
+        summary.p95 = values[((uint32_t)n * 95 + 99) / 100 - 1];
+        summary.best = values[0];
+        summary.worst = values[n - 1];
+    }
+    return summary;
+}
+
+const char* TransitionStats::MarkName(uint8_t mark)
+{
+    switch (mark)
+    {
+        case MARK_FIRST_MOTOR:  return "first_motor";
+        case MARK_LEG_RELEASE:  return "leg_release";
+        case MARK_TILT_RELEASE: return "tilt_release";
+        case MARK_PHASE1:       return "phase1";
+        case MARK_PHASE2:       return "phase2";
+        case MARK_LEG_CLOSE:    return "leg_close";
+        case MARK_TILT_CLOSE:   return "tilt_close";
+        case MARK_COMPLETE:     return "complete";
+        default:                return "unknown";
+    }
+}
+
+const char* TransitionStats::DirectionName(uint8_t dir)
+{
+    return (dir == TRANSITION_TWO_TO_THREE) ? "2to3" : "3to2";
+}
+
+void TransitionStats::SaveLifetime(TransitionDirection dir)
+{
+    preferences.begin(NVS_NAMESPACE, false); // read-write
+    preferences.putBytes((dir == TRANSITION_TWO_TO_THREE) ? "life23" : "life32",
+                         &lifetime[dir], sizeof(TransitionLifetime));
+    preferences.end();
+}
+
+#endif // USE_WAVESHARE_ESP32_LCD
@@ -0,0 +1,117 @@
+#ifdef USE_WAVESHARE_ESP32_LCD
+
+#ifndef TRANSITIONSTATS_H
+#define TRANSITIONSTATS_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Direction of a full stance transition
+enum TransitionDirection
+{
+    TRANSITION_TWO_TO_THREE = 0,
+    TRANSITION_THREE_TO_TWO,
+    TRANSITION_DIRECTION_COUNT
+};
+
+// Points in a transition that are timestamped, relative to command receipt
+enum TransitionMark
+{
+    MARK_FIRST_MOTOR = 0,   // First motor command from TwoToThree()/ThreeToTwo()
+    MARK_LEG_RELEASE,       // Origin leg limit switch opened
+    MARK_TILT_RELEASE,      // Origin tilt limit switch opened
+    MARK_PHASE1,            // 3->2 only: slow leg lift started
+    MARK_PHASE2,            // 3->2 only: fast leg lift started
+    MARK_LEG_CLOSE,         // Destination leg limit switch closed
+    MARK_TILT_CLOSE,        // Destination tilt limit switch closed
+    MARK_COMPLETE,          // loop() saw the target stance
+    MARK_COUNT
+};
+
+// Summary of one mark over the rolling history (milliseconds)
+struct MarkSummary
+{
+    uint16_t samples;
+    uint16_t last;
+    uint16_t mean;
+    uint16_t p95;
+    uint16_t best;
+    uint16_t worst;
+};
+
+// Lifetime totals kept in NVS, one per direction
+struct TransitionLifetime
+{
+    uint32_t count;
+    uint32_t totalMs;   // Sum of completion times, for the lifetime mean
+    uint16_t bestMs;
+    uint16_t worstMs;
+    uint16_t recentMeanMs;
+    uint16_t recentP95Ms;
+};
+
+class TransitionStats
+{
+    public:
+        // Marks not reached in a transition hold this value.
+        static const uint16_t NOT_SEEN = 0xFFFF;
+
+        TransitionStats();
+
+        // Load lifetime totals from NVS. Call from setup().
+        void Begin();
+
+        // A stance target was commanded. Starts timing if it is a full 2->3 or 3->2 transition.
+        void CommandReceived(int target, int stance, uint32_t nowMs);
+
+        // Record a mark the first time it happens in the active transition.
+        void Mark(TransitionMark mark, uint32_t nowMs);
+
+        // Feed the latest limit switch readings so releases and closes are timestamped.
+        void SwitchSample(int legUp, int legDn, int tiltUp, int tiltDn, uint32_t nowMs);
+
+        // The target stance was reached. Adds the transition to the history and NVS totals.
+        void Complete(uint32_t nowMs);
+
+        // The transition was stopped before completing (emergency stop, new command, timeout).
+        void Abort();
+
+        bool Active() const { return active; }
+        TransitionDirection Direction() const { return activeDirection; }
+
+        // A mark from the most recent completed transition, or NOT_SEEN.
+        uint16_t LastMark(TransitionDirection dir, TransitionMark mark) const;
+
+        // Summarize one mark over the rolling history.
+        MarkSummary Summarize(TransitionDirection dir, TransitionMark mark) const;
+
+        const TransitionLifetime& Lifetime(TransitionDirection dir) const { return lifetime[dir]; }
+
+        static const char* MarkName(uint8_t mark);
+        static const char* DirectionName(uint8_t dir);
+
+    private:
+        static const uint8_t HISTORY_LENGTH = 128;
+        static const uint32_t ABANDON_MS = 60000;   // Give up on a transition that never completes
+
+        struct TransitionRecord
+        {
+            uint16_t marks[MARK_COUNT];
+        };
+
+        TransitionRecord history[TRANSITION_DIRECTION_COUNT][HISTORY_LENGTH];
+        uint8_t historyHead[TRANSITION_DIRECTION_COUNT];
+        uint8_t historyCount[TRANSITION_DIRECTION_COUNT];
+        TransitionLifetime lifetime[TRANSITION_DIRECTION_COUNT];
+
+        bool active;
+        TransitionDirection activeDirection;
+        uint32_t commandMs;
+        TransitionRecord current;
+
+        Preferences preferences;
+        void SaveLifetime(TransitionDirection dir);
+};
+
+#endif // TRANSITIONSTATS_H
+#endif // USE_WAVESHARE_ESP32_LCD
@@ -3,6 +3,12 @@
 #ifdef USE_WAVESHARE_ESP32_LCD
 
 #include "webconfig.h"
+#include "eventlog.h"
+#include "profiler.h"
+#include "transitionstats.h"
+#include "phasetuner.h"
+#include "motortelemetry.h"
+#include "logger.h"
 
 // Access global state variables from remote_3-2-3.ino for status display
 extern int currentStance;
@@ -13,6 +19,10 @@ extern bool TiltMoving;
 extern bool enableRollCodeTransitions;
 extern int LegUp, LegDn, TiltUp, TiltDn;
 extern int webMoveActive;
+extern EventLog eventLog;
+extern TransitionStats transitionStats;
+extern PhaseTuner phaseTuner;
+extern MotorTelemetry telemetry;
 #ifdef USE_WAVESHARE_ESP32_S3_LCD
 extern float imuTiltAngleDeg;
 extern bool imuTiltValid;
@@ -27,16 +37,19 @@ void WebConfigServer::Begin()
 {
     WiFi.softAP(WIFI_AP_SSID, WIFI_AP_PASSWORD);
 
-    Serial.print("WiFi AP started. SSID: ");
-    Serial.println(WIFI_AP_SSID);
-    Serial.print("Config page: http://");
-    Serial.println(WiFi.softAPIP());
+    LOG_INFO("WiFi AP started. SSID: %s", WIFI_AP_SSID);
+    LOG_INFO("Config page: http://%s", WiFi.softAPIP().toString().c_str());
 
     server.on("/", HTTP_GET, [this]() { HandleRoot(); });
     server.on("/save", HTTP_POST, [this]() { HandleSave(); });
     server.on("/reset", HTTP_POST, [this]() { HandleReset(); });
     server.on("/status", HTTP_GET, [this]() { HandleStatus(); });
     server.on("/cmd", HTTP_POST, [this]() { HandleCommand(); });
+    server.on("/log", HTTP_GET, [this]() { HandleLog(); });
+    server.on("/metrics", HTTP_GET, [this]() { HandleMetrics(); });
+    server.on("/transitions", HTTP_GET, [this]() { HandleTransitions(); });
+    server.on("/settings", HTTP_GET, [this]() { HandleSettings(); });
+    server.on("/profile", HTTP_POST, [this]() { HandleProfile(); });
     server.begin();
 }
 
@@ -77,6 +90,8 @@ void WebConfigServer::SendHtmlHeader(const char* title)
         ".cmd-stop{background:#d32f2f;font-weight:bold;}"
         "#control-panel{margin-bottom:16px;}"
         "#control-panel h2{margin-top:0;}"
+        "#log-table td{font-family:monospace;font-size:0.85em;padding:1px 6px;}"
+        "#tr-table td,#tr-table th{font-size:0.85em;padding:1px 6px;text-align:right;}"
         "</style></head><body>"));
     server.sendContent(F("<h1>"));
     server.sendContent(title);
@@ -124,9 +139,12 @@ void WebConfigServer::HandleRoot()
         "<tr><td>Stance:</td><td id='st-stance'>--</td></tr>"
         "<tr><td>Target:</td><td id='st-target'>--</td></tr>"
         "<tr><td>Remote Armed:</td><td id='st-armed'>--</td></tr>"
+        "<tr><td>Profile:</td><td id='st-profile'>--</td></tr>"
         "<tr><td>Tilt Angle:</td><td id='st-tilt'>--</td></tr>"
         "<tr><td>Limit Switches:</td><td id='st-switches'>--</td></tr>"
         "<tr><td>Web Move:</td><td id='st-webmove'>--</td></tr>"
+        "<tr><td>Motor Current:</td><td id='st-current'>--</td></tr>"
+        "<tr><td>Battery / Temp:</td><td id='st-battery'>--</td></tr>"
         "</table>"
         "</div>"));
 
@@ -164,6 +182,7 @@ void WebConfigServer::HandleRoot()
         "var tgt={0:'None',1:'Two Legs',2:'Three Legs'};"
         "document.getElementById('st-target').textContent=tgt[d.target]||'Stance '+d.target;"
         "document.getElementById('st-armed').textContent=d.armed?'YES':'No';"
+        "document.getElementById('st-profile').textContent=d.profile;"
         "document.getElementById('st-tilt').textContent=d.tiltValid?(d.tiltDeg.toFixed(1)+' deg'):'--';"
         "var sw='';"
         "sw+='LegUp:'+(d.legUp?'<span class=sw-open>OPEN</span>':'<span class=sw-closed>CLOSED</span>');"
@@ -173,6 +192,9 @@ void WebConfigServer::HandleRoot()
         "document.getElementById('st-switches').innerHTML=sw;"
         "var wm={0:'None',1:'Leg Up',2:'Leg Down',3:'Tilt Up',4:'Tilt Down'};"
         "document.getElementById('st-webmove').textContent=wm[d.webMove]||'Unknown';"
+        "var a=(v,ok)=>ok?(v/10).toFixed(1):'--';"
+        "document.getElementById('st-current').textContent='Leg '+a(d.m1Current,d.m1Valid)+' A (peak '+(d.m1Peak/10).toFixed(1)+'), Tilt '+a(d.m2Current,d.m2Valid)+' A (peak '+(d.m2Peak/10).toFixed(1)+')';"
+        "document.getElementById('st-battery').textContent=a(d.battery,d.batteryValid)+' V (min '+(d.batteryMin/10).toFixed(1)+'), '+(d.tempValid?d.temp:'--')+' C (max '+d.tempMax+')';"
         // Update button enabled/disabled states
         // Leg up: disabled if leg is already up (LegUp switch closed = 0)
         "document.getElementById('btn-legup').disabled=d.moving||!d.legUp;"
@@ -190,50 +212,102 @@ void WebConfigServer::HandleRoot()
         "}).catch(()=>{});"
         "}"
         "poll();setInterval(poll,1000);"
+        "var logPage=0;"
+        "function loadLog(p){"
+        "if(p<0)return;"
+        "fetch('/log?page='+p).then(r=>r.json()).then(d=>{"
+        "logPage=p;"
+        "var h='<tr><th>#</th><th>Boot</th><th>Time (s)</th><th>Event</th><th>Code</th><th>Arg</th></tr>';"
+        "d.records.forEach(e=>{h+='<tr><td>'+e.seq+'</td><td>'+e.boot+'</td><td>'+(e.ms/1000).toFixed(1)+'</td><td>'+e.type+'</td><td>'+e.code+'</td><td>'+e.arg+'</td></tr>';});"
+        "document.getElementById('log-table').innerHTML=h;"
+        "document.getElementById('log-info').textContent='Page '+(p+1)+' of '+Math.max(1,Math.ceil(d.total/d.pageSize))+', '+d.total+' events, boot '+d.boot+(d.dropped?', '+d.dropped+' dropped':'');"
+        "}).catch(()=>{});"
+        "}"
         "</script>"));
 
-    server.sendContent(F("<p>Settings apply when motors are idle.</p>"
-        "<form method='POST' action='/save'>"));
-
-    WiFiClient client = server.client();
-    ControllerSettings& s = settingsMgr.settings;
-
-    // Global power multiplier
-    server.sendContent(F("<h2>Global Power Scale</h2><table>"));
-    SendNumberRow(client, "Power Multiplier (%)", "pwrMult", s.powerMultiplier, DEFAULT_POWER_MULTIPLIER, 0, 100);
-    server.sendContent(F("</table>"));
-
-    // Motor Power Settings
-    server.sendContent(F("<h2>Motor Power (-2047 to 2047)</h2><table>"));
-
-    SendNumberRow(client, "Leg Down",          "legDnPwr",    s.moveLegDnPower,         DEFAULT_MOVE_LEG_DN_POWER,           -2047, 2047);
-    SendNumberRow(client, "Leg Up",            "legUpPwr",    s.moveLegUpPower,         DEFAULT_MOVE_LEG_UP_POWER,           -2047, 2047);
-    SendNumberRow(client, "Tilt Down",         "tiltDnPwr",   s.moveTiltDnPower,        DEFAULT_MOVE_TILT_DN_POWER,          -2047, 2047);
-    SendNumberRow(client, "Tilt Up",           "tiltUpPwr",   s.moveTiltUpPower,        DEFAULT_MOVE_TILT_UP_POWER,          -2047, 2047);
-
-    server.sendContent(F("</table><h2>Transition: 2-Leg to 3-Leg</h2><table>"));
-
-    SendNumberRow(client, "Leg Power",         "23legPwr",    s.twoToThreeLegPower,     DEFAULT_TWO_TO_THREE_LEG_POWER,      -2047, 2047);
-    SendNumberRow(client, "Tilt Power",        "23tiltPwr",   s.twoToThreeTiltPower,    DEFAULT_TWO_TO_THREE_TILT_POWER,     -2047, 2047);
-
-    server.sendContent(F("</table><h2>Transition: 3-Leg to 2-Leg</h2><table>"));
+    // Transition timing analytics, refreshed every few seconds
+    server.sendContent(F(
+        "<h2>Transition Timing (ms from command)</h2>"
+        "<table id='tr-table'></table><div id='tr-life'></div>"
+        "<p><span id='tr-tune'></span> <button id='btn-revert' disabled "
+        "onclick=\"if(confirm('Put back the hand-tuned phase timing and stop learning?'))sendCmd('phaserevert')\">"
+        "Revert Learned Timing</button></p>"
+        "<script>"
+        "function loadTr(){"
+        "fetch('/transitions').then(r=>r.json()).then(d=>{"
+        "var h='<tr><th></th><th colspan=3>2&rarr;3</th><th colspan=3>3&rarr;2</th></tr>"
+        "<tr><th>Mark</th><th>last</th><th>mean</th><th>p95</th><th>last</th><th>mean</th><th>p95</th></tr>';"
+        "var f=m=>m.n?'<td>'+m.last+'</td><td>'+m.mean+'</td><td>'+m.p95+'</td>':'<td>-</td><td>-</td><td>-</td>';"
+        "d.dirs[0].marks.forEach((m,i)=>{h+='<tr><td>'+m.name+'</td>'+f(m)+f(d.dirs[1].marks[i])+'</tr>';});"
+        "document.getElementById('tr-table').innerHTML=h;"
+        "var l='';d.dirs.forEach(x=>{var a=x.lifetime;"
+        "l+=x.name+': '+a.count+' total, mean '+(a.count?Math.round(a.totalMs/a.count):'-')+', best '+a.best+', worst '+a.worst+'. ';});"
+        "document.getElementById('tr-life').textContent='Lifetime '+l;"
+        "var t=d.tuner,w=x=>x[0]+'-'+x[1]+', phase 2 '+x[2];"
+        "document.getElementById('tr-tune').textContent='Phase learning '+(t.learning?(t.settled?'settled':'on'):'off')+"
+        "': phase 1 '+w(t.window)+(t.handTuned?' (hand-tuned '+w(t.handTuned)+')':'')+"
+        "(t.last.result!='none'?'. Last 3->2 '+t.last.result+', '+t.last.ms+' ms, fell back '+t.last.fellBack+' deg, overshot '+t.last.overshoot+' deg':'')+'.';"
+        "document.getElementById('btn-revert').disabled=!t.handTuned;"
+        "}).catch(()=>{});"
+        "}"
+        "loadTr();setInterval(loadTr,5000);"
+        "</script>"));
 
-    SendNumberRow(client, "Leg Slow Power",    "32legSlwPwr", s.threeToTwoLegSlowPower, DEFAULT_THREE_TO_TWO_LEG_SLOW_POWER, -2047, 2047);
-    SendNumberRow(client, "Leg Fast Power",    "32legFstPwr", s.threeToTwoLegFastPower, DEFAULT_THREE_TO_TWO_LEG_FAST_POWER, -2047, 2047);
-    SendNumberRow(client, "Tilt Power",        "32tiltPwr",   s.threeToTwoTiltPower,    DEFAULT_THREE_TO_TWO_TILT_POWER,     -2047, 2047);
+    // Persistent event log viewer, newest first
+    server.sendContent(F(
+        "<h2>Event Log</h2>"
+        "<div><button onclick='loadLog(logPage-1)'>&larr; Newer</button>"
+        "<button onclick='loadLog(logPage+1)'>Older &rarr;</button>"
+        "<button onclick='loadLog(0)'>Refresh</button> <span id='log-info'></span></div>"
+        "<table id='log-table'></table>"
+        "<script>loadLog(0);</script>"));
+
+    // Tuning profile picker. The profile settings below belong to the selected profile.
+    server.sendContent(F("<h2>Tuning Profile</h2><form method='POST' action='/profile'><select name='profile'>"));
+    for (uint8_t p = 0; p < PROFILE_COUNT; p++)
+    {
+        String option = "<option value='";
+        option += p;
+        option += (p == settingsMgr.ActiveProfile()) ? "' selected>" : "'>";
+        option += settingsMgr.ProfileName(p);
+        option += "</option>";
+        server.sendContent(option);
+    }
+    server.sendContent(F("</select> <input type='submit' value='Switch'></form>"));
 
-    server.sendContent(F("</table><h2>3-to-2 Phase Timing (ShowTime ticks)</h2><table>"));
+    server.sendContent(F("<p>Over-current, watchdog, log, phase learning, enable timeout and debounce "
+        "settings apply at once; the rest wait until the motors are idle. Motor power, power multiplier, "
+        "phase timing and the stance and ShowTime intervals are saved to the selected profile.</p>"
+        "<form method='POST' action='/save'><table>"));
 
-    SendNumberRow(client, "Phase 1 Start",     "ph1Start",    s.phase1Start,            DEFAULT_PHASE1_START,                0, 100);
-    SendNumberRow(client, "Phase 1 End",       "ph1End",      s.phase1End,              DEFAULT_PHASE1_END,                  0, 100);
-    SendNumberRow(client, "Phase 2 Start",     "ph2Start",    s.phase2Start,            DEFAULT_PHASE2_START,                0, 100);
+    String nameRow = "<tr><td>Profile Name</td><td><input type='text' name='profileName' maxlength='";
+    nameRow += PROFILE_NAME_LENGTH - 1;
+    nameRow += "' value='";
+    nameRow += settingsMgr.ProfileName(settingsMgr.ActiveProfile());
+    nameRow += "'></td></tr></table>";
+    server.sendContent(nameRow);
 
-    server.sendContent(F("</table><h2>Timing (milliseconds)</h2><table>"));
+    WiFiClient client = server.client();
+    ControllerSettings& s = settingsMgr.settings;
 
-    SendNumberRow(client, "Stance Interval",       "stanceInt",  s.stanceInterval,       DEFAULT_STANCE_INTERVAL,        10, 1000);
-    SendNumberRow(client, "ShowTime Interval",     "showTimeInt", s.showTimeInterval,     DEFAULT_SHOWTIME_INTERVAL,      10, 1000);
-    SendNumberRow(client, "Command Enable Timeout", "cmdTimeout", s.commandEnableTimeout, DEFAULT_COMMAND_ENABLE_TIMEOUT, 1000, 120000);
-    SendNumberRow(client, "Button Debounce",       "btnDebounce", s.buttonDebounceTime,   DEFAULT_BUTTON_DEBOUNCE_TIME,   50, 500);
+    // One section per group, rows in schema order
+    uint8_t group = SETTING_GROUP_COUNT;
+    for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+    {
+        const SettingDescriptor& d = SETTINGS_SCHEMA[i];
+        if (d.group != group)
+        {
+            if (group != SETTING_GROUP_COUNT)
+            {
+                server.sendContent(F("</table>"));
+            }
+            group = d.group;
+            server.sendContent(F("<h2>"));
+            server.sendContent(SettingsManager::GroupTitle(group));
+            server.sendContent(F("</h2><table>"));
+        }
+        SendNumberRow(client, d.label, d.key, SettingsManager::Get(s, d), d.defaultValue, d.minValue, d.maxValue);
+    }
 
     server.sendContent(F("</table><br>"
         "<input type='submit' value='Save Settings' class='save'>"
@@ -269,6 +343,43 @@ void WebConfigServer::HandleStatus()
     json += TiltDn;
     json += ",\"webMove\":";
     json += webMoveActive;
+    json += ",\"m1Current\":";
+    json += telemetry.Value(TELEMETRY_CURRENT_M1);
+    json += ",\"m1Valid\":";
+    json += telemetry.Valid(TELEMETRY_CURRENT_M1) ? "true" : "false";
+    json += ",\"m1Peak\":";
+    json += telemetry.Peak(TELEMETRY_CURRENT_M1);
+    json += ",\"m2Current\":";
+    json += telemetry.Value(TELEMETRY_CURRENT_M2);
+    json += ",\"m2Valid\":";
+    json += telemetry.Valid(TELEMETRY_CURRENT_M2) ? "true" : "false";
+    json += ",\"m2Peak\":";
+    json += telemetry.Peak(TELEMETRY_CURRENT_M2);
+    json += ",\"battery\":";
+    json += telemetry.Value(TELEMETRY_BATTERY);
+    json += ",\"batteryValid\":";
+    json += telemetry.Valid(TELEMETRY_BATTERY) ? "true" : "false";
+    json += ",\"batteryMin\":";
+    json += telemetry.Peak(TELEMETRY_BATTERY);
+    json += ",\"temp\":";
+    json += telemetry.Value(TELEMETRY_TEMPERATURE);
+    json += ",\"tempValid\":";
+    json += telemetry.Valid(TELEMETRY_TEMPERATURE) ? "true" : "false";
+    json += ",\"tempMax\":";
+    json += telemetry.Peak(TELEMETRY_TEMPERATURE);
+    json += ",\"profile\":\"";
+    json += settingsMgr.ProfileName(settingsMgr.ActiveProfile());
+    json += "\"";
+    json += ",\"settingsPending\":";
+    json += settingsMgr.Pending() ? "true" : "false";
+    json += ",\"telemetryTimeouts\":";
+    json += telemetry.Timeouts();
+#ifdef ENABLE_SERIAL_LOG
+    json += ",\"logDropped\":";
+    json += logger.Dropped();
+    json += ",\"logSuppressed\":";
+    json += logger.Suppressed();
+#endif
 #ifdef USE_WAVESHARE_ESP32_S3_LCD
     json += ",\"tiltDeg\":";
     json += String(imuTiltAngleDeg, 1);
@@ -283,6 +394,239 @@ void WebConfigServer::HandleStatus()
     server.send(200, "application/json", json);
 }
 
+void WebConfigServer::HandleLog()
+{
+    // Page through the event log, newest first. /log?page=N
+    const uint32_t pageSize = 20;
+    uint32_t page = server.hasArg("page") ? server.arg("page").toInt() : 0;
+
+    EventRecord records[pageSize];
+    size_t n = eventLog.ReadNewest(page * pageSize, records, pageSize);
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+
+    String json = "{\"total\":";
+    json += eventLog.Count();
+    json += ",\"dropped\":";
+    json += eventLog.Dropped();
+    json += ",\"boot\":";
+    json += eventLog.BootCount();
+    json += ",\"page\":";
+    json += page;
+    json += ",\"pageSize\":";
+    json += pageSize;
+    json += ",\"records\":[";
+    server.sendContent(json);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        String row = (i > 0) ? ",{\"seq\":" : "{\"seq\":";
+        row += records[i].sequence;
+        row += ",\"boot\":";
+        row += records[i].bootCount;
+        row += ",\"ms\":";
+        row += records[i].timestampMs;
+        row += ",\"type\":\"";
+        row += EventLog::TypeName(records[i].type);
+        row += "\",\"code\":";
+        row += records[i].code;
+        row += ",\"arg\":";
+        row += records[i].arg;
+        row += "}";
+        server.sendContent(row);
+    }
+
+    server.sendContent("]}");
+}
+
+#ifdef ENABLE_LOOP_PROFILER
+// Print adapter that streams into the response in ~1KB chunks.
+class ChunkedResponsePrint : public Print
+{
+    public:
+        ChunkedResponsePrint(WebServer& server) : server(server) { chunk.reserve(1100); }
+        ~ChunkedResponsePrint() { Flush(); }
+
+        size_t write(uint8_t c) override
+        {
+            chunk += (char)c;
+            if (chunk.length() >= 1024)
+            {
+                Flush();
+            }
+            return 1;
+        }
+
+        void Flush()
+        {
+            if (chunk.length() > 0)
+            {
+                server.sendContent(chunk);
+                chunk = "";
+            }
+        }
+
+    private:
+        WebServer& server;
+        String chunk;
+};
+#endif
+
+void WebConfigServer::HandleMetrics()
+{
+    // Prometheus text exposition of the loop profiler
+#ifdef ENABLE_LOOP_PROFILER
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain; version=0.0.4", "");
+    ChunkedResponsePrint out(server);
+    loopProfiler.PrintMetrics(out);
+#else
+    server.send(404, "text/plain", "Loop profiler disabled in this build.\n");
+#endif
+}
+
+void WebConfigServer::HandleTransitions()
+{
+    // Rolling and lifetime transition timing for both directions
+    String json = "{\"active\":";
+    json += transitionStats.Active() ? "true" : "false";
+    json += ",\"dirs\":[";
+    for (uint8_t d = 0; d < TRANSITION_DIRECTION_COUNT; d++)
+    {
+        TransitionDirection dir = (TransitionDirection)d;
+        const TransitionLifetime& life = transitionStats.Lifetime(dir);
+
+        json += (d > 0) ? ",{\"name\":\"" : "{\"name\":\"";
+        json += TransitionStats::DirectionName(d);
+        json += "\",\"lifetime\":{\"count\":";
+        json += life.count;
+        json += ",\"totalMs\":";
+        json += life.totalMs;
+        json += ",\"best\":";
+        json += life.bestMs;
+        json += ",\"worst\":";
+        json += life.worstMs;
+        json += "},\"marks\":[";
+
+        for (uint8_t m = 0; m < MARK_COUNT; m++)
+        {
+            MarkSummary ms = transitionStats.Summarize(dir, (TransitionMark)m);
+            json += (m > 0) ? ",{\"name\":\"" : "{\"name\":\"";
+            json += TransitionStats::MarkName(m);
+            json += "\",\"n\":";
+            json += ms.samples;
+            json += ",\"last\":";
+            json += ms.last;
+            json += ",\"mean\":";
+            json += ms.mean;
+            json += ",\"p95\":";
+            json += ms.p95;
+            json += ",\"best\":";
+            json += ms.best;
+            json += ",\"worst\":";
+            json += ms.worst;
+            json += "}";
+        }
+        json += "]}";
+    }
+
+    // Phase learning, with the timing the active profile runs now
+    const ControllerSettings& s = settingsMgr.settings;
+    const PhaseRun& run = phaseTuner.LastRun();
+    json += "],\"tuner\":{\"learning\":";
+    json += phaseTuner.Learning() ? "true" : "false";
+    json += ",\"settled\":";
+    json += phaseTuner.Settled() ? "true" : "false";
+    json += ",\"window\":[";
+    json += s.phase1Start;
+    json += ",";
+    json += s.phase1End;
+    json += ",";
+    json += s.phase2Start;
+    json += "],\"handTuned\":";
+    if (phaseTuner.HasHandTuned())
+    {
+        const PhaseWindow& h = phaseTuner.HandTuned();
+        json += "[";
+        json += h.phase1Start;
+        json += ",";
+        json += h.phase1End;
+        json += ",";
+        json += h.phase2Start;
+        json += "]";
+    }
+    else
+    {
+        json += "null";
+    }
+    json += ",\"last\":{\"result\":\"";
+    json += PhaseTuner::ResultName(run.result);
+    json += "\",\"ms\":";
+    json += run.completeMs;
+    json += ",\"legRelease\":";
+    json += run.legReleaseMs;
+    json += ",\"tiltRelease\":";
+    json += run.tiltReleaseMs;
+    json += ",\"legClose\":";
+    json += run.legCloseMs;
+    json += ",\"tiltClose\":";
+    json += run.tiltCloseMs;
+    json += ",\"fellBack\":";
+    json += String(run.fellBackDeg, 1);
+    json += ",\"overshoot\":";
+    json += String(run.overshootDeg, 1);
+    json += "}}}";
+
+    server.send(200, "application/json", json);
+}
+
+void WebConfigServer::HandleSettings()
+{
+    // Every setting with its current value, default and range, from the settings schema
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    String head = "{\"profile\":";
+    head += settingsMgr.ActiveProfile();
+    head += ",\"profiles\":[";
+    for (uint8_t p = 0; p < PROFILE_COUNT; p++)
+    {
+        head += (p > 0) ? ",\"" : "\"";
+        head += settingsMgr.ProfileName(p);
+        head += "\"";
+    }
+    head += "],\"settings\":[";
+    server.sendContent(head);
+
+    const ControllerSettings& s = settingsMgr.settings;
+    for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+    {
+        const SettingDescriptor& d = SETTINGS_SCHEMA[i];
+        String row = (i > 0) ? ",{\"key\":\"" : "{\"key\":\"";
+        row += d.key;
+        row += "\",\"label\":\"";
+        row += d.label;
+        row += "\",\"group\":\"";
+        row += SettingsManager::GroupTitle(d.group);
+        row += "\",\"profile\":";
+        row += (d.flags & SETTING_PROFILE) ? "true" : "false";
+        row += ",\"live\":";
+        row += (d.flags & SETTING_LIVE) ? "true" : "false";
+        row += ",\"value\":";
+        row += SettingsManager::Get(s, d);
+        row += ",\"default\":";
+        row += d.defaultValue;
+        row += ",\"min\":";
+        row += d.minValue;
+        row += ",\"max\":";
+        row += d.maxValue;
+        row += "}";
+        server.sendContent(row);
+    }
+
+    server.sendContent("]}");
+}
+
 void WebConfigServer::HandleCommand()
 {
     if (!server.hasArg("cmd"))
@@ -301,6 +645,7 @@ void WebConfigServer::HandleCommand()
     else if (cmd == "twotothree") wc = WEB_CMD_TWO_TO_THREE;
     else if (cmd == "threetotwo") wc = WEB_CMD_THREE_TO_TWO;
     else if (cmd == "stop")     wc = WEB_CMD_EMERGENCY_STOP;
+    else if (cmd == "phaserevert") wc = WEB_CMD_PHASE_REVERT;
 
     if (wc == WEB_CMD_NONE)
     {
@@ -309,8 +654,7 @@ void WebConfigServer::HandleCommand()
     }
 
     pendingCommand = wc;
-    Serial.print("Web command received: ");
-    Serial.println(cmd);
+    LOG_INFO("Web command received: %s", cmd.c_str());
     server.send(200, "application/json", "{\"ok\":true}");
 }
 
@@ -318,34 +662,50 @@ void WebConfigServer::HandleSave()
 {
     ControllerSettings& s = settingsMgr.settings;
 
-    if (server.hasArg("pwrMult"))     s.powerMultiplier        = constrain(server.arg("pwrMult").toInt(), 0, 100);
-    if (server.hasArg("legDnPwr"))    s.moveLegDnPower         = server.arg("legDnPwr").toInt();
-    if (server.hasArg("legUpPwr"))    s.moveLegUpPower         = server.arg("legUpPwr").toInt();
-    if (server.hasArg("tiltDnPwr"))   s.moveTiltDnPower        = server.arg("tiltDnPwr").toInt();
-    if (server.hasArg("tiltUpPwr"))   s.moveTiltUpPower        = server.arg("tiltUpPwr").toInt();
-    if (server.hasArg("23legPwr"))    s.twoToThreeLegPower     = server.arg("23legPwr").toInt();
-    if (server.hasArg("23tiltPwr"))   s.twoToThreeTiltPower    = server.arg("23tiltPwr").toInt();
-    if (server.hasArg("32legSlwPwr")) s.threeToTwoLegSlowPower = server.arg("32legSlwPwr").toInt();
-    if (server.hasArg("32legFstPwr")) s.threeToTwoLegFastPower = server.arg("32legFstPwr").toInt();
-    if (server.hasArg("32tiltPwr"))   s.threeToTwoTiltPower    = server.arg("32tiltPwr").toInt();
-
-    if (server.hasArg("stanceInt"))   s.stanceInterval         = server.arg("stanceInt").toInt();
-    if (server.hasArg("showTimeInt")) s.showTimeInterval       = server.arg("showTimeInt").toInt();
-    if (server.hasArg("cmdTimeout"))  s.commandEnableTimeout   = server.arg("cmdTimeout").toInt();
-    if (server.hasArg("btnDebounce")) s.buttonDebounceTime     = server.arg("btnDebounce").toInt();
-
-    if (server.hasArg("ph1Start"))    s.phase1Start            = server.arg("ph1Start").toInt();
-    if (server.hasArg("ph1End"))      s.phase1End              = server.arg("ph1End").toInt();
-    if (server.hasArg("ph2Start"))    s.phase2Start            = server.arg("ph2Start").toInt();
+    // Every field is clamped to its schema range, whatever the form sent
+    for (uint8_t i = 0; i < SETTINGS_SCHEMA_COUNT; i++)
+    {
+        const SettingDescriptor& d = SETTINGS_SCHEMA[i];
+        if (server.hasArg(d.key))
+        {
+            SettingsManager::Set(s, d, server.arg(d.key).toInt());
+        }
+    }
+
+    if (server.hasArg("profileName"))
+    {
+        settingsMgr.SetProfileName(settingsMgr.ActiveProfile(), server.arg("profileName").c_str());
+    }
 
     settingsMgr.Save();
+    LOG_SET_LEVEL(s.logLevel);
 
-    Serial.println("Settings saved via web interface.");
+    LOG_INFO("Settings saved via web interface.");
 
     server.setContentLength(CONTENT_LENGTH_UNKNOWN);
     server.send(200, "text/html", "");
     SendHtmlHeader("Settings Saved");
-    server.sendContent(F("<p>Settings saved successfully. They will apply when motors are idle.</p>"
+    server.sendContent(F("<p>Settings saved successfully. Motion settings will apply when motors are idle.</p>"
+        "<p><a href='/'>Back to configuration</a></p>"));
+    SendHtmlFooter();
+}
+
+void WebConfigServer::HandleProfile()
+{
+    int index = server.hasArg("profile") ? server.arg("profile").toInt() : -1;
+    if (index < 0 || !settingsMgr.SelectProfile(index))
+    {
+        server.send(400, "text/plain", "Unknown profile");
+        return;
+    }
+    LOG_INFO("Tuning profile %s selected via web interface.", settingsMgr.ProfileName(index));
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/html", "");
+    SendHtmlHeader("Profile Selected");
+    server.sendContent(F("<p>Switched to profile "));
+    server.sendContent(settingsMgr.ProfileName(index));
+    server.sendContent(F(". It will apply when motors are idle.</p>"
         "<p><a href='/'>Back to configuration</a></p>"));
     SendHtmlFooter();
 }
@@ -353,8 +713,9 @@ void WebConfigServer::HandleSave()
 void WebConfigServer::HandleReset()
 {
     settingsMgr.ResetToDefaults();
+    LOG_SET_LEVEL(settingsMgr.settings.logLevel);
 
-    Serial.println("Settings reset to defaults via web interface.");
+    LOG_INFO("Settings reset to defaults via web interface.");
 
     server.setContentLength(CONTENT_LENGTH_UNKNOWN);
     server.send(200, "text/html", "");
@@ -17,7 +17,18 @@ enum WebCommand
     WEB_CMD_MOVE_TILT_DN,
     WEB_CMD_TWO_TO_THREE,
     WEB_CMD_THREE_TO_TWO,
-    WEB_CMD_EMERGENCY_STOP
+    WEB_CMD_EMERGENCY_STOP,
+    WEB_CMD_PHASE_REVERT
+};
+
+// Single motor move started from the web page, driven by loop() until its limit switch closes
+enum WebMoveActive
+{
+    WEB_MOVE_NONE = 0,
+    WEB_MOVE_LEG_UP,
+    WEB_MOVE_LEG_DN,
+    WEB_MOVE_TILT_UP,
+    WEB_MOVE_TILT_DN
 };
 
 class WebConfigServer
@@ -43,6 +54,11 @@ class WebConfigServer
         void HandleReset();
         void HandleStatus();
         void HandleCommand();
+        void HandleLog();
+        void HandleMetrics();
+        void HandleTransitions();
+        void HandleSettings();
+        void HandleProfile();
         void SendNumberRow(WiFiClient& client, const char* label, const char* name,
                            int value, int defaultValue, int minVal, int maxVal);
         void SendHtmlHeader(const char* title);
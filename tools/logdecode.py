@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""
+Decode the binary serial log (SERIAL_LOG_BINARY in config.h) back into text.
+
+The firmware sends a message ID (FNV-1a hash of the format string) and the raw arguments
+instead of formatted text. This script finds every LOG_* format string in the sources, hashes
+it the same way, and formats the records as the text logger would have. Plain text between
+records (command replies, the profiler dump) is passed through unchanged.
+
+    python3 tools/logdecode.py /dev/ttyACM0        # read a serial port (needs pyserial)
+    python3 tools/logdecode.py capture.bin         # decode a saved capture
+    python3 tools/logdecode.py - < capture.bin     # or stdin
+
+Run it against the same sources the firmware was built from.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+FRAME_SYNC = 0xA5
+FLAG_SUPPRESSED = 0x80
+LEVEL_TAGS = {0: "ERROR: ", 1: "WARN: "}
+
+# LOG_ERROR("..."), LOG_WARN, LOG_INFO, LOG_DEBUG and LOG_EVERY(level, ms, "..."). Adjacent
+# literals are joined like the compiler does.
+CALL_RE = re.compile(r'\bLOG_(?:ERROR|WARN|INFO|DEBUG|EVERY\s*\([^,]*,[^,]*)\s*[(,]\s*((?:"(?:[^"\\]|\\.)*"\s*)+)')
+LITERAL_RE = re.compile(r'"((?:[^"\\]|\\.)*)"')
+SPEC_RE = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z)?([diuxXcsfFeEgG%])')
+
+ESCAPES = {"n": "\n", "t": "\t", "r": "\r", "\\": "\\", '"': '"', "'": "'", "0": "\0"}
+
+
+def unescape(text):
+    return re.sub(r'\\(.)', lambda m: ESCAPES.get(m.group(1), m.group(1)), text)
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def build_table(src_dirs):
+    table = {}
+    for src in src_dirs:
+        for root, _, files in os.walk(src):
+            for name in files:
+                if not name.endswith((".h", ".cpp", ".ino")):
+                    continue
+                path = os.path.join(root, name)
+                with open(path, encoding="utf-8", errors="replace") as f:
+                    code = f.read()
+                for match in CALL_RE.finditer(code):
+                    fmt = "".join(unescape(s) for s in LITERAL_RE.findall(match.group(1)))
+                    msg_id = fnv1a(fmt.encode("utf-8"))
+                    if msg_id in table and table[msg_id] != fmt:
+                        print("warning: ID 0x%08x used by %r and %r" % (msg_id, table[msg_id], fmt),
+                              file=sys.stderr)
+                    table[msg_id] = fmt
+    return table
+
+
+def format_record(fmt, payload):
+    """Apply the record's arguments to its format string, the way vsnprintf would."""
+    pos = 0
+    out = []
+    last = 0
+    for spec in SPEC_RE.finditer(fmt):
+        out.append(fmt[last:spec.start()])
+        last = spec.end()
+        flags, _, conv = spec.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        try:
+            if conv == "s":
+                n = payload[pos]
+                value = payload[pos + 1:pos + 1 + n].decode("utf-8", "replace")
+                pos += 1 + n
+            else:
+                raw = payload[pos:pos + 4]
+                if len(raw) < 4:
+                    raise IndexError
+                pos += 4
+                if conv in "di":
+                    value = struct.unpack("<i", raw)[0]
+                elif conv == "c":
+                    value = chr(struct.unpack("<I", raw)[0] & 0xFF)
+                elif conv in "fFeEgG":
+                    value = struct.unpack("<f", raw)[0]
+                else:
+                    value = struct.unpack("<I", raw)[0]
+            out.append(("%" + flags + conv) % value)
+        except (IndexError, ValueError, TypeError):
+            out.append("<?>")
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+def decode(stream, table, write):
+    buf = bytearray()
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            break
+        buf += chunk
+
+        while buf:
+            if buf[0] != FRAME_SYNC:
+                # Pass text through up to the next record.
+                end = buf.find(bytes([FRAME_SYNC]))
+                text = buf if end < 0 else buf[:end]
+                write(text.decode("utf-8", "replace"))
+                del buf[:len(text)]
+                continue
+            if len(buf) < 2 or len(buf) < 2 + buf[1]:
+                break
+            frame = bytes(buf[2:2 + buf[1]])
+            del buf[:2 + buf[1]]
+
+            if len(frame) < 5:
+                write("<short log record>\n")
+                continue
+            level = frame[0] & 0x7F
+            msg_id = struct.unpack("<I", frame[1:5])[0]
+            payload = frame[5:]
+            suppressed = 0
+            if frame[0] & FLAG_SUPPRESSED:
+                suppressed = struct.unpack("<H", payload[:2])[0]
+                payload = payload[2:]
+
+            fmt = table.get(msg_id)
+            if fmt is None:
+                line = "<unknown message 0x%08x: %s>" % (msg_id, payload.hex())
+            else:
+                line = format_record(fmt, payload)
+            if suppressed:
+                line += " (+%d)" % suppressed
+            write(LEVEL_TAGS.get(level, "") + line + "\n")
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("input", help="serial port, capture file, or - for stdin")
+    parser.add_argument("--src", action="append",
+                        help="source directory to read format strings from (default: ../src)")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    table = build_table(args.src or [os.path.join(here, "..", "src")])
+
+    if args.input == "-":
+        stream = sys.stdin.buffer
+    elif os.path.isfile(args.input):
+        stream = open(args.input, "rb")
+    else:
+        import serial  # pyserial
+        stream = serial.Serial(args.input, args.baud)
+
+    def write(text):
+        sys.stdout.write(text)
+        sys.stdout.flush()
+
+    try:
+        decode(stream, table, write)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()